@@ -38,11 +38,13 @@ public:
     page_renderer_private()
         : paper_color(0xffffffff)
         , hints(0)
+        , threads(1)
     {
     }
 
     argb paper_color;
     unsigned int hints;
+    int threads;
 };
 
 
@@ -136,6 +138,35 @@ void page_renderer::set_render_hints(unsigned int hints)
     d->hints = hints;
 }
 
+/**
+ The number of threads each page is rendered with.
+
+ By default pages are rendered with one thread.
+
+ \returns the number of render threads
+
+ \since 0.34
+ */
+int page_renderer::render_threads() const
+{
+    return d->threads;
+}
+
+/**
+ Set the number of threads each page is rendered with.
+
+ The page is split in horizontal bands which are rendered in parallel;
+ the resulting image is the same as with one thread.
+
+ \param threads the number of render threads
+
+ \since 0.34
+ */
+void page_renderer::set_render_threads(int threads)
+{
+    d->threads = threads < 1 ? 1 : threads;
+}
+
 /**
  Render the specified page.
 
@@ -176,6 +207,7 @@ image page_renderer::render_page(const page *p,
     splashOutputDev.setFontAntialias(d->hints & text_antialiasing ? gTrue : gFalse);
     splashOutputDev.setVectorAntialias(d->hints & antialiasing ? gTrue : gFalse);
     splashOutputDev.setFreeTypeHinting(d->hints & text_hinting ? gTrue : gFalse, gFalse);
+    splashOutputDev.setRasterThreads(d->threads);
     splashOutputDev.startDoc(pdfdoc);
     pdfdoc->displayPageSlice(&splashOutputDev, pp->index + 1,
                              xres, yres, int(rotate) * 90,
@@ -49,6 +49,9 @@ public:
     void set_render_hint(render_hint hint, bool on = true);
     void set_render_hints(unsigned int hints);
 
+    int render_threads() const;
+    void set_render_threads(int threads);
+
     image render_page(const page *p,
                       double xres = 72.0, double yres = 72.0,
                       int x = -1, int y = -1, int w = -1, int h = -1,
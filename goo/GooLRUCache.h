@@ -0,0 +1,194 @@
+//========================================================================
+//
+// GooLRUCache.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef GOOLRUCACHE_H
+#define GOOLRUCACHE_H
+
+#include <map>
+#include "gtypes.h"
+
+//------------------------------------------------------------------------
+// GooLRUCache
+//------------------------------------------------------------------------
+
+// LRU cache of <Value>s, looked up by <Key> (which must be copyable
+// and ordered by operator<) and bounded by the memory charged for the
+// cached values.  The cache owns the values and deletes them when they
+// are evicted, so values which are shared with other owners should
+// release their reference in their destructor.  It does no locking of
+// its own.
+template <class Key, class Value>
+class GooLRUCache {
+public:
+
+  GooLRUCache(Goffset maxBytesA);
+  ~GooLRUCache();
+
+  // Return the value cached under <key> and make it the most recently
+  // used one, or return NULL if there is none.  The value stays owned
+  // by the cache.
+  Value *lookup(const Key &key);
+
+  // Add <value> under <key>, charging <size> bytes for it, replacing
+  // the value cached under <key> if there is one, and evicting the
+  // least recently used values if the memory budget is exceeded.  If
+  // <value> alone is bigger than the budget, it is deleted and put
+  // returns false.
+  GBool put(const Key &key, Value *value, Goffset size);
+
+  // Drop the value cached under <key>, if any.
+  void remove(const Key &key);
+
+  // Drop all the values.
+  void clear();
+
+  // Set the memory budget, evicting values if needed.  A budget of 0
+  // turns the cache off.
+  void setMaxBytes(Goffset maxBytesA);
+  Goffset getMaxBytes() { return maxBytes; }
+
+  // Memory charged for the cached values.
+  Goffset getBytes() { return bytes; }
+
+private:
+
+  struct Entry {
+    Key key;
+    Value *value;
+    Goffset size;
+    Entry *prev, *next;		// LRU list, most recently used first
+  };
+
+  GooLRUCache(const GooLRUCache &);			// not allowed
+  GooLRUCache &operator=(const GooLRUCache &);	// not allowed
+
+  void unlink(Entry *entry);
+  void pushFront(Entry *entry);
+  void evict(Entry *entry);
+  void shrink();
+
+  std::map<Key, Entry *> index;
+  Entry *head, *tail;
+  Goffset bytes;		// memory charged for the cached values
+  Goffset maxBytes;		// memory budget
+};
+
+template <class Key, class Value>
+GooLRUCache<Key, Value>::GooLRUCache(Goffset maxBytesA) {
+  head = tail = NULL;
+  bytes = 0;
+  maxBytes = maxBytesA;
+}
+
+template <class Key, class Value>
+GooLRUCache<Key, Value>::~GooLRUCache() {
+  clear();
+}
+
+template <class Key, class Value>
+Value *GooLRUCache<Key, Value>::lookup(const Key &key) {
+  typename std::map<Key, Entry *>::iterator it;
+  Entry *entry;
+
+  if ((it = index.find(key)) == index.end()) {
+    return NULL;
+  }
+  entry = it->second;
+  if (entry != head) {
+    unlink(entry);
+    pushFront(entry);
+  }
+  return entry->value;
+}
+
+template <class Key, class Value>
+GBool GooLRUCache<Key, Value>::put(const Key &key, Value *value,
+				   Goffset size) {
+  Entry *entry;
+
+  remove(key);
+  if (size > maxBytes) {
+    delete value;
+    return gFalse;
+  }
+  entry = new Entry;
+  entry->key = key;
+  entry->value = value;
+  entry->size = size;
+  pushFront(entry);
+  index[key] = entry;
+  bytes += size;
+  shrink();
+  return gTrue;
+}
+
+template <class Key, class Value>
+void GooLRUCache<Key, Value>::remove(const Key &key) {
+  typename std::map<Key, Entry *>::iterator it;
+
+  if ((it = index.find(key)) != index.end()) {
+    evict(it->second);
+  }
+}
+
+template <class Key, class Value>
+void GooLRUCache<Key, Value>::clear() {
+  while (tail) {
+    evict(tail);
+  }
+}
+
+template <class Key, class Value>
+void GooLRUCache<Key, Value>::setMaxBytes(Goffset maxBytesA) {
+  maxBytes = maxBytesA;
+  shrink();
+}
+
+template <class Key, class Value>
+void GooLRUCache<Key, Value>::unlink(Entry *entry) {
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+  } else {
+    head = entry->next;
+  }
+  if (entry->next) {
+    entry->next->prev = entry->prev;
+  } else {
+    tail = entry->prev;
+  }
+}
+
+template <class Key, class Value>
+void GooLRUCache<Key, Value>::pushFront(Entry *entry) {
+  entry->prev = NULL;
+  entry->next = head;
+  if (head) {
+    head->prev = entry;
+  } else {
+    tail = entry;
+  }
+  head = entry;
+}
+
+template <class Key, class Value>
+void GooLRUCache<Key, Value>::evict(Entry *entry) {
+  unlink(entry);
+  index.erase(entry->key);
+  bytes -= entry->size;
+  delete entry->value;
+  delete entry;
+}
+
+template <class Key, class Value>
+void GooLRUCache<Key, Value>::shrink() {
+  while (tail && bytes > maxBytes) {
+    evict(tail);
+  }
+}
+
+#endif
@@ -40,6 +40,11 @@
 // gUnlockMutex(&m);
 // ...
 // gDestroyMutex(&m);
+//
+// A structure built by one thread can be handed to others without a
+// lock by storing the pointer to it with gStorePtrRelease and reading
+// it with gLoadPtrAcquire: a thread which sees the pointer also sees
+// everything written to the structure before it was stored.
 
 #ifdef _WIN32
 #ifndef NOMINMAX
@@ -54,6 +59,16 @@ typedef CRITICAL_SECTION GooMutex;
 #define gLockMutex(m) EnterCriticalSection(m)
 #define gUnlockMutex(m) LeaveCriticalSection(m)
 
+template <class T> inline T *gLoadPtrAcquire(T * volatile *p) {
+  T *v = *p;
+  MemoryBarrier();
+  return v;
+}
+template <class T> inline void gStorePtrRelease(T * volatile *p, T *v) {
+  MemoryBarrier();
+  *p = v;
+}
+
 #else // assume pthreads
 
 #include <pthread.h>
@@ -71,6 +86,13 @@ inline void gInitMutex(GooMutex *m) {
 #define gLockMutex(m) pthread_mutex_lock(m)
 #define gUnlockMutex(m) pthread_mutex_unlock(m)
 
+template <class T> inline T *gLoadPtrAcquire(T * volatile *p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+template <class T> inline void gStorePtrRelease(T * volatile *p, T *v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
 #endif
 
 class MutexLocker {
@@ -0,0 +1,183 @@
+//========================================================================
+//
+// GooThreadPool.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include "gmem.h"
+#include "GooThreadPool.h"
+
+// upper limit on the number of threads in the shared pool
+#define gooThreadPoolMaxThreads 16
+
+static GooThreadPool *sharedPool = NULL;
+
+#if GOO_THREAD_POOL_PTHREADS
+
+static pthread_once_t sharedPoolOnce = PTHREAD_ONCE_INIT;
+
+// set (non-NULL) on threads which are running jobs, to catch nested
+// batches
+static pthread_key_t inJobKey;
+
+GooThreadPool *GooThreadPool::get() {
+  pthread_once(&sharedPoolOnce, &GooThreadPool::init);
+  return sharedPool;
+}
+
+void GooThreadPool::init() {
+  pthread_key_create(&inJobKey, NULL);
+  sharedPool = new GooThreadPool();
+}
+
+GooThreadPool::GooThreadPool() {
+  pthread_mutex_init(&runMutex, NULL);
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&workCond, NULL);
+  pthread_cond_init(&doneCond, NULL);
+  func = NULL;
+  data = NULL;
+  nJobs = nextJob = nDone = 0;
+  nWorkers = nWorking = 0;
+
+  // the calling thread is one of the nThreads; workers are started by
+  // run()
+  nThreads = 1;
+  threads = (pthread_t *)gmallocn(gooThreadPoolMaxThreads - 1,
+				  sizeof(pthread_t));
+}
+
+// The shared pool lives as long as the process, so its threads are
+// never stopped.
+GooThreadPool::~GooThreadPool() {
+  gfree(threads);
+}
+
+void *GooThreadPool::workerMain(void *arg) {
+  GooThreadPool *pool = (GooThreadPool *)arg;
+
+  pthread_setspecific(inJobKey, pool);
+  pthread_mutex_lock(&pool->mutex);
+  while (1) {
+    while (pool->nextJob >= pool->nJobs ||
+	   pool->nWorking >= pool->nWorkers) {
+      pthread_cond_wait(&pool->workCond, &pool->mutex);
+    }
+    ++pool->nWorking;
+    pool->runJobs();
+    --pool->nWorking;
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+// Run jobs from the current batch until there are none left to hand
+// out.  Called, and returns, with mutex locked.
+void GooThreadPool::runJobs() {
+  GooThreadPoolFunc jobFunc;
+  void *jobData;
+  int idx;
+
+  while (nextJob < nJobs) {
+    idx = nextJob++;
+    jobFunc = func;
+    jobData = data;
+    pthread_mutex_unlock(&mutex);
+    (*jobFunc)(jobData, idx);
+    pthread_mutex_lock(&mutex);
+    if (++nDone == nJobs) {
+      pthread_cond_signal(&doneCond);
+    }
+  }
+}
+
+void GooThreadPool::run(int nJobsA, GooThreadPoolFunc funcA, void *dataA,
+			int maxThreads) {
+  int i;
+
+  if (nJobsA <= 0) {
+    return;
+  }
+  if (maxThreads > nJobsA) {
+    maxThreads = nJobsA;
+  }
+  if (maxThreads <= 1 ||
+      pthread_getspecific(inJobKey) ||
+      pthread_mutex_trylock(&runMutex)) {
+    for (i = 0; i < nJobsA; ++i) {
+      (*funcA)(dataA, i);
+    }
+    return;
+  }
+
+  // start more workers if this batch wants them; only the thread
+  // holding runMutex changes nThreads
+  while (nThreads < maxThreads && nThreads < gooThreadPoolMaxThreads) {
+    if (pthread_create(&threads[nThreads - 1], NULL,
+		       &GooThreadPool::workerMain, this)) {
+      break;
+    }
+    pthread_detach(threads[nThreads - 1]);
+    ++nThreads;
+  }
+
+  pthread_setspecific(inJobKey, this);
+  pthread_mutex_lock(&mutex);
+  func = funcA;
+  data = dataA;
+  nJobs = nJobsA;
+  nextJob = 0;
+  nDone = 0;
+  nWorkers = maxThreads - 1;
+  pthread_cond_broadcast(&workCond);
+  runJobs();
+  while (nDone < nJobs) {
+    pthread_cond_wait(&doneCond, &mutex);
+  }
+  nJobs = nextJob = nDone = 0;
+  nWorkers = 0;
+  func = NULL;
+  data = NULL;
+  pthread_mutex_unlock(&mutex);
+  pthread_setspecific(inJobKey, NULL);
+  pthread_mutex_unlock(&runMutex);
+}
+
+#else // no pthreads: run everything on the calling thread
+
+GooThreadPool *GooThreadPool::get() {
+  if (!sharedPool) {
+    init();
+  }
+  return sharedPool;
+}
+
+void GooThreadPool::init() {
+  sharedPool = new GooThreadPool();
+}
+
+GooThreadPool::GooThreadPool() {
+  nThreads = 1;
+}
+
+GooThreadPool::~GooThreadPool() {
+}
+
+void GooThreadPool::run(int nJobsA, GooThreadPoolFunc funcA, void *dataA,
+			int maxThreads) {
+  int i;
+
+  for (i = 0; i < nJobsA; ++i) {
+    (*funcA)(dataA, i);
+  }
+}
+
+#endif
@@ -0,0 +1,81 @@
+//========================================================================
+//
+// GooThreadPool.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef GOOTHREADPOOL_H
+#define GOOTHREADPOOL_H
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "poppler-config.h"
+#include "gtypes.h"
+
+#if MULTITHREADED && !defined(_WIN32)
+#define GOO_THREAD_POOL_PTHREADS 1
+#include <pthread.h>
+#endif
+
+//------------------------------------------------------------------------
+// GooThreadPool
+//------------------------------------------------------------------------
+
+typedef void (*GooThreadPoolFunc)(void *data, int idx);
+
+// A set of worker threads, shared by the whole process, which run
+// batches of independent jobs.  No threads are started until a batch
+// asks for more than one.  Without pthreads all jobs run on the
+// calling thread.
+class GooThreadPool {
+public:
+
+  // Return the shared pool.
+  static GooThreadPool *get();
+
+  // Number of threads started so far, including the caller.
+  int getNumThreads() { return nThreads; }
+
+  // Call <func>(<data>, i) for 0 <= i < <nJobs>, and return when all
+  // of the calls have finished.  At most <maxThreads> threads,
+  // including the caller, work on the batch; more worker threads are
+  // started if needed, up to a fixed limit.  Jobs are handed out one
+  // at a time to whichever thread is idle, so they don't need to be
+  // the same size.  A batch started while the pool is busy with
+  // another batch, or from inside a job, is run entirely on the
+  // calling thread.
+  void run(int nJobs, GooThreadPoolFunc func, void *data, int maxThreads);
+
+private:
+
+  GooThreadPool();
+  ~GooThreadPool();
+  static void init();
+
+  int nThreads;
+
+#if GOO_THREAD_POOL_PTHREADS
+  static void *workerMain(void *arg);
+  void runJobs();
+
+  pthread_t *threads;
+  pthread_mutex_t runMutex;	// held by the thread running a batch
+  pthread_mutex_t mutex;	// protects the batch state below
+  pthread_cond_t workCond;	// signalled when a batch is started
+  pthread_cond_t doneCond;	// signalled when the last job finishes
+  GooThreadPoolFunc func;
+  void *data;
+  int nJobs;			// number of jobs in the current batch
+  int nWorkers;			// number of worker threads allowed to
+				//   work on the current batch
+  int nWorking;			// number of worker threads working on it
+  int nextJob;			// next job to hand out
+  int nDone;			// number of finished jobs
+#endif
+};
+
+#endif
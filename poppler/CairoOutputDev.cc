@@ -65,6 +65,7 @@
 #include "CairoRescaleBox.h"
 #include "UnicodeMap.h"
 #include "JBIG2Stream.h"
+#include "DecodedImageCache.h"
 //------------------------------------------------------------------------
 
 // #define LOG_CAIRO
@@ -3013,6 +3014,16 @@ public:
 
 };
 
+// Pixel format of the images CairoOutputDev puts in the decoded image
+// cache (SplashOutputDev uses its color modes, which are all smaller).
+#define cairoDecodedImageFormat 0x100
+
+static cairo_user_data_key_t decodedImageKey;
+
+static void decodedImageDestroy(void *data) {
+  ((DecodedImage *)data)->decRefCnt();
+}
+
 void CairoOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
 			       int widthA, int heightA,
 			       GfxImageColorMap *colorMap,
@@ -3026,12 +3037,66 @@ void CairoOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
   int scaledWidth, scaledHeight;
   cairo_filter_t filter = CAIRO_FILTER_BILINEAR;
   RescaleDrawImage rescale;
+  DecodedImageCache *imageCache;
+  GooString *cacheKey;
+  DecodedImage *decodedImage;
+  Guchar *decodedData;
+  int stride;
 
   LOG (printf ("drawImage %dx%d\n", widthA, heightA));
 
   cairo_get_matrix(cairo, &matrix);
   getScaledSize (&matrix, widthA, heightA, &scaledWidth, &scaledHeight);
-  image = rescale.getSourceImage(str, widthA, heightA, scaledWidth, scaledHeight, printing, colorMap, maskColors);
+
+  // image XObjects are kept in the document's decoded image cache at
+  // the size getSourceImage produces
+  imageCache = NULL;
+  cacheKey = NULL;
+  decodedImage = NULL;
+  if (printing || scaledWidth >= widthA || scaledHeight >= heightA) {
+    width = widthA;
+    height = heightA;
+  } else {
+    width = scaledWidth;
+    height = scaledHeight;
+  }
+  if (!inlineImg && !maskColors && ref && ref->isRef() && xref &&
+      (imageCache = xref->getDecodedImageCache()) &&
+      (Goffset)width * height * 4 <= imageCache->getMaxBytes() &&
+      (cacheKey = imageCache->makeKey(ref->getRef(), width, height,
+				      cairoDecodedImageFormat,
+				      colorMap, state))) {
+    decodedImage = imageCache->lookup(cacheKey);
+  }
+
+  if (decodedImage) {
+    // draw straight from the cached pixels, which the surface holds a
+    // reference to
+    image = cairo_image_surface_create_for_data(decodedImage->getData(),
+						CAIRO_FORMAT_RGB24,
+						width, height,
+						decodedImage->getRowSize());
+    if (cairo_surface_set_user_data(image, &decodedImageKey, decodedImage,
+				    &decodedImageDestroy)) {
+      cairo_surface_destroy(image);
+      decodedImage->decRefCnt();
+      image = NULL;
+    }
+  } else {
+    image = rescale.getSourceImage(str, widthA, heightA, scaledWidth, scaledHeight, printing, colorMap, maskColors);
+    if (image && cacheKey &&
+	cairo_surface_status(image) == CAIRO_STATUS_SUCCESS) {
+      cairo_surface_flush(image);
+      stride = cairo_image_surface_get_stride(image);
+      decodedData = (Guchar *)gmallocn(height, stride);
+      memcpy(decodedData, cairo_image_surface_get_data(image),
+	     (size_t)height * stride);
+      decodedImage = new DecodedImage(width, height, stride, decodedData);
+      imageCache->put(cacheKey, decodedImage);
+      decodedImage->decRefCnt();
+    }
+  }
+  delete cacheKey;
   if (!image)
     return;
 
@@ -44,6 +44,7 @@
 #endif
 
 #include <stddef.h>
+#include <limits.h>
 #include <stdlib.h>
 #include "goo/gmem.h"
 #include "Object.h"
@@ -98,11 +99,17 @@ Catalog::Catalog(PDFDoc *docA) {
   viewerPrefs = NULL;
   structTreeRoot = NULL;
 
-  pagesList = NULL;
-  pagesRefList = NULL;
-  attrsList = NULL;
-  kidsIdxList = NULL;
-  lastCachedPage = 0;
+  pageParents = NULL;
+  pageNodes = NULL;
+  pageWalkNodes = NULL;
+  pageWalkKids = NULL;
+  pageWalkCount = 0;
+  pageHoles = NULL;
+  pageCountsTrusted = gTrue;
+  stalePages = NULL;
+  pageIndexBuilt = gFalse;
+  pageHash = NULL;
+  pageHashSize = 0;
   markInfo = markInfoNull;
 
   xref->getCatalog(&catDict);
@@ -146,23 +153,24 @@ Catalog::Catalog(PDFDoc *docA) {
 }
 
 Catalog::~Catalog() {
-  delete kidsIdxList;
-  if (attrsList) {
-    std::vector<PageAttrs *>::iterator it;
-    for (it = attrsList->begin() ; it != attrsList->end(); ++it ) {
-      delete *it;
-    }
-    delete attrsList;
-  }
-  delete pagesRefList;
-  if (pagesList) {
-    std::vector<Dict *>::iterator it;
-    for (it = pagesList->begin() ; it != pagesList->end(); ++it ) {
-      if (!(*it)->decRef()) {
-         delete *it;
+  if (pageNodes) {
+    std::vector<PageTreeNode>::iterator it;
+    for (it = pageNodes->begin() ; it != pageNodes->end(); ++it ) {
+      if (!it->dict->decRef()) {
+         delete it->dict;
       }
     }
-    delete pagesList;
+    delete pageNodes;
+  }
+  delete pageWalkNodes;
+  delete pageWalkKids;
+  delete pageHoles;
+  if (stalePages) {
+    std::vector<Page *>::iterator it;
+    for (it = stalePages->begin(); it != stalePages->end(); ++it) {
+      delete *it;
+    }
+    delete stalePages;
   }
   if (pages) {
     for (int i = 0; i < pagesSize; ++i) {
@@ -172,7 +180,9 @@ Catalog::~Catalog() {
     }
     gfree(pages);
     gfree(pageRefs);
+    gfree(pageParents);
   }
+  gfree(pageHash);
   names.free();
   dests.free();
   delete destNameTree;
@@ -235,11 +245,11 @@ Page *Catalog::getPage(int i)
   if (i < 1) return NULL;
 
   catalogLocker();
-  if (i > lastCachedPage) {
-     GBool cached = cachePageTree(i);
-     if ( cached == gFalse) {
-       return NULL;
-     }
+  if (!initPageTree() || i > pagesSize) {
+    return NULL;
+  }
+  if (!pages[i-1]) {
+    loadIndexedPage(i);
   }
   return pages[i-1];
 }
@@ -249,195 +259,459 @@ Ref *Catalog::getPageRef(int i)
   if (i < 1) return NULL;
 
   catalogLocker();
-  if (i > lastCachedPage) {
-     GBool cached = cachePageTree(i);
-     if ( cached == gFalse) {
-       return NULL;
-     }
+  if (!initPageTree() || i > pagesSize) {
+    return NULL;
   }
-  return &pageRefs[i-1];
+  extendPageIndex(i);
+  return pageRefs[i-1].num >= 0 ? &pageRefs[i-1] : (Ref *)NULL;
 }
 
-GBool Catalog::cachePageTree(int page)
+GBool Catalog::initPageTree()
 {
-  Dict *pagesDict;
+  Object catDict, pagesDictRef, obj;
+  PageTreeNode root;
 
-  if (pagesList == NULL) {
+  if (pages) {
+    return gTrue;
+  }
+  // this also handles the case of a single Page as the root
+  if (getNumPages() <= 0 || pages) {
+    return pages != NULL;
+  }
 
-    Object catDict;
-    Ref pagesRef;
+  xref->getCatalog(&catDict);
+  if (!catDict.isDict()) {
+    error(errSyntaxError, -1, "Could not find catalog dictionary");
+    catDict.free();
+    return gFalse;
+  }
+  if (catDict.dictLookupNF("Pages", &pagesDictRef)->isRef() &&
+      pagesDictRef.getRefNum() >= 0 &&
+      pagesDictRef.getRefNum() < xref->getNumObjects()) {
+    root.ref = pagesDictRef.getRef();
+    pagesDictRef.free();
+  } else {
+    error(errSyntaxError, -1, "Catalog dictionary does not contain a valid \"Pages\" entry");
+    pagesDictRef.free();
+    catDict.free();
+    return gFalse;
+  }
+  catDict.dictLookup("Pages", &obj);
+  catDict.free();
+  // This should really be isDict("Pages"), but I've seen at least one
+  // PDF file where the /Type entry is missing.
+  if (!obj.isDict()) {
+    error(errSyntaxError, -1, "Top-level pages object is wrong type ({0:s})", obj.getTypeName());
+    obj.free();
+    return gFalse;
+  }
+  root.dict = obj.getDict();
+  root.dict->incRef();
+  root.parent = -1;
+  obj.free();
 
-    xref->getCatalog(&catDict);
+  pagesSize = numPages;
+  pages = (Page **)gmallocn(pagesSize, sizeof(Page *));
+  pageRefs = (Ref *)gmallocn(pagesSize, sizeof(Ref));
+  pageParents = (int *)gmallocn(pagesSize, sizeof(int));
+  for (int i = 0; i < pagesSize; ++i) {
+    pages[i] = NULL;
+    pageRefs[i].num = -1;
+    pageRefs[i].gen = -1;
+    pageParents[i] = -1;
+  }
+  pageNodes = new std::vector<PageTreeNode>();
+  pageNodes->push_back(root);
+  pageWalkNodes = new std::vector<int>();
+  pageWalkNodes->push_back(0);
+  pageWalkKids = new std::vector<int>();
+  pageWalkKids->push_back(0);
+  pageWalkCount = 0;
+  pageHoles = new std::vector<PageTreeHole>();
+  stalePages = new std::vector<Page *>();
+  return gTrue;
+}
 
-    if (catDict.isDict()) {
-      Object pagesDictRef;
-      if (catDict.dictLookupNF("Pages", &pagesDictRef)->isRef() &&
-          pagesDictRef.getRefNum() >= 0 &&
-          pagesDictRef.getRefNum() < xref->getNumObjects()) {
-        pagesRef = pagesDictRef.getRef();
-        pagesDictRef.free();
-      } else {
-        error(errSyntaxError, -1, "Catalog dictionary does not contain a valid \"Pages\" entry");
-        pagesDictRef.free();
-        catDict.free();
-        return gFalse;
-      }
+// The number of pages below the intermediate node <dict>, if its
+// /Count is consistent with its kids, or -1 otherwise.  A node with as
+// many kids as its /Count is taken to have only pages as kids, without
+// fetching them; otherwise the kids' /Count entries must add up.  This
+// only looks one level down, so that it is cheap; the subtree's pages
+// are counted for real when the subtree is walked.
+int Catalog::getCheckedPageCount(Dict *dict)
+{
+  Object count, kids, kidRef, kid;
+  int n, sum, i;
+
+  // some PDF files actually use real numbers here ("/Count 9.0")
+  if (!dict->lookup("Count", &count)->isNum() ||
+      count.getNum() < 0 || count.getNum() > INT_MAX) {
+    count.free();
+    return -1;
+  }
+  n = (int)count.getNum();
+  count.free();
+  if (!dict->lookup("Kids", &kids)->isArray() || kids.arrayGetLength() > n) {
+    kids.free();
+    return -1;
+  }
+  if (kids.arrayGetLength() == n) {
+    kids.free();
+    return n;
+  }
+  sum = 0;
+  for (i = 0; sum >= 0 && i < kids.arrayGetLength(); ++i) {
+    if (!kids.arrayGetNF(i, &kidRef)->isRef()) {
+      sum = -1;
+    } else if (kids.arrayGet(i, &kid)->isDict("Page") ||
+	       (kid.isDict() && !kid.getDict()->hasKey("Kids"))) {
+      sum += 1;
+    } else if (kid.isDict() && kid.dictLookup("Count", &count)->isNum() &&
+	       count.getNum() >= 0 && count.getNum() <= n - sum) {
+      sum += (int)count.getNum();
+      count.free();
     } else {
-      error(errSyntaxError, -1, "Could not find catalog dictionary");
-      catDict.free();
-      return gFalse;
+      count.free();
+      sum = -1;
     }
-
-    Object obj;
-    catDict.dictLookup("Pages", &obj);
-    catDict.free();
-    // This should really be isDict("Pages"), but I've seen at least one
-    // PDF file where the /Type entry is missing.
-    if (obj.isDict()) {
-      obj.getDict()->incRef();
-      pagesDict = obj.getDict();
-      obj.free();
-    }
-    else {
-      error(errSyntaxError, -1, "Top-level pages object is wrong type ({0:s})", obj.getTypeName());
-      obj.free();
-      return gFalse;
-    }
-
-    pagesSize = getNumPages();
-    pages = (Page **)gmallocn(pagesSize, sizeof(Page *));
-    pageRefs = (Ref *)gmallocn(pagesSize, sizeof(Ref));
-    for (int i = 0; i < pagesSize; ++i) {
-      pages[i] = NULL;
-      pageRefs[i].num = -1;
-      pageRefs[i].gen = -1;
+    kid.free();
+    kidRef.free();
+    if (sum > n) {
+      sum = -1;
     }
-
-    pagesList = new std::vector<Dict *>();
-    pagesList->push_back(pagesDict);
-    pagesRefList = new std::vector<Ref>();
-    pagesRefList->push_back(pagesRef);
-    attrsList = new std::vector<PageAttrs *>();
-    attrsList->push_back(new PageAttrs(NULL, pagesDict));
-    kidsIdxList = new std::vector<int>();
-    kidsIdxList->push_back(0);
-    lastCachedPage = 0;
-
   }
+  kids.free();
+  return sum == n ? n : -1;
+}
 
-  while(1) {
-
-    if (page <= lastCachedPage) return gTrue;
-
-    if (pagesList->empty()) return gFalse;
-
-    pagesDict = pagesList->back();
-    Object kids;
-    pagesDict->lookup("Kids", &kids);
+// Walk the page tree in order from the node on top of <nodeStack>,
+// without creating any Page objects, filling pageRefs and pageParents
+// from slot <n> on; the slots must stay below <end>.  With <skip>,
+// intermediate nodes whose pages all come before <page>, or after it
+// if <toEnd> is set, are recorded in pageHoles instead of being walked,
+// provided their /Count checks out.  The walk stops after page <page>,
+// unless <toEnd> is set.  Returns the number of the next slot, or -1
+// if the pages don't fit below <end>.
+int Catalog::walkPageTree(std::vector<int> &nodeStack,
+			  std::vector<int> &kidsIdxStack,
+			  int n, int end, int page, GBool skip, GBool toEnd)
+{
+  PageTreeNode node;
+  PageTreeHole hole;
+  Object kids, kidRef, kid;
+  int kidsIdx, count, i;
+  GBool loop;
+
+  while (!nodeStack.empty() && (toEnd || n < page)) {
+    (*pageNodes)[nodeStack.back()].dict->lookup("Kids", &kids);
     if (!kids.isArray()) {
       error(errSyntaxError, -1, "Kids object (page {0:d}) is wrong type ({1:s})",
-            lastCachedPage+1, kids.getTypeName());
+            n+1, kids.getTypeName());
       kids.free();
-      return gFalse;
+      nodeStack.clear();
+      break;
     }
 
-    int kidsIdx = kidsIdxList->back();
+    kidsIdx = kidsIdxStack.back();
     if (kidsIdx >= kids.arrayGetLength()) {
-       if (!pagesList->back()->decRef()) {
-         delete pagesList->back();
-       }
-       pagesList->pop_back();
-       pagesRefList->pop_back();
-       delete attrsList->back();
-       attrsList->pop_back();
-       kidsIdxList->pop_back();
-       if (!kidsIdxList->empty()) kidsIdxList->back()++;
-       kids.free();
-       continue;
+      nodeStack.pop_back();
+      kidsIdxStack.pop_back();
+      if (!kidsIdxStack.empty()) kidsIdxStack.back()++;
+      kids.free();
+      continue;
     }
 
-    Object kidRef;
     kids.arrayGetNF(kidsIdx, &kidRef);
     if (!kidRef.isRef()) {
       error(errSyntaxError, -1, "Kid object (page {0:d}) is not an indirect reference ({1:s})",
-            lastCachedPage+1, kidRef.getTypeName());
+            n+1, kidRef.getTypeName());
       kidRef.free();
       kids.free();
-      return gFalse;
+      nodeStack.clear();
+      break;
     }
 
-    GBool loop = gFalse;;
-    for (size_t i = 0; i < pagesRefList->size(); i++) {
-      if (((*pagesRefList)[i]).num == kidRef.getRefNum()) {
-         loop = gTrue;
-         break;
+    // the stack may start below the root, so follow the parent links
+    loop = gFalse;
+    for (i = nodeStack.back(); i >= 0; i = (*pageNodes)[i].parent) {
+      if ((*pageNodes)[i].ref.num == kidRef.getRefNum()) {
+	loop = gTrue;
+	break;
       }
     }
     if (loop) {
       error(errSyntaxError, -1, "Loop in Pages tree");
       kidRef.free();
       kids.free();
-      kidsIdxList->back()++;
+      kidsIdxStack.back()++;
       continue;
     }
 
-    Object kid;
     kids.arrayGet(kidsIdx, &kid);
     kids.free();
     if (kid.isDict("Page") || (kid.isDict() && !kid.getDict()->hasKey("Kids"))) {
-      PageAttrs *attrs = new PageAttrs(attrsList->back(), kid.getDict());
-      Page *p = new Page(doc, lastCachedPage+1, kid.getDict(),
-                     kidRef.getRef(), attrs, form);
-      if (!p->isOk()) {
-        error(errSyntaxError, -1, "Failed to create page (page {0:d})", lastCachedPage+1);
-        delete p;
+      if (n >= end) {
         kidRef.free();
         kid.free();
-        return gFalse;
+        return -1;
       }
-
-      if (lastCachedPage >= numPages) {
-        error(errSyntaxError, -1, "Page count in top-level pages object is incorrect");
-        kidRef.free();
-        kid.free();
-        return gFalse;
-      }
-
-      pages[lastCachedPage] = p;
-      pageRefs[lastCachedPage].num = kidRef.getRefNum();
-      pageRefs[lastCachedPage].gen = kidRef.getRefGen();
-
-      lastCachedPage++;
-      kidsIdxList->back()++;
+      pageRefs[n] = kidRef.getRef();
+      pageParents[n] = nodeStack.back();
+      n++;
+      kidsIdxStack.back()++;
 
     // This should really be isDict("Pages"), but I've seen at least one
     // PDF file where the /Type entry is missing.
     } else if (kid.isDict()) {
-      attrsList->push_back(new PageAttrs(attrsList->back(), kid.getDict()));
-      pagesRefList->push_back(kidRef.getRef());
-      kid.getDict()->incRef();
-      pagesList->push_back(kid.getDict());
-      kidsIdxList->push_back(0);
+      node.ref = kidRef.getRef();
+      node.dict = kid.getDict();
+      node.dict->incRef();
+      node.parent = nodeStack.back();
+      pageNodes->push_back(node);
+      count = -1;
+      if (skip) {
+	count = getCheckedPageCount(node.dict);
+	if (count > end - n || (n < page && page <= n + count)) {
+	  count = -1;
+	}
+      }
+      if (count >= 0) {
+	hole.node = pageNodes->size() - 1;
+	hole.start = n;
+	hole.count = count;
+	pageHoles->push_back(hole);
+	n += count;
+	kidsIdxStack.back()++;
+      } else {
+	nodeStack.push_back(pageNodes->size() - 1);
+	kidsIdxStack.push_back(0);
+      }
     } else {
       error(errSyntaxError, -1, "Kid object (page {0:d}) is wrong type ({1:s})",
-            lastCachedPage+1, kid.getTypeName());
-      kidsIdxList->back()++;
+            n+1, kid.getTypeName());
+      kidsIdxStack.back()++;
     }
     kidRef.free();
     kid.free();
+  }
+  return n;
+}
+
+// Walk the subtree skipped as hole <i>, skipping in turn the parts
+// that don't contain page <page> if <skip> is set.  Returns false if
+// the subtree doesn't have the number of pages its /Count claims.
+GBool Catalog::fillPageHole(int i, int page, GBool skip)
+{
+  std::vector<int> nodeStack, kidsIdxStack;
+  PageTreeHole hole;
+  int n;
+
+  hole = (*pageHoles)[i];
+  pageHoles->erase(pageHoles->begin() + i);
+  nodeStack.push_back(hole.node);
+  kidsIdxStack.push_back(0);
+  n = walkPageTree(nodeStack, kidsIdxStack, hole.start,
+		   hole.start + hole.count, page, skip, gTrue);
+  return n == hole.start + hole.count;
+}
+
+// Index the pages up to <page>.  The walk of the page tree resumes
+// where the previous call stopped, and skips subtrees with a /Count
+// that checks out; they are walked when one of their pages is needed.
+// If a skipped subtree turns out not to have the number of pages its
+// /Count claims, the whole index is rebuilt without trusting /Count,
+// so page numbers always follow the order of the page tree's leaves.
+void Catalog::extendPageIndex(int page)
+{
+  int n;
+  size_t i;
+
+  if (pageIndexBuilt) {
+    return;
+  }
+
+  for (i = 0; i < pageHoles->size(); ++i) {
+    if ((*pageHoles)[i].start < page &&
+	page <= (*pageHoles)[i].start + (*pageHoles)[i].count) {
+      if (!fillPageHole(i, page, pageCountsTrusted)) {
+	rebuildPageIndex();
+	return;
+      }
+      break;
+    }
+  }
+
+  if (page > pageWalkCount && !pageWalkNodes->empty()) {
+    n = walkPageTree(*pageWalkNodes, *pageWalkKids, pageWalkCount, pagesSize,
+		     page, pageCountsTrusted, gFalse);
+    if (n < 0) {
+      // the skipped subtrees may have claimed too many pages
+      if (!pageHoles->empty()) {
+	rebuildPageIndex();
+	return;
+      }
+      error(errSyntaxError, -1, "Page count in top-level pages object is incorrect");
+      pageWalkNodes->clear();
+    } else {
+      pageWalkCount = n;
+    }
+  }
 
+  // once the walk is over, the index is complete
+  if (pageWalkNodes->empty() && pageHoles->empty()) {
+    pageWalkKids->clear();
+    pageIndexBuilt = gTrue;
+    buildPageHash();
   }
+}
 
-  return gFalse;
+// Walk the rest of the page tree, so that pageRefs, pageParents and
+// pageHash cover every page.
+void Catalog::buildPageIndex()
+{
+  if (pageIndexBuilt) {
+    return;
+  }
+  while (!pageHoles->empty()) {
+    if (!fillPageHole(pageHoles->size() - 1, 0, gFalse)) {
+      rebuildPageIndex();
+      return;
+    }
+  }
+  extendPageIndex(INT_MAX);
 }
 
-int Catalog::findPage(int num, int gen) {
+// Called when the /Count entries were found to be wrong: throw away
+// the index and walk the whole page tree in order.  Pages that were
+// loaded with a wrong number are kept alive, since the caller may
+// still use them, but are loaded again when asked for.
+void Catalog::rebuildPageIndex()
+{
+  std::vector<PageTreeNode>::iterator it;
+  int i;
+
+  error(errSyntaxError, -1, "Page count in pages object is incorrect");
+  pageCountsTrusted = gFalse;
+  pageHoles->clear();
+  for (it = pageNodes->begin() + 1; it != pageNodes->end(); ++it) {
+    if (!it->dict->decRef()) {
+      delete it->dict;
+    }
+  }
+  pageNodes->resize(1);
+  for (i = 0; i < pagesSize; ++i) {
+    pageRefs[i].num = -1;
+    pageRefs[i].gen = -1;
+    pageParents[i] = -1;
+  }
+  pageWalkNodes->clear();
+  pageWalkNodes->push_back(0);
+  pageWalkKids->clear();
+  pageWalkKids->push_back(0);
+  pageWalkCount = 0;
+  extendPageIndex(INT_MAX);
+
+  for (i = 0; i < pagesSize; ++i) {
+    if (pages[i] && (pageRefs[i].num != pages[i]->getRef().num ||
+		     pageRefs[i].gen != pages[i]->getRef().gen)) {
+      stalePages->push_back(pages[i]);
+      pages[i] = NULL;
+    }
+  }
+}
+
+void Catalog::buildPageHash()
+{
+  int i, h;
+
+  gfree(pageHash);
+  pageHashSize = 16;
+  while (pageHashSize / 2 < pagesSize) {
+    pageHashSize <<= 1;
+  }
+  pageHash = (int *)gmallocn(pageHashSize, sizeof(int));
+  for (i = 0; i < pageHashSize; ++i) {
+    pageHash[i] = -1;
+  }
+  // object numbers are mostly dense, so the low bits make a good hash;
+  // if a page appears more than once, the first one wins
+  for (i = 0; i < pagesSize; ++i) {
+    if (pageRefs[i].num < 0) {
+      continue;
+    }
+    h = pageRefs[i].num & (pageHashSize - 1);
+    while (pageHash[h] >= 0 &&
+	   (pageRefs[pageHash[h]].num != pageRefs[i].num ||
+	    pageRefs[pageHash[h]].gen != pageRefs[i].gen)) {
+      h = (h + 1) & (pageHashSize - 1);
+    }
+    if (pageHash[h] < 0) {
+      pageHash[h] = i;
+    }
+  }
+}
+
+Page *Catalog::loadIndexedPage(int page)
+{
+  std::vector<int> chain;
+  PageAttrs *attrs, *attrs2;
+  Object obj;
+  Page *p;
   int i;
 
-  for (i = 0; i < getNumPages(); ++i) {
-    Ref *ref = getPageRef(i+1);
-    if (ref != NULL && ref->num == num && ref->gen == gen)
-      return i + 1;
+  extendPageIndex(page);
+  if (pageRefs[page-1].num < 0) {
+    return NULL;
+  }
+  xref->fetch(pageRefs[page-1].num, pageRefs[page-1].gen, &obj);
+  if (!obj.isDict()) {
+    error(errSyntaxError, -1, "Page object (page {0:d}) is wrong type ({1:s})",
+	  page, obj.getTypeName());
+    obj.free();
+    return NULL;
+  }
+
+  // merge the inherited attributes from the root down
+  for (i = pageParents[page-1]; i >= 0; i = (*pageNodes)[i].parent) {
+    chain.push_back(i);
+  }
+  attrs = NULL;
+  for (i = (int)chain.size() - 1; i >= 0; --i) {
+    attrs2 = new PageAttrs(attrs, (*pageNodes)[chain[i]].dict);
+    delete attrs;
+    attrs = attrs2;
+  }
+  attrs2 = new PageAttrs(attrs, obj.getDict());
+  delete attrs;
+
+  p = new Page(doc, page, obj.getDict(), pageRefs[page-1], attrs2, form);
+  obj.free();
+  if (!p->isOk()) {
+    error(errSyntaxError, -1, "Failed to create page (page {0:d})", page);
+    delete p;
+    return NULL;
+  }
+  pages[page-1] = p;
+  return p;
+}
+
+int Catalog::findPage(int num, int gen) {
+  int h;
+
+  catalogLocker();
+  if (!initPageTree()) {
+    return 0;
+  }
+  buildPageIndex();
+  if (!pageHash) {
+    return 0;
+  }
+  h = num & (pageHashSize - 1);
+  while (pageHash[h] >= 0) {
+    if (pageRefs[pageHash[h]].num == num && pageRefs[pageHash[h]].gen == gen) {
+      return pageHash[h] + 1;
+    }
+    h = (h + 1) & (pageHashSize - 1);
   }
   return 0;
 }
@@ -833,14 +1107,17 @@ int Catalog::getNumPages()
 	if (p->isOk()) {
 	  pages = (Page **)gmallocn(1, sizeof(Page *));
 	  pageRefs = (Ref *)gmallocn(1, sizeof(Ref));
+	  pageParents = (int *)gmallocn(1, sizeof(int));
 
 	  pages[0] = p;
 	  pageRefs[0].num = pageRef.num;
 	  pageRefs[0].gen = pageRef.gen;
+	  pageParents[0] = -1;
 
 	  numPages = 1;
-	  lastCachedPage = 1;
 	  pagesSize = 1;
+	  pageIndexBuilt = gTrue;
+	  buildPageHash();
 	} else {
 	  delete p;
 	  numPages = 0;
@@ -221,18 +221,45 @@ public:
 
 private:
 
+  // A Pages node of the page tree.
+  struct PageTreeNode {
+    Ref ref;
+    Dict *dict;
+    int parent;			// index of the parent node, or -1
+  };
+
+  // A subtree of the page tree that was skipped, going by its /Count.
+  struct PageTreeHole {
+    int node;			// index of its root in pageNodes
+    int start;			// index of its first page
+    int count;			// its /Count
+  };
+
   // Get page label info.
   PageLabelInfo *getPageLabelInfo();
 
   PDFDoc *doc;
   XRef *xref;			// the xref table for this PDF file
   Page **pages;			// array of pages
-  Ref *pageRefs;		// object ID for each page
-  int lastCachedPage;
-  std::vector<Dict *> *pagesList;
-  std::vector<Ref> *pagesRefList;
-  std::vector<PageAttrs *> *attrsList;
-  std::vector<int> *kidsIdxList;
+  Ref *pageRefs;		// object ID for each page, num = -1 if
+				//   not known yet
+  int *pageParents;		// index in pageNodes of each page's
+				//   parent, or -1
+  std::vector<PageTreeNode> *pageNodes; // [0] is the root; the others
+				//   are filled in by extendPageIndex
+  std::vector<int> *pageWalkNodes; // stack of pageNodes indexes on the
+				//   way to the next page to index
+  std::vector<int> *pageWalkKids; // index of the current kid in each
+				//   node of pageWalkNodes
+  int pageWalkCount;		// number of pages indexed or skipped
+				//   so far
+  std::vector<PageTreeHole> *pageHoles; // subtrees skipped so far
+  GBool pageCountsTrusted;	// false once a /Count turned out wrong
+  std::vector<Page *> *stalePages; // pages loaded with a wrong number
+  GBool pageIndexBuilt;		// true if pageRefs is complete
+  int *pageHash;		// page index by object ID (open
+				//   addressing), or NULL
+  int pageHashSize;		// size of pageHash, a power of two
   Form *form;
   ViewerPreferences *viewerPrefs;
   int numPages;			// number of pages
@@ -256,7 +283,16 @@ private:
   PageLayout pageLayout;	// page layout
   Object additionalActions;     // page additional actions
 
-  GBool cachePageTree(int page); // Cache first <page> pages.
+  GBool initPageTree();
+  int getCheckedPageCount(Dict *dict);
+  int walkPageTree(std::vector<int> &nodeStack, std::vector<int> &kidsIdxStack,
+		   int n, int end, int page, GBool skip, GBool toEnd);
+  GBool fillPageHole(int i, int page, GBool skip);
+  void extendPageIndex(int page);
+  void buildPageIndex();
+  void rebuildPageIndex();
+  void buildPageHash();
+  Page *loadIndexedPage(int page);
   Object *findDestInTree(Object *tree, GooString *name, Object *obj);
 
   Object *getNames();
@@ -63,6 +63,7 @@ static void str_term_source(j_decompress_ptr cinfo)
 DCTStream::DCTStream(Stream *strA, int colorXformA, Object *dict, int recursion) :
   FilterStream(strA) {
   colorXform = colorXformA;
+  reduction = 0;
   if (dict != NULL) {
     Object obj;
 
@@ -191,6 +192,12 @@ void DCTStream::reset() {
 	break;
       }
 
+      // decode straight to a reduced size with libjpeg's DCT scaling
+      if (reduction > 0) {
+	cinfo.scale_num = 1;
+	cinfo.scale_denom = 1 << reduction;
+      }
+
       jpeg_start_decompress(&cinfo);
 
       row_stride = cinfo.output_width * cinfo.output_components;
@@ -264,3 +271,26 @@ GooString *DCTStream::getPSFilter(int psLevel, const char *indent) {
 GBool DCTStream::isBinary(GBool last) {
   return str->isBinary(gTrue);
 }
+
+GBool DCTStream::reduceResolution(int minWidth, int minHeight,
+				  int *width, int *height) {
+  int r, d;
+
+  // libjpeg can scale by 1/2, 1/4 and 1/8; its output size is
+  // rounded up, as it is here
+  for (r = 0; r < 3; ++r) {
+    d = 2 << r;
+    if ((*width + d - 1) / d < minWidth ||
+	(*height + d - 1) / d < minHeight) {
+      break;
+    }
+  }
+  reduction = r;
+  if (r == 0) {
+    return gFalse;
+  }
+  d = 1 << r;
+  *width = (*width + d - 1) / d;
+  *height = (*height + d - 1) / d;
+  return gTrue;
+}
@@ -72,6 +72,8 @@ public:
   virtual int lookChar();
   virtual GooString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
+  virtual GBool reduceResolution(int minWidth, int minHeight,
+				 int *width, int *height);
 
 private:
   void init();
@@ -80,6 +82,7 @@ private:
   virtual int getChars(int nChars, Guchar *buffer);
 
   int colorXform;
+  int reduction;		// log2 of the DCT scaling denominator
   JSAMPLE *current;
   JSAMPLE *limit;
   struct jpeg_decompress_struct cinfo;
@@ -0,0 +1,198 @@
+//========================================================================
+//
+// DecodedImageCache.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#include "GfxState.h"
+#include "XRef.h"
+#include "DecodedImageCache.h"
+
+#if MULTITHREADED
+#  define imageLocker()   MutexLocker locker(&mutex)
+#  define imageCacheLocker()   MutexLocker locker(&mutex)
+#else
+#  define imageLocker()
+#  define imageCacheLocker()
+#endif
+
+//------------------------------------------------------------------------
+// DecodedImage
+//------------------------------------------------------------------------
+
+DecodedImage::DecodedImage(int widthA, int heightA, int rowSizeA,
+			   Guchar *dataA) {
+  width = widthA;
+  height = heightA;
+  rowSize = rowSizeA;
+  data = dataA;
+  refCnt = 1;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+DecodedImage::~DecodedImage() {
+  gfree(data);
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+void DecodedImage::incRefCnt() {
+  imageLocker();
+  ++refCnt;
+}
+
+void DecodedImage::decRefCnt() {
+  int n;
+
+  {
+    imageLocker();
+    n = --refCnt;
+  }
+  if (n == 0) {
+    delete this;
+  }
+}
+
+//------------------------------------------------------------------------
+// DecodedImageCache
+//------------------------------------------------------------------------
+
+DecodedImageCache::DecodedImageCache(XRef *xrefA, Goffset maxBytesA):
+  cache(maxBytesA)
+{
+  xref = xrefA;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+DecodedImageCache::~DecodedImageCache() {
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+GooString *DecodedImageCache::makeKey(Ref ref, int width, int height,
+				      int format, GfxImageColorMap *colorMap,
+				      GfxState *state) {
+  GooString *key;
+
+  if (ref.num < 0 || ref.num >= xref->getNumObjects() ||
+      xref->getEntry(ref.num)->getFlag(XRefEntry::Updated)) {
+    return NULL;
+  }
+
+  // the image dictionary fixes the bits per component, the decode
+  // array and the color space object -- but the color space can still
+  // pick up the page's DefaultGray/RGB/CMYK, and ICC transforms use
+  // the rendering intent
+  key = GooString::format("{0:d} {1:d} {2:d}x{3:d} {4:d} {5:d} {6:s}",
+			  ref.num, ref.gen, width, height, format,
+			  colorMap->getBits(), state->getRenderingIntent());
+  if (!appendColorKey(key, colorMap->getColorSpace(), 0)) {
+    delete key;
+    return NULL;
+  }
+  return key;
+}
+
+// Append the part of the key which identifies <cs>.  A page's default
+// color space takes the place of a device space, so it shows up as a
+// different mode.  Of the CIE-based spaces, only ICC profiles, which
+// are identified by their stream, are allowed.  Everything else that
+// goes into the color conversion (lookup tables, tint transforms)
+// comes from the image dictionary.
+GBool DecodedImageCache::appendColorKey(GooString *key, GfxColorSpace *cs,
+					int recursion) {
+  GfxICCBasedColorSpace *iccCS;
+  Ref profile;
+
+  if (recursion > 8) {
+    return gFalse;
+  }
+  key->appendf(" {0:d}", cs->getMode());
+  switch (cs->getMode()) {
+  case csDeviceGray:
+  case csDeviceRGB:
+  case csDeviceCMYK:
+    return gTrue;
+  case csICCBased:
+    iccCS = (GfxICCBasedColorSpace *)cs;
+    profile = iccCS->getRef();
+    if (profile.num <= 0) {
+      return gFalse;
+    }
+    key->appendf(":{0:d}.{1:d}", profile.num, profile.gen);
+    return appendColorKey(key, iccCS->getAlt(), recursion + 1);
+  case csIndexed:
+    return appendColorKey(key, ((GfxIndexedColorSpace *)cs)->getBase(),
+			  recursion + 1);
+  case csSeparation:
+    return appendColorKey(key, ((GfxSeparationColorSpace *)cs)->getAlt(),
+			  recursion + 1);
+  case csDeviceN:
+    return appendColorKey(key, ((GfxDeviceNColorSpace *)cs)->getAlt(),
+			  recursion + 1);
+  default:
+    return gFalse;
+  }
+}
+
+DecodedImage *DecodedImageCache::lookup(GooString *key) {
+  Entry *entry;
+
+  imageCacheLocker();
+  if (!(entry = cache.lookup(std::string(key->getCString(),
+					 key->getLength())))) {
+    return NULL;
+  }
+  entry->image->incRefCnt();
+  return entry->image;
+}
+
+void DecodedImageCache::put(GooString *key, DecodedImage *image) {
+  std::string k(key->getCString(), key->getLength());
+  Entry *entry;
+
+  imageCacheLocker();
+  if (cache.lookup(k)) {
+    return;
+  }
+  entry = new Entry;
+  entry->image = image;
+  image->incRefCnt();
+  cache.put(k, entry, image->getSize());
+}
+
+void DecodedImageCache::clear() {
+  imageCacheLocker();
+  cache.clear();
+}
+
+void DecodedImageCache::setMaxBytes(Goffset maxBytesA) {
+  imageCacheLocker();
+  cache.setMaxBytes(maxBytesA);
+}
+
+Goffset DecodedImageCache::getMaxBytes() {
+  imageCacheLocker();
+  return cache.getMaxBytes();
+}
+
+Goffset DecodedImageCache::getBytes() {
+  imageCacheLocker();
+  return cache.getBytes();
+}
@@ -0,0 +1,123 @@
+//========================================================================
+//
+// DecodedImageCache.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef DECODEDIMAGECACHE_H
+#define DECODEDIMAGECACHE_H
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include <string>
+#include "goo/gtypes.h"
+#include "goo/GooLRUCache.h"
+#include "goo/GooMutex.h"
+#include "Object.h"
+
+class GooString;
+class GfxColorSpace;
+class GfxImageColorMap;
+class GfxState;
+class XRef;
+
+//------------------------------------------------------------------------
+// DecodedImage
+//------------------------------------------------------------------------
+
+// The pixels of an image XObject, decoded and color converted by an
+// output device into its own pixel format.  They are never modified
+// once the image is built, so several pages (and threads) can draw
+// from the same DecodedImage.
+class DecodedImage {
+public:
+
+  // Takes ownership of <dataA>, which must have been allocated with
+  // gmalloc and hold <heightA> rows of <rowSizeA> bytes.
+  DecodedImage(int widthA, int heightA, int rowSizeA, Guchar *dataA);
+
+  void incRefCnt();
+  void decRefCnt();
+
+  int getWidth() { return width; }
+  int getHeight() { return height; }
+  int getRowSize() { return rowSize; }
+  Guchar *getData() { return data; }
+  Goffset getSize() { return (Goffset)rowSize * height; }
+
+private:
+
+  ~DecodedImage();
+
+  int width, height;
+  int rowSize;			// size of a row in bytes
+  Guchar *data;
+  int refCnt;
+#if MULTITHREADED
+  GooMutex mutex;
+#endif
+};
+
+//------------------------------------------------------------------------
+// DecodedImageCache
+//------------------------------------------------------------------------
+
+// Per-document LRU cache of DecodedImages, bounded by the memory held
+// by the cached pixels.  Images which are in use when they are evicted
+// stay alive until they are released.
+class DecodedImageCache {
+public:
+
+  DecodedImageCache(XRef *xrefA, Goffset maxBytesA);
+  ~DecodedImageCache();
+
+  // Build the key under which image XObject <ref>, decoded at
+  // <width> x <height> with <colorMap> into the output device pixel
+  // format <format>, is cached.  Output devices pick their own
+  // <format> values, which must not collide with other devices'.
+  // Returns NULL if the image can't be cached: if it was modified
+  // through XRef, or if its colors could depend on more than the
+  // image XObject itself (e.g. on a page's default color spaces).
+  GooString *makeKey(Ref ref, int width, int height, int format,
+		     GfxImageColorMap *colorMap, GfxState *state);
+
+  // Return the image cached under <key>, or NULL if there isn't one.
+  // The caller must call decRefCnt() on the result.
+  DecodedImage *lookup(GooString *key);
+
+  // Add <image> under <key>, evicting the least recently used images
+  // if the memory budget is exceeded.  Does nothing if <key> is
+  // already cached, or if <image> alone is bigger than the budget.
+  void put(GooString *key, DecodedImage *image);
+
+  // Drop all the images.
+  void clear();
+
+  void setMaxBytes(Goffset maxBytesA);
+  Goffset getMaxBytes();
+
+  // Memory held by the cached images.
+  Goffset getBytes();
+
+private:
+
+  struct Entry {
+    DecodedImage *image;
+    ~Entry() { image->decRefCnt(); }
+  };
+
+  static GBool appendColorKey(GooString *key, GfxColorSpace *cs,
+			      int recursion);
+
+  XRef *xref;
+  GooLRUCache<std::string, Entry> cache;
+#if MULTITHREADED
+  GooMutex mutex;
+#endif
+};
+
+#endif
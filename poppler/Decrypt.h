@@ -84,7 +84,6 @@ struct DecryptRC4State {
 
 struct DecryptAESState {
   Guint w[44];
-  Guchar state[16];
   Guchar cbc[16];
   Guchar buf[16];
   GBool paddingReached; // encryption only
@@ -93,7 +92,6 @@ struct DecryptAESState {
 
 struct DecryptAES256State {
   Guint w[60];
-  Guchar state[16];
   Guchar cbc[16];
   Guchar buf[16];
   GBool paddingReached; // encryption only
@@ -152,6 +150,11 @@ public:
   ~DecryptStream();
   virtual void reset();
   virtual int lookChar();
+
+private:
+
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
 };
  
 //------------------------------------------------------------------------
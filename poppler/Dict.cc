@@ -33,7 +33,6 @@
 #pragma implementation
 #endif
 
-#include <algorithm>
 #include <stddef.h>
 #include <string.h>
 #include "goo/gmem.h"
@@ -50,29 +49,16 @@
 // Dict
 //------------------------------------------------------------------------
 
-static const int SORT_LENGTH_LOWER_LIMIT = 32;
+// Dictionaries shorter than this are searched linearly
+static const int HASH_LENGTH_LOWER_LIMIT = 16;
 
-static inline bool cmpDictEntries(const DictEntry &e1, const DictEntry &e2)
+static inline unsigned int hashKey(const char *key)
 {
-  return strcmp(e1.key, e2.key) < 0;
-}
-
-static int binarySearch(const char *key, DictEntry *entries, int length)
-{
-  int first = 0;
-  int end = length - 1;
-  while (first <= end) {
-    const int middle = (first + end) / 2;
-    const int res = strcmp(key, entries[middle].key);
-    if (res == 0) {
-      return middle;
-    } else if (res < 0) {
-      end = middle - 1;
-    } else {
-      first = middle + 1;
-    }
+  unsigned int h = 2166136261u;
+  for (const unsigned char *p = (const unsigned char *)key; *p; ++p) {
+    h = (h ^ *p) * 16777619u;
   }
-  return -1;
+  return h;
 }
 
 Dict::Dict(XRef *xrefA) {
@@ -80,7 +66,7 @@ Dict::Dict(XRef *xrefA) {
   entries = NULL;
   size = length = 0;
   ref = 1;
-  sorted = gFalse;
+  hashTable = NULL;
 #if MULTITHREADED
   gInitMutex(&mutex);
 #endif
@@ -94,7 +80,7 @@ Dict::Dict(Dict* dictA) {
   gInitMutex(&mutex);
 #endif
 
-  sorted = dictA->sorted;
+  hashTable = NULL;
   entries = (DictEntry *)gmallocn(size, sizeof(DictEntry));
   for (int i=0; i<length; i++) {
     entries[i].key = copyString(dictA->entries[i].key);
@@ -127,6 +113,7 @@ Dict::~Dict() {
     entries[i].val.free();
   }
   gfree(entries);
+  clearHashTable();
 #if MULTITHREADED
   gDestroyMutex(&mutex);
 #endif
@@ -146,12 +133,6 @@ int Dict::decRef() {
 
 void Dict::add(char *key, Object *val) {
   dictLocker();
-  if (sorted) {
-    // We use add on very few occasions so
-    // virtually this will never be hit
-    sorted = gFalse;
-  }
-
   if (length == size) {
     if (length == 0) {
       size = 8;
@@ -163,20 +144,85 @@ void Dict::add(char *key, Object *val) {
   entries[length].key = key;
   entries[length].val = *val;
   ++length;
+  if (hashTable) {
+    if (2 * length > hashTable->size) {
+      clearHashTable();
+      hashTable = makeHashTable(4 * length);
+    } else {
+      hashInsert(hashTable, length - 1);
+    }
+  }
 }
 
-inline DictEntry *Dict::find(const char *key) {
-  if (!sorted && length >= SORT_LENGTH_LOWER_LIMIT)
-  {
-      dictLocker();
-      sorted = gTrue;
-      std::sort(entries, entries+length, cmpDictEntries);
+// Build a hash index of the entries with at least <minSize> slots.
+DictHashTable *Dict::makeHashTable(int minSize) {
+  DictHashTable *table;
+  int i;
+
+  table = new DictHashTable;
+  table->size = 64;
+  while (table->size < minSize) {
+    table->size *= 2;
+  }
+  table->items = (DictHashSlot *)gmallocn(table->size, sizeof(DictHashSlot));
+  for (i = 0; i < table->size; ++i) {
+    table->items[i].pos = -1;
+  }
+  for (i = 0; i < length; ++i) {
+    hashInsert(table, i);
+  }
+  return table;
+}
+
+// Add entry <pos> to the hash index.  If the key is already indexed
+// the later entry wins, as with the linear search.
+void Dict::hashInsert(DictHashTable *table, int pos) {
+  const unsigned int h = hashKey(entries[pos].key);
+  const unsigned int mask = table->size - 1;
+  DictHashSlot *items = table->items;
+  unsigned int i;
+
+  for (i = h & mask; items[i].pos >= 0; i = (i + 1) & mask) {
+    if (items[i].hash == h &&
+	!strcmp(entries[items[i].pos].key, entries[pos].key)) {
+      break;
+    }
   }
+  items[i].hash = h;
+  items[i].pos = pos;
+}
+
+void Dict::clearHashTable() {
+  if (hashTable) {
+    gfree(hashTable->items);
+    delete hashTable;
+    hashTable = NULL;
+  }
+}
 
-  if (sorted) {
-    const int pos = binarySearch(key, entries, length);
-    if (pos != -1) {
-      return &entries[pos];
+// Large dictionaries are searched through the hash index, which is
+// built on first use.  The first thread to need it builds it under the
+// lock and publishes it complete, so lookups from any number of
+// threads probe it without locking.  Like the entries themselves, the
+// index may only be changed (by add, remove or set adding a key) while
+// no other thread is looking up keys.
+inline DictEntry *Dict::find(const char *key) {
+  if (length >= HASH_LENGTH_LOWER_LIMIT) {
+    DictHashTable *table = gLoadPtrAcquire(&hashTable);
+    if (!table) {
+      dictLocker();
+      if (!(table = hashTable)) {
+        table = makeHashTable(2 * length);
+        gStorePtrRelease(&hashTable, table);
+      }
+    }
+    const unsigned int h = hashKey(key);
+    const unsigned int mask = table->size - 1;
+    const DictHashSlot *items = table->items;
+    for (unsigned int i = h & mask; items[i].pos >= 0; i = (i + 1) & mask) {
+      if (items[i].hash == h && !strcmp(key, entries[items[i].pos].key)) {
+        return &entries[items[i].pos];
+      }
     }
   } else {
     int i;
@@ -195,41 +241,31 @@ GBool Dict::hasKey(const char *key) {
 
 void Dict::remove(const char *key) {
   dictLocker();
-  if (sorted) {
-    const int pos = binarySearch(key, entries, length);
-    if (pos != -1) {
-      length -= 1;
-      gfree(entries[pos].key);
-      entries[pos].val.free();
-      if (pos != length) {
-        memmove(&entries[pos], &entries[pos + 1], (length - pos) * sizeof(DictEntry));
-      }
-    }
-  } else {
-    int i; 
-    bool found = false;
-    DictEntry tmp;
-    if(length == 0) {
-      return;
-    }
+  int i; 
+  bool found = false;
+  DictEntry tmp;
+  if(length == 0) {
+    return;
+  }
 
-    for(i=0; i<length; i++) {
-      if (!strcmp(key, entries[i].key)) {
-        found = true;
-        break;
-      }
+  for(i=0; i<length; i++) {
+    if (!strcmp(key, entries[i].key)) {
+      found = true;
+      break;
     }
-    if(!found) {
-      return;
-    }
-    //replace the deleted entry with the last entry
-    gfree(entries[i].key);
-    entries[i].val.free();
-    length -= 1;
-    tmp = entries[length];
-    if (i!=length) //don't copy the last entry if it is deleted 
-      entries[i] = tmp;
   }
+  if(!found) {
+    return;
+  }
+  //replace the deleted entry with the last entry
+  gfree(entries[i].key);
+  entries[i].val.free();
+  length -= 1;
+  tmp = entries[length];
+  if (i!=length) //don't copy the last entry if it is deleted 
+    entries[i] = tmp;
+  // the index is rebuilt on the next lookup
+  clearHashTable();
 }
 
 void Dict::set(const char *key, Object *val) {
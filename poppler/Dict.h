@@ -45,6 +45,16 @@ struct DictEntry {
   Object val;
 };
 
+struct DictHashSlot {
+  unsigned int hash;		// hash of the key
+  int pos;			// index in the entries array, -1 if empty
+};
+
+struct DictHashTable {
+  int size;			// number of slots (a power of 2)
+  DictHashSlot *items;
+};
+
 class Dict {
 public:
 
@@ -96,17 +106,23 @@ public:
 
 private:
 
-  GBool sorted;
   XRef *xref;			// the xref table for this PDF file
   DictEntry *entries;		// array of entries
   int size;			// size of <entries> array
   int length;			// number of entries in dictionary
+  DictHashTable *hashTable;	// open-addressed index of <entries>,
+				//   built lazily for large dictionaries;
+				//   published with gStorePtrRelease and
+				//   probed without the lock
   int ref;			// reference count
 #if MULTITHREADED
   GooMutex mutex;
 #endif
 
   DictEntry *find(const char *key);
+  DictHashTable *makeHashTable(int minSize);
+  void hashInsert(DictHashTable *table, int pos);
+  void clearHashTable();
 };
 
 #endif
@@ -0,0 +1,1509 @@
+//========================================================================
+//
+// DisplayListOutputDev.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <string.h>
+#include "goo/gmem.h"
+#include "goo/GooList.h"
+#include "goo/GooString.h"
+#include "Object.h"
+#include "Stream.h"
+#include "GfxState.h"
+#include "GfxFont.h"
+#include "Function.h"
+#include "Page.h"
+#include "DisplayListOutputDev.h"
+
+//------------------------------------------------------------------------
+// DisplayListPlayer
+//------------------------------------------------------------------------
+
+struct DisplayListPlayer {
+  OutputDev *out;
+  GfxState *state;
+  XRef *xref;
+  double mat[6];		// recorded device space -> output device space
+  GBool sameCTM;		// mat is the identity
+  double baseMatrix[6];		// for setSoftMaskFromImageMask
+  GooList *colorSpaces;		// [GfxColorSpace] blending color spaces
+				//   given to the OutputDev
+};
+
+// Map a CTM of the recording device to the output device.
+static void transformCTM(DisplayListPlayer *p, double *m, double *m2) {
+  double *t = p->mat;
+
+  // played back at the recorded resolution, the CTMs must come out
+  // bit for bit the same
+  if (p->sameCTM) {
+    memcpy(m2, m, 6 * sizeof(double));
+    return;
+  }
+  m2[0] = m[0] * t[0] + m[1] * t[2];
+  m2[1] = m[0] * t[1] + m[1] * t[3];
+  m2[2] = m[2] * t[0] + m[3] * t[2];
+  m2[3] = m[2] * t[1] + m[3] * t[3];
+  m2[4] = m[4] * t[0] + m[5] * t[2] + t[4];
+  m2[5] = m[4] * t[1] + m[5] * t[3] + t[5];
+}
+
+//------------------------------------------------------------------------
+// DisplayListOp
+//------------------------------------------------------------------------
+
+class DisplayListOp {
+public:
+
+  virtual ~DisplayListOp() {}
+
+  virtual void play(DisplayListPlayer *p) = 0;
+};
+
+//------------------------------------------------------------------------
+
+class DLSaveOp: public DisplayListOp {
+public:
+
+  DLSaveOp(GBool saveA) { save = saveA; }
+
+  virtual void play(DisplayListPlayer *p) {
+    if (save) {
+      p->out->saveState(p->state);
+      p->state = p->state->save();
+    } else if (p->state->hasSaves()) {
+      p->state = p->state->restore();
+      p->out->restoreState(p->state);
+    }
+  }
+
+private:
+
+  GBool save;
+};
+
+//------------------------------------------------------------------------
+
+class DLCTMOp: public DisplayListOp {
+public:
+
+  // If <notify> is false, the CTM changed without an updateCTM() call.
+  DLCTMOp(double *ctmA, double *paramsA, GBool notifyA) {
+    memcpy(ctm, ctmA, 6 * sizeof(double));
+    if (paramsA) {
+      memcpy(params, paramsA, 6 * sizeof(double));
+    }
+    notify = notifyA;
+  }
+
+  virtual void play(DisplayListPlayer *p) {
+    double m[6];
+
+    transformCTM(p, ctm, m);
+    p->state->setCTM(m[0], m[1], m[2], m[3], m[4], m[5]);
+    if (notify) {
+      p->out->updateCTM(p->state, params[0], params[1], params[2],
+			params[3], params[4], params[5]);
+    }
+  }
+
+private:
+
+  double ctm[6];
+  double params[6];
+  GBool notify;
+};
+
+//------------------------------------------------------------------------
+
+enum DLParam {
+  dlFlatness,
+  dlLineJoin,
+  dlLineCap,
+  dlMiterLimit,
+  dlLineWidth,
+  dlStrokeAdjust,
+  dlAlphaIsShape,
+  dlTextKnockout,
+  dlBlendMode,
+  dlFillOpacity,
+  dlStrokeOpacity,
+  dlFillOverprint,
+  dlStrokeOverprint,
+  dlOverprintMode,
+  dlCharSpace,
+  dlRender,
+  dlRise,
+  dlWordSpace,
+  dlHorizScaling
+};
+
+// A single numeric graphics state parameter.
+class DLParamOp: public DisplayListOp {
+public:
+
+  DLParamOp(DLParam paramA, double valueA, GBool notifyA)
+    { param = paramA; value = valueA; notify = notifyA; }
+
+  virtual void play(DisplayListPlayer *p);
+
+private:
+
+  DLParam param;
+  double value;
+  GBool notify;
+};
+
+void DLParamOp::play(DisplayListPlayer *p) {
+  GfxState *state = p->state;
+  OutputDev *out = p->out;
+
+  switch (param) {
+  case dlFlatness:
+    state->setFlatness((int)value);
+    if (notify) out->updateFlatness(state);
+    break;
+  case dlLineJoin:
+    state->setLineJoin((int)value);
+    if (notify) out->updateLineJoin(state);
+    break;
+  case dlLineCap:
+    state->setLineCap((int)value);
+    if (notify) out->updateLineCap(state);
+    break;
+  case dlMiterLimit:
+    state->setMiterLimit(value);
+    if (notify) out->updateMiterLimit(state);
+    break;
+  case dlLineWidth:
+    state->setLineWidth(value);
+    if (notify) out->updateLineWidth(state);
+    break;
+  case dlStrokeAdjust:
+    state->setStrokeAdjust(value != 0);
+    if (notify) out->updateStrokeAdjust(state);
+    break;
+  case dlAlphaIsShape:
+    state->setAlphaIsShape(value != 0);
+    if (notify) out->updateAlphaIsShape(state);
+    break;
+  case dlTextKnockout:
+    state->setTextKnockout(value != 0);
+    if (notify) out->updateTextKnockout(state);
+    break;
+  case dlBlendMode:
+    state->setBlendMode((GfxBlendMode)(int)value);
+    if (notify) out->updateBlendMode(state);
+    break;
+  case dlFillOpacity:
+    state->setFillOpacity(value);
+    if (notify) out->updateFillOpacity(state);
+    break;
+  case dlStrokeOpacity:
+    state->setStrokeOpacity(value);
+    if (notify) out->updateStrokeOpacity(state);
+    break;
+  case dlFillOverprint:
+    state->setFillOverprint(value != 0);
+    if (notify) out->updateFillOverprint(state);
+    break;
+  case dlStrokeOverprint:
+    state->setStrokeOverprint(value != 0);
+    if (notify) out->updateStrokeOverprint(state);
+    break;
+  case dlOverprintMode:
+    state->setOverprintMode((int)value);
+    if (notify) out->updateOverprintMode(state);
+    break;
+  case dlCharSpace:
+    state->setCharSpace(value);
+    if (notify) out->updateCharSpace(state);
+    break;
+  case dlRender:
+    state->setRender((int)value);
+    if (notify) out->updateRender(state);
+    break;
+  case dlRise:
+    state->setRise(value);
+    if (notify) out->updateRise(state);
+    break;
+  case dlWordSpace:
+    state->setWordSpace(value);
+    if (notify) out->updateWordSpace(state);
+    break;
+  case dlHorizScaling:
+    state->setHorizScaling(value);
+    if (notify) out->updateHorizScaling(state);
+    break;
+  }
+}
+
+//------------------------------------------------------------------------
+
+class DLUpdateAllOp: public DisplayListOp {
+public:
+
+  virtual void play(DisplayListPlayer *p) { p->out->updateAll(p->state); }
+};
+
+//------------------------------------------------------------------------
+
+class DLLineDashOp: public DisplayListOp {
+public:
+
+  DLLineDashOp(GfxState *state, GBool notifyA) {
+    double *dashA;
+
+    state->getLineDash(&dashA, &length, &start);
+    dash = (double *)gmallocn(length, sizeof(double));
+    memcpy(dash, dashA, length * sizeof(double));
+    notify = notifyA;
+  }
+
+  virtual ~DLLineDashOp() { gfree(dash); }
+
+  virtual void play(DisplayListPlayer *p) {
+    double *dashA;
+
+    dashA = (double *)gmallocn(length, sizeof(double));
+    memcpy(dashA, dash, length * sizeof(double));
+    p->state->setLineDash(dashA, length, start);
+    if (notify) {
+      p->out->updateLineDash(p->state);
+    }
+  }
+
+private:
+
+  double *dash;
+  int length;
+  double start;
+  GBool notify;
+};
+
+//------------------------------------------------------------------------
+
+class DLColorSpaceOp: public DisplayListOp {
+public:
+
+  DLColorSpaceOp(GfxColorSpace *colorSpaceA, GBool strokeA, GBool notifyA) {
+    colorSpace = colorSpaceA ? colorSpaceA->copy() : (GfxColorSpace *)NULL;
+    stroke = strokeA;
+    notify = notifyA;
+  }
+
+  virtual ~DLColorSpaceOp() { delete colorSpace; }
+
+  virtual void play(DisplayListPlayer *p) {
+    GfxColorSpace *cs = colorSpace ? colorSpace->copy() : (GfxColorSpace *)NULL;
+
+    if (stroke) {
+      p->state->setStrokeColorSpace(cs);
+      if (notify) p->out->updateStrokeColorSpace(p->state);
+    } else {
+      p->state->setFillColorSpace(cs);
+      if (notify) p->out->updateFillColorSpace(p->state);
+    }
+  }
+
+private:
+
+  GfxColorSpace *colorSpace;
+  GBool stroke;
+  GBool notify;
+};
+
+//------------------------------------------------------------------------
+
+class DLColorOp: public DisplayListOp {
+public:
+
+  DLColorOp(GfxColor *colorA, GBool strokeA, GBool notifyA)
+    { color = *colorA; stroke = strokeA; notify = notifyA; }
+
+  virtual void play(DisplayListPlayer *p) {
+    if (stroke) {
+      p->state->setStrokeColor(&color);
+      if (notify) p->out->updateStrokeColor(p->state);
+    } else {
+      p->state->setFillColor(&color);
+      if (notify) p->out->updateFillColor(p->state);
+    }
+  }
+
+private:
+
+  GfxColor color;
+  GBool stroke;
+  GBool notify;
+};
+
+//------------------------------------------------------------------------
+
+class DLTransferOp: public DisplayListOp {
+public:
+
+  DLTransferOp(Function **funcsA, GBool notifyA) {
+    for (int i = 0; i < 4; ++i) {
+      funcs[i] = funcsA[i] ? funcsA[i]->copy() : (Function *)NULL;
+    }
+    notify = notifyA;
+  }
+
+  virtual ~DLTransferOp() {
+    for (int i = 0; i < 4; ++i) {
+      delete funcs[i];
+    }
+  }
+
+  virtual void play(DisplayListPlayer *p) {
+    Function *funcsA[4];
+
+    for (int i = 0; i < 4; ++i) {
+      funcsA[i] = funcs[i] ? funcs[i]->copy() : (Function *)NULL;
+    }
+    p->state->setTransfer(funcsA);
+    if (notify) {
+      p->out->updateTransfer(p->state);
+    }
+  }
+
+private:
+
+  Function *funcs[4];
+  GBool notify;
+};
+
+//------------------------------------------------------------------------
+
+class DLFontOp: public DisplayListOp {
+public:
+
+  DLFontOp(GfxFont *fontA, double sizeA, GBool notifyA) {
+    font = fontA;
+    if (font) {
+      font->incRefCnt();
+    }
+    size = sizeA;
+    notify = notifyA;
+  }
+
+  virtual ~DLFontOp() {
+    if (font) {
+      font->decRefCnt();
+    }
+  }
+
+  virtual void play(DisplayListPlayer *p) {
+    if (font) {
+      font->incRefCnt();
+    }
+    p->state->setFont(font, size);
+    if (notify) {
+      p->out->updateFont(p->state);
+    }
+  }
+
+private:
+
+  GfxFont *font;
+  double size;
+  GBool notify;
+};
+
+//------------------------------------------------------------------------
+
+enum DLTextParam {
+  dlTextMat,
+  dlTextPos,
+  dlTextShift
+};
+
+// The text matrix, or the text position and the call that moved it.
+class DLTextStateOp: public DisplayListOp {
+public:
+
+  DLTextStateOp(DLTextParam paramA, GfxState *state, double shiftA) {
+    param = paramA;
+    memcpy(textMat, state->getTextMat(), 6 * sizeof(double));
+    lineX = state->getLineX();
+    lineY = state->getLineY();
+    curX = state->getCurX();
+    curY = state->getCurY();
+    shift = shiftA;
+  }
+
+  virtual void play(DisplayListPlayer *p);
+
+private:
+
+  DLTextParam param;
+  double textMat[6];
+  double lineX, lineY, curX, curY;
+  double shift;
+};
+
+void DLTextStateOp::play(DisplayListPlayer *p) {
+  GfxState *state = p->state;
+
+  if (param == dlTextMat) {
+    state->setTextMat(textMat[0], textMat[1], textMat[2],
+		      textMat[3], textMat[4], textMat[5]);
+    p->out->updateTextMat(state);
+    return;
+  }
+  state->textMoveTo(lineX, lineY);
+  state->shift(curX - state->getCurX(), curY - state->getCurY());
+  if (param == dlTextPos) {
+    p->out->updateTextPos(state);
+  } else {
+    p->out->updateTextShift(state, shift);
+  }
+}
+
+//------------------------------------------------------------------------
+
+enum DLPathKind {
+  dlStroke,
+  dlFill,
+  dlEOFill,
+  dlClip,
+  dlEOClip,
+  dlClipToStrokePath
+};
+
+class DLPathOp: public DisplayListOp {
+public:
+
+  DLPathOp(DLPathKind kindA, GfxPath *pathA)
+    { kind = kindA; path = pathA->copy(); }
+
+  virtual ~DLPathOp() { delete path; }
+
+  virtual void play(DisplayListPlayer *p);
+
+private:
+
+  DLPathKind kind;
+  GfxPath *path;
+};
+
+void DLPathOp::play(DisplayListPlayer *p) {
+  GfxState *state = p->state;
+  OutputDev *out = p->out;
+
+  state->setPath(path->copy());
+  switch (kind) {
+  case dlStroke:
+    out->stroke(state);
+    break;
+  case dlFill:
+    out->fill(state);
+    break;
+  case dlEOFill:
+    out->eoFill(state);
+    break;
+  case dlClip:
+    state->clip();
+    out->clip(state);
+    break;
+  case dlEOClip:
+    state->clip();
+    out->eoClip(state);
+    break;
+  case dlClipToStrokePath:
+    state->clipToStrokePath();
+    out->clipToStrokePath(state);
+    break;
+  }
+  state->clearPath();
+}
+
+//------------------------------------------------------------------------
+
+enum DLTextKind {
+  dlBeginStringOp,
+  dlEndStringOp,
+  dlBeginString,
+  dlEndString,
+  dlBeginTextObject,
+  dlEndTextObject,
+  dlBeginActualText,
+  dlEndActualText
+};
+
+class DLTextOp: public DisplayListOp {
+public:
+
+  DLTextOp(DLTextKind kindA, GooString *sA)
+    { kind = kindA; s = sA ? sA->copy() : (GooString *)NULL; }
+
+  virtual ~DLTextOp() { delete s; }
+
+  virtual void play(DisplayListPlayer *p);
+
+private:
+
+  DLTextKind kind;
+  GooString *s;
+};
+
+void DLTextOp::play(DisplayListPlayer *p) {
+  GfxState *state = p->state;
+  OutputDev *out = p->out;
+
+  switch (kind) {
+  case dlBeginStringOp:
+    out->beginStringOp(state);
+    break;
+  case dlEndStringOp:
+    out->endStringOp(state);
+    break;
+  case dlBeginString:
+    out->beginString(state, s);
+    break;
+  case dlEndString:
+    out->endString(state);
+    break;
+  case dlBeginTextObject:
+    out->beginTextObject(state);
+    break;
+  case dlEndTextObject:
+    out->endTextObject(state);
+    break;
+  case dlBeginActualText:
+    out->beginActualText(state, s);
+    break;
+  case dlEndActualText:
+    out->endActualText(state);
+    break;
+  }
+}
+
+//------------------------------------------------------------------------
+
+class DLCharOp: public DisplayListOp {
+public:
+
+  DLCharOp(double xA, double yA, double dxA, double dyA,
+	   double originXA, double originYA,
+	   CharCode codeA, int nBytesA, Unicode *uA, int uLenA) {
+    x = xA; y = yA;
+    dx = dxA; dy = dyA;
+    originX = originXA; originY = originYA;
+    code = codeA;
+    nBytes = nBytesA;
+    if (uA && uLenA > 0) {
+      u = (Unicode *)gmallocn(uLenA, sizeof(Unicode));
+      memcpy(u, uA, uLenA * sizeof(Unicode));
+      uLen = uLenA;
+    } else {
+      u = NULL;
+      uLen = 0;
+    }
+  }
+
+  virtual ~DLCharOp() { gfree(u); }
+
+  virtual void play(DisplayListPlayer *p) {
+    p->out->drawChar(p->state, x, y, dx, dy, originX, originY,
+		     code, nBytes, u, uLen);
+  }
+
+private:
+
+  double x, y, dx, dy, originX, originY;
+  CharCode code;
+  int nBytes;
+  Unicode *u;
+  int uLen;
+};
+
+//------------------------------------------------------------------------
+
+// Decoded image samples, played back through a MemStream.
+class DLImageData {
+public:
+
+  // Read <height> rows of <width> x <nComps> x <nBits> samples from
+  // <str>.  Missing data reads as 0xff, like ImageStream does.
+  DLImageData(Stream *str, int width, int height, int nComps, int nBits) {
+    int rowSize, n;
+
+    // Gfx has already checked that a row fits in an int
+    rowSize = (width * nComps * nBits + 7) / 8;
+    buf = (char *)gmallocn_checkoverflow(height, rowSize);
+    length = buf ? height * rowSize : 0;
+    str->reset();
+    n = 0;
+    while (n < length) {
+      int m = str->doGetChars(length - n, (Guchar *)buf + n);
+      if (m <= 0) {
+	break;
+      }
+      n += m;
+    }
+    if (n < length) {
+      memset(buf + n, 0xff, length - n);
+    }
+    str->close();
+  }
+
+  ~DLImageData() { gfree(buf); }
+
+  Stream *makeStream(XRef *xref) {
+    Object dictObj;
+
+    dictObj.initDict(xref);
+    return new MemStream(buf, 0, length, &dictObj);
+  }
+
+private:
+
+  char *buf;
+  int length;
+};
+
+enum DLImageKind {
+  dlImageMask,
+  dlSoftMaskFromImageMask,
+  dlImage,
+  dlMaskedImage,
+  dlSoftMaskedImage
+};
+
+class DLImageOp: public DisplayListOp {
+public:
+
+  DLImageOp(DLImageKind kindA, Object *refA, Stream *str,
+	    int widthA, int heightA, GfxImageColorMap *colorMapA) {
+    kind = kindA;
+    if (refA) {
+      refA->copy(&ref);
+    } else {
+      ref.initNull();
+    }
+    width = widthA;
+    height = heightA;
+    colorMap = colorMapA ? colorMapA->copy() : (GfxImageColorMap *)NULL;
+    data = new DLImageData(str, width, height,
+			   colorMap ? colorMap->getNumPixelComps() : 1,
+			   colorMap ? colorMap->getBits() : 1);
+    invert = interpolate = inlineImg = gFalse;
+    maskColors = NULL;
+    maskData = NULL;
+    maskWidth = maskHeight = 0;
+    maskColorMap = NULL;
+    maskInvert = maskInterpolate = gFalse;
+  }
+
+  virtual ~DLImageOp() {
+    ref.free();
+    delete colorMap;
+    delete data;
+    gfree(maskColors);
+    delete maskData;
+    delete maskColorMap;
+  }
+
+  virtual void play(DisplayListPlayer *p);
+
+  GBool invert, interpolate, inlineImg;
+  int *maskColors;
+  DLImageData *maskData;
+  int maskWidth, maskHeight;
+  GfxImageColorMap *maskColorMap;
+  GBool maskInvert, maskInterpolate;
+  double baseMatrix[6];
+
+private:
+
+  DLImageKind kind;
+  Object ref;
+  int width, height;
+  GfxImageColorMap *colorMap;
+  DLImageData *data;
+};
+
+void DLImageOp::play(DisplayListPlayer *p) {
+  Stream *str, *maskStr;
+  GfxImageColorMap *colorMapA, *maskColorMapA;
+
+  str = data->makeStream(p->xref);
+  maskStr = maskData ? maskData->makeStream(p->xref) : (Stream *)NULL;
+  // color maps may cache conversions, so each playback gets its own
+  colorMapA = colorMap ? colorMap->copy() : (GfxImageColorMap *)NULL;
+  maskColorMapA = maskColorMap ? maskColorMap->copy()
+                               : (GfxImageColorMap *)NULL;
+  switch (kind) {
+  case dlImageMask:
+    p->out->drawImageMask(p->state, &ref, str, width, height, invert,
+			  interpolate, inlineImg);
+    break;
+  case dlSoftMaskFromImageMask:
+    transformCTM(p, baseMatrix, p->baseMatrix);
+    p->out->setSoftMaskFromImageMask(p->state, &ref, str, width, height,
+				     invert, inlineImg, p->baseMatrix);
+    break;
+  case dlImage:
+    p->out->drawImage(p->state, &ref, str, width, height, colorMapA,
+		      interpolate, maskColors, inlineImg);
+    break;
+  case dlMaskedImage:
+    p->out->drawMaskedImage(p->state, &ref, str, width, height, colorMapA,
+			    interpolate, maskStr, maskWidth, maskHeight,
+			    maskInvert, maskInterpolate);
+    break;
+  case dlSoftMaskedImage:
+    p->out->drawSoftMaskedImage(p->state, &ref, str, width, height,
+				colorMapA, interpolate, maskStr,
+				maskWidth, maskHeight, maskColorMapA,
+				maskInterpolate);
+    break;
+  }
+  delete str;
+  delete maskStr;
+  delete colorMapA;
+  delete maskColorMapA;
+}
+
+class DLUnsetSoftMaskOp: public DisplayListOp {
+public:
+
+  virtual void play(DisplayListPlayer *p)
+    { p->out->unsetSoftMaskFromImageMask(p->state, p->baseMatrix); }
+};
+
+//------------------------------------------------------------------------
+
+enum DLGroupKind {
+  dlBeginTransparencyGroup,
+  dlEndTransparencyGroup,
+  dlPaintTransparencyGroup,
+  dlSetSoftMask,
+  dlClearSoftMask
+};
+
+class DLGroupOp: public DisplayListOp {
+public:
+
+  DLGroupOp(DLGroupKind kindA, double *bboxA) {
+    kind = kindA;
+    if (bboxA) {
+      memcpy(bbox, bboxA, 4 * sizeof(double));
+    } else {
+      bbox[0] = bbox[1] = bbox[2] = bbox[3] = 0;
+    }
+    colorSpace = NULL;
+    isolated = knockout = forSoftMask = alpha = gFalse;
+    transferFunc = NULL;
+    hasBackdrop = gFalse;
+  }
+
+  virtual ~DLGroupOp() {
+    delete colorSpace;
+    delete transferFunc;
+  }
+
+  virtual void play(DisplayListPlayer *p);
+
+  GfxColorSpace *colorSpace;
+  GBool isolated, knockout, forSoftMask;
+  GBool alpha;
+  Function *transferFunc;
+  GfxColor backdropColor;
+  GBool hasBackdrop;
+
+private:
+
+  DLGroupKind kind;
+  double bbox[4];
+};
+
+void DLGroupOp::play(DisplayListPlayer *p) {
+  GfxColorSpace *cs;
+  Function *func;
+
+  switch (kind) {
+  case dlBeginTransparencyGroup:
+    // the OutputDev may keep the color space until the soft mask is set
+    cs = NULL;
+    if (colorSpace) {
+      cs = colorSpace->copy();
+      p->colorSpaces->append(cs);
+    }
+    p->out->beginTransparencyGroup(p->state, bbox, cs,
+				   isolated, knockout, forSoftMask);
+    break;
+  case dlEndTransparencyGroup:
+    p->out->endTransparencyGroup(p->state);
+    break;
+  case dlPaintTransparencyGroup:
+    p->out->paintTransparencyGroup(p->state, bbox);
+    break;
+  case dlSetSoftMask:
+    func = transferFunc ? transferFunc->copy() : (Function *)NULL;
+    p->out->setSoftMask(p->state, bbox, alpha, func,
+			hasBackdrop ? &backdropColor : (GfxColor *)NULL);
+    delete func;
+    break;
+  case dlClearSoftMask:
+    p->out->clearSoftMask(p->state);
+    break;
+  }
+}
+
+//------------------------------------------------------------------------
+// DisplayList
+//------------------------------------------------------------------------
+
+DisplayList::DisplayList(int pageNumA, XRef *xrefA, double *baseCTMA) {
+  pageNum = pageNumA;
+  xref = xrefA;
+  memcpy(baseCTM, baseCTMA, 6 * sizeof(double));
+  ops = new GooList();
+  exact = gTrue;
+}
+
+DisplayList::~DisplayList() {
+  deleteGooList(ops, DisplayListOp);
+}
+
+void DisplayList::append(DisplayListOp *op) {
+  ops->append(op);
+}
+
+// Set up the page the way Page::createGfx and the Gfx constructor do.
+GfxState *DisplayList::makeState(OutputDev *out, Page *page,
+				 double hDPI, double vDPI,
+				 int rotate, GBool useMediaBox,
+				 int sliceX, int sliceY,
+				 int sliceW, int sliceH) {
+  PDFRectangle box;
+  GBool crop;
+
+  rotate += page->getRotate();
+  if (rotate >= 360) {
+    rotate -= 360;
+  } else if (rotate < 0) {
+    rotate += 360;
+  }
+  crop = gFalse;
+  page->makeBox(hDPI, vDPI, rotate, useMediaBox, out->upsideDown(),
+		sliceX, sliceY, sliceW, sliceH, &box, &crop);
+  return new GfxState(hDPI, vDPI, &box, rotate, out->upsideDown());
+}
+
+void DisplayList::startPage(OutputDev *out, Page *page,
+			    double hDPI, double vDPI,
+			    int rotate, GBool useMediaBox,
+			    int sliceX, int sliceY, int sliceW, int sliceH) {
+  GfxState *state;
+
+  state = makeState(out, page, hDPI, vDPI, rotate, useMediaBox,
+		    sliceX, sliceY, sliceW, sliceH);
+  out->startPage(pageNum, state, xref);
+  out->setDefaultCTM(state->getCTM());
+  delete state;
+}
+
+void DisplayList::display(OutputDev *out, Page *page,
+			  double hDPI, double vDPI,
+			  int rotate, GBool useMediaBox,
+			  int sliceX, int sliceY, int sliceW, int sliceH) {
+  DisplayListPlayer p;
+  double *ctm;
+  double ibase[6], det;
+  int i;
+
+  p.out = out;
+  p.state = makeState(out, page, hDPI, vDPI, rotate, useMediaBox,
+		      sliceX, sliceY, sliceW, sliceH);
+  p.xref = xref;
+  p.colorSpaces = new GooList();
+  out->startPage(pageNum, p.state, xref);
+  out->setDefaultCTM(p.state->getCTM());
+
+  // recorded CTMs are mapped through the inverse of the recording's
+  // default CTM and then the new one
+  det = baseCTM[0] * baseCTM[3] - baseCTM[1] * baseCTM[2];
+  if (det == 0) {
+    det = 1;
+  }
+  det = 1 / det;
+  ibase[0] = baseCTM[3] * det;
+  ibase[1] = -baseCTM[1] * det;
+  ibase[2] = -baseCTM[2] * det;
+  ibase[3] = baseCTM[0] * det;
+  ibase[4] = (baseCTM[2] * baseCTM[5] - baseCTM[3] * baseCTM[4]) * det;
+  ibase[5] = (baseCTM[1] * baseCTM[4] - baseCTM[0] * baseCTM[5]) * det;
+  ctm = p.state->getCTM();
+  p.mat[0] = ibase[0] * ctm[0] + ibase[1] * ctm[2];
+  p.mat[1] = ibase[0] * ctm[1] + ibase[1] * ctm[3];
+  p.mat[2] = ibase[2] * ctm[0] + ibase[3] * ctm[2];
+  p.mat[3] = ibase[2] * ctm[1] + ibase[3] * ctm[3];
+  p.mat[4] = ibase[4] * ctm[0] + ibase[5] * ctm[2] + ctm[4];
+  p.mat[5] = ibase[4] * ctm[1] + ibase[5] * ctm[3] + ctm[5];
+  p.sameCTM = !memcmp(ctm, baseCTM, 6 * sizeof(double));
+  for (i = 0; i < 6; ++i) {
+    p.baseMatrix[i] = ctm[i];
+  }
+
+  for (i = 0; i < ops->getLength(); ++i) {
+    ((DisplayListOp *)ops->get(i))->play(&p);
+  }
+
+  out->dump();
+  out->endPage();
+  while (p.state->hasSaves()) {
+    p.state = p.state->restore();
+  }
+  delete p.state;
+  deleteGooList(p.colorSpaces, GfxColorSpace);
+}
+
+//------------------------------------------------------------------------
+// DisplayListOutputDev
+//------------------------------------------------------------------------
+
+// An entry on the mask state stack: a saveState() or the start of a
+// transparency group.
+struct DLMaskState {
+  GBool group;
+  GBool softMask;		// the soft mask was set before this entry
+  GBool knockoutGroup;		// non-isolated knockout group
+};
+
+DisplayListOutputDev::DisplayListOutputDev(GBool upsideDownA) {
+  upsideDownFlag = upsideDownA;
+  target = NULL;
+  silent = gFalse;
+  list = NULL;
+  lastList = NULL;
+  softMask = gFalse;
+  maskStack = NULL;
+  maskStackLen = maskStackSize = 0;
+}
+
+DisplayListOutputDev::~DisplayListOutputDev() {
+  delete list;
+  delete lastList;
+  gfree(maskStack);
+}
+
+DisplayList *DisplayListOutputDev::takeDisplayList() {
+  DisplayList *l;
+
+  l = lastList;
+  lastList = NULL;
+  return l;
+}
+
+// Gfx only asks these when the page has a tiling pattern, a shading
+// or a Type 3 glyph, which it then breaks down.
+GBool DisplayListOutputDev::useTilingPatternFill() {
+  if (list) {
+    list->exact = gFalse;
+  }
+  return gFalse;
+}
+
+GBool DisplayListOutputDev::useShadedFills(int type) {
+  if (list) {
+    list->exact = gFalse;
+  }
+  return gFalse;
+}
+
+GBool DisplayListOutputDev::interpretType3Chars() {
+  if (list) {
+    list->exact = gFalse;
+  }
+  return gTrue;
+}
+
+GBool DisplayListOutputDev::useReducedImages() {
+  return target ? target->useReducedImages() : gFalse;
+}
+
+GBool DisplayListOutputDev::checkTransparencyGroup(GfxState *state,
+						   GBool knockout) {
+  if (!target || target->checkTransparencyGroup(state, knockout)) {
+    return gTrue;
+  }
+  // the target may still want a group because of its own soft mask or
+  // an enclosing knockout group, which it can't be asked about here
+  if (list && (softMask || inKnockoutGroup())) {
+    list->exact = gFalse;
+  }
+  return gFalse;
+}
+
+void DisplayListOutputDev::pushMaskState(GBool group, GBool knockoutGroup) {
+  DLMaskState *m;
+
+  if (maskStackLen == maskStackSize) {
+    maskStackSize = maskStackSize ? 2 * maskStackSize : 16;
+    maskStack = (DLMaskState *)greallocn(maskStack, maskStackSize,
+					 sizeof(DLMaskState));
+  }
+  m = &maskStack[maskStackLen++];
+  m->group = group;
+  m->softMask = softMask;
+  m->knockoutGroup = knockoutGroup;
+  if (group) {
+    // a group is drawn with a new Splash, without a soft mask
+    softMask = gFalse;
+  }
+}
+
+// Pop a saved state, or everything up to the start of the innermost
+// group.  A restore never pops a group.
+void DisplayListOutputDev::popMaskState(GBool group) {
+  while (maskStackLen > 0) {
+    if (maskStack[maskStackLen - 1].group && !group) {
+      return;
+    }
+    --maskStackLen;
+    softMask = maskStack[maskStackLen].softMask;
+    if (maskStack[maskStackLen].group || !group) {
+      return;
+    }
+  }
+}
+
+GBool DisplayListOutputDev::inKnockoutGroup() {
+  int i;
+
+  for (i = maskStackLen - 1; i >= 0; --i) {
+    if (maskStack[i].group) {
+      return maskStack[i].knockoutGroup;
+    }
+  }
+  return gFalse;
+}
+
+void DisplayListOutputDev::record(DisplayListOp *op) {
+  if (list) {
+    list->append(op);
+  } else {
+    delete op;
+  }
+}
+
+void DisplayListOutputDev::recordParam(int param, double v) {
+  record(new DLParamOp((DLParam)param, v, !silent));
+}
+
+// Gfx changes the CTM without calling updateCTM() in a few places;
+// make sure drawing operations are played back with the right one.
+void DisplayListOutputDev::checkCTM(GfxState *state) {
+  if (memcmp(curCTM, state->getCTM(), 6 * sizeof(double))) {
+    memcpy(curCTM, state->getCTM(), 6 * sizeof(double));
+    record(new DLCTMOp(curCTM, NULL, gFalse));
+  }
+}
+
+void DisplayListOutputDev::recordPath(int kind, GfxState *state) {
+  checkCTM(state);
+  record(new DLPathOp((DLPathKind)kind, state->getPath()));
+}
+
+void DisplayListOutputDev::recordText(int kind, GooString *s) {
+  record(new DLTextOp((DLTextKind)kind, s));
+}
+
+void DisplayListOutputDev::startPage(int pageNum, GfxState *state,
+				     XRef *xref) {
+  delete list;
+  list = new DisplayList(pageNum, xref, state->getCTM());
+  memcpy(curCTM, state->getCTM(), 6 * sizeof(double));
+  softMask = gFalse;
+  maskStackLen = 0;
+}
+
+void DisplayListOutputDev::endPage() {
+  delete lastList;
+  lastList = list;
+  list = NULL;
+}
+
+void DisplayListOutputDev::saveState(GfxState *state) {
+  record(new DLSaveOp(gTrue));
+  pushMaskState(gFalse, gFalse);
+}
+
+void DisplayListOutputDev::restoreState(GfxState *state) {
+  record(new DLSaveOp(gFalse));
+  popMaskState(gFalse);
+  memcpy(curCTM, state->getCTM(), 6 * sizeof(double));
+}
+
+void DisplayListOutputDev::updateAll(GfxState *state) {
+  silent = gTrue;
+  OutputDev::updateAll(state);
+  silent = gFalse;
+  record(new DLUpdateAllOp());
+}
+
+void DisplayListOutputDev::updateCTM(GfxState *state, double m11, double m12,
+				     double m21, double m22,
+				     double m31, double m32) {
+  double params[6];
+
+  params[0] = m11; params[1] = m12;
+  params[2] = m21; params[3] = m22;
+  params[4] = m31; params[5] = m32;
+  memcpy(curCTM, state->getCTM(), 6 * sizeof(double));
+  record(new DLCTMOp(curCTM, params, gTrue));
+}
+
+void DisplayListOutputDev::updateLineDash(GfxState *state) {
+  record(new DLLineDashOp(state, !silent));
+}
+
+void DisplayListOutputDev::updateFlatness(GfxState *state) {
+  recordParam(dlFlatness, state->getFlatness());
+}
+
+void DisplayListOutputDev::updateLineJoin(GfxState *state) {
+  recordParam(dlLineJoin, state->getLineJoin());
+}
+
+void DisplayListOutputDev::updateLineCap(GfxState *state) {
+  recordParam(dlLineCap, state->getLineCap());
+}
+
+void DisplayListOutputDev::updateMiterLimit(GfxState *state) {
+  recordParam(dlMiterLimit, state->getMiterLimit());
+}
+
+void DisplayListOutputDev::updateLineWidth(GfxState *state) {
+  recordParam(dlLineWidth, state->getLineWidth());
+}
+
+void DisplayListOutputDev::updateStrokeAdjust(GfxState *state) {
+  recordParam(dlStrokeAdjust, state->getStrokeAdjust());
+}
+
+void DisplayListOutputDev::updateAlphaIsShape(GfxState *state) {
+  recordParam(dlAlphaIsShape, state->getAlphaIsShape());
+}
+
+void DisplayListOutputDev::updateTextKnockout(GfxState *state) {
+  recordParam(dlTextKnockout, state->getTextKnockout());
+}
+
+void DisplayListOutputDev::updateFillColorSpace(GfxState *state) {
+  record(new DLColorSpaceOp(state->getFillColorSpace(), gFalse, !silent));
+}
+
+void DisplayListOutputDev::updateStrokeColorSpace(GfxState *state) {
+  record(new DLColorSpaceOp(state->getStrokeColorSpace(), gTrue, !silent));
+}
+
+void DisplayListOutputDev::updateFillColor(GfxState *state) {
+  record(new DLColorOp(state->getFillColor(), gFalse, !silent));
+}
+
+void DisplayListOutputDev::updateStrokeColor(GfxState *state) {
+  record(new DLColorOp(state->getStrokeColor(), gTrue, !silent));
+}
+
+void DisplayListOutputDev::updateBlendMode(GfxState *state) {
+  recordParam(dlBlendMode, state->getBlendMode());
+}
+
+void DisplayListOutputDev::updateFillOpacity(GfxState *state) {
+  recordParam(dlFillOpacity, state->getFillOpacity());
+}
+
+void DisplayListOutputDev::updateStrokeOpacity(GfxState *state) {
+  recordParam(dlStrokeOpacity, state->getStrokeOpacity());
+}
+
+void DisplayListOutputDev::updateFillOverprint(GfxState *state) {
+  recordParam(dlFillOverprint, state->getFillOverprint());
+}
+
+void DisplayListOutputDev::updateStrokeOverprint(GfxState *state) {
+  recordParam(dlStrokeOverprint, state->getStrokeOverprint());
+}
+
+void DisplayListOutputDev::updateOverprintMode(GfxState *state) {
+  recordParam(dlOverprintMode, state->getOverprintMode());
+}
+
+void DisplayListOutputDev::updateTransfer(GfxState *state) {
+  record(new DLTransferOp(state->getTransfer(), !silent));
+}
+
+void DisplayListOutputDev::updateFont(GfxState *state) {
+  record(new DLFontOp(state->getFont(), state->getFontSize(), !silent));
+}
+
+void DisplayListOutputDev::updateTextMat(GfxState *state) {
+  record(new DLTextStateOp(dlTextMat, state, 0));
+}
+
+void DisplayListOutputDev::updateCharSpace(GfxState *state) {
+  recordParam(dlCharSpace, state->getCharSpace());
+}
+
+void DisplayListOutputDev::updateRender(GfxState *state) {
+  recordParam(dlRender, state->getRender());
+}
+
+void DisplayListOutputDev::updateRise(GfxState *state) {
+  recordParam(dlRise, state->getRise());
+}
+
+void DisplayListOutputDev::updateWordSpace(GfxState *state) {
+  recordParam(dlWordSpace, state->getWordSpace());
+}
+
+void DisplayListOutputDev::updateHorizScaling(GfxState *state) {
+  recordParam(dlHorizScaling, state->getHorizScaling());
+}
+
+void DisplayListOutputDev::updateTextPos(GfxState *state) {
+  record(new DLTextStateOp(dlTextPos, state, 0));
+}
+
+void DisplayListOutputDev::updateTextShift(GfxState *state, double shift) {
+  record(new DLTextStateOp(dlTextShift, state, shift));
+}
+
+void DisplayListOutputDev::stroke(GfxState *state) {
+  recordPath(dlStroke, state);
+}
+
+void DisplayListOutputDev::fill(GfxState *state) {
+  recordPath(dlFill, state);
+}
+
+void DisplayListOutputDev::eoFill(GfxState *state) {
+  recordPath(dlEOFill, state);
+}
+
+void DisplayListOutputDev::clip(GfxState *state) {
+  recordPath(dlClip, state);
+}
+
+void DisplayListOutputDev::eoClip(GfxState *state) {
+  recordPath(dlEOClip, state);
+}
+
+void DisplayListOutputDev::clipToStrokePath(GfxState *state) {
+  recordPath(dlClipToStrokePath, state);
+}
+
+void DisplayListOutputDev::beginStringOp(GfxState *state) {
+  recordText(dlBeginStringOp, NULL);
+}
+
+void DisplayListOutputDev::endStringOp(GfxState *state) {
+  recordText(dlEndStringOp, NULL);
+}
+
+void DisplayListOutputDev::beginString(GfxState *state, GooString *s) {
+  recordText(dlBeginString, s);
+}
+
+void DisplayListOutputDev::endString(GfxState *state) {
+  recordText(dlEndString, NULL);
+}
+
+void DisplayListOutputDev::drawChar(GfxState *state, double x, double y,
+				    double dx, double dy,
+				    double originX, double originY,
+				    CharCode code, int nBytes,
+				    Unicode *u, int uLen) {
+  checkCTM(state);
+  record(new DLCharOp(x, y, dx, dy, originX, originY, code, nBytes, u, uLen));
+}
+
+void DisplayListOutputDev::beginTextObject(GfxState *state) {
+  recordText(dlBeginTextObject, NULL);
+}
+
+void DisplayListOutputDev::endTextObject(GfxState *state) {
+  checkCTM(state);
+  recordText(dlEndTextObject, NULL);
+}
+
+void DisplayListOutputDev::beginActualText(GfxState *state, GooString *text) {
+  recordText(dlBeginActualText, text);
+}
+
+void DisplayListOutputDev::endActualText(GfxState *state) {
+  recordText(dlEndActualText, NULL);
+}
+
+void DisplayListOutputDev::drawImageMask(GfxState *state, Object *ref,
+					 Stream *str, int width, int height,
+					 GBool invert, GBool interpolate,
+					 GBool inlineImg) {
+  DLImageOp *op;
+
+  checkCTM(state);
+  op = new DLImageOp(dlImageMask, ref, str, width, height, NULL);
+  op->invert = invert;
+  op->interpolate = interpolate;
+  op->inlineImg = inlineImg;
+  record(op);
+}
+
+void DisplayListOutputDev::setSoftMaskFromImageMask(GfxState *state,
+						    Object *ref, Stream *str,
+						    int width, int height,
+						    GBool invert,
+						    GBool inlineImg,
+						    double *baseMatrix) {
+  DLImageOp *op;
+
+  checkCTM(state);
+  op = new DLImageOp(dlSoftMaskFromImageMask, ref, str, width, height, NULL);
+  // drawn in a transparency group, like the one below
+  pushMaskState(gTrue, gFalse);
+  op->invert = invert;
+  op->inlineImg = inlineImg;
+  memcpy(op->baseMatrix, baseMatrix, 6 * sizeof(double));
+  record(op);
+}
+
+void DisplayListOutputDev::unsetSoftMaskFromImageMask(GfxState *state,
+						      double *baseMatrix) {
+  checkCTM(state);
+  record(new DLUnsetSoftMaskOp());
+  popMaskState(gTrue);
+}
+
+void DisplayListOutputDev::drawImage(GfxState *state, Object *ref,
+				     Stream *str, int width, int height,
+				     GfxImageColorMap *colorMap,
+				     GBool interpolate, int *maskColors,
+				     GBool inlineImg) {
+  DLImageOp *op;
+  int n;
+
+  checkCTM(state);
+  op = new DLImageOp(dlImage, ref, str, width, height, colorMap);
+  op->interpolate = interpolate;
+  op->inlineImg = inlineImg;
+  if (maskColors) {
+    n = 2 * colorMap->getNumPixelComps();
+    op->maskColors = (int *)gmallocn(n, sizeof(int));
+    memcpy(op->maskColors, maskColors, n * sizeof(int));
+  }
+  record(op);
+}
+
+void DisplayListOutputDev::drawMaskedImage(GfxState *state, Object *ref,
+					   Stream *str, int width, int height,
+					   GfxImageColorMap *colorMap,
+					   GBool interpolate,
+					   Stream *maskStr,
+					   int maskWidth, int maskHeight,
+					   GBool maskInvert,
+					   GBool maskInterpolate) {
+  DLImageOp *op;
+
+  checkCTM(state);
+  op = new DLImageOp(dlMaskedImage, ref, str, width, height, colorMap);
+  op->interpolate = interpolate;
+  op->maskData = new DLImageData(maskStr, maskWidth, maskHeight, 1, 1);
+  op->maskWidth = maskWidth;
+  op->maskHeight = maskHeight;
+  op->maskInvert = maskInvert;
+  op->maskInterpolate = maskInterpolate;
+  record(op);
+}
+
+void DisplayListOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref,
+					       Stream *str,
+					       int width, int height,
+					       GfxImageColorMap *colorMap,
+					       GBool interpolate,
+					       Stream *maskStr,
+					       int maskWidth, int maskHeight,
+					       GfxImageColorMap *maskColorMap,
+					       GBool maskInterpolate) {
+  DLImageOp *op;
+
+  checkCTM(state);
+  op = new DLImageOp(dlSoftMaskedImage, ref, str, width, height, colorMap);
+  op->interpolate = interpolate;
+  op->maskData = new DLImageData(maskStr, maskWidth, maskHeight,
+				 maskColorMap->getNumPixelComps(),
+				 maskColorMap->getBits());
+  op->maskWidth = maskWidth;
+  op->maskHeight = maskHeight;
+  op->maskColorMap = maskColorMap->copy();
+  op->maskInterpolate = maskInterpolate;
+  record(op);
+}
+
+void DisplayListOutputDev::beginTransparencyGroup(GfxState *state,
+						  double *bbox,
+						  GfxColorSpace *blendingColorSpace,
+						  GBool isolated, GBool knockout,
+						  GBool forSoftMask) {
+  DLGroupOp *op;
+
+  checkCTM(state);
+  op = new DLGroupOp(dlBeginTransparencyGroup, bbox);
+  pushMaskState(gTrue, knockout && !isolated);
+  if (blendingColorSpace) {
+    op->colorSpace = blendingColorSpace->copy();
+  }
+  op->isolated = isolated;
+  op->knockout = knockout;
+  op->forSoftMask = forSoftMask;
+  record(op);
+}
+
+void DisplayListOutputDev::endTransparencyGroup(GfxState *state) {
+  checkCTM(state);
+  record(new DLGroupOp(dlEndTransparencyGroup, NULL));
+  popMaskState(gTrue);
+}
+
+void DisplayListOutputDev::paintTransparencyGroup(GfxState *state,
+						  double *bbox) {
+  checkCTM(state);
+  record(new DLGroupOp(dlPaintTransparencyGroup, bbox));
+}
+
+void DisplayListOutputDev::setSoftMask(GfxState *state, double *bbox,
+				       GBool alpha, Function *transferFunc,
+				       GfxColor *backdropColor) {
+  DLGroupOp *op;
+
+  checkCTM(state);
+  op = new DLGroupOp(dlSetSoftMask, bbox);
+  softMask = gTrue;
+  op->alpha = alpha;
+  if (transferFunc) {
+    op->transferFunc = transferFunc->copy();
+  }
+  if (backdropColor) {
+    op->backdropColor = *backdropColor;
+    op->hasBackdrop = gTrue;
+  }
+  record(op);
+}
+
+void DisplayListOutputDev::clearSoftMask(GfxState *state) {
+  record(new DLGroupOp(dlClearSoftMask, NULL));
+  softMask = gFalse;
+}
@@ -0,0 +1,266 @@
+//========================================================================
+//
+// DisplayListOutputDev.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef DISPLAYLISTOUTPUTDEV_H
+#define DISPLAYLISTOUTPUTDEV_H
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "goo/gtypes.h"
+#include "OutputDev.h"
+
+class GooList;
+class GfxState;
+class Page;
+class XRef;
+class DisplayListOp;
+struct DisplayListPlayer;
+struct DLMaskState;
+
+//------------------------------------------------------------------------
+// DisplayList
+//------------------------------------------------------------------------
+
+// The OutputDev calls made while displaying one page, with the paths,
+// fonts, colors and decoded image data they used.  A display list can
+// be played back into another OutputDev at any resolution, rotation or
+// slice without parsing the page again.
+//
+// Playing back uses the fonts of the recorded document, so the PDFDoc
+// must outlive the display list.  Several threads may play the same
+// display list back at the same time, each into its own OutputDev.
+class DisplayList {
+public:
+
+  ~DisplayList();
+
+  // Play the page back into <out>.  The arguments are those of
+  // Page::displaySlice; <page> must be the page that was recorded.
+  // Clipping to the crop box is decided when recording.
+  void display(OutputDev *out, Page *page, double hDPI, double vDPI,
+	       int rotate, GBool useMediaBox,
+	       int sliceX = -1, int sliceY = -1,
+	       int sliceW = -1, int sliceH = -1);
+
+  // Only call <out>->startPage() and setDefaultCTM(), with the same
+  // GfxState display() would use.
+  void startPage(OutputDev *out, Page *page, double hDPI, double vDPI,
+		 int rotate, GBool useMediaBox,
+		 int sliceX = -1, int sliceY = -1,
+		 int sliceW = -1, int sliceH = -1);
+
+  int getPageNum() { return pageNum; }
+
+  // Returns false if Gfx broke shadings, tiling patterns or Type 3
+  // glyphs down into other operations while recording, or if it had
+  // to guess whether a form needs a transparency group.  Otherwise,
+  // playing the list back at the resolution, rotation and slice it
+  // was recorded at makes the same calls as displaying the page into
+  // the recorder's target device does.
+  GBool isExact() { return exact; }
+
+private:
+
+  DisplayList(int pageNumA, XRef *xrefA, double *baseCTMA);
+
+  void append(DisplayListOp *op);
+  GfxState *makeState(OutputDev *out, Page *page, double hDPI, double vDPI,
+		      int rotate, GBool useMediaBox,
+		      int sliceX, int sliceY, int sliceW, int sliceH);
+
+  int pageNum;
+  XRef *xref;
+  double baseCTM[6];		// default CTM of the recording
+  GooList *ops;			// [DisplayListOp]
+  GBool exact;
+
+  friend class DisplayListOutputDev;
+};
+
+//------------------------------------------------------------------------
+// DisplayListOutputDev
+//------------------------------------------------------------------------
+
+// Records a page into a DisplayList.  Pages are normally recorded at
+// 72 dpi with no rotation:
+//
+//   page->displaySlice(dlOut, 72, 72, 0, gFalse, gTrue, -1, -1, -1, -1,
+//                      gFalse);
+//   list = dlOut->takeDisplayList();
+//
+// Tiling patterns and shadings are recorded as the paths and images
+// Gfx breaks them into, and Type 3 glyphs as their drawing operators,
+// so the list plays back into any OutputDev.
+class DisplayListOutputDev: public OutputDev {
+public:
+
+  // <upsideDownA> should match the devices the list is played into.
+  DisplayListOutputDev(GBool upsideDownA = gTrue);
+  virtual ~DisplayListOutputDev();
+
+  // Return the list recorded for the last page, or NULL.  The caller
+  // owns the result.
+  DisplayList *takeDisplayList();
+
+  // Answer useReducedImages() and checkTransparencyGroup() the way
+  // <targetA> does, so Gfx records what it would draw into <targetA>.
+  // The target can only be asked about the graphics state, so lists
+  // where its answer could depend on its own soft mask or groups are
+  // marked inexact.  Without a target, images are recorded at full size and
+  // every form gets a transparency group.
+  void setTarget(OutputDev *targetA) { target = targetA; }
+
+  // Returns false as soon as the page being recorded is known not to
+  // play back exactly, see DisplayList::isExact().
+  GBool isExact() { return !list || list->isExact(); }
+
+  //----- get info about output device
+
+  virtual GBool upsideDown() { return upsideDownFlag; }
+  virtual GBool useDrawChar() { return gTrue; }
+  virtual GBool useTilingPatternFill();
+  virtual GBool useShadedFills(int type);
+  virtual GBool interpretType3Chars();
+  virtual GBool useReducedImages();
+
+  //----- initialization and control
+
+  virtual void startPage(int pageNum, GfxState *state, XRef *xref);
+  virtual void endPage();
+
+  //----- save/restore graphics state
+  virtual void saveState(GfxState *state);
+  virtual void restoreState(GfxState *state);
+
+  //----- update graphics state
+  virtual void updateAll(GfxState *state);
+  virtual void updateCTM(GfxState *state, double m11, double m12,
+			 double m21, double m22, double m31, double m32);
+  virtual void updateLineDash(GfxState *state);
+  virtual void updateFlatness(GfxState *state);
+  virtual void updateLineJoin(GfxState *state);
+  virtual void updateLineCap(GfxState *state);
+  virtual void updateMiterLimit(GfxState *state);
+  virtual void updateLineWidth(GfxState *state);
+  virtual void updateStrokeAdjust(GfxState *state);
+  virtual void updateAlphaIsShape(GfxState *state);
+  virtual void updateTextKnockout(GfxState *state);
+  virtual void updateFillColorSpace(GfxState *state);
+  virtual void updateStrokeColorSpace(GfxState *state);
+  virtual void updateFillColor(GfxState *state);
+  virtual void updateStrokeColor(GfxState *state);
+  virtual void updateBlendMode(GfxState *state);
+  virtual void updateFillOpacity(GfxState *state);
+  virtual void updateStrokeOpacity(GfxState *state);
+  virtual void updateFillOverprint(GfxState *state);
+  virtual void updateStrokeOverprint(GfxState *state);
+  virtual void updateOverprintMode(GfxState *state);
+  virtual void updateTransfer(GfxState *state);
+
+  //----- update text state
+  virtual void updateFont(GfxState *state);
+  virtual void updateTextMat(GfxState *state);
+  virtual void updateCharSpace(GfxState *state);
+  virtual void updateRender(GfxState *state);
+  virtual void updateRise(GfxState *state);
+  virtual void updateWordSpace(GfxState *state);
+  virtual void updateHorizScaling(GfxState *state);
+  virtual void updateTextPos(GfxState *state);
+  virtual void updateTextShift(GfxState *state, double shift);
+
+  //----- path painting
+  virtual void stroke(GfxState *state);
+  virtual void fill(GfxState *state);
+  virtual void eoFill(GfxState *state);
+
+  //----- path clipping
+  virtual void clip(GfxState *state);
+  virtual void eoClip(GfxState *state);
+  virtual void clipToStrokePath(GfxState *state);
+
+  //----- text drawing
+  virtual void beginStringOp(GfxState *state);
+  virtual void endStringOp(GfxState *state);
+  virtual void beginString(GfxState *state, GooString *s);
+  virtual void endString(GfxState *state);
+  virtual void drawChar(GfxState *state, double x, double y,
+			double dx, double dy,
+			double originX, double originY,
+			CharCode code, int nBytes, Unicode *u, int uLen);
+  virtual void beginTextObject(GfxState *state);
+  virtual void endTextObject(GfxState *state);
+  virtual void beginActualText(GfxState *state, GooString *text);
+  virtual void endActualText(GfxState *state);
+
+  //----- image drawing
+  virtual void drawImageMask(GfxState *state, Object *ref, Stream *str,
+			     int width, int height, GBool invert,
+			     GBool interpolate, GBool inlineImg);
+  virtual void setSoftMaskFromImageMask(GfxState *state,
+					Object *ref, Stream *str,
+					int width, int height, GBool invert,
+					GBool inlineImg, double *baseMatrix);
+  virtual void unsetSoftMaskFromImageMask(GfxState *state,
+					  double *baseMatrix);
+  virtual void drawImage(GfxState *state, Object *ref, Stream *str,
+			 int width, int height, GfxImageColorMap *colorMap,
+			 GBool interpolate, int *maskColors, GBool inlineImg);
+  virtual void drawMaskedImage(GfxState *state, Object *ref, Stream *str,
+			       int width, int height,
+			       GfxImageColorMap *colorMap, GBool interpolate,
+			       Stream *maskStr, int maskWidth, int maskHeight,
+			       GBool maskInvert, GBool maskInterpolate);
+  virtual void drawSoftMaskedImage(GfxState *state, Object *ref, Stream *str,
+				   int width, int height,
+				   GfxImageColorMap *colorMap,
+				   GBool interpolate,
+				   Stream *maskStr,
+				   int maskWidth, int maskHeight,
+				   GfxImageColorMap *maskColorMap,
+				   GBool maskInterpolate);
+
+  //----- transparency groups and soft masks
+  virtual GBool checkTransparencyGroup(GfxState *state, GBool knockout);
+  virtual void beginTransparencyGroup(GfxState *state, double *bbox,
+				      GfxColorSpace *blendingColorSpace,
+				      GBool isolated, GBool knockout,
+				      GBool forSoftMask);
+  virtual void endTransparencyGroup(GfxState *state);
+  virtual void paintTransparencyGroup(GfxState *state, double *bbox);
+  virtual void setSoftMask(GfxState *state, double *bbox, GBool alpha,
+			   Function *transferFunc, GfxColor *backdropColor);
+  virtual void clearSoftMask(GfxState *state);
+
+private:
+
+  void record(DisplayListOp *op);
+  void recordParam(int param, double v);
+  void checkCTM(GfxState *state);
+  void recordPath(int kind, GfxState *state);
+  void recordText(int kind, GooString *s);
+  void pushMaskState(GBool group, GBool knockoutGroup);
+  void popMaskState(GBool group);
+  GBool inKnockoutGroup();
+
+  GBool upsideDownFlag;
+  OutputDev *target;		// device the list is recorded for, or NULL
+  GBool silent;			// recording the parts of an updateAll()
+  DisplayList *list;		// list being recorded, or NULL
+  DisplayList *lastList;	// last completed list, or NULL
+  double curCTM[6];		// CTM as known to the playback
+
+  // the target's soft mask and transparency group state, as far as
+  // checkTransparencyGroup() needs it
+  GBool softMask;		// a soft mask is set
+  DLMaskState *maskStack;	// saved states and open groups
+  int maskStackLen, maskStackSize;
+};
+
+#endif
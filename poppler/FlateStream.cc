@@ -48,9 +48,19 @@ int FlateStream::getRawChar() {
   return doGetRawChar();
 }
 
-void FlateStream::getRawChars(int nChars, int *buffer) {
-  for (int i = 0; i < nChars; ++i)
-    buffer[i] = doGetRawChar();
+int FlateStream::getRawChars(int nChars, Guchar *buffer) {
+  int n, m;
+
+  for (n = 0; n < nChars; n += m) {
+    if (fill_buffer())
+      break;
+    m = out_buf_len - out_pos;
+    if (m > nChars - n)
+      m = nChars - n;
+    memcpy(buffer + n, out_buf + out_pos, m);
+    out_pos += m;
+  }
+  return n;
 }
 
 int FlateStream::getChar() {
@@ -51,7 +51,7 @@ public:
   virtual int getChar();
   virtual int lookChar();
   virtual int getRawChar();
-  virtual void getRawChars(int nChars, int *buffer);
+  virtual int getRawChars(int nChars, Guchar *buffer);
   virtual GooString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
 
@@ -311,6 +311,81 @@ Operator Gfx::opTab[] = {
 
 #define numOps (sizeof(opTab) / sizeof(Operator))
 
+//------------------------------------------------------------------------
+// GfxOpHashTable
+//------------------------------------------------------------------------
+
+// Operator names are at most 3 chars long, so they are packed into an
+// int and found by hashing instead of a strcmp binary search over
+// opTab.  The multiplier was chosen so that the operators currently in
+// opTab all land in different slots; anything added later that
+// collides is still found by linear probing.
+
+#define opHashSize 256
+#define opHashMul 0xcc3954a7u
+
+class GfxOpHashTable {
+public:
+
+  GfxOpHashTable(Operator *opTabA, int nOps);
+
+  Operator *lookup(const char *name);
+
+private:
+
+  static int packName(const char *name);
+  static int hash(int key)
+    { return (int)(((Guint)key * opHashMul) >> 24); }
+
+  int keys[opHashSize];
+  Operator *ops[opHashSize];
+};
+
+GfxOpHashTable::GfxOpHashTable(Operator *opTabA, int nOps) {
+  int i, h;
+
+  for (i = 0; i < opHashSize; ++i) {
+    keys[i] = 0;
+    ops[i] = NULL;
+  }
+  for (i = 0; i < nOps; ++i) {
+    const int key = packName(opTabA[i].name);
+    for (h = hash(key); ops[h]; h = (h + 1) & (opHashSize - 1)) ;
+    keys[h] = key;
+    ops[h] = &opTabA[i];
+  }
+}
+
+// Returns -1 for names too long to be an operator.
+inline int GfxOpHashTable::packName(const char *name) {
+  int key, i;
+
+  key = 0;
+  for (i = 0; name[i]; ++i) {
+    if (i == 3) {
+      return -1;
+    }
+    key = (key << 8) | (name[i] & 0xff);
+  }
+  return key;
+}
+
+inline Operator *GfxOpHashTable::lookup(const char *name) {
+  int key, h;
+
+  if ((key = packName(name)) < 0) {
+    return NULL;
+  }
+  for (h = hash(key); ops[h]; h = (h + 1) & (opHashSize - 1)) {
+    if (keys[h] == key) {
+      return ops[h];
+    }
+  }
+  return NULL;
+}
+
+GfxOpHashTable Gfx::opHashTable(Gfx::opTab, numOps);
+
 static inline GBool isSameGfxColor(const GfxColor &colorA, const GfxColor &colorB, Guint nComps, double delta) {
   for (Guint k = 0; k < nComps; ++k) {
     if (abs(colorA.c[k] - colorB.c[k]) > delta) {
@@ -530,6 +605,204 @@ GBool GfxResources::lookupGStateNF(char *name, Object *obj) {
   return gFalse;
 }
 
+//------------------------------------------------------------------------
+// GfxContentTokens
+//------------------------------------------------------------------------
+
+#if MULTITHREADED
+#  define tokensLocker()   MutexLocker locker(&mutex)
+#  define formCacheLocker()   MutexLocker locker(&mutex)
+#else
+#  define tokensLocker()
+#  define formCacheLocker()
+#endif
+
+// Rough estimate of the memory used by a content stream token.
+static Goffset tokenSize(Object *obj, int recursion) {
+  Object obj1;
+  Goffset n;
+  int i;
+
+  n = sizeof(Object);
+  if (recursion > 32) {
+    return n;
+  }
+  switch (obj->getType()) {
+  case objString:
+    n += sizeof(GooString) + obj->getString()->getLength();
+    break;
+  case objName:
+    n += strlen(obj->getName()) + 1;
+    break;
+  case objCmd:
+    n += strlen(obj->getCmd()) + 1;
+    break;
+  case objArray:
+    n += sizeof(Array);
+    for (i = 0; i < obj->arrayGetLength(); ++i) {
+      n += tokenSize(obj->arrayGetNF(i, &obj1), recursion + 1);
+      obj1.free();
+    }
+    break;
+  case objDict:
+    n += sizeof(Dict);
+    for (i = 0; i < obj->dictGetLength(); ++i) {
+      n += sizeof(DictEntry) + strlen(obj->dictGetKey(i)) + 1;
+      n += tokenSize(obj->dictGetValNF(i, &obj1), recursion + 1) - sizeof(Object);
+      obj1.free();
+    }
+    break;
+  default:
+    break;
+  }
+  return n;
+}
+
+GfxContentTokens::GfxContentTokens(Goffset maxBytesA) {
+  tokens = NULL;
+  length = size = 0;
+  opPos = NULL;
+  nOps = opPosSize = 0;
+  bytes = sizeof(GfxContentTokens);
+  maxBytes = maxBytesA;
+  ok = gTrue;
+  refCnt = 1;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+GfxContentTokens::~GfxContentTokens() {
+  abandon();
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+void GfxContentTokens::incRefCnt() {
+  tokensLocker();
+  ++refCnt;
+}
+
+void GfxContentTokens::decRefCnt() {
+  int n;
+
+  {
+    tokensLocker();
+    n = --refCnt;
+  }
+  if (n == 0) {
+    delete this;
+  }
+}
+
+void GfxContentTokens::add(Object *cmd, Object args[], int numArgs,
+			   Goffset pos) {
+  int i;
+
+  if (ok) {
+    for (i = 0; i < numArgs; ++i) {
+      append(&args[i]);
+    }
+    append(cmd);
+    if (nOps == opPosSize) {
+      opPosSize = opPosSize ? 2 * opPosSize : 16;
+      opPos = (Goffset *)greallocn(opPos, opPosSize, sizeof(Goffset));
+    }
+    opPos[nOps++] = pos;
+    bytes += sizeof(Goffset);
+    if (bytes > maxBytes) {
+      abandon();
+    }
+  } else {
+    for (i = 0; i < numArgs; ++i) {
+      args[i].free();
+    }
+    cmd->free();
+  }
+}
+
+void GfxContentTokens::append(Object *obj) {
+  if (length == size) {
+    size = size ? 2 * size : 64;
+    tokens = (Object *)greallocn(tokens, size, sizeof(Object));
+  }
+  tokens[length++] = *obj;
+  bytes += tokenSize(obj, 0);
+}
+
+void GfxContentTokens::abandon() {
+  int i;
+
+  for (i = 0; i < length; ++i) {
+    tokens[i].free();
+  }
+  gfree(tokens);
+  tokens = NULL;
+  length = size = 0;
+  gfree(opPos);
+  opPos = NULL;
+  nOps = opPosSize = 0;
+  bytes = sizeof(GfxContentTokens);
+  ok = gFalse;
+}
+
+//------------------------------------------------------------------------
+// GfxFormCache
+//------------------------------------------------------------------------
+
+GfxFormCache::GfxFormCache(Goffset maxBytesA): cache(maxBytesA) {
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+GfxFormCache::~GfxFormCache() {
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+GfxContentTokens *GfxFormCache::lookup(Ref ref) {
+  Entry *entry;
+
+  formCacheLocker();
+  if (!(entry = cache.lookup(ref.num)) || entry->gen != ref.gen) {
+    return NULL;
+  }
+  entry->tokens->incRefCnt();
+  return entry->tokens;
+}
+
+void GfxFormCache::put(Ref ref, GfxContentTokens *tokens) {
+  Entry *entry;
+
+  formCacheLocker();
+  if (!tokens->isOk()) {
+    return;
+  }
+  entry = new Entry;
+  entry->gen = ref.gen;
+  entry->tokens = tokens;
+  tokens->incRefCnt();
+  cache.put(ref.num, entry, tokens->getBytes());
+}
+
+void GfxFormCache::clear() {
+  formCacheLocker();
+  cache.clear();
+}
+
+void GfxFormCache::setMaxBytes(Goffset maxBytesA) {
+  formCacheLocker();
+  cache.setMaxBytes(maxBytesA);
+}
+
+Goffset GfxFormCache::getMaxBytes() {
+  formCacheLocker();
+  return cache.getMaxBytes();
+}
+
 //------------------------------------------------------------------------
 // Gfx
 //------------------------------------------------------------------------
@@ -550,6 +823,7 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, int pageNum, Dict *resDict,
   profileCommands = globalParams->getProfileCommands();
   mcStack = NULL;
   parser = NULL;
+  replayPos = -1;
 
   // start the resource stack
   res = new GfxResources(xref, resDict, NULL);
@@ -605,6 +879,7 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, Dict *resDict,
   profileCommands = globalParams->getProfileCommands();
   mcStack = NULL;
   parser = NULL;
+  replayPos = -1;
 
   // start the resource stack
   res = new GfxResources(xref, resDict, NULL);
@@ -707,7 +982,7 @@ Gfx::~Gfx() {
   }
 }
 
-void Gfx::display(Object *obj, GBool topLevel) {
+void Gfx::display(Object *obj, GBool topLevel, GfxContentTokens *rec) {
   Object obj2;
   int i;
 
@@ -717,25 +992,33 @@ void Gfx::display(Object *obj, GBool topLevel) {
       if (!obj2.isStream()) {
 	error(errSyntaxError, -1, "Weird page contents");
 	obj2.free();
+	if (rec) {
+	  rec->abandon();
+	}
 	return;
       }
       obj2.free();
     }
   } else if (!obj->isStream()) {
     error(errSyntaxError, -1, "Weird page contents");
+    if (rec) {
+      rec->abandon();
+    }
     return;
   }
   parser = new Parser(xref, new Lexer(xref, obj), gFalse);
-  go(topLevel);
+  go(topLevel, rec);
   delete parser;
   parser = NULL;
 }
 
-void Gfx::go(GBool topLevel) {
+void Gfx::go(GBool topLevel, GfxContentTokens *rec) {
   Object obj;
   Object args[maxArgs];
   int numArgs, i;
   int lastAbortCheck;
+  Goffset pos;
+  GBool cont;
 
   // scan a sequence of objects
   pushStateGuard();
@@ -748,66 +1031,31 @@ void Gfx::go(GBool topLevel) {
 
     // got a command - execute it
     if (obj.isCmd()) {
-      if (printCommands) {
-	obj.print(stdout);
-	for (i = 0; i < numArgs; ++i) {
-	  printf(" ");
-	  args[i].print(stdout);
-	}
-	printf("\n");
-	fflush(stdout);
+      // in-line image data is read straight from the parser, so it
+      // can't be recorded
+      if (rec && !strcmp(obj.getCmd(), "BI")) {
+	rec->abandon();
       }
-      GooTimer timer;
-
-      // Run the operation
-      execOp(&obj, args, numArgs);
-
-      // Update the profile information
-      if (profileCommands) {
-	GooHash *hash;
 
-	hash = out->getProfileHash ();
-	if (hash) {
-	  GooString *cmd_g;
-	  ProfileData *data_p;
+      pos = rec ? parser->getPos() : 0;
+      cont = runOp(&obj, args, numArgs, &lastAbortCheck);
 
-	  cmd_g = new GooString (obj.getCmd());
-	  data_p = (ProfileData *)hash->lookup (cmd_g);
-	  if (data_p == NULL) {
-	    data_p = new ProfileData();
-	    hash->add (cmd_g, data_p);
-	  }
-	  
-	  data_p->addElement(timer.getElapsed ());
-	}
+      if (rec) {
+	// rec owns the command now
+	rec->add(&obj, args, numArgs, pos);
+	obj.initNull();
+      } else {
+	obj.free();
+	for (i = 0; i < numArgs; ++i)
+	  args[i].free();
       }
-      obj.free();
-      for (i = 0; i < numArgs; ++i)
-	args[i].free();
       numArgs = 0;
 
-      // periodically update display
-      if (++updateLevel >= 20000) {
-	out->dump();
-	updateLevel = 0;
-      }
-
-      // did the command throw an exception
-      if (commandAborted) {
-	// don't propogate; recursive drawing comes from Form XObjects which
-	// should probably be drawn in a separate context anyway for caching
-	commandAborted = gFalse;
-	break;
-      }
-
-      // check for an abort
-      if (abortCheckCbk) {
-	if (updateLevel - lastAbortCheck > 10) {
-	  if ((*abortCheckCbk)(abortCheckCbkData)) {
-	    break;
-	  }
-	  lastAbortCheck = updateLevel;
+      if (!cont) {
+	if (rec) {
+	  rec->abandon();
 	}
+	break;
       }
 
     // got an argument - save it
@@ -855,6 +1103,106 @@ void Gfx::go(GBool topLevel) {
   }
 }
 
+// Run a content stream recorded by go().  The tokens may be shared
+// with other threads, so the operators only read their arguments.
+void Gfx::replay(GfxContentTokens *tokens) {
+  Object *toks;
+  Goffset *opPos;
+  Goffset oldReplayPos;
+  int n, i, firstArg, op;
+  int lastAbortCheck;
+
+  oldReplayPos = replayPos;
+  pushStateGuard();
+  updateLevel = 1;
+  lastAbortCheck = 0;
+  toks = tokens->getTokens();
+  opPos = tokens->getOpPositions();
+  n = tokens->getLength();
+  firstArg = 0;
+  op = 0;
+  for (i = 0; i < n; ++i) {
+    if (toks[i].isCmd()) {
+      commandAborted = gFalse;
+      replayPos = opPos[op++];
+      if (!runOp(&toks[i], &toks[firstArg], i - firstArg, &lastAbortCheck)) {
+	break;
+      }
+      firstArg = i + 1;
+    }
+  }
+  popStateGuard();
+  replayPos = oldReplayPos;
+}
+
+// Execute one operator with the debugging and abort handling shared by
+// go() and replay().  Returns false if the rest of the content stream
+// should be skipped.
+GBool Gfx::runOp(Object *cmd, Object args[], int numArgs,
+		 int *lastAbortCheck) {
+  int i;
+
+  if (printCommands) {
+    cmd->print(stdout);
+    for (i = 0; i < numArgs; ++i) {
+      printf(" ");
+      args[i].print(stdout);
+    }
+    printf("\n");
+    fflush(stdout);
+  }
+  GooTimer timer;
+
+  // Run the operation
+  execOp(cmd, args, numArgs);
+
+  // Update the profile information
+  if (profileCommands) {
+    GooHash *hash;
+
+    hash = out->getProfileHash ();
+    if (hash) {
+      GooString *cmd_g;
+      ProfileData *data_p;
+
+      cmd_g = new GooString (cmd->getCmd());
+      data_p = (ProfileData *)hash->lookup (cmd_g);
+      if (data_p == NULL) {
+	data_p = new ProfileData();
+	hash->add (cmd_g, data_p);
+      }
+	  
+      data_p->addElement(timer.getElapsed ());
+    }
+  }
+
+  // periodically update display
+  if (++updateLevel >= 20000) {
+    out->dump();
+    updateLevel = 0;
+  }
+
+  // did the command throw an exception
+  if (commandAborted) {
+    // don't propogate; recursive drawing comes from Form XObjects which
+    // should probably be drawn in a separate context anyway for caching
+    commandAborted = gFalse;
+    return gFalse;
+  }
+
+  // check for an abort
+  if (abortCheckCbk) {
+    if (updateLevel - *lastAbortCheck > 10) {
+      if ((*abortCheckCbk)(abortCheckCbkData)) {
+	return gFalse;
+      }
+      *lastAbortCheck = updateLevel;
+    }
+  }
+
+  return gTrue;
+}
+
 void Gfx::execOp(Object *cmd, Object args[], int numArgs) {
   Operator *op;
   char *name;
@@ -905,25 +1253,7 @@ void Gfx::execOp(Object *cmd, Object args[], int numArgs) {
 }
 
 Operator *Gfx::findOp(char *name) {
-  int a, b, m, cmp;
-
-  a = -1;
-  b = numOps;
-  cmp = 0; // make gcc happy
-  // invariant: opTab[a] < name < opTab[b]
-  while (b - a > 1) {
-    m = (a + b) / 2;
-    cmp = strcmp(opTab[m].name, name);
-    if (cmp < 0)
-      a = m;
-    else if (cmp > 0)
-      b = m;
-    else
-      a = b = m;
-  }
-  if (cmp != 0)
-    return NULL;
-  return &opTab[a];
+  return opHashTable.lookup(name);
 }
 
 GBool Gfx::checkArg(Object *arg, TchkType type) {
@@ -942,7 +1272,7 @@ GBool Gfx::checkArg(Object *arg, TchkType type) {
 }
 
 Goffset Gfx::getPos() {
-  return parser ? parser->getPos() : -1;
+  return parser ? parser->getPos() : replayPos;
 }
 
 //------------------------------------------------------------------------
@@ -2283,6 +2613,9 @@ void Gfx::doTilingPatternFill(GfxTilingPattern *tPat,
 		       xi0, yi0, xi1, yi1, xstep, ystep)) {
     goto restore;
   } else {
+    // the content stream is parsed for the first tile only, or for
+    // every tile if it can't be recorded
+    GfxContentTokens *tokens = NULL;
     for (yi = yi0; yi < yi1; ++yi) {
       for (xi = xi0; xi < xi1; ++xi) {
         x = xi * xstep;
@@ -2290,9 +2623,13 @@ void Gfx::doTilingPatternFill(GfxTilingPattern *tPat,
         m1[4] = x * m[0] + y * m[2] + m[4];
         m1[5] = x * m[1] + y * m[3] + m[5];
         drawForm(tPat->getContentStream(), tPat->getResDict(),
-        	  m1, tPat->getBBox());
+        	  m1, tPat->getBBox(), gFalse, gFalse, NULL, gFalse, gFalse,
+        	  gFalse, NULL, NULL, &tokens);
       }
     }
+    if (tokens) {
+      tokens->decRefCnt();
+    }
   }
 
   // restore graphics state
@@ -4205,7 +4542,7 @@ void Gfx::opXObject(Object args[], int numArgs) {
       if (out->useDrawForm() && refObj.isRef()) {
 	out->drawForm(refObj.getRef());
       } else {
-	doForm(&obj1);
+	doForm(&obj1, &refObj);
       }
     }
     if (refObj.isRef() && shouldDoForm) {
@@ -4659,6 +4996,16 @@ void Gfx::doImage(Object *ref, Stream *str, GBool inlineImg) {
 	out->drawMaskedImage(state, ref, str, width, height, colorMap, interpolate,
 			     maskStr, maskWidth, maskHeight, maskInvert, maskInterpolate);
       } else {
+	// if the image will be drawn smaller than its native size, let
+	// the decoder skip the detail that would be thrown away anyway
+	if (!inlineImg && !haveColorKeyMask && out->useReducedImages()) {
+	  double *ctm = state->getCTM();
+	  double w = sqrt(ctm[0] * ctm[0] + ctm[1] * ctm[1]);
+	  double h = sqrt(ctm[2] * ctm[2] + ctm[3] * ctm[3]);
+	  str->reduceResolution(w < width ? (int)ceil(w) : width,
+				h < height ? (int)ceil(h) : height,
+				&width, &height);
+	}
 	out->drawImage(state, ref, str, width, height, colorMap, interpolate,
 		       haveColorKeyMask ? maskColors : (int *)NULL, inlineImg);
       }
@@ -4744,10 +5091,13 @@ GBool Gfx::checkTransparencyGroup(Dict *resDict) {
   return transpGroup;
 }
 
-void Gfx::doForm(Object *str) {
+void Gfx::doForm(Object *str, Object *ref) {
   Dict *dict;
   GBool transpGroup, isolated, knockout;
   GfxColorSpace *blendingColorSpace;
+  GfxFormCache *formCache;
+  GfxContentTokens *tokens;
+  GBool cached;
   Object matrixObj, bboxObj;
   double m[6], bbox[4];
   Object resObj;
@@ -4848,12 +5198,35 @@ void Gfx::doForm(Object *str) {
   }
   obj1.free();
 
+  // look for the parsed content stream in the form cache (if it is
+  // enabled); forms that were modified since the document was loaded
+  // aren't cached
+  formCache = NULL;
+  tokens = NULL;
+  cached = gFalse;
+  if (ref->isRef() && xref == doc->getXRef() &&
+      doc->getFormCache()->getMaxBytes() > 0 &&
+      ref->getRefNum() >= 0 && ref->getRefNum() < xref->getNumObjects() &&
+      !xref->getEntry(ref->getRefNum())->getFlag(XRefEntry::Updated)) {
+    formCache = doc->getFormCache();
+    tokens = formCache->lookup(ref->getRef());
+    cached = tokens != NULL;
+  }
+
   // draw it
   ++formDepth;
   drawForm(str, resDict, m, bbox,
-	  transpGroup, gFalse, blendingColorSpace, isolated, knockout);
+	  transpGroup, gFalse, blendingColorSpace, isolated, knockout,
+	  gFalse, NULL, NULL, formCache ? &tokens : (GfxContentTokens **)NULL);
   --formDepth;
 
+  if (tokens) {
+    if (!cached && tokens->isOk()) {
+      formCache->put(ref->getRef(), tokens);
+    }
+    tokens->decRefCnt();
+  }
+
   if (blendingColorSpace) {
     delete blendingColorSpace;
   }
@@ -4867,7 +5240,7 @@ void Gfx::drawForm(Object *str, Dict *resDict, double *matrix, double *bbox,
 		  GfxColorSpace *blendingColorSpace,
 		  GBool isolated, GBool knockout,
 		  GBool alpha, Function *transferFunc,
-		  GfxColor *backdropColor) {
+		  GfxColor *backdropColor, GfxContentTokens **tokens) {
   Parser *oldParser;
   GfxState *savedState;
   double oldBaseMatrix[6];
@@ -4927,8 +5300,17 @@ void Gfx::drawForm(Object *str, Dict *resDict, double *matrix, double *bbox,
 
   GfxState *stateBefore = state;
 
-  // draw the form
-  display(str, gFalse);
+  // draw the form; if it couldn't be recorded before, *tokens is
+  // left as it was, so that it isn't recorded again
+  if (tokens && *tokens && (*tokens)->isOk()) {
+    parser = NULL;
+    replay(*tokens);
+  } else if (tokens && !*tokens) {
+    *tokens = new GfxContentTokens(doc->getFormCache()->getMaxBytes());
+    display(str, gFalse, *tokens);
+  } else {
+    display(str, gFalse);
+  }
   
   if (stateBefore != state) {
     if (state->isParentState(stateBefore)) {
@@ -38,6 +38,8 @@
 #include "poppler-config.h"
 #include "goo/gtypes.h"
 #include "goo/GooList.h"
+#include "goo/GooLRUCache.h"
+#include "goo/GooMutex.h"
 #include "GfxState.h"
 #include "Object.h"
 #include "PopplerCache.h"
@@ -104,6 +106,8 @@ struct Operator {
   void (Gfx::*func)(Object args[], int numArgs);
 };
 
+class GfxOpHashTable;
+
 //------------------------------------------------------------------------
 
 class GfxResources {
@@ -137,6 +141,99 @@ private:
   GfxResources *next;
 };
 
+//------------------------------------------------------------------------
+// GfxContentTokens
+//------------------------------------------------------------------------
+
+// The operands and operators of a content stream, in stream order, so
+// that it can be run again without decoding and parsing it.  Each
+// operator is preceded by its operands.  The stream position of each
+// operator is kept too, for error messages.
+class GfxContentTokens {
+public:
+
+  // Stop recording once the tokens use more than <maxBytesA>.
+  GfxContentTokens(Goffset maxBytesA);
+
+  void incRefCnt();
+  void decRefCnt();
+
+  // Append an operator and its operands, taking ownership of them.
+  // <pos> is the position of the operator in the content stream.
+  void add(Object *cmd, Object args[], int numArgs, Goffset pos);
+
+  // Drop the recorded tokens; add() discards anything that follows.
+  void abandon();
+
+  GBool isOk() { return ok; }
+  Object *getTokens() { return tokens; }
+  int getLength() { return length; }
+  Goffset *getOpPositions() { return opPos; }
+  Goffset getBytes() { return bytes; }
+
+private:
+
+  ~GfxContentTokens();
+
+  void append(Object *obj);
+
+  Object *tokens;
+  int length;
+  int size;
+  Goffset *opPos;		// stream position of each operator
+  int nOps;
+  int opPosSize;
+  Goffset bytes;		// estimated memory used by the tokens
+  Goffset maxBytes;
+  GBool ok;
+  int refCnt;
+#if MULTITHREADED
+  GooMutex mutex;
+#endif
+};
+
+//------------------------------------------------------------------------
+// GfxFormCache
+//------------------------------------------------------------------------
+
+// Per-document LRU cache of the tokenized content streams of Form
+// XObjects, keyed by the form's object number and bounded by the
+// memory used by the tokens.
+class GfxFormCache {
+public:
+
+  GfxFormCache(Goffset maxBytesA);
+  ~GfxFormCache();
+
+  // Return the tokens of form <ref>, or NULL if they are not cached.
+  // The caller must call decRefCnt() on the result.
+  GfxContentTokens *lookup(Ref ref);
+
+  // Add <tokens> for form <ref>, evicting the least recently used
+  // forms if the memory budget is exceeded.
+  void put(Ref ref, GfxContentTokens *tokens);
+
+  // Drop all the cached forms.
+  void clear();
+
+  // A budget of 0 disables the cache.
+  void setMaxBytes(Goffset maxBytesA);
+  Goffset getMaxBytes();
+
+private:
+
+  struct Entry {
+    int gen;
+    GfxContentTokens *tokens;
+    ~Entry() { tokens->decRefCnt(); }
+  };
+
+  GooLRUCache<int, Entry> cache;	// keyed by object number
+#if MULTITHREADED
+  GooMutex mutex;
+#endif
+};
+
 //------------------------------------------------------------------------
 // Gfx
 //------------------------------------------------------------------------
@@ -163,8 +260,10 @@ public:
 
   XRef *getXRef() { return xref; }
 
-  // Interpret a stream or array of streams.
-  void display(Object *obj, GBool topLevel = gTrue);
+  // Interpret a stream or array of streams.  If <rec> is non-NULL,
+  // the operators and operands are also recorded in it.
+  void display(Object *obj, GBool topLevel = gTrue,
+	       GfxContentTokens *rec = NULL);
 
   // Display an annotation, given its appearance (a Form XObject),
   // border style, and bounding box (in default user space).
@@ -188,12 +287,18 @@ public:
 
   GBool checkTransparencyGroup(Dict *resDict);
 
+  // If <tokens> is non-NULL and points to recorded tokens, they are
+  // run instead of <str>; if it points to NULL, the tokens of <str>
+  // are recorded and returned there.  Tokens which could not be
+  // recorded (!isOk()) are returned too, and <str> is displayed
+  // without recording it when they are passed in again.
   void drawForm(Object *str, Dict *resDict, double *matrix, double *bbox,
 	       GBool transpGroup = gFalse, GBool softMask = gFalse,
 	       GfxColorSpace *blendingColorSpace = NULL,
 	       GBool isolated = gFalse, GBool knockout = gFalse,
 	       GBool alpha = gFalse, Function *transferFunc = NULL,
-	       GfxColor *backdropColor = NULL);
+	       GfxColor *backdropColor = NULL,
+	       GfxContentTokens **tokens = NULL);
 
   void pushResources(Dict *resDict);
   void popResources();
@@ -226,6 +331,8 @@ private:
   MarkedContentStack *mcStack;	// current BMC/EMC stack
 
   Parser *parser;		// parser for page content stream(s)
+  Goffset replayPos;		// stream position of the operator being
+				//   replayed, if parser is NULL
   
   std::set<int> formsDrawing;	// the forms that are being drawn
 
@@ -234,8 +341,11 @@ private:
   void *abortCheckCbkData;
 
   static Operator opTab[];	// table of operators
+  static GfxOpHashTable opHashTable; // hash index of opTab
 
-  void go(GBool topLevel);
+  void go(GBool topLevel, GfxContentTokens *rec);
+  void replay(GfxContentTokens *tokens);
+  GBool runOp(Object *cmd, Object args[], int numArgs, int *lastAbortCheck);
   void execOp(Object *cmd, Object args[], int numArgs);
   Operator *findOp(char *name);
   GBool checkArg(Object *arg, TchkType type);
@@ -357,7 +467,7 @@ private:
   // XObject operators
   void opXObject(Object args[], int numArgs);
   void doImage(Object *ref, Stream *str, GBool inlineImg);
-  void doForm(Object *str);
+  void doForm(Object *str, Object *ref);
 
   // in-line image operators
   void opBeginImage(Object args[], int numArgs);
@@ -245,6 +245,9 @@ GfxFont::GfxFont(const char *tagA, Ref idA, GooString *nameA,
   stretch = StretchNotDefined;
   weight = WeightNotDefined;
   refCnt = 1;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
   encodingName = new GooString("");
   hasToUnicode = gFalse;
 }
@@ -261,14 +264,32 @@ GfxFont::~GfxFont() {
   if (encodingName) {
     delete encodingName;
   }
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
 }
 
 void GfxFont::incRefCnt() {
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
   refCnt++;
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
 }
 
 void GfxFont::decRefCnt() {
-  if (--refCnt == 0)
+  GBool done;
+
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  done = --refCnt == 0;
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+  if (done)
     delete this;
 }
 
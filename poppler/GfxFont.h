@@ -34,11 +34,16 @@
 #pragma interface
 #endif
 
+#include "poppler-config.h"
 #include "goo/gtypes.h"
 #include "goo/GooString.h"
 #include "Object.h"
 #include "CharTypes.h"
 
+#if MULTITHREADED
+#include "goo/GooMutex.h"
+#endif
+
 class Dict;
 class CMap;
 class CharCodeToUnicode;
@@ -295,6 +300,9 @@ protected:
   double ascent;		// max height above baseline
   double descent;		// max depth below baseline
   int refCnt;
+#if MULTITHREADED
+  GooMutex mutex;
+#endif
   GBool ok;
   GBool hasToUnicode;
   GooString *encodingName;
@@ -553,6 +553,7 @@ public:
 
   // ICCBased-specific access.
   GfxColorSpace *getAlt() { return alt; }
+  Ref getRef() { return iccProfileStream; }
 
 private:
 
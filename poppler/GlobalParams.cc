@@ -622,6 +622,11 @@ GlobalParams::GlobalParams(const char *customPopplerDataDir)
   printCommands = gFalse;
   profileCommands = gFalse;
   errQuiet = gFalse;
+  mapLocalFiles = gFalse;
+  fetchCacheSize = 0;
+  formCacheSize = 0;
+  decodedImageCacheSize = 0;
+  jpxDecodeThreads = 1;
 
   cidToUnicodeCache = new CharCodeToUnicodeCache(cidToUnicodeCacheSize);
   unicodeToUnicodeCache =
@@ -1692,6 +1697,51 @@ GBool GlobalParams::getErrQuiet() {
   return errQuiet;
 }
 
+GBool GlobalParams::getMapLocalFiles() {
+  GBool map;
+
+  lockGlobalParams;
+  map = mapLocalFiles;
+  unlockGlobalParams;
+  return map;
+}
+
+Goffset GlobalParams::getFetchCacheSize() {
+  Goffset size;
+
+  lockGlobalParams;
+  size = fetchCacheSize;
+  unlockGlobalParams;
+  return size;
+}
+
+Goffset GlobalParams::getFormCacheSize() {
+  Goffset size;
+
+  lockGlobalParams;
+  size = formCacheSize;
+  unlockGlobalParams;
+  return size;
+}
+
+Goffset GlobalParams::getDecodedImageCacheSize() {
+  Goffset size;
+
+  lockGlobalParams;
+  size = decodedImageCacheSize;
+  unlockGlobalParams;
+  return size;
+}
+
+int GlobalParams::getJPXDecodeThreads() {
+  int n;
+
+  lockGlobalParams;
+  n = jpxDecodeThreads;
+  unlockGlobalParams;
+  return n;
+}
+
 CharCodeToUnicode *GlobalParams::getCIDToUnicode(GooString *collection) {
   GooString *fileName;
   CharCodeToUnicode *ctu;
@@ -1968,6 +2018,36 @@ void GlobalParams::setErrQuiet(GBool errQuietA) {
   unlockGlobalParams;
 }
 
+void GlobalParams::setMapLocalFiles(GBool mapLocalFilesA) {
+  lockGlobalParams;
+  mapLocalFiles = mapLocalFilesA;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setFetchCacheSize(Goffset fetchCacheSizeA) {
+  lockGlobalParams;
+  fetchCacheSize = fetchCacheSizeA;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setFormCacheSize(Goffset formCacheSizeA) {
+  lockGlobalParams;
+  formCacheSize = formCacheSizeA;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setDecodedImageCacheSize(Goffset decodedImageCacheSizeA) {
+  lockGlobalParams;
+  decodedImageCacheSize = decodedImageCacheSizeA;
+  unlockGlobalParams;
+}
+
+void GlobalParams::setJPXDecodeThreads(int jpxDecodeThreadsA) {
+  lockGlobalParams;
+  jpxDecodeThreads = jpxDecodeThreadsA;
+  unlockGlobalParams;
+}
+
 void GlobalParams::addSecurityHandler(XpdfSecurityHandler *handler) {
 #ifdef ENABLE_PLUGINS
   lockGlobalParams;
@@ -185,6 +185,11 @@ public:
   GBool getPrintCommands();
   GBool getProfileCommands();
   GBool getErrQuiet();
+  GBool getMapLocalFiles();
+  Goffset getFetchCacheSize();
+  Goffset getFormCacheSize();
+  Goffset getDecodedImageCacheSize();
+  int getJPXDecodeThreads();
 
   CharCodeToUnicode *getCIDToUnicode(GooString *collection);
   CharCodeToUnicode *getUnicodeToUnicode(GooString *fontName);
@@ -224,6 +229,11 @@ public:
   void setPrintCommands(GBool printCommandsA);
   void setProfileCommands(GBool profileCommandsA);
   void setErrQuiet(GBool errQuietA);
+  void setMapLocalFiles(GBool mapLocalFilesA);
+  void setFetchCacheSize(Goffset fetchCacheSizeA);
+  void setFormCacheSize(Goffset formCacheSizeA);
+  void setDecodedImageCacheSize(Goffset decodedImageCacheSizeA);
+  void setJPXDecodeThreads(int jpxDecodeThreadsA);
 
   static GBool parseYesNo2(const char *token, GBool *flag);
 
@@ -311,6 +321,19 @@ private:
   GBool printCommands;		// print the drawing commands
   GBool profileCommands;	// profile the drawing commands
   GBool errQuiet;		// suppress error messages?
+  GBool mapLocalFiles;		// memory-map local PDF files?
+  Goffset fetchCacheSize;	// memory budget of the parsed object cache
+				//   of documents opened from now on
+				//   (0, the default, disables it)
+  Goffset formCacheSize;	// memory budget of the parsed Form XObject
+				//   cache of documents opened from now on
+				//   (0, the default, disables it)
+  Goffset decodedImageCacheSize;// memory budget of the decoded image
+				//   cache of documents opened from now on
+				//   (0, the default, disables it)
+  int jpxDecodeThreads;		// max number of threads which decode a
+				//   JPEG 2000 image (1, the default, decodes
+				//   on the calling thread)
   double splashResolution;	// resolution when rasterizing images
 
   CharCodeToUnicodeCache *cidToUnicodeCache;
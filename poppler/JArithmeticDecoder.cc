@@ -169,42 +169,38 @@ void JArithmeticDecoder::cleanup() {
   }
 }
 
-int JArithmeticDecoder::decodeBit(Guint context,
-				  JArithmeticDecoderStats *stats) {
+// The rest of decodeBit(), once <a> has been reduced by <qe> and the
+// MPS fast path has been ruled out.
+int JArithmeticDecoder::decodeBitSlow(Guint context,
+				      JArithmeticDecoderStats *stats,
+				      Guint qe) {
   int bit;
-  Guint qe;
   int iCX, mpsCX;
 
   iCX = stats->cxTab[context] >> 1;
   mpsCX = stats->cxTab[context] & 1;
-  qe = qeTab[iCX];
-  a -= qe;
   if (c < a) {
-    if (a & 0x80000000) {
-      bit = mpsCX;
-    } else {
-      // MPS_EXCHANGE
-      if (a < qe) {
-	bit = 1 - mpsCX;
-	if (switchTab[iCX]) {
-	  stats->cxTab[context] = (nlpsTab[iCX] << 1) | (1 - mpsCX);
-	} else {
-	  stats->cxTab[context] = (nlpsTab[iCX] << 1) | mpsCX;
-	}
+    // MPS_EXCHANGE
+    if (a < qe) {
+      bit = 1 - mpsCX;
+      if (switchTab[iCX]) {
+	stats->cxTab[context] = (nlpsTab[iCX] << 1) | (1 - mpsCX);
       } else {
-	bit = mpsCX;
-	stats->cxTab[context] = (nmpsTab[iCX] << 1) | mpsCX;
+	stats->cxTab[context] = (nlpsTab[iCX] << 1) | mpsCX;
       }
-      // RENORMD
-      do {
-	if (ct == 0) {
-	  byteIn();
-	}
-	a <<= 1;
-	c <<= 1;
-	--ct;
-      } while (!(a & 0x80000000));
+    } else {
+      bit = mpsCX;
+      stats->cxTab[context] = (nmpsTab[iCX] << 1) | mpsCX;
     }
+    // RENORMD
+    do {
+      if (ct == 0) {
+	byteIn();
+      }
+      a <<= 1;
+      c <<= 1;
+      --ct;
+    } while (!(a & 0x80000000));
   } else {
     c -= a;
     // LPS_EXCHANGE
@@ -70,8 +70,18 @@ public:
   // Read any leftover data in the stream.
   void cleanup();
 
-  // Decode one bit.
-  int decodeBit(Guint context, JArithmeticDecoderStats *stats);
+  // Decode one bit.  The common case -- an MPS which doesn't need
+  // renormalization -- is handled inline.
+  int decodeBit(Guint context, JArithmeticDecoderStats *stats)
+  {
+    Guint cxVal = stats->cxTab[context];
+    Guint qe = qeTab[cxVal >> 1];
+    a -= qe;
+    if (c < a && (a & 0x80000000)) {
+      return cxVal & 1;
+    }
+    return decodeBitSlow(context, stats, qe);
+  }
 
   // Decode eight bits.
   int decodeByte(Guint context, JArithmeticDecoderStats *stats);
@@ -88,6 +98,8 @@ public:
 private:
 
   Guint readByte();
+  int decodeBitSlow(Guint context, JArithmeticDecoderStats *stats,
+		    Guint qe);
   int decodeIntBit(JArithmeticDecoderStats *stats);
   void byteIn();
 
@@ -40,6 +40,7 @@
 #include "goo/GooList.h"
 #include "Error.h"
 #include "JArithmeticDecoder.h"
+#include "PopplerCache.h"
 #include "JBIG2Stream.h"
 
 //~ share these tables
@@ -691,6 +692,7 @@ public:
     { data[y * line + (x >> 3)] |= 1 << (7 - (x & 7)); }
   void clearPixel(int x, int y)
     { data[y * line + (x >> 3)] &= 0x7f7f >> (x & 7); }
+  void setPixelRun(int x0, int x1, int y);
   void getPixelPtr(int x, int y, JBIG2BitmapPtr *ptr);
   int nextPixel(JBIG2BitmapPtr *ptr);
   void duplicateRow(int yDest, int ySrc);
@@ -841,6 +843,29 @@ inline int JBIG2Bitmap::nextPixel(JBIG2BitmapPtr *ptr) {
   return pix;
 }
 
+// Set the pixels x0 <= x < x1 in row y.
+inline void JBIG2Bitmap::setPixelRun(int x0, int x1, int y) {
+  Guchar *p;
+  int n;
+
+  if (x1 > w) {
+    x1 = w;
+  }
+  if (x0 >= x1) {
+    return;
+  }
+  p = data + y * line + (x0 >> 3);
+  n = ((x1 - 1) >> 3) - (x0 >> 3);
+  if (n == 0) {
+    *p |= (0xff >> (x0 & 7)) & (0xff00 >> (((x1 - 1) & 7) + 1));
+  } else {
+    *p++ |= 0xff >> (x0 & 7);
+    memset(p, 0xff, n - 1);
+    p += n - 1;
+    *p |= 0xff00 >> (((x1 - 1) & 7) + 1);
+  }
+}
+
 void JBIG2Bitmap::duplicateRow(int yDest, int ySrc) {
   memcpy(data + yDest * line, data + ySrc * line, line);
 }
@@ -1165,11 +1190,135 @@ JBIG2CodeTable::~JBIG2CodeTable() {
   gfree(table);
 }
 
+//------------------------------------------------------------------------
+// JBIG2Globals
+//------------------------------------------------------------------------
+
+#if MULTITHREADED
+#  define globalsLocker()   MutexLocker locker(&mutex)
+#  define globalsCacheLocker()   MutexLocker locker(&mutex)
+#else
+#  define globalsLocker()
+#  define globalsCacheLocker()
+#endif
+
+JBIG2Globals::JBIG2Globals(GooList *segmentsA) {
+  segments = segmentsA;
+  refCnt = 1;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+JBIG2Globals::~JBIG2Globals() {
+  deleteGooList(segments, JBIG2Segment);
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+void JBIG2Globals::incRefCnt() {
+  globalsLocker();
+  ++refCnt;
+}
+
+void JBIG2Globals::decRefCnt() {
+  int n;
+
+  {
+    globalsLocker();
+    n = --refCnt;
+  }
+  if (n == 0) {
+    delete this;
+  }
+}
+
+//------------------------------------------------------------------------
+// JBIG2GlobalsCache
+//------------------------------------------------------------------------
+
+// number of globals streams kept by each document
+#define jbig2GlobalsCacheSize 8
+
+class JBIG2GlobalsKey : public PopplerCacheKey
+{
+  public:
+    JBIG2GlobalsKey(Ref refA) : ref(refA)
+    {
+    }
+
+    bool operator==(const PopplerCacheKey &key) const
+    {
+      const JBIG2GlobalsKey *k = static_cast<const JBIG2GlobalsKey*>(&key);
+      return ref.num == k->ref.num && ref.gen == k->ref.gen;
+    }
+
+    const Ref ref;
+};
+
+class JBIG2GlobalsItem : public PopplerCacheItem
+{
+  public:
+    JBIG2GlobalsItem(JBIG2Globals *globalsA) : globals(globalsA)
+    {
+      globals->incRefCnt();
+    }
+
+    ~JBIG2GlobalsItem()
+    {
+      globals->decRefCnt();
+    }
+
+    JBIG2Globals *globals;
+};
+
+JBIG2GlobalsCache::JBIG2GlobalsCache() {
+  cache = new PopplerCache(jbig2GlobalsCacheSize);
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+JBIG2GlobalsCache::~JBIG2GlobalsCache() {
+  delete cache;
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+JBIG2Globals *JBIG2GlobalsCache::lookup(Ref ref) {
+  JBIG2GlobalsItem *item;
+
+  globalsCacheLocker();
+  item = static_cast<JBIG2GlobalsItem *>(cache->lookup(JBIG2GlobalsKey(ref)));
+  if (!item) {
+    return NULL;
+  }
+  item->globals->incRefCnt();
+  return item->globals;
+}
+
+void JBIG2GlobalsCache::put(Ref ref, JBIG2Globals *globals) {
+  globalsCacheLocker();
+  if (cache->lookup(JBIG2GlobalsKey(ref))) {
+    return;
+  }
+  cache->put(new JBIG2GlobalsKey(ref), new JBIG2GlobalsItem(globals));
+}
+
+void JBIG2GlobalsCache::clear() {
+  globalsCacheLocker();
+  delete cache;
+  cache = new PopplerCache(jbig2GlobalsCacheSize);
+}
+
 //------------------------------------------------------------------------
 // JBIG2Stream
 //------------------------------------------------------------------------
 
-JBIG2Stream::JBIG2Stream(Stream *strA, Object *globalsStreamA, Object *globalsStreamRefA):
+JBIG2Stream::JBIG2Stream(Stream *strA, Object *globalsStreamA, Object *globalsStreamRefA,
+			 JBIG2GlobalsCache *globalsCacheA):
   FilterStream(strA)
 {
   pageBitmap = NULL;
@@ -1194,13 +1343,18 @@ JBIG2Stream::JBIG2Stream(Stream *strA, Object *globalsStreamA, Object *globalsSt
   huffDecoder = new JBIG2HuffmanDecoder();
   mmrDecoder = new JBIG2MMRDecoder();
 
+  globalsStreamRef.num = globalsStreamRef.gen = -1;
+  globalsCache = NULL;
   if (globalsStreamA->isStream()) {
     globalsStreamA->copy(&globalsStream);
-    if (globalsStreamRefA->isRef())
+    if (globalsStreamRefA->isRef()) {
       globalsStreamRef = globalsStreamRefA->getRef();
+      globalsCache = globalsCacheA;
+    }
   }
 
-  segments = globalSegments = NULL;
+  segments = NULL;
+  globals = NULL;
   curStr = NULL;
   dataPtr = dataEnd = NULL;
 }
@@ -1231,17 +1385,27 @@ JBIG2Stream::~JBIG2Stream() {
 }
 
 void JBIG2Stream::reset() {
-  // read the globals stream
-  globalSegments = new GooList();
-  if (globalsStream.isStream()) {
-    segments = globalSegments;
-    curStr = globalsStream.getStream();
-    curStr->reset();
-    arithDecoder->setStream(curStr);
-    huffDecoder->setStream(curStr);
-    mmrDecoder->setStream(curStr);
-    readSegments();
-    curStr->close();
+  // read the globals stream, unless another stream has already
+  // decoded it
+  if (globalsCache) {
+    globals = globalsCache->lookup(globalsStreamRef);
+  }
+  if (!globals) {
+    segments = new GooList();
+    if (globalsStream.isStream()) {
+      curStr = globalsStream.getStream();
+      curStr->reset();
+      arithDecoder->setStream(curStr);
+      huffDecoder->setStream(curStr);
+      mmrDecoder->setStream(curStr);
+      readSegments();
+      curStr->close();
+    }
+    globals = new JBIG2Globals(segments);
+    // globals which draw on the page can't be shared
+    if (globalsCache && !pageBitmap) {
+      globalsCache->put(globalsStreamRef, globals);
+    }
   }
 
   // read the main stream
@@ -1270,9 +1434,9 @@ void JBIG2Stream::close() {
     deleteGooList(segments, JBIG2Segment);
     segments = NULL;
   }
-  if (globalSegments) {
-    deleteGooList(globalSegments, JBIG2Segment);
-    globalSegments = NULL;
+  if (globals) {
+    globals->decRefCnt();
+    globals = NULL;
   }
   dataPtr = dataEnd = NULL;
   FilterStream::close();
@@ -2934,8 +3098,9 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
   Guint buf0, buf1, buf2;
   Guint atBuf0, atBuf1, atBuf2, atBuf3;
   int atShift0, atShift1, atShift2, atShift3;
-  Guchar mask;
-  int x, y, x0, x1, a0i, b1i, blackPixels, pix, i;
+  Guchar mask, pixByte;
+  GBool atNominal;
+  int x, y, x0, x1, a0i, b1i, blackPixels, i;
 
   bitmap = new JBIG2Bitmap(0, w, h);
   if (!bitmap->isOk()) {
@@ -3138,9 +3303,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
       // convert the run lengths to a bitmap line
       i = 0;
       while (1) {
-	for (x = codingLine[i]; x < codingLine[i+1]; ++x) {
-	  bitmap->setPixel(x, y);
-	}
+	bitmap->setPixelRun(codingLine[i], codingLine[i+1], y);
 	if (codingLine[i+1] >= w || codingLine[i+2] >= w) {
 	  break;
 	}
@@ -3181,6 +3344,23 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
       }
     }
 
+    // with the nominal adaptive template pixels, the whole context
+    // comes from the row buffers
+    switch (templ) {
+    case 0:
+      atNominal = atx[0] == 3 && aty[0] == -1 &&
+		  atx[1] == -3 && aty[1] == -1 &&
+		  atx[2] == 2 && aty[2] == -2 &&
+		  atx[3] == -2 && aty[3] == -2;
+      break;
+    case 1:
+      atNominal = atx[0] == 3 && aty[0] == -1;
+      break;
+    default:
+      atNominal = atx[0] == 2 && aty[0] == -1;
+      break;
+    }
+
     ltp = 0;
     cx = cx0 = cx1 = cx2 = 0; // make gcc happy
     for (y = 0; y < h; ++y) {
@@ -3219,10 +3399,53 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	  buf1 = buf0 = 0;
 	}
 
-	if (atx[0] >= -8 && atx[0] <= 8 &&
-	    atx[1] >= -8 && atx[1] <= 8 &&
-	    atx[2] >= -8 && atx[2] <= 8 &&
-	    atx[3] >= -8 && atx[3] <= 8) {
+	if (atNominal) {
+	  // decode the row
+	  for (x0 = 0, x = 0; x0 < w; x0 += 8, ++pp) {
+	    if (x0 + 8 < w) {
+	      if (p0) {
+		buf0 |= *p0++;
+	      }
+	      if (p1) {
+		buf1 |= *p1++;
+	      }
+	      buf2 |= *p2++;
+	    }
+	    pixByte = 0;
+	    for (x1 = 0, mask = 0x80; x1 < 8 && x < w; ++x1, ++x, mask >>= 1) {
+
+	      // build the context
+	      cx0 = (buf0 >> 14) & 0x07;
+	      cx1 = (buf1 >> 13) & 0x1f;
+	      cx2 = (buf2 >> 16) & 0x0f;
+	      cx = (cx0 << 13) | (cx1 << 8) | (cx2 << 4) |
+		   (((buf1 >> 12) & 1) << 3) |
+		   (((buf1 >> 18) & 1) << 2) |
+		   (((buf0 >> 13) & 1) << 1) |
+		   ((buf0 >> 17) & 1);
+
+	      // check for a skipped pixel
+	      if (!(useSkip && skip->getPixel(x, y))) {
+
+		// decode the pixel
+		if (arithDecoder->decodeBit(cx, genericRegionStats)) {
+		  pixByte |= mask;
+		  buf2 |= 0x8000;
+		}
+	      }
+
+	      // update the context
+	      buf0 <<= 1;
+	      buf1 <<= 1;
+	      buf2 <<= 1;
+	    }
+	    *pp = pixByte;
+	  }
+
+	} else if (atx[0] >= -8 && atx[0] <= 8 &&
+		   atx[1] >= -8 && atx[1] <= 8 &&
+		   atx[2] >= -8 && atx[2] <= 8 &&
+		   atx[3] >= -8 && atx[3] <= 8) {
 	  // set up the adaptive context
 	  if (y + aty[0] >= 0 && y + aty[0] < bitmap->getHeight()) {
 	    atP0 = bitmap->getDataPtr() + (y + aty[0]) * bitmap->getLineSize();
@@ -3280,6 +3503,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 		atBuf3 |= *atP3++;
 	      }
 	    }
+	    pixByte = 0;
 	    for (x1 = 0, mask = 0x80; x1 < 8 && x < w; ++x1, ++x, mask >>= 1) {
 
 	      // build the context
@@ -3296,8 +3520,8 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      if (!(useSkip && skip->getPixel(x, y))) {
 
 		// decode the pixel
-		if ((pix = arithDecoder->decodeBit(cx, genericRegionStats))) {
-		  *pp |= mask;
+		if (arithDecoder->decodeBit(cx, genericRegionStats)) {
+		  pixByte |= mask;
 		  buf2 |= 0x8000;
 		  if (aty[0] == 0) {
 		    atBuf0 |= 0x8000;
@@ -3323,6 +3547,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      atBuf2 <<= 1;
 	      atBuf3 <<= 1;
 	    }
+	    *pp = pixByte;
 	  }
 
 	} else {
@@ -3337,6 +3562,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      }
 	      buf2 |= *p2++;
 	    }
+	    pixByte = 0;
 	    for (x1 = 0, mask = 0x80; x1 < 8 && x < w; ++x1, ++x, mask >>= 1) {
 
 	      // build the context
@@ -3353,8 +3579,8 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      if (!(useSkip && skip->getPixel(x, y))) {
 
 		// decode the pixel
-		if ((pix = arithDecoder->decodeBit(cx, genericRegionStats))) {
-		  *pp |= mask;
+		if (arithDecoder->decodeBit(cx, genericRegionStats)) {
+		  pixByte |= mask;
 		  buf2 |= 0x8000;
 		}
 	      }
@@ -3364,6 +3590,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      buf1 <<= 1;
 	      buf2 <<= 1;
 	    }
+	    *pp = pixByte;
 	  }
 	}
 	break;
@@ -3388,7 +3615,47 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	  buf1 = buf0 = 0;
 	}
 
-	if (atx[0] >= -8 && atx[0] <= 8) {
+	if (atNominal) {
+	  // decode the row
+	  for (x0 = 0, x = 0; x0 < w; x0 += 8, ++pp) {
+	    if (x0 + 8 < w) {
+	      if (p0) {
+		buf0 |= *p0++;
+	      }
+	      if (p1) {
+		buf1 |= *p1++;
+	      }
+	      buf2 |= *p2++;
+	    }
+	    pixByte = 0;
+	    for (x1 = 0, mask = 0x80; x1 < 8 && x < w; ++x1, ++x, mask >>= 1) {
+
+	      // build the context
+	      cx0 = (buf0 >> 13) & 0x0f;
+	      cx1 = (buf1 >> 13) & 0x1f;
+	      cx2 = (buf2 >> 16) & 0x07;
+	      cx = (cx0 << 9) | (cx1 << 4) | (cx2 << 1) |
+		   ((buf1 >> 12) & 1);
+
+	      // check for a skipped pixel
+	      if (!(useSkip && skip->getPixel(x, y))) {
+
+		// decode the pixel
+		if (arithDecoder->decodeBit(cx, genericRegionStats)) {
+		  pixByte |= mask;
+		  buf2 |= 0x8000;
+		}
+	      }
+
+	      // update the context
+	      buf0 <<= 1;
+	      buf1 <<= 1;
+	      buf2 <<= 1;
+	    }
+	    *pp = pixByte;
+	  }
+
+	} else if (atx[0] >= -8 && atx[0] <= 8) {
 	  // set up the adaptive context
 	  const int atY = y + aty[0];
 	  if ((atY >= 0) && (atY < bitmap->getHeight())) {
@@ -3414,6 +3681,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 		atBuf0 |= *atP0++;
 	      }
 	    }
+	    pixByte = 0;
 	    for (x1 = 0, mask = 0x80; x1 < 8 && x < w; ++x1, ++x, mask >>= 1) {
 
 	      // build the context
@@ -3427,8 +3695,8 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      if (!(useSkip && skip->getPixel(x, y))) {
 
 		// decode the pixel
-		if ((pix = arithDecoder->decodeBit(cx, genericRegionStats))) {
-		  *pp |= mask;
+		if (arithDecoder->decodeBit(cx, genericRegionStats)) {
+		  pixByte |= mask;
 		  buf2 |= 0x8000;
 		  if (aty[0] == 0) {
 		    atBuf0 |= 0x8000;
@@ -3442,6 +3710,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      buf2 <<= 1;
 	      atBuf0 <<= 1;
 	    }
+	    *pp = pixByte;
 	  }
 
 	} else {
@@ -3456,6 +3725,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      }
 	      buf2 |= *p2++;
 	    }
+	    pixByte = 0;
 	    for (x1 = 0, mask = 0x80; x1 < 8 && x < w; ++x1, ++x, mask >>= 1) {
 
 	      // build the context
@@ -3469,8 +3739,8 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      if (!(useSkip && skip->getPixel(x, y))) {
 
 		// decode the pixel
-		if ((pix = arithDecoder->decodeBit(cx, genericRegionStats))) {
-		  *pp |= mask;
+		if (arithDecoder->decodeBit(cx, genericRegionStats)) {
+		  pixByte |= mask;
 		  buf2 |= 0x8000;
 		}
 	      }
@@ -3480,6 +3750,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      buf1 <<= 1;
 	      buf2 <<= 1;
 	    }
+	    *pp = pixByte;
 	  }
 	}
 	break;
@@ -3504,7 +3775,47 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	  buf1 = buf0 = 0;
 	}
 
-	if (atx[0] >= -8 && atx[0] <= 8) {
+	if (atNominal) {
+	  // decode the row
+	  for (x0 = 0, x = 0; x0 < w; x0 += 8, ++pp) {
+	    if (x0 + 8 < w) {
+	      if (p0) {
+		buf0 |= *p0++;
+	      }
+	      if (p1) {
+		buf1 |= *p1++;
+	      }
+	      buf2 |= *p2++;
+	    }
+	    pixByte = 0;
+	    for (x1 = 0, mask = 0x80; x1 < 8 && x < w; ++x1, ++x, mask >>= 1) {
+
+	      // build the context
+	      cx0 = (buf0 >> 14) & 0x07;
+	      cx1 = (buf1 >> 14) & 0x0f;
+	      cx2 = (buf2 >> 16) & 0x03;
+	      cx = (cx0 << 7) | (cx1 << 3) | (cx2 << 1) |
+		   ((buf1 >> 13) & 1);
+
+	      // check for a skipped pixel
+	      if (!(useSkip && skip->getPixel(x, y))) {
+
+		// decode the pixel
+		if (arithDecoder->decodeBit(cx, genericRegionStats)) {
+		  pixByte |= mask;
+		  buf2 |= 0x8000;
+		}
+	      }
+
+	      // update the context
+	      buf0 <<= 1;
+	      buf1 <<= 1;
+	      buf2 <<= 1;
+	    }
+	    *pp = pixByte;
+	  }
+
+	} else if (atx[0] >= -8 && atx[0] <= 8) {
 	  // set up the adaptive context
 	  const int atY = y + aty[0];
 	  if ((atY >= 0) && (atY < bitmap->getHeight())) {
@@ -3530,6 +3841,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 		atBuf0 |= *atP0++;
 	      }
 	    }
+	    pixByte = 0;
 	    for (x1 = 0, mask = 0x80; x1 < 8 && x < w; ++x1, ++x, mask >>= 1) {
 
 	      // build the context
@@ -3543,8 +3855,8 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      if (!(useSkip && skip->getPixel(x, y))) {
 
 		// decode the pixel
-		if ((pix = arithDecoder->decodeBit(cx, genericRegionStats))) {
-		  *pp |= mask;
+		if (arithDecoder->decodeBit(cx, genericRegionStats)) {
+		  pixByte |= mask;
 		  buf2 |= 0x8000;
 		  if (aty[0] == 0) {
 		    atBuf0 |= 0x8000;
@@ -3558,6 +3870,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      buf2 <<= 1;
 	      atBuf0 <<= 1;
 	    }
+	    *pp = pixByte;
 	  }
 
 	} else {
@@ -3572,6 +3885,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      }
 	      buf2 |= *p2++;
 	    }
+	    pixByte = 0;
 	    for (x1 = 0, mask = 0x80; x1 < 8 && x < w; ++x1, ++x, mask >>= 1) {
 
 	      // build the context
@@ -3585,8 +3899,8 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      if (!(useSkip && skip->getPixel(x, y))) {
 
 		// decode the pixel
-		if ((pix = arithDecoder->decodeBit(cx, genericRegionStats))) {
-		  *pp |= mask;
+		if (arithDecoder->decodeBit(cx, genericRegionStats)) {
+		  pixByte |= mask;
 		  buf2 |= 0x8000;
 		}
 	      }
@@ -3596,6 +3910,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      buf1 <<= 1;
 	      buf2 <<= 1;
 	    }
+	    *pp = pixByte;
 	  }
 	}
 	break;
@@ -3613,7 +3928,42 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	  buf1 = 0;
 	}
 
-	if (atx[0] >= -8 && atx[0] <= 8) {
+	if (atNominal) {
+	  // decode the row
+	  for (x0 = 0, x = 0; x0 < w; x0 += 8, ++pp) {
+	    if (x0 + 8 < w) {
+	      if (p1) {
+		buf1 |= *p1++;
+	      }
+	      buf2 |= *p2++;
+	    }
+	    pixByte = 0;
+	    for (x1 = 0, mask = 0x80; x1 < 8 && x < w; ++x1, ++x, mask >>= 1) {
+
+	      // build the context
+	      cx1 = (buf1 >> 14) & 0x1f;
+	      cx2 = (buf2 >> 16) & 0x0f;
+	      cx = (cx1 << 5) | (cx2 << 1) |
+		   ((buf1 >> 13) & 1);
+
+	      // check for a skipped pixel
+	      if (!(useSkip && skip->getPixel(x, y))) {
+
+		// decode the pixel
+		if (arithDecoder->decodeBit(cx, genericRegionStats)) {
+		  pixByte |= mask;
+		  buf2 |= 0x8000;
+		}
+	      }
+
+	      // update the context
+	      buf1 <<= 1;
+	      buf2 <<= 1;
+	    }
+	    *pp = pixByte;
+	  }
+
+	} else if (atx[0] >= -8 && atx[0] <= 8) {
 	  // set up the adaptive context
 	  const int atY = y + aty[0];
 	  if ((atY >= 0) && (atY < bitmap->getHeight())) {
@@ -3636,6 +3986,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 		atBuf0 |= *atP0++;
 	      }
 	    }
+	    pixByte = 0;
 	    for (x1 = 0, mask = 0x80; x1 < 8 && x < w; ++x1, ++x, mask >>= 1) {
 
 	      // build the context
@@ -3648,8 +3999,8 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      if (!(useSkip && skip->getPixel(x, y))) {
 
 		// decode the pixel
-		if ((pix = arithDecoder->decodeBit(cx, genericRegionStats))) {
-		  *pp |= mask;
+		if (arithDecoder->decodeBit(cx, genericRegionStats)) {
+		  pixByte |= mask;
 		  buf2 |= 0x8000;
 		  if (aty[0] == 0) {
 		    atBuf0 |= 0x8000;
@@ -3662,6 +4013,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      buf2 <<= 1;
 	      atBuf0 <<= 1;
 	    }
+	    *pp = pixByte;
 	  }
 
 	} else {
@@ -3673,6 +4025,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      }
 	      buf2 |= *p2++;
 	    }
+	    pixByte = 0;
 	    for (x1 = 0, mask = 0x80; x1 < 8 && x < w; ++x1, ++x, mask >>= 1) {
 
 	      // build the context
@@ -3685,8 +4038,8 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      if (!(useSkip && skip->getPixel(x, y))) {
 
 		// decode the pixel
-		if ((pix = arithDecoder->decodeBit(cx, genericRegionStats))) {
-		  *pp |= mask;
+		if (arithDecoder->decodeBit(cx, genericRegionStats)) {
+		  pixByte |= mask;
 		  buf2 |= 0x8000;
 		}
 	      }
@@ -3695,6 +4048,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	      buf1 <<= 1;
 	      buf2 <<= 1;
 	    }
+	    *pp = pixByte;
 	  }
 	}
 	break;
@@ -4124,13 +4478,18 @@ void JBIG2Stream::readExtensionSeg(Guint length) {
 }
 
 JBIG2Segment *JBIG2Stream::findSegment(Guint segNum) {
+  GooList *globalSegments;
   JBIG2Segment *seg;
   int i;
 
-  for (i = 0; i < globalSegments->getLength(); ++i) {
-    seg = (JBIG2Segment *)globalSegments->get(i);
-    if (seg->getSegNum() == segNum) {
-      return seg;
+  // globals is NULL while the globals stream itself is being read
+  if (globals) {
+    globalSegments = globals->getSegments();
+    for (i = 0; i < globalSegments->getLength(); ++i) {
+      seg = (JBIG2Segment *)globalSegments->get(i);
+      if (seg->getSegNum() == segNum) {
+	return seg;
+      }
     }
   }
   for (i = 0; i < segments->getLength(); ++i) {
@@ -4142,17 +4501,12 @@ JBIG2Segment *JBIG2Stream::findSegment(Guint segNum) {
   return NULL;
 }
 
+// Segments from the globals stream may be shared with other streams,
+// so they are never discarded.
 void JBIG2Stream::discardSegment(Guint segNum) {
   JBIG2Segment *seg;
   int i;
 
-  for (i = 0; i < globalSegments->getLength(); ++i) {
-    seg = (JBIG2Segment *)globalSegments->get(i);
-    if (seg->getSegNum() == segNum) {
-      globalSegments->del(i);
-      return;
-    }
-  }
   for (i = 0; i < segments->getLength(); ++i) {
     seg = (JBIG2Segment *)segments->get(i);
     if (seg->getSegNum() == segNum) {
@@ -30,10 +30,12 @@
 #endif
 
 #include "goo/gtypes.h"
+#include "goo/GooMutex.h"
 #include "Object.h"
 #include "Stream.h"
 
 class GooList;
+class PopplerCache;
 class JBIG2Segment;
 class JBIG2Bitmap;
 class JArithmeticDecoder;
@@ -42,12 +44,75 @@ class JBIG2HuffmanDecoder;
 struct JBIG2HuffmanTable;
 class JBIG2MMRDecoder;
 
+//------------------------------------------------------------------------
+// JBIG2Globals
+//------------------------------------------------------------------------
+
+// The segments decoded from a JBIG2Globals stream.  They are never
+// modified after decoding, so several JBIG2Streams (and threads) can
+// share them.
+class JBIG2Globals {
+public:
+
+  // Takes ownership of <segmentsA>.
+  JBIG2Globals(GooList *segmentsA);
+
+  void incRefCnt();
+  void decRefCnt();
+
+  GooList *getSegments() { return segments; }
+
+private:
+
+  ~JBIG2Globals();
+
+  GooList *segments;		// [JBIG2Segment]
+  int refCnt;
+#if MULTITHREADED
+  GooMutex mutex;
+#endif
+};
+
+//------------------------------------------------------------------------
+// JBIG2GlobalsCache
+//------------------------------------------------------------------------
+
+// Per-document cache of decoded JBIG2Globals streams, keyed by the
+// globals stream's object reference.
+class JBIG2GlobalsCache {
+public:
+
+  JBIG2GlobalsCache();
+  ~JBIG2GlobalsCache();
+
+  // Return the globals decoded from stream <ref>, or NULL if they are
+  // not cached.  The caller must call decRefCnt() on the result.
+  JBIG2Globals *lookup(Ref ref);
+
+  // Add <globals> for stream <ref>, unless another stream got there
+  // first.
+  void put(Ref ref, JBIG2Globals *globals);
+
+  // Drop all the cached globals.
+  void clear();
+
+private:
+
+  PopplerCache *cache;
+#if MULTITHREADED
+  GooMutex mutex;
+#endif
+};
+
 //------------------------------------------------------------------------
 
 class JBIG2Stream: public FilterStream {
 public:
 
-  JBIG2Stream(Stream *strA, Object *globalsStreamA, Object *globalsStreamRefA);
+  // If <globalsCacheA> is non-NULL, the decoded globals stream is
+  // looked up in, and added to, that cache.
+  JBIG2Stream(Stream *strA, Object *globalsStreamA, Object *globalsStreamRefA,
+	      JBIG2GlobalsCache *globalsCacheA = NULL);
   virtual ~JBIG2Stream();
   virtual StreamKind getKind() { return strJBIG2; }
   virtual void reset();
@@ -135,12 +200,13 @@ private:
 
   Object globalsStream;
   Ref globalsStreamRef;
+  JBIG2GlobalsCache *globalsCache;
   Guint pageW, pageH, curPageH;
   Guint pageDefPixel;
   JBIG2Bitmap *pageBitmap;
   Guint defCombOp;
   GooList *segments;		// [JBIG2Segment]
-  GooList *globalSegments;	// [JBIG2Segment]
+  JBIG2Globals *globals;	// segments from the globals stream
   Stream *curStr;
   Guchar *dataPtr;
   Guchar *dataEnd;
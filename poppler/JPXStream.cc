@@ -29,8 +29,11 @@
 #endif
 
 #include <limits.h>
+#include <string.h>
 #include "gmem.h"
+#include "GooThreadPool.h"
 #include "Error.h"
+#include "GlobalParams.h"
 #include "JArithmeticDecoder.h"
 #include "JPXStream.h"
 
@@ -188,6 +191,35 @@ static const Guint signContext[5][5][2] = {
 
 //------------------------------------------------------------------------
 
+// number of columns handled together by the vertical IDWT
+#define jpxStripWidth 8
+
+//------------------------------------------------------------------------
+
+// A code-block to be decoded by JPXStream::decodeCodeBlockJob.
+struct JPXCodeBlockJob {
+  JPXStream *str;
+  JPXTileComp *tileComp;
+  JPXResLevel *resLevel;
+  JPXPrecinct *precinct;
+  JPXSubband *subband;
+  Guint res, sb;
+  JPXCodeBlock *cb;
+  GBool ok;
+};
+
+// A tile-component (for the IDWT) or tile (for the multi-component
+// transform) to be finished by JPXStream::inverseTransformJob or
+// inverseMultiCompAndDCJob.
+struct JPXTileJob {
+  JPXStream *str;
+  JPXTile *tile;
+  JPXTileComp *tileComp;
+  GBool ok;
+};
+
+//------------------------------------------------------------------------
+
 #if 1 //----- disable coverage tracking
 
 #define cover(idx)
@@ -260,6 +292,9 @@ JPXStream::JPXStream(Stream *strA):
   bitBufSkip = gFalse;
   byteCount = 0;
 
+  decodeThreads = 1;
+  reduction = 0;
+  outXOffset = outYOffset = outXSize = outYSize = 0;
   curX = curY = 0;
   curComp = 0;
   readBufLen = 0;
@@ -271,14 +306,22 @@ JPXStream::~JPXStream() {
 }
 
 void JPXStream::reset() {
+  GBool ok;
+
   bufStr->reset();
-  if (readBoxes()) {
-    curY = img.yOffset;
+  decodeThreads = globalParams ? globalParams->getJPXDecodeThreads() : 1;
+  ok = readBoxes();
+  outXOffset = jpxCeilDivPow2(img.xOffset, reduction);
+  outYOffset = jpxCeilDivPow2(img.yOffset, reduction);
+  outXSize = jpxCeilDivPow2(img.xSize, reduction);
+  outYSize = jpxCeilDivPow2(img.ySize, reduction);
+  if (ok) {
+    curY = outYOffset;
   } else {
     // readBoxes reported an error, so we go immediately to EOF
-    curY = img.ySize;
+    curY = outYSize;
   }
-  curX = img.xOffset;
+  curX = outXOffset;
   curComp = 0;
   readBufLen = 0;
 }
@@ -336,6 +379,8 @@ void JPXStream::close() {
 			for (k = 0; k < subband->nXCBs * subband->nYCBs; ++k) {
 			  cb = &subband->cbs[k];
 			  gfree(cb->dataLen);
+			  gfree(cb->segData);
+			  gfree(cb->segLens);
 			  gfree(cb->touched);
 			  if (cb->arithDecoder) {
 			    delete cb->arithDecoder;
@@ -404,17 +449,100 @@ int JPXStream::lookChar() {
   return c;
 }
 
+int JPXStream::getChars(int nChars, Guchar *buffer) {
+  int n, m, c;
+
+  n = 0;
+  while (n < nChars) {
+    if ((m = copyTileRow(nChars - n, buffer + n)) > 0) {
+      n += m;
+    } else if ((c = JPXStream::getChar()) == EOF) {
+      break;
+    } else {
+      buffer[n++] = (Guchar)c;
+    }
+  }
+  return n;
+}
+
+// Copy the samples from the current position to the end of the tile
+// row (or of the output row) straight out of the decoded tile-comps.
+// This handles the common layout only -- full resolution, 8-bit
+// samples and no subsampling, starting on a pixel boundary; it
+// returns 0 for anything else, and getChars falls back to getChar.
+int JPXStream::copyTileRow(int nChars, Guchar *buffer) {
+  JPXTile *tile;
+  JPXTileComp *tileComp;
+  Guint tileIdx, x, y, tx, ty, xEnd, nPixels, comp, i;
+  int *row;
+  Guchar *p;
+
+  if (readBufLen != 0 || curComp != 0 || reduction != 0 ||
+      curY >= outYSize || !img.tiles || img.nComps == 0) {
+    return 0;
+  }
+  x = curX;
+  y = curY;
+  tileIdx = ((y - img.yTileOffset) / img.yTileSize) * img.nXTiles
+            + (x - img.xTileOffset) / img.xTileSize;
+  if (tileIdx >= img.nXTiles * img.nYTiles ||
+      !(tile = &img.tiles[tileIdx])->tileComps) {
+    return 0;
+  }
+  xEnd = img.xTileOffset +
+         ((x - img.xTileOffset) / img.xTileSize + 1) * img.xTileSize;
+  if (xEnd > outXSize) {
+    xEnd = outXSize;
+  }
+  nPixels = xEnd - x;
+  if (nPixels > (Guint)nChars / img.nComps) {
+    nPixels = (Guint)nChars / img.nComps;
+  }
+  if (nPixels == 0) {
+    return 0;
+  }
+  tx = (x - img.xTileOffset) % img.xTileSize;
+  ty = (y - img.yTileOffset) % img.yTileSize;
+  for (comp = 0; comp < img.nComps; ++comp) {
+    tileComp = &tile->tileComps[comp];
+    if (tileComp->prec != 8 || tileComp->hSep != 1 || tileComp->vSep != 1 ||
+	ty >= tileComp->y1 - tileComp->y0 ||
+	tx + nPixels > tileComp->x1 - tileComp->x0) {
+      return 0;
+    }
+  }
+  for (comp = 0; comp < img.nComps; ++comp) {
+    tileComp = &tile->tileComps[comp];
+    row = tileComp->data + ty * (tileComp->x1 - tileComp->x0) + tx;
+    p = buffer + comp;
+    for (i = 0; i < nPixels; ++i) {
+      *p = (Guchar)row[i];
+      p += img.nComps;
+    }
+  }
+  curX += nPixels;
+  if (curX == outXSize) {
+    curX = outXOffset;
+    ++curY;
+  }
+  return (int)(nPixels * img.nComps);
+}
+
 void JPXStream::fillReadBuf() {
   JPXTileComp *tileComp;
-  Guint tileIdx, tx, ty;
+  Guint tileIdx, tx, ty, x, y;
   int pix, pixBits;
 
   do {
-    if (curY >= img.ySize) {
+    if (curY >= outYSize) {
       return;
     }
-    tileIdx = ((curY - img.yTileOffset) / img.yTileSize) * img.nXTiles
-              + (curX - img.xTileOffset) / img.xTileSize;
+    // (x, y) is a reference grid point which lies in the same tile as
+    // the reduced-resolution sample (curX, curY)
+    x = curX << reduction;
+    y = curY << reduction;
+    tileIdx = ((y - img.yTileOffset) / img.yTileSize) * img.nXTiles
+              + (x - img.xTileOffset) / img.xTileSize;
 #if 1 //~ ignore the palette, assume the PDF ColorSpace object is valid
     if (img.tiles == NULL || tileIdx >= img.nXTiles * img.nYTiles || img.tiles[tileIdx].tileComps == NULL) {
       error(errSyntaxError, getPos(), "Unexpected tileIdx in fillReadBuf in JPX stream");
@@ -424,8 +552,16 @@ void JPXStream::fillReadBuf() {
 #else
     tileComp = &img.tiles[tileIdx].tileComps[havePalette ? 0 : curComp];
 #endif
-    tx = jpxCeilDiv((curX - img.xTileOffset) % img.xTileSize, tileComp->hSep);
-    ty = jpxCeilDiv((curY - img.yTileOffset) % img.yTileSize, tileComp->vSep);
+    if (reduction == 0) {
+      tx = jpxCeilDiv((x - img.xTileOffset) % img.xTileSize, tileComp->hSep);
+      ty = jpxCeilDiv((y - img.yTileOffset) % img.yTileSize, tileComp->vSep);
+    } else {
+      // reduceResolution only allows this with hSep = vSep = 1
+      tx = (x >> tileComp->reduction) -
+	   jpxCeilDivPow2(tileComp->x0, tileComp->reduction);
+      ty = (y >> tileComp->reduction) -
+	   jpxCeilDivPow2(tileComp->y0, tileComp->reduction);
+    }
     if (unlikely(ty >= (tileComp->y1 - tileComp->y0))) {
       error(errSyntaxError, getPos(), "Unexpected ty in fillReadBuf in JPX stream");
       return;
@@ -450,8 +586,8 @@ void JPXStream::fillReadBuf() {
     if (++curComp == (Guint)(havePalette ? palette.nComps : img.nComps)) {
 #endif
       curComp = 0;
-      if (++curX == img.xSize) {
-	curX = img.xOffset;
+      if (++curX == outXSize) {
+	curX = outXOffset;
 	++curY;
 	if (pixBits < 8) {
 	  pix <<= 8 - pixBits;
@@ -608,6 +744,138 @@ void JPXStream::getImageParams2(int *bitsPerComponent,
   }
 }
 
+GBool JPXStream::reduceResolution(int minWidth, int minHeight,
+				  int *width, int *height) {
+  Guint boxType, boxLen, dataLen;
+  Guint xSize, ySize, xOffset, yOffset, nLevels, r, i;
+  GBool ok;
+
+  // find the main codestream header, skipping the JP2/JPX wrapper
+  ok = gFalse;
+  bufStr->reset();
+  if (bufStr->lookChar() == 0xff) {
+    ok = getCodestreamLevels(&xSize, &ySize, &xOffset, &yOffset, &nLevels);
+  } else {
+    while (readBoxHdr(&boxType, &boxLen, &dataLen)) {
+      if (boxType == 0x6a703268) { // JP2 header
+	// skip the superbox
+      } else if (boxType == 0x6A703263) { // codestream
+	ok = getCodestreamLevels(&xSize, &ySize, &xOffset, &yOffset,
+				 &nLevels);
+	break;
+      } else {
+	for (i = 0; i < dataLen; ++i) {
+	  if (bufStr->getChar() == EOF) {
+	    break;
+	  }
+	}
+      }
+    }
+  }
+  bufStr->close();
+
+  // the image dictionary must agree with the codestream
+  if (!ok ||
+      (int)(xSize - xOffset) != *width || (int)(ySize - yOffset) != *height) {
+    return gFalse;
+  }
+
+  // each decomposition level which isn't inverse transformed halves
+  // the image size
+  for (r = 0; r < nLevels; ++r) {
+    if ((int)(jpxCeilDivPow2(xSize, r + 1) -
+	      jpxCeilDivPow2(xOffset, r + 1)) < minWidth ||
+	(int)(jpxCeilDivPow2(ySize, r + 1) -
+	      jpxCeilDivPow2(yOffset, r + 1)) < minHeight) {
+      break;
+    }
+  }
+  reduction = r;
+  if (r == 0) {
+    return gFalse;
+  }
+  *width = jpxCeilDivPow2(xSize, r) - jpxCeilDivPow2(xOffset, r);
+  *height = jpxCeilDivPow2(ySize, r) - jpxCeilDivPow2(yOffset, r);
+  return gTrue;
+}
+
+// Get the image size and the smallest number of decomposition levels
+// from the main codestream header.  This fails if any component is
+// subsampled.
+GBool JPXStream::getCodestreamLevels(Guint *xSize, Guint *ySize,
+				     Guint *xOffset, Guint *yOffset,
+				     Guint *nLevels) {
+  int segType;
+  Guint segLen, nComps1, nLevels1, prec, hSep, vSep, dummy, comp, n, i;
+  GBool haveSIZ, haveCOD;
+
+  haveSIZ = haveCOD = gFalse;
+  nComps1 = 0;
+  while (readMarkerHdr(&segType, &segLen)) {
+    if (segType == 0x51) { // SIZ - image and tile size
+      if (!readUWord(&dummy) ||
+	  !readULong(xSize) ||
+	  !readULong(ySize) ||
+	  !readULong(xOffset) ||
+	  !readULong(yOffset) ||
+	  !readULong(&dummy) ||
+	  !readULong(&dummy) ||
+	  !readULong(&dummy) ||
+	  !readULong(&dummy) ||
+	  !readUWord(&nComps1) ||
+	  *xOffset >= *xSize || *yOffset >= *ySize) {
+	return gFalse;
+      }
+      for (comp = 0; comp < nComps1; ++comp) {
+	if (!readUByte(&prec) ||
+	    !readUByte(&hSep) ||
+	    !readUByte(&vSep) ||
+	    hSep != 1 || vSep != 1) {
+	  return gFalse;
+	}
+      }
+      haveSIZ = gTrue;
+    } else if (segType == 0x52 || segType == 0x53) { // COD, COC
+      if (!haveSIZ) {
+	return gFalse;
+      }
+      // the number of decomposition levels follows the style,
+      // progression order, layer count, and multi-component transform
+      // bytes in COD, or the component index and style bytes in COC
+      if (segType == 0x52) {
+	n = 5;
+      } else {
+	n = nComps1 > 256 ? 3 : 2;
+      }
+      if (segLen < n + 3) {
+	return gFalse;
+      }
+      for (i = 0; i < n; ++i) {
+	if (bufStr->getChar() == EOF) {
+	  return gFalse;
+	}
+      }
+      if (!readUByte(&nLevels1)) {
+	return gFalse;
+      }
+      if (!haveCOD || nLevels1 < *nLevels) {
+	*nLevels = nLevels1;
+      }
+      haveCOD = gTrue;
+      for (i = n + 3; i < segLen; ++i) {
+	bufStr->getChar();
+      }
+    } else if (segType == 0x90) { // SOT - end of the main header
+      break;
+    } else if (segLen > 2) {
+      for (i = 0; i < segLen - 2; ++i) {
+	bufStr->getChar();
+      }
+    }
+  }
+  return haveSIZ && haveCOD;
+}
+
 GBool JPXStream::readBoxes() {
   Guint boxType, boxLen, dataLen;
   Guint bpc1, compression, unknownColorspace, ipr;
@@ -922,7 +1190,6 @@ GBool JPXStream::readColorSpecBox(Guint dataLen) {
 
 GBool JPXStream::readCodestream(Guint len) {
   JPXTile *tile;
-  JPXTileComp *tileComp;
   int segType;
   GBool haveSIZ, haveCOD, haveQCD, haveSOT;
   Guint precinctSize, style, nDecompLevels;
@@ -1509,18 +1776,9 @@ GBool JPXStream::readCodestream(Guint len) {
       error(errSyntaxError, getPos(), "Uninitialized tile in JPX codestream");
       return gFalse;
     }
-    for (comp = 0; comp < img.nComps; ++comp) {
-      tileComp = &tile->tileComps[comp];
-      inverseTransform(tileComp);
-    }
-    if (!inverseMultiCompAndDC(tile)) {
-      return gFalse;
-    }
   }
+  return decodeTiles();
 
-  //~ can free memory below tileComps here, and also tileComp.buf
-
-  return gTrue;
 }
 
 GBool JPXStream::readTilePart() {
@@ -1947,6 +2205,8 @@ GBool JPXStream::readTilePart() {
       tileComp->x1 = jpxCeilDiv(tile->x1, tileComp->hSep);
       tileComp->y1 = jpxCeilDiv(tile->y1, tileComp->vSep);
       tileComp->w = tileComp->x1 - tileComp->x0;
+      tileComp->reduction = reduction < tileComp->nDecompLevels
+	                      ? reduction : tileComp->nDecompLevels;
       tileComp->cbW = 1 << tileComp->codeBlockW;
       tileComp->cbH = 1 << tileComp->codeBlockH;
       tileComp->data = (int *)gmallocn((tileComp->x1 - tileComp->x0) *
@@ -1957,7 +2217,7 @@ GBool JPXStream::readTilePart() {
       } else {
 	n = tileComp->y1 - tileComp->y0;
       }
-      tileComp->buf = (int *)gmallocn(n + 8, sizeof(int));
+      tileComp->buf = (int *)gmallocn((n + 8) * jpxStripWidth, sizeof(int));
       for (r = 0; r <= tileComp->nDecompLevels; ++r) {
 	resLevel = &tileComp->resLevels[r];
 	k = r == 0 ? tileComp->nDecompLevels
@@ -2073,6 +2333,10 @@ GBool JPXStream::readTilePart() {
 		cb->nZeroBitPlanes = 0;
 		cb->dataLenSize = 1;
 		cb->dataLen = (Guint *)gmalloc(sizeof(Guint));
+		cb->segData = NULL;
+		cb->segDataLen = cb->segDataSize = 0;
+		cb->segLens = NULL;
+		cb->segLensLen = cb->segLensSize = 0;
 		cb->coeffs = sbCoeffs
 		             + (cb->y0 - subband->y0) * tileComp->w
 		             + (cb->x0 - subband->x0);
@@ -2337,17 +2601,29 @@ GBool JPXStream::readTilePartData(Guint tileIdx,
 	for (cbX = 0; cbX < subband->nXCBs; ++cbX) {
 	  cb = &subband->cbs[cbY * subband->nXCBs + cbX];
 	  if (cb->included) {
-	    if (!readCodeBlockData(tileComp, resLevel, precinct, subband,
-				   tile->res, sb, cb)) {
-	      return gFalse;
-	    }
 	    if (tileComp->codeBlockStyle & 0x04) {
-	      for (i = 0; i < cb->nCodingPasses; ++i) {
-		tilePartLen -= cb->dataLen[i];
+	      for (i = 0, n = 0; i < cb->nCodingPasses; ++i) {
+		n += cb->dataLen[i];
 	      }
 	    } else {
-	      tilePartLen -= cb->dataLen[0];
+	      n = cb->dataLen[0];
+	    }
+	    if (tile->res + tileComp->reduction > tileComp->nDecompLevels) {
+	      // this resolution level won't be inverse transformed, so
+	      // don't bother decoding it
+	      for (i = 0; i < n; ++i) {
+		if (bufStr->getChar() == EOF) {
+		  break;
+		}
+	      }
+	    } else if (decodeThreads > 1) {
+	      saveCodeBlockData(tileComp, cb, n);
+	    } else if (!readCodeBlockData(tileComp, resLevel, precinct,
+					  subband, tile->res, sb, cb,
+					  bufStr)) {
+	      return gFalse;
 	    }
+	    tilePartLen -= n;
 	    cb->seen = gTrue;
 	  }
 	}
@@ -2436,12 +2712,216 @@ GBool JPXStream::readTilePartData(Guint tileIdx,
   return gFalse;
 }
 
+// Append the <n> bytes of code-block data from the current packet,
+// along with the coding pass count and segment lengths, to <cb>.  The
+// code-blocks are decoded by decodeTiles, once all of the tile-parts
+// have been read.
+void JPXStream::saveCodeBlockData(JPXTileComp *tileComp, JPXCodeBlock *cb,
+				  Guint n) {
+  Guint nLens, i;
+  int c;
+
+  nLens = (tileComp->codeBlockStyle & 0x04) ? cb->nCodingPasses : 1;
+  if (cb->segLensLen + 1 + nLens > cb->segLensSize) {
+    cb->segLensSize = 2 * cb->segLensSize + 1 + nLens;
+    cb->segLens = (Guint *)greallocn(cb->segLens, cb->segLensSize,
+				     sizeof(Guint));
+  }
+  cb->segLens[cb->segLensLen++] = cb->nCodingPasses;
+  for (i = 0; i < nLens; ++i) {
+    cb->segLens[cb->segLensLen++] = cb->dataLen[i];
+  }
+
+  // the arithmetic decoder reads 0xff bytes past the end of the
+  // stream, and so does decodeCodeBlock past the end of segData, so
+  // there's no need to save anything after EOF (and the lengths may
+  // be bogus)
+  for (i = 0; i < n; ++i) {
+    if ((c = bufStr->getChar()) == EOF) {
+      break;
+    }
+    if (cb->segDataLen == cb->segDataSize) {
+      cb->segDataSize = cb->segDataSize ? 2 * cb->segDataSize : 256;
+      cb->segData = (Guchar *)greallocn(cb->segData, cb->segDataSize,
+					sizeof(Guchar));
+    }
+    cb->segData[cb->segDataLen++] = (Guchar)c;
+  }
+}
+
+// Decode the saved code-block data, if any, and do the inverse
+// transforms.  Code-blocks are independent of each other, as are
+// tile-components for the IDWT and tiles for the multi-component
+// transform, so each step is spread over up to decodeThreads threads
+// of the thread pool.
+GBool JPXStream::decodeTiles() {
+  GooThreadPool *pool;
+  JPXCodeBlockJob *jobs;
+  JPXTileJob *tileJobs;
+  JPXTileComp *tileComp;
+  JPXResLevel *resLevel;
+  JPXPrecinct *precinct;
+  JPXSubband *subband;
+  JPXCodeBlock *cb;
+  Guint nTiles, nJobs, i, comp, r, sb, k;
+  GBool ok;
+
+  pool = GooThreadPool::get();
+  nTiles = img.nXTiles * img.nYTiles;
+
+  //----- code-blocks
+  nJobs = 0;
+  for (i = 0; i < nTiles; ++i) {
+    for (comp = 0; comp < img.nComps; ++comp) {
+      tileComp = &img.tiles[i].tileComps[comp];
+      for (r = 0; r <= tileComp->nDecompLevels - tileComp->reduction; ++r) {
+	precinct = &tileComp->resLevels[r].precincts[0];
+	for (sb = 0; sb < (Guint)(r == 0 ? 1 : 3); ++sb) {
+	  subband = &precinct->subbands[sb];
+	  for (k = 0; k < subband->nXCBs * subband->nYCBs; ++k) {
+	    if (subband->cbs[k].segLensLen > 0) {
+	      ++nJobs;
+	    }
+	  }
+	}
+      }
+    }
+  }
+  jobs = (JPXCodeBlockJob *)gmallocn(nJobs, sizeof(JPXCodeBlockJob));
+  nJobs = 0;
+  for (i = 0; i < nTiles; ++i) {
+    for (comp = 0; comp < img.nComps; ++comp) {
+      tileComp = &img.tiles[i].tileComps[comp];
+      for (r = 0; r <= tileComp->nDecompLevels - tileComp->reduction; ++r) {
+	resLevel = &tileComp->resLevels[r];
+	precinct = &resLevel->precincts[0];
+	for (sb = 0; sb < (Guint)(r == 0 ? 1 : 3); ++sb) {
+	  subband = &precinct->subbands[sb];
+	  for (k = 0; k < subband->nXCBs * subband->nYCBs; ++k) {
+	    cb = &subband->cbs[k];
+	    if (cb->segLensLen > 0) {
+	      jobs[nJobs].str = this;
+	      jobs[nJobs].tileComp = tileComp;
+	      jobs[nJobs].resLevel = resLevel;
+	      jobs[nJobs].precinct = precinct;
+	      jobs[nJobs].subband = subband;
+	      jobs[nJobs].res = r;
+	      jobs[nJobs].sb = sb;
+	      jobs[nJobs].cb = cb;
+	      jobs[nJobs].ok = gTrue;
+	      ++nJobs;
+	    }
+	  }
+	}
+      }
+    }
+  }
+  pool->run(nJobs, &JPXStream::decodeCodeBlockJob, jobs, decodeThreads);
+  ok = gTrue;
+  for (i = 0; i < nJobs; ++i) {
+    if (!jobs[i].ok) {
+      ok = gFalse;
+    }
+  }
+  gfree(jobs);
+  if (!ok) {
+    return gFalse;
+  }
+
+  tileJobs = (JPXTileJob *)gmallocn(nTiles * img.nComps, sizeof(JPXTileJob));
+
+  //----- IDWT
+  for (i = 0; i < nTiles; ++i) {
+    for (comp = 0; comp < img.nComps; ++comp) {
+      k = i * img.nComps + comp;
+      tileJobs[k].str = this;
+      tileJobs[k].tile = &img.tiles[i];
+      tileJobs[k].tileComp = &img.tiles[i].tileComps[comp];
+      tileJobs[k].ok = gTrue;
+    }
+  }
+  pool->run(nTiles * img.nComps, &JPXStream::inverseTransformJob, tileJobs,
+	    decodeThreads);
+
+  //----- inverse multi-component transform and DC level shift
+  for (i = 0; i < nTiles; ++i) {
+    tileJobs[i].tile = &img.tiles[i];
+  }
+  pool->run(nTiles, &JPXStream::inverseMultiCompAndDCJob, tileJobs,
+	    decodeThreads);
+  for (i = 0; i < nTiles; ++i) {
+    if (!tileJobs[i].ok) {
+      ok = gFalse;
+    }
+  }
+  gfree(tileJobs);
+
+  //~ can free memory below tileComps here, and also tileComp.buf
+
+  return ok;
+}
+
+void JPXStream::decodeCodeBlockJob(void *data, int idx) {
+  JPXCodeBlockJob *job = &((JPXCodeBlockJob *)data)[idx];
+
+  job->ok = job->str->decodeCodeBlock(job);
+}
+
+void JPXStream::inverseTransformJob(void *data, int idx) {
+  JPXTileJob *job = &((JPXTileJob *)data)[idx];
+
+  job->str->inverseTransform(job->tileComp);
+}
+
+void JPXStream::inverseMultiCompAndDCJob(void *data, int idx) {
+  JPXTileJob *job = &((JPXTileJob *)data)[idx];
+
+  job->ok = job->str->inverseMultiCompAndDC(job->tile);
+}
+
+// Replay the packets saved by saveCodeBlockData through
+// readCodeBlockData.
+GBool JPXStream::decodeCodeBlock(JPXCodeBlockJob *job) {
+  JPXCodeBlock *cb;
+  MemStream *dataStr;
+  Object obj;
+  Guint nLens, i, j;
+  GBool ok;
+
+  cb = job->cb;
+  obj.initNull();
+  dataStr = new MemStream((char *)cb->segData, 0, cb->segDataLen, &obj);
+  ok = gTrue;
+  for (j = 0; ok && j < cb->segLensLen; j += 1 + nLens) {
+    cb->nCodingPasses = cb->segLens[j];
+    nLens = (job->tileComp->codeBlockStyle & 0x04) ? cb->nCodingPasses : 1;
+    if (nLens > cb->dataLenSize) {
+      cb->dataLenSize = nLens;
+      cb->dataLen = (Guint *)greallocn(cb->dataLen, cb->dataLenSize,
+				       sizeof(Guint));
+    }
+    for (i = 0; i < nLens; ++i) {
+      cb->dataLen[i] = cb->segLens[j + 1 + i];
+    }
+    ok = readCodeBlockData(job->tileComp, job->resLevel, job->precinct,
+			   job->subband, job->res, job->sb, cb, dataStr);
+  }
+
+  // the decoder state isn't needed once all of the data is decoded
+  delete cb->arithDecoder;
+  cb->arithDecoder = NULL;
+  delete cb->stats;
+  cb->stats = NULL;
+  delete dataStr;
+  return ok;
+}
+
 GBool JPXStream::readCodeBlockData(JPXTileComp *tileComp,
 				   JPXResLevel *resLevel,
 				   JPXPrecinct *precinct,
 				   JPXSubband *subband,
 				   Guint res, Guint sb,
-				   JPXCodeBlock *cb) {
+				   JPXCodeBlock *cb, Stream *dataStr) {
   int *coeff0, *coeff1, *coeff;
   char *touched0, *touched1, *touched;
   Guint horiz, vert, diag, all, cx, xorBit;
@@ -2455,7 +2935,7 @@ GBool JPXStream::readCodeBlockData(JPXTileComp *tileComp,
   } else {
     cover(64);
     cb->arithDecoder = new JArithmeticDecoder();
-    cb->arithDecoder->setStream(bufStr, cb->dataLen[0]);
+    cb->arithDecoder->setStream(dataStr, cb->dataLen[0]);
     cb->arithDecoder->start();
     cb->stats = new JArithmeticDecoderStats(jpxNContexts);
     cb->stats->setEntry(jpxContextSigProp, 4, 0);
@@ -2465,7 +2945,7 @@ GBool JPXStream::readCodeBlockData(JPXTileComp *tileComp,
 
   for (i = 0; i < cb->nCodingPasses; ++i) {
     if ((tileComp->codeBlockStyle & 0x04) && i > 0) {
-      cb->arithDecoder->setStream(bufStr, cb->dataLen[i]);
+      cb->arithDecoder->setStream(dataStr, cb->dataLen[i]);
       cb->arithDecoder->start();
     }
 
@@ -2848,7 +3328,7 @@ void JPXStream::inverseTransform(JPXTileComp *tileComp) {
 
   //----- IDWT for each level
 
-  for (r = 1; r <= tileComp->nDecompLevels; ++r) {
+  for (r = 1; r <= tileComp->nDecompLevels - tileComp->reduction; ++r) {
     resLevel = &tileComp->resLevels[r];
 
     // (n)LL is already in the upper-left corner of the
@@ -2875,8 +3355,8 @@ void JPXStream::inverseTransformLevel(JPXTileComp *tileComp,
   double mu;
   int val;
   int *dataPtr, *bufPtr;
-  Guint nx1, nx2, ny1, ny2, offset;
-  Guint x, y, sb, cbX, cbY;
+  Guint nx1, nx2, ny1, ny2, offset, evenOffset, nCols;
+  Guint x, y, k, sb, cbX, cbY;
 
   //----- fixed-point adjustment and dequantization
 
@@ -3028,53 +3508,58 @@ void JPXStream::inverseTransformLevel(JPXTileComp *tileComp,
     }
   }
 
-  // vertical (column) transforms
+  // vertical (column) transforms -- these are done on strips of
+  // jpxStripWidth columns, with each row of the strip stored
+  // contiguously in buf, so that the lifting steps work along rows of
+  // the tile-component instead of down individual columns
   if (r == tileComp->nDecompLevels) {
     offset = 3 + (tileComp->y0 & 1);
   } else {
     offset = 3 + (tileComp->resLevels[r+1].y0 & 1);
   }
-  for (x = 0, dataPtr = tileComp->data; x < nx2; ++x, ++dataPtr) {
-    if (precinct->subbands[1].y0 == precinct->subbands[0].y0) {
-      // fetch LL/HL
-      for (y = 0, bufPtr = tileComp->buf + offset;
-	   y < ny1;
-	   ++y, bufPtr += 2) {
-	*bufPtr = dataPtr[y * tileComp->w];
-      }
-      // fetch LH/HH
-      for (y = ny1, bufPtr = tileComp->buf + offset + 1;
-	   y < ny2;
-	   ++y, bufPtr += 2) {
-	*bufPtr = dataPtr[y * tileComp->w];
+  if (tileComp->x1 - tileComp->x0 > tileComp->y1 - tileComp->y0) {
+    y = tileComp->x1 - tileComp->x0 + 5;
+  } else {
+    y = tileComp->y1 - tileComp->y0 + 5;
+  }
+  if (offset + ny2 > y || ny2 == 0) {
+    error(errSyntaxError, getPos(),
+	  "Invalid call of inverseTransformStrip in inverseTransformLevel in JPX stream");
+    return;
+  }
+  if (precinct->subbands[1].y0 == precinct->subbands[0].y0) {
+    evenOffset = offset;
+  } else {
+    evenOffset = offset + 1;
+  }
+  for (x = 0; x < nx2; x += jpxStripWidth) {
+    nCols = nx2 - x < jpxStripWidth ? nx2 - x : jpxStripWidth;
+    // fetch LL/HL into the even (or odd) rows, and LH/HH into the
+    // others; columns past the end of the strip are zeroed
+    for (y = 0; y < ny2; ++y) {
+      if (y < ny1) {
+	bufPtr = tileComp->buf + (evenOffset + 2 * y) * jpxStripWidth;
+      } else {
+	bufPtr = tileComp->buf
+	         + ((2 * offset + 1 - evenOffset) + 2 * (y - ny1))
+	           * jpxStripWidth;
       }
-    } else {
-      // fetch LL/HL
-      for (y = 0, bufPtr = tileComp->buf + offset + 1;
-	   y < ny1;
-	   ++y, bufPtr += 2) {
-	*bufPtr = dataPtr[y * tileComp->w];
+      dataPtr = tileComp->data + y * tileComp->w + x;
+      for (k = 0; k < nCols; ++k) {
+	bufPtr[k] = dataPtr[k];
       }
-      // fetch LH/HH
-      for (y = ny1, bufPtr = tileComp->buf + offset;
-	   y < ny2;
-	   ++y, bufPtr += 2) {
-	*bufPtr = dataPtr[y * tileComp->w];
+      for (; k < jpxStripWidth; ++k) {
+	bufPtr[k] = 0;
       }
     }
-    if (tileComp->x1 - tileComp->x0 > tileComp->y1 - tileComp->y0) {
-      y = tileComp->x1 - tileComp->x0 + 5;
-    } else {
-      y = tileComp->y1 - tileComp->y0 + 5;
-    }
-    if (offset + ny2 > y || ny2 == 0) {
-      error(errSyntaxError, getPos(),
-	"Invalid call of inverseTransform1D in inverseTransformLevel in JPX stream");
-      return;
-    }
-    inverseTransform1D(tileComp, tileComp->buf, offset, ny2);
-    for (y = 0, bufPtr = tileComp->buf + offset; y < ny2; ++y, ++bufPtr) {
-      dataPtr[y * tileComp->w] = *bufPtr;
+    inverseTransformStrip(tileComp, tileComp->buf, offset, ny2);
+    for (y = 0, bufPtr = tileComp->buf + offset * jpxStripWidth;
+	 y < ny2;
+	 ++y, bufPtr += jpxStripWidth) {
+      dataPtr = tileComp->data + y * tileComp->w + x;
+      for (k = 0; k < nCols; ++k) {
+	dataPtr[k] = bufPtr[k];
+      }
     }
   }
 }
@@ -3177,6 +3662,140 @@ void JPXStream::inverseTransform1D(JPXTileComp *tileComp, int *data,
   }
 }
 
+// Copy row <src> of a strip to row <dst>.
+#define jpxStripCopy(data, dst, src) \
+  memcpy((data) + (dst) * jpxStripWidth, (data) + (src) * jpxStripWidth, \
+	 jpxStripWidth * sizeof(int))
+
+// The same as inverseTransform1D, but on jpxStripWidth interleaved
+// signals at once: element i of signal k is data[i * jpxStripWidth + k].
+// Each lifting step is a fixed-length loop across a row, which the
+// compiler can vectorize.
+void JPXStream::inverseTransformStrip(JPXTileComp *tileComp, int *data,
+				      Guint offset, Guint n) {
+  int *p, *prev, *next;
+  Guint end, i, k;
+
+  //----- special case for length = 1
+  if (n == 1) {
+    if (offset == 4) {
+      for (k = 0; k < jpxStripWidth; ++k) {
+	data[k] >>= 1;
+      }
+    }
+
+  } else {
+
+    end = offset + n;
+
+    //----- extend right
+    jpxStripCopy(data, end, end - 2);
+    if (n == 2) {
+      jpxStripCopy(data, end + 1, offset + 1);
+      jpxStripCopy(data, end + 2, offset);
+      jpxStripCopy(data, end + 3, offset + 1);
+    } else {
+      jpxStripCopy(data, end + 1, end - 3);
+      if (n == 3) {
+	jpxStripCopy(data, end + 2, offset + 1);
+	jpxStripCopy(data, end + 3, offset + 2);
+      } else {
+	jpxStripCopy(data, end + 2, end - 4);
+	if (n == 4) {
+	  jpxStripCopy(data, end + 3, offset + 1);
+	} else {
+	  jpxStripCopy(data, end + 3, end - 5);
+	}
+      }
+    }
+
+    //----- extend left
+    jpxStripCopy(data, offset - 1, offset + 1);
+    jpxStripCopy(data, offset - 2, offset + 2);
+    jpxStripCopy(data, offset - 3, offset + 3);
+    if (offset == 4) {
+      jpxStripCopy(data, 0, offset + 4);
+    }
+
+    //----- 9-7 irreversible filter
+
+    if (tileComp->transform == 0) {
+      // step 1 (even)
+      for (i = 1; i <= end + 2; i += 2) {
+	p = data + i * jpxStripWidth;
+	for (k = 0; k < jpxStripWidth; ++k) {
+	  p[k] = (int)(idwtKappa * p[k]);
+	}
+      }
+      // step 2 (odd)
+      for (i = 0; i <= end + 3; i += 2) {
+	p = data + i * jpxStripWidth;
+	for (k = 0; k < jpxStripWidth; ++k) {
+	  p[k] = (int)(idwtIKappa * p[k]);
+	}
+      }
+      // step 3 (even)
+      for (i = 1; i <= end + 2; i += 2) {
+	p = data + i * jpxStripWidth;
+	prev = p - jpxStripWidth;
+	next = p + jpxStripWidth;
+	for (k = 0; k < jpxStripWidth; ++k) {
+	  p[k] = (int)(p[k] - idwtDelta * (prev[k] + next[k]));
+	}
+      }
+      // step 4 (odd)
+      for (i = 2; i <= end + 1; i += 2) {
+	p = data + i * jpxStripWidth;
+	prev = p - jpxStripWidth;
+	next = p + jpxStripWidth;
+	for (k = 0; k < jpxStripWidth; ++k) {
+	  p[k] = (int)(p[k] - idwtGamma * (prev[k] + next[k]));
+	}
+      }
+      // step 5 (even)
+      for (i = 3; i <= end; i += 2) {
+	p = data + i * jpxStripWidth;
+	prev = p - jpxStripWidth;
+	next = p + jpxStripWidth;
+	for (k = 0; k < jpxStripWidth; ++k) {
+	  p[k] = (int)(p[k] - idwtBeta * (prev[k] + next[k]));
+	}
+      }
+      // step 6 (odd)
+      for (i = 4; i <= end - 1; i += 2) {
+	p = data + i * jpxStripWidth;
+	prev = p - jpxStripWidth;
+	next = p + jpxStripWidth;
+	for (k = 0; k < jpxStripWidth; ++k) {
+	  p[k] = (int)(p[k] - idwtAlpha * (prev[k] + next[k]));
+	}
+      }
+
+    //----- 5-3 reversible filter
+
+    } else {
+      // step 1 (even)
+      for (i = 3; i <= end; i += 2) {
+	p = data + i * jpxStripWidth;
+	prev = p - jpxStripWidth;
+	next = p + jpxStripWidth;
+	for (k = 0; k < jpxStripWidth; ++k) {
+	  p[k] -= (prev[k] + next[k] + 2) >> 2;
+	}
+      }
+      // step 2 (odd)
+      for (i = 4; i < end; i += 2) {
+	p = data + i * jpxStripWidth;
+	prev = p - jpxStripWidth;
+	next = p + jpxStripWidth;
+	for (k = 0; k < jpxStripWidth; ++k) {
+	  p[k] += (prev[k] + next[k]) >> 1;
+	}
+      }
+    }
+  }
+}
+
 // Inverse multi-component transform and DC level shift.  This also
 // converts fixed point samples back to integers.
 GBool JPXStream::inverseMultiCompAndDC(JPXTile *tile) {
@@ -19,6 +19,8 @@
 
 class JArithmeticDecoder;
 class JArithmeticDecoderStats;
+struct JPXCodeBlockJob;
+struct JPXTileJob;
 
 //------------------------------------------------------------------------
 
@@ -119,6 +121,15 @@ struct JPXCodeBlock {
   Guint *dataLen;		// data lengths (one per codeword segment)
   Guint dataLenSize;		// size of the dataLen array
 
+  //----- data from all packets, decoded after the codestream is read
+  Guchar *segData;		// code-block data
+  Guint segDataLen;		// number of bytes in segData
+  Guint segDataSize;		// size of the segData array
+  Guint *segLens;		// for each packet: the number of coding
+				//   passes, then the data length(s)
+  Guint segLensLen;		// number of entries in segLens
+  Guint segLensSize;		// size of the segLens array
+
   //----- coefficient data
   int *coeffs;
   char *touched;		// coefficient 'touched' flags
@@ -185,6 +196,8 @@ struct JPXTileComp {
   //----- from the COD and COC segments (main and tile)
   Guint style;			// coding style parameter (Scod / Scoc)
   Guint nDecompLevels;		// number of decomposition levels
+  Guint reduction;		// number of decomposition levels which
+				//   are not inverse transformed
   Guint codeBlockW;		// log2(code-block width)
   Guint codeBlockH;		// log2(code-block height)
   Guint codeBlockStyle;		// code-block style
@@ -271,28 +284,46 @@ public:
   virtual GBool isBinary(GBool last = gTrue);
   virtual void getImageParams(int *bitsPerComponent,
 			      StreamColorSpaceMode *csMode);
+  virtual GBool reduceResolution(int minWidth, int minHeight,
+				 int *width, int *height);
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
+  int copyTileRow(int nChars, Guchar *buffer);
   void fillReadBuf();
   void getImageParams2(int *bitsPerComponent, StreamColorSpaceMode *csMode);
+  GBool getCodestreamLevels(Guint *xSize, Guint *ySize,
+			    Guint *xOffset, Guint *yOffset,
+			    Guint *nLevels);
   GBool readBoxes();
   GBool readColorSpecBox(Guint dataLen);
   GBool readCodestream(Guint len);
   GBool readTilePart();
   GBool readTilePartData(Guint tileIdx,
 			 Guint tilePartLen, GBool tilePartToEOC);
+  void saveCodeBlockData(JPXTileComp *tileComp, JPXCodeBlock *cb,
+			 Guint n);
+  GBool decodeTiles();
+  static void decodeCodeBlockJob(void *data, int idx);
+  static void inverseTransformJob(void *data, int idx);
+  static void inverseMultiCompAndDCJob(void *data, int idx);
+  GBool decodeCodeBlock(JPXCodeBlockJob *job);
   GBool readCodeBlockData(JPXTileComp *tileComp,
 			  JPXResLevel *resLevel,
 			  JPXPrecinct *precinct,
 			  JPXSubband *subband,
 			  Guint res, Guint sb,
-			  JPXCodeBlock *cb);
+			  JPXCodeBlock *cb, Stream *dataStr);
   void inverseTransform(JPXTileComp *tileComp);
   void inverseTransformLevel(JPXTileComp *tileComp,
 			     Guint r, JPXResLevel *resLevel);
   void inverseTransform1D(JPXTileComp *tileComp, int *data,
 			  Guint offset, Guint n);
+  void inverseTransformStrip(JPXTileComp *tileComp, int *data,
+			     Guint offset, Guint n);
   GBool inverseMultiCompAndDC(JPXTile *tile);
   GBool readBoxHdr(Guint *boxType, Guint *boxLen, Guint *dataLen);
   int readMarkerHdr(int *segType, Guint *segLen);
@@ -330,6 +361,13 @@ private:
 				//   (for bit stuffing)
   Guint byteCount;		// number of available bytes left
 
+  int decodeThreads;		// max number of threads to decode with; if
+				//   1, code-blocks are decoded as they are
+				//   read, otherwise their data is saved
+				//   until the codestream has been read
+  Guint reduction;		// log2 of the resolution reduction
+  Guint outXOffset, outYOffset,	// image bounds at the reduced resolution
+        outXSize, outYSize;
   Guint curX, curY, curComp;	// current position for lookChar/getChar
   Guint readBuf;		// read buffer
   Guint readBufLen;		// number of valid bits in readBuf
@@ -70,37 +70,35 @@ static const long long LongLongSafeLimit = (LLONG_MAX - 9) / 10;
 //------------------------------------------------------------------------
 
 Lexer::Lexer(XRef *xrefA, Stream *str) {
-  Object obj;
-
   lookCharLastValueCached = LOOK_VALUE_NOT_CACHED;
   xref = xrefA;
 
-  curStr.initStream(str);
-  streams = new Array(xref);
-  streams->add(curStr.copy(&obj));
+  // a single stream doesn't need the streams array, which saves an
+  // allocation for each object fetched from the xref
+  singleStr.initStream(str);
+  streams = NULL;
   strPtr = 0;
-  freeArray = gTrue;
+  singleStr.copy(&curStr);
   curStr.streamReset();
 }
 
 Lexer::Lexer(XRef *xrefA, Object *obj) {
-  Object obj2;
-
   lookCharLastValueCached = LOOK_VALUE_NOT_CACHED;
   xref = xrefA;
 
+  strPtr = 0;
   if (obj->isStream()) {
-    streams = new Array(xref);
-    freeArray = gTrue;
-    streams->add(obj->copy(&obj2));
+    streams = NULL;
+    obj->copy(&singleStr);
+    singleStr.copy(&curStr);
+    curStr.streamReset();
   } else {
     streams = obj->getArray();
-    freeArray = gFalse;
-  }
-  strPtr = 0;
-  if (streams->getLength() > 0) {
-    streams->get(strPtr, &curStr);
-    curStr.streamReset();
+    singleStr.initNull();
+    if (streams->getLength() > 0) {
+      streams->get(strPtr, &curStr);
+      curStr.streamReset();
+    }
   }
 }
 
@@ -109,9 +107,7 @@ Lexer::~Lexer() {
     curStr.streamClose();
     curStr.free();
   }
-  if (freeArray) {
-    delete streams;
-  }
+  singleStr.free();
 }
 
 int Lexer::getChar(GBool comesFromLook) {
@@ -131,7 +127,7 @@ int Lexer::getChar(GBool comesFromLook) {
       curStr.streamClose();
       curStr.free();
       ++strPtr;
-      if (strPtr < streams->getLength()) {
+      if (streams && strPtr < streams->getLength()) {
         streams->get(strPtr, &curStr);
         curStr.streamReset();
       }
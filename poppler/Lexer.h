@@ -96,10 +96,12 @@ private:
   int getChar(GBool comesFromLook = gFalse);
   int lookChar();
 
-  Array *streams;		// array of input streams
+  Array *streams;		// array of input streams (NULL if the
+				//   lexer reads a single stream)
   int strPtr;			// index of current stream
   Object curStr;		// current stream
-  GBool freeArray;		// should lexer free the streams array?
+  Object singleStr;		// the input stream, if <streams> is NULL;
+				//   kept alive until the lexer is deleted
   char tokBuf[tokBufSize];	// temporary token buffer
 
   XRef *xref;
@@ -12,6 +12,8 @@
 #include <config.h>
 
 #include "LocalPDFDocBuilder.h"
+#include "GlobalParams.h"
+#include "Stream.h"
 
 //------------------------------------------------------------------------
 // LocalPDFDocBuilder
@@ -22,14 +24,18 @@ LocalPDFDocBuilder::buildPDFDoc(
     const GooString &uri, GooString *ownerPassword, GooString
     *userPassword, void *guiDataA)
 {
+  GooString *fileName = uri.copy();
   if (uri.cmpN("file://", 7) == 0) {
-     GooString *fileName = uri.copy();
      fileName->del(0, 7);
-     return new PDFDoc(fileName, ownerPassword, userPassword, guiDataA);
-  } else {
-     GooString *fileName = uri.copy();
-     return new PDFDoc(fileName, ownerPassword, userPassword, guiDataA);
   }
+  if (globalParams && globalParams->getMapLocalFiles()) {
+    MmapStream *str = MmapStream::open(fileName);
+    if (str) {
+      delete fileName;
+      return new PDFDoc(str, ownerPassword, userPassword, guiDataA);
+    }
+  }
+  return new PDFDoc(fileName, ownerPassword, userPassword, guiDataA);
 }
 
 GBool LocalPDFDocBuilder::supports(const GooString &uri)
@@ -109,6 +109,11 @@ public:
   // form-type XObjects will be interpreted (i.e., unrolled).
   virtual GBool useDrawForm() { return gFalse; }
 
+  // May images drawn smaller than their native size be decoded at a
+  // reduced resolution?  Only devices which rasterize images at device
+  // resolution should return true.
+  virtual GBool useReducedImages() { return gFalse; }
+
   // Does this device use beginType3Char/endType3Char?  Otherwise,
   // text in Type 3 fonts will be drawn with drawChar/drawString.
   virtual GBool interpretType3Chars() = 0;
@@ -76,6 +76,7 @@
 #endif
 #include "PDFDoc.h"
 #include "Hints.h"
+#include "Gfx.h"
 
 #if MULTITHREADED
 #  define pdfdocLocker()   MutexLocker locker(&mutex)
@@ -120,6 +121,8 @@ void PDFDoc::init()
   startXRefPos = -1;
   secHdlr = NULL;
   pageCache = NULL;
+  formCache = new GfxFormCache(globalParams ? globalParams->getFormCacheSize()
+                                            : 0);
 }
 
 PDFDoc::PDFDoc()
@@ -302,6 +305,7 @@ GBool PDFDoc::setup(GooString *ownerPassword, GooString *userPassword) {
 }
 
 PDFDoc::~PDFDoc() {
+  delete formCache;
   if (pageCache) {
     for (int i = 0; i < getNumPages(); i++) {
       if (pageCache[i]) {
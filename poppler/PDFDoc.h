@@ -62,6 +62,7 @@ class Linearization;
 class SecurityHandler;
 class Hints;
 class StructTreeRoot;
+class GfxFormCache;
 
 enum PDFWriteMode {
   writeStandard,
@@ -115,6 +116,11 @@ public:
   // Get catalog.
   Catalog *getCatalog() { return catalog; }
 
+  // Get the cache of parsed Form XObject content streams.  Its memory
+  // budget comes from GlobalParams::getFormCacheSize (off by default),
+  // and can be changed with GfxFormCache::setMaxBytes.
+  GfxFormCache *getFormCache() { return formCache; }
+
   // Get optional content configuration
   OCGs *getOptContentConfig() { return catalog->getOptContentConfig(); }
 
@@ -146,7 +152,8 @@ public:
   // Get page.
   Page *getPage(int page);
 
-  // Display a page.
+  // Display a page.  With MULTITHREADED, several threads can display
+  // pages of the same document at once, each with its own OutputDev.
   void displayPage(OutputDev *out, int page,
 		   double hDPI, double vDPI, int rotate,
 		   GBool useMediaBox, GBool crop, GBool printing,
@@ -327,6 +334,7 @@ private:
   Outline *outline;
 #endif
   Page **pageCache;
+  GfxFormCache *formCache;
 
   GBool ok;
   int errCode;
@@ -110,8 +110,10 @@ Object *Parser::getObj(Object *obj, GBool simpleOnly,
 	if (strict) goto err;
 	shift();
       } else {
-	// buf1 might go away in shift(), so construct the key
-	key = copyString(buf1.getName());
+	// buf1 goes away in shift(), so take over its name as the key
+	// instead of copying it
+	key = buf1.getName();
+	buf1.initNull();
 	shift();
 	if (buf1.isEOF() || buf1.isError()) {
 	  gfree(key);
@@ -49,6 +49,7 @@
 #include <string.h>
 #include <math.h>
 #include "goo/gfile.h"
+#include "goo/GooThreadPool.h"
 #include "GlobalParams.h"
 #include "Error.h"
 #include "Object.h"
@@ -58,6 +59,8 @@
 #include "PDFDoc.h"
 #include "Link.h"
 #include "FontEncodingTables.h"
+#include "DecodedImageCache.h"
+#include "DisplayListOutputDev.h"
 #include "fofi/FoFiTrueType.h"
 #include "splash/SplashBitmap.h"
 #include "splash/SplashGlyphBitmap.h"
@@ -1260,6 +1263,7 @@ SplashOutputDev::SplashOutputDev(SplashColorMode colorModeA,
   bitmapUpsideDown = gFalse;
   fontAntialias = gTrue;
   vectorAntialias = gTrue;
+  vectorAntialiasMode = splashAASupersample;
   overprintPreview = overprintPreviewA;
   enableFreeTypeHinting = gFalse;
   enableSlightHinting = gFalse;
@@ -1294,6 +1298,13 @@ SplashOutputDev::SplashOutputDev(SplashColorMode colorModeA,
   transpGroupStack = NULL;
   nestCount = 0;
   xref = NULL;
+
+  reducedImages = gFalse;
+  rasterThreads = 1;
+  bandDevs = NULL;
+  nBandDevs = 0;
+  bandMaster = NULL;
+  bandYMin = bandYMax = 0;
 }
 
 void SplashOutputDev::setupScreenParams(double hDPI, double vDPI) {
@@ -1359,9 +1370,14 @@ SplashOutputDev::~SplashOutputDev() {
   if (splash) {
     delete splash;
   }
-  if (bitmap) {
+  // a band device's bitmap belongs to its master
+  if (bitmap && !bandMaster) {
     delete bitmap;
   }
+  for (i = 0; i < nBandDevs; ++i) {
+    delete bandDevs[i];
+  }
+  gfree(bandDevs);
 }
 
 void SplashOutputDev::startDoc(PDFDoc *docA) {
@@ -1386,6 +1402,11 @@ void SplashOutputDev::startDoc(PDFDoc *docA) {
     delete t3FontCache[i];
   }
   nT3Fonts = 0;
+  // the band devices are set up for the old document
+  for (i = 0; i < nBandDevs; ++i) {
+    delete bandDevs[i];
+  }
+  nBandDevs = 0;
 }
 
 void SplashOutputDev::startPage(int pageNum, GfxState *state, XRef *xrefA) {
@@ -1414,7 +1435,11 @@ void SplashOutputDev::startPage(int pageNum, GfxState *state, XRef *xrefA) {
     delete splash;
     splash = NULL;
   }
-  if (!bitmap || w != bitmap->getWidth() || h != bitmap->getHeight()) {
+  if (bandMaster) {
+    // draw into the master's bitmap, which it has already cleared
+    thinLineMode = bandMaster->splash->getThinLineMode();
+    bitmap = bandMaster->bitmap;
+  } else if (!bitmap || w != bitmap->getWidth() || h != bitmap->getHeight()) {
     if (bitmap) {
       delete bitmap;
       bitmap = NULL;
@@ -1430,6 +1455,7 @@ void SplashOutputDev::startPage(int pageNum, GfxState *state, XRef *xrefA) {
   }
   splash = new Splash(bitmap, vectorAntialias, &screenParams);
   splash->setThinLineMode(thinLineMode);
+  splash->setAAMode(vectorAntialiasMode);
   splash->setMinLineWidth(globalParams->getMinLineWidth());
   if (state) {
     ctm = state->getCTM();
@@ -1472,7 +1498,11 @@ void SplashOutputDev::startPage(int pageNum, GfxState *state, XRef *xrefA) {
   // the SA parameter supposedly defaults to false, but Acrobat
   // apparently hardwires it to true
   splash->setStrokeAdjust(globalParams->getStrokeAdjust());
-  splash->clear(paperColor, 0);
+  if (bandMaster) {
+    splash->setBand(bandYMin, bandYMax);
+  } else {
+    splash->clear(paperColor, 0);
+  }
 }
 
 void SplashOutputDev::endPage() {
@@ -1481,6 +1511,151 @@ void SplashOutputDev::endPage() {
   }
 }
 
+struct SplashOutRecordData {
+  DisplayListOutputDev *dlOut;
+  GBool (*abortCheckCbk)(void *data);
+  void *abortCheckCbkData;
+};
+
+// Stop recording as soon as the page has to be drawn without bands.
+static GBool recordAbortCheck(void *data) {
+  SplashOutRecordData *rec = (SplashOutRecordData *)data;
+
+  if (!rec->dlOut->isExact()) {
+    return gTrue;
+  }
+  return rec->abortCheckCbk && (*rec->abortCheckCbk)(rec->abortCheckCbkData);
+}
+
+struct SplashOutBandData {
+  DisplayList *list;
+  Page *page;
+  SplashOutputDev **devs;
+  double hDPI, vDPI;
+  int rotate;
+  GBool useMediaBox;
+  int sliceX, sliceY, sliceW, sliceH;
+};
+
+GBool SplashOutputDev::checkPageSlice(Page *page, double hDPI, double vDPI,
+				      int rotate, GBool useMediaBox,
+				      GBool crop,
+				      int sliceX, int sliceY,
+				      int sliceW, int sliceH,
+				      GBool printing,
+				      GBool (*abortCheckCbk)(void *data),
+				      void *abortCheckCbkData,
+				      GBool (*annotDisplayDecideCbk)(Annot *annot, void *user_data),
+				      void *annotDisplayDecideCbkData) {
+  DisplayListOutputDev *dlOut;
+  DisplayList *list;
+  SplashOutRecordData rec;
+  SplashOutBandData band;
+  int n, h, i;
+
+  if (rasterThreads <= 1 || bandMaster) {
+    return gTrue;
+  }
+
+  // interpret the page once, asking this device how to handle images
+  // and forms; a soft mask left over from the last page would make
+  // every form look like it needs a transparency group
+  if (splash) {
+    splash->setSoftMask(NULL);
+  }
+  dlOut = new DisplayListOutputDev(upsideDown());
+  dlOut->setTarget(this);
+  rec.dlOut = dlOut;
+  rec.abortCheckCbk = abortCheckCbk;
+  rec.abortCheckCbkData = abortCheckCbkData;
+  page->displaySlice(dlOut, hDPI, vDPI, rotate, useMediaBox, crop,
+		     sliceX, sliceY, sliceW, sliceH, printing,
+		     &recordAbortCheck, &rec,
+		     annotDisplayDecideCbk, annotDisplayDecideCbkData);
+  list = dlOut->takeDisplayList();
+  delete dlOut;
+  if (!list || !list->isExact()) {
+    delete list;
+    return gTrue;
+  }
+
+  // allocate and clear the bitmap
+  list->startPage(this, page, hDPI, vDPI, rotate, useMediaBox,
+		  sliceX, sliceY, sliceW, sliceH);
+
+  h = bitmap->getHeight();
+  n = rasterThreads < h ? rasterThreads : h;
+  if (n > nBandDevs) {
+    bandDevs = (SplashOutputDev **)greallocn(bandDevs, n,
+					     sizeof(SplashOutputDev *));
+    for (i = nBandDevs; i < n; ++i) {
+      bandDevs[i] = makeBandDev();
+    }
+    nBandDevs = n;
+  }
+  for (i = 0; i < n; ++i) {
+    bandDevs[i]->vectorAntialias = vectorAntialias;
+    bandDevs[i]->vectorAntialiasMode = vectorAntialiasMode;
+    bandDevs[i]->bitmapUpsideDown = bitmapUpsideDown;
+    bandDevs[i]->reverseVideo = reverseVideo;
+    splashColorCopy(bandDevs[i]->paperColor, paperColor);
+    bandDevs[i]->skipHorizText = skipHorizText;
+    bandDevs[i]->skipRotatedText = skipRotatedText;
+    bandDevs[i]->bandYMin = (int)(((long long)h * i) / n);
+    bandDevs[i]->bandYMax = (int)(((long long)h * (i + 1)) / n) - 1;
+  }
+
+  band.list = list;
+  band.page = page;
+  band.devs = bandDevs;
+  band.hDPI = hDPI;
+  band.vDPI = vDPI;
+  band.rotate = rotate;
+  band.useMediaBox = useMediaBox;
+  band.sliceX = sliceX;
+  band.sliceY = sliceY;
+  band.sliceW = sliceW;
+  band.sliceH = sliceH;
+  GooThreadPool::get()->run(n, &drawBand, &band, n);
+
+  delete list;
+  return gFalse;
+}
+
+void SplashOutputDev::drawBand(void *data, int idx) {
+  SplashOutBandData *band = (SplashOutBandData *)data;
+
+  band->list->display(band->devs[idx], band->page, band->hDPI, band->vDPI,
+		      band->rotate, band->useMediaBox,
+		      band->sliceX, band->sliceY,
+		      band->sliceW, band->sliceH);
+}
+
+// Create a device which draws a band of this device's bitmap.
+SplashOutputDev *SplashOutputDev::makeBandDev() {
+  SplashOutputDev *dev;
+
+  dev = new SplashOutputDev(colorMode, bitmapRowPad, reverseVideo,
+			    keepAlphaChannel ? (SplashColorPtr)NULL
+			                     : paperColor,
+			    bitmapTopDown, splash->getThinLineMode(),
+			    overprintPreview);
+  dev->fontAntialias = fontAntialias;
+  dev->enableFreeTypeHinting = enableFreeTypeHinting;
+  dev->enableSlightHinting = enableSlightHinting;
+  dev->startDoc(doc);
+  delete dev->splash;
+  dev->splash = NULL;
+  delete dev->bitmap;
+  dev->bitmap = NULL;
+  dev->bandMaster = this;
+  return dev;
+}
+
+void SplashOutputDev::setRasterThreads(int n) {
+  rasterThreads = n < 1 ? 1 : n;
+}
+
 void SplashOutputDev::saveState(GfxState *state) {
   splash->saveState();
 }
@@ -2629,6 +2804,7 @@ void SplashOutputDev::type3D1(GfxState *state, double wx, double wy,
 			      splashModeMono8, gFalse);
     splash = new Splash(bitmap, vectorAntialias,
 			t3GlyphStack->origSplash->getScreen());
+    splash->setAAMode(vectorAntialiasMode);
     color[0] = 0x00;
     splash->clear(color);
     color[0] = 0xff;
@@ -2782,6 +2958,7 @@ void SplashOutputDev::setSoftMaskFromImageMask(GfxState *state,
   maskSplash = new Splash(maskBitmap, vectorAntialias);
   maskColor[0] = 0;
   maskSplash->clear(maskColor);
+  maskSplash->setBand(splash->getBandYMin(), splash->getBandYMax());
   maskColor[0] = 0xff;
   maskSplash->setFillPattern(new SplashSolidColor(maskColor));
   maskSplash->fillImageMask(&imageMaskSrc, &imgMaskData,  width, height, mat, t3GlyphStack != NULL);
@@ -3062,6 +3239,25 @@ GBool SplashOutputDev::alphaImageSrc(void *data, SplashColorPtr colorLine,
   return gTrue;
 }
 
+struct SplashOutDecodedImageData {
+  DecodedImage *image;
+  int y;
+};
+
+GBool SplashOutputDev::decodedImageSrc(void *data, SplashColorPtr colorLine,
+				       Guchar * /*alphaLine*/) {
+  SplashOutDecodedImageData *imgData = (SplashOutDecodedImageData *)data;
+  DecodedImage *image = imgData->image;
+
+  if (imgData->y >= image->getHeight()) {
+    return gFalse;
+  }
+  memcpy(colorLine, image->getData() + imgData->y * image->getRowSize(),
+	 image->getRowSize());
+  ++imgData->y;
+  return gTrue;
+}
+
 struct TilingSplashOutBitmap {
   SplashBitmap *bitmap;
   SplashPattern *pattern;
@@ -3162,8 +3358,13 @@ void SplashOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
   double *ctm;
   SplashCoord mat[6];
   SplashOutImageData imgData;
+  SplashOutDecodedImageData decData;
   SplashColorMode srcMode;
   SplashImageSource src;
+  DecodedImageCache *imageCache;
+  GooString *cacheKey;
+  DecodedImage *decodedImage;
+  Guchar *decodedData;
   GfxGray gray;
   GfxRGB rgb;
 #if SPLASH_CMYK
@@ -3172,7 +3373,7 @@ void SplashOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
   GfxColor deviceN;
 #endif
   Guchar pix;
-  int n, i;
+  int rowSize, n, i, y;
 
   ctm = state->getCTM();
   for (i = 0; i < 6; ++i) {
@@ -3185,10 +3386,38 @@ void SplashOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
   mat[4] = ctm[2] + ctm[4];
   mat[5] = ctm[3] + ctm[5];
 
-  imgData.imgStr = new ImageStream(str, width,
-				   colorMap->getNumPixelComps(),
-				   colorMap->getBits());
-  imgData.imgStr->reset();
+  if (colorMode == splashModeMono1) {
+    srcMode = splashModeMono8;
+  } else {
+    srcMode = colorMode;
+  }
+
+  // image XObjects are decoded into the document's decoded image
+  // cache, so they only need to be decoded once
+  imageCache = NULL;
+  cacheKey = NULL;
+  decodedImage = NULL;
+  rowSize = width * splashColorModeNComps[srcMode];
+  if (!inlineImg && !maskColors && ref && ref->isRef() && xref &&
+#if SPLASH_CMYK
+      // DeviceN output depends on the page's separations
+      colorMode != splashModeDeviceN8 &&
+#endif
+      (imageCache = xref->getDecodedImageCache()) &&
+      (Goffset)rowSize * height <= imageCache->getMaxBytes() &&
+      (cacheKey = imageCache->makeKey(ref->getRef(), width, height, srcMode,
+				      colorMap, state))) {
+    decodedImage = imageCache->lookup(cacheKey);
+  }
+
+  if (decodedImage) {
+    imgData.imgStr = NULL;
+  } else {
+    imgData.imgStr = new ImageStream(str, width,
+				     colorMap->getNumPixelComps(),
+				     colorMap->getBits());
+    imgData.imgStr->reset();
+  }
   imgData.colorMap = colorMap;
   imgData.maskColors = maskColors;
   imgData.colorMode = colorMode;
@@ -3276,21 +3505,40 @@ void SplashOutputDev::drawImage(GfxState *state, Object *ref, Stream *str,
 		   state->getOverprintMode(), NULL);
 #endif		   
 
-  if (colorMode == splashModeMono1) {
-    srcMode = splashModeMono8;
-  } else {
-    srcMode = colorMode;
+  if (cacheKey && !decodedImage) {
+    decodedData = (Guchar *)gmallocn(height, rowSize);
+    for (y = 0; y < height; ++y) {
+      if (!imageSrc(&imgData, decodedData + y * rowSize, NULL)) {
+	break;
+      }
+    }
+    // a damaged image is drawn as far as it could be decoded, but
+    // isn't cached
+    decodedImage = new DecodedImage(width, y, rowSize, decodedData);
+    if (y == height) {
+      imageCache->put(cacheKey, decodedImage);
+    }
   }
-  src = maskColors ? &alphaImageSrc : &imageSrc;
-  splash->drawImage(src, &imgData, srcMode, maskColors ? gTrue : gFalse,
-		    width, height, mat, interpolate);
-  if (inlineImg) {
-    while (imgData.y < height) {
-      imgData.imgStr->getLine();
-      ++imgData.y;
+
+  if (decodedImage) {
+    decData.image = decodedImage;
+    decData.y = 0;
+    splash->drawImage(&decodedImageSrc, &decData, srcMode, gFalse,
+		      width, height, mat, interpolate);
+    decodedImage->decRefCnt();
+  } else {
+    src = maskColors ? &alphaImageSrc : &imageSrc;
+    splash->drawImage(src, &imgData, srcMode, maskColors ? gTrue : gFalse,
+		      width, height, mat, interpolate);
+    if (inlineImg) {
+      while (imgData.y < height) {
+	imgData.imgStr->getLine();
+	++imgData.y;
+      }
     }
   }
 
+  delete cacheKey;
   gfree(imgData.lookup);
   delete imgData.imgStr;
   str->close();
@@ -3659,6 +3907,7 @@ void SplashOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref,
   maskSplash = new Splash(maskBitmap, vectorAntialias);
   maskColor[0] = 0;
   maskSplash->clear(maskColor);
+  maskSplash->setBand(splash->getBandYMin(), splash->getBandYMax());
   maskSplash->drawImage(&imageSrc, &imgMaskData, splashModeMono8, gFalse,
 			maskWidth, maskHeight, mat, maskInterpolate);
   delete imgMaskData.imgStr;
@@ -3844,7 +4093,12 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
   transpGroup->ty = ty;
   transpGroup->blendingColorSpace = blendingColorSpace;
   transpGroup->isolated = isolated;
-  transpGroup->shape = (knockout && !isolated) ? SplashBitmap::copy(bitmap) : NULL;
+  // other threads may be drawing the rows outside the band
+  transpGroup->shape = (knockout && !isolated)
+                         ? SplashBitmap::copyRows(bitmap,
+						  splash->getBandYMin(),
+						  splash->getBandYMax())
+                         : NULL;
   transpGroup->knockout = (knockout && isolated);
   transpGroup->knockoutOpacity = 1.0;
   transpGroup->next = transpGroupStack;
@@ -3885,6 +4139,9 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
 			    bitmapTopDown, bitmap->getSeparationList());
   splash = new Splash(bitmap, vectorAntialias,
 		      transpGroup->origSplash->getScreen());
+  splash->setAAMode(transpGroup->origSplash->getAAMode());
+  splash->setBand(transpGroup->origSplash->getBandYMin() - ty,
+		  transpGroup->origSplash->getBandYMax() - ty);
   if (transpGroup->next != NULL && transpGroup->next->knockout) {
     fontEngine->setAA(gFalse);
   }
@@ -3996,6 +4253,8 @@ void SplashOutputDev::setSoftMask(GfxState *state, double *bbox,
     if (transpGroupStack->blendingColorSpace) {
       tSplash = new Splash(tBitmap, vectorAntialias,
 			   transpGroupStack->origSplash->getScreen());
+      tSplash->setBand(splash->getBandYMin() - ty,
+		       splash->getBandYMax() - ty);
       switch (tBitmap->getMode()) {
       case splashModeMono1:
 	// transparency is not supported in mono1 mode
@@ -4050,7 +4309,13 @@ void SplashOutputDev::setSoftMask(GfxState *state, double *bbox,
   int yMax = tBitmap->getHeight();
   if (xMax > bitmap->getWidth() - tx) xMax = bitmap->getWidth() - tx;
   if (yMax > bitmap->getHeight() - ty) yMax = bitmap->getHeight() - ty;
-  for (y = 0; y < yMax; ++y) {
+  // the group was only drawn in the band
+  int yMin = splash->getBandYMin() - ty;
+  if (yMin < 0) yMin = 0;
+  if (yMax > splash->getBandYMax() - ty + 1)
+    yMax = splash->getBandYMax() - ty + 1;
+  p += yMin * softMask->getRowSize();
+  for (y = yMin; y < yMax; ++y) {
     for (x = 0; x < xMax; ++x) {
       if (alpha) {
 	if (transferFunc) {
@@ -4153,6 +4418,11 @@ void SplashOutputDev::setVectorAntialias(GBool vaa) {
 }
 #endif
 
+void SplashOutputDev::setVectorAntialiasMode(SplashAAMode mode) {
+  vectorAntialiasMode = mode;
+  splash->setAAMode(mode);
+}
+
 void SplashOutputDev::setFreeTypeHinting(GBool enable, GBool enableSlightHintingA)
 {
   enableFreeTypeHinting = enable;
@@ -190,6 +190,10 @@ public:
   virtual GBool useShadedFills(int type)
   { return (type >= 2 && type <= 5) ? gTrue : gFalse; }
 
+  // Images drawn smaller than their native size may be decoded at a
+  // reduced resolution, if setReducedImages() asked for it.
+  virtual GBool useReducedImages() { return reducedImages; }
+
   // Does this device use upside-down coordinates?
   // (Upside-down means (0,0) is the top left corner of the page.)
   virtual GBool upsideDown() { return bitmapTopDown ^ bitmapUpsideDown; }
@@ -209,6 +213,16 @@ public:
   // End a page.
   virtual void endPage();
 
+  // Rasterize the page in bands if setRasterThreads() asked for it.
+  virtual GBool checkPageSlice(Page *page, double hDPI, double vDPI,
+			       int rotate, GBool useMediaBox, GBool crop,
+			       int sliceX, int sliceY, int sliceW, int sliceH,
+			       GBool printing,
+			       GBool (* abortCheckCbk)(void *data) = NULL,
+			       void * abortCheckCbkData = NULL,
+			       GBool (*annotDisplayDecideCbk)(Annot *annot, void *user_data) = NULL,
+			       void *annotDisplayDecideCbkData = NULL);
+
   //----- save/restore graphics state
   virtual void saveState(GfxState *state);
   virtual void restoreState(GfxState *state);
@@ -359,11 +373,35 @@ public:
   virtual void setVectorAntialias(GBool vaa);
 #endif
 
+  // Select how vector anti-aliasing computes pixel coverage:
+  // splashAASupersample (the default) or splashAAAnalytic.
+  void setVectorAntialiasMode(SplashAAMode mode);
+  SplashAAMode getVectorAntialiasMode() { return vectorAntialiasMode; }
+
   GBool getFontAntialias() { return fontAntialias; }
   void setFontAntialias(GBool anti) { fontAntialias = anti; }
 
   void setFreeTypeHinting(GBool enable, GBool enableSlightHinting);
 
+  // Rasterize each page in <n> horizontal bands, in parallel on the
+  // shared thread pool.  The page is interpreted once into a
+  // DisplayList, which every band plays back into its own Splash
+  // object; the bitmap comes out the same as with one thread.  Pages
+  // whose list would not play back exactly (shadings, tiling
+  // patterns, Type 3 fonts, some soft masks) are drawn the usual way.
+  // Images and font glyphs are scaled and rendered once per band.
+  // Subclasses which override startPage(), endPage() or the drawing
+  // calls should leave this at 1, the default.
+  void setRasterThreads(int n);
+  int getRasterThreads() { return rasterThreads; }
+
+  // Let DCT and JPX images which are drawn smaller than their native
+  // size be decoded at a reduced resolution.  This is faster, but the
+  // decoders don't downsample the way Splash does, so the output
+  // differs slightly.  Off by default.
+  void setReducedImages(GBool reducedImagesA) { reducedImages = reducedImagesA; }
+  GBool getReducedImages() { return reducedImages; }
+
 protected:
   void doUpdateFont(GfxState *state);
 
@@ -388,10 +426,14 @@ private:
 			Guchar *alphaLine);
   static GBool alphaImageSrc(void *data, SplashColorPtr line,
 			     Guchar *alphaLine);
+  static GBool decodedImageSrc(void *data, SplashColorPtr colorLine,
+			       Guchar *alphaLine);
   static GBool maskedImageSrc(void *data, SplashColorPtr line,
 			      Guchar *alphaLine);
   static GBool tilingBitmapSrc(void *data, SplashColorPtr line,
 			     Guchar *alphaLine);
+  SplashOutputDev *makeBandDev();
+  static void drawBand(void *data, int idx);
 
   GBool keepAlphaChannel;	// don't fill with paper color, keep alpha channel
 
@@ -401,6 +443,7 @@ private:
   GBool bitmapUpsideDown;
   GBool fontAntialias;
   GBool vectorAntialias;
+  SplashAAMode vectorAntialiasMode;
   GBool overprintPreview;
   GBool enableFreeTypeHinting;
   GBool enableSlightHinting;
@@ -431,6 +474,14 @@ private:
     transpGroupStack;
   SplashBitmap *maskBitmap; // for image masks in pattern colorspace
   int nestCount;
+
+  GBool reducedImages;		// decode images at reduced resolution?
+  int rasterThreads;		// number of bands to draw pages in
+  SplashOutputDev **bandDevs;	// devices drawing the bands
+  int nBandDevs;
+  SplashOutputDev *bandMaster;	// device whose bitmap this one draws a
+				//   band of, or NULL
+  int bandYMin, bandYMax;	// rows drawn by a band device
 };
 
 #endif
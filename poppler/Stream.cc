@@ -52,6 +52,11 @@
 #endif
 #include <string.h>
 #include <ctype.h>
+#if HAVE_FCNTL_H && HAVE_SYS_MMAN_H && HAVE_SYS_STAT_H
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
 #include "goo/gmem.h"
 #include "goo/gfile.h"
 #include "poppler-config.h"
@@ -138,8 +143,9 @@ int Stream::getChars(int nChars, Guchar *buffer) {
   return 0;
 }
 
-void Stream::getRawChars(int nChars, int *buffer) {
+int Stream::getRawChars(int nChars, Guchar *buffer) {
   error(errInternal, -1, "Internal: called getRawChars() on non-predictor stream");
+  return 0;
 }
 
 char *Stream::getLine(char *buf, int size) {
@@ -338,6 +344,7 @@ Stream *Stream::makeFilter(char *name, Stream *str, Object *params, int recursio
     }
     str = new FlateStream(str, pred, columns, colors, bits);
   } else if (!strcmp(name, "JBIG2Decode")) {
+    JBIG2GlobalsCache *globalsCache = NULL;
     if (params->isDict()) {
       XRef *xref = params->getDict()->getXRef();
       params->dictLookupNF("JBIG2Globals", &globals);
@@ -347,8 +354,15 @@ Stream *Stream::makeFilter(char *name, Stream *str, Object *params, int recursio
         globals.free();
         obj.fetch(xref, &globals);
       }
+      // globals streams that were modified since the document was
+      // loaded aren't cached
+      if (xref && obj.isRef() &&
+	  obj.getRefNum() >= 0 && obj.getRefNum() < xref->getNumObjects() &&
+	  !xref->getEntry(obj.getRefNum())->getFlag(XRefEntry::Updated)) {
+	globalsCache = xref->getJBIG2GlobalsCache();
+      }
     }
-    str = new JBIG2Stream(str, &globals, &obj);
+    str = new JBIG2Stream(str, &globals, &obj, globalsCache);
     globals.free();
     obj.free();
   } else if (!strcmp(name, "JPXDecode")) {
@@ -448,10 +462,56 @@ void FilterStream::setPos(Goffset pos, int dir) {
   error(errInternal, -1, "Internal: called setPos() on FilterStream");
 }
 
+//------------------------------------------------------------------------
+// StreamInput
+//------------------------------------------------------------------------
+
+int StreamInput::fill() {
+  if (!readAhead) {
+    return str->getChar();
+  }
+  pos = 0;
+  len = str->doGetChars(streamInputBufSize, buf);
+  if (len <= 0) {
+    len = 0;
+    return EOF;
+  }
+  return buf[pos++];
+}
+
 //------------------------------------------------------------------------
 // ImageStream
 //------------------------------------------------------------------------
 
+// Unpacking tables for 1- and 2-bit images: entry <c> holds the
+// samples packed into input byte <c>, one per byte, so that each input
+// byte is expanded with a single memcpy.
+#define unpack1(c) \
+  { ((c) >> 7) & 1, ((c) >> 6) & 1, ((c) >> 5) & 1, ((c) >> 4) & 1, \
+    ((c) >> 3) & 1, ((c) >> 2) & 1, ((c) >> 1) & 1, (c) & 1 }
+#define unpack2(c) \
+  { ((c) >> 6) & 3, ((c) >> 4) & 3, ((c) >> 2) & 3, (c) & 3 }
+#define unpack4x(u, c) u(c), u((c) + 1), u((c) + 2), u((c) + 3)
+#define unpack16x(u, c) \
+  unpack4x(u, c), unpack4x(u, (c) + 4), \
+  unpack4x(u, (c) + 8), unpack4x(u, (c) + 12)
+#define unpack256x(u) \
+  unpack16x(u, 0x00), unpack16x(u, 0x10), unpack16x(u, 0x20), \
+  unpack16x(u, 0x30), unpack16x(u, 0x40), unpack16x(u, 0x50), \
+  unpack16x(u, 0x60), unpack16x(u, 0x70), unpack16x(u, 0x80), \
+  unpack16x(u, 0x90), unpack16x(u, 0xa0), unpack16x(u, 0xb0), \
+  unpack16x(u, 0xc0), unpack16x(u, 0xd0), unpack16x(u, 0xe0), \
+  unpack16x(u, 0xf0)
+
+static const Guchar imgUnpack1[256][8] = { unpack256x(unpack1) };
+static const Guchar imgUnpack2[256][4] = { unpack256x(unpack2) };
+
+#undef unpack1
+#undef unpack2
+#undef unpack4x
+#undef unpack16x
+#undef unpack256x
+
 ImageStream::ImageStream(Stream *strA, int widthA, int nCompsA, int nBitsA) {
   int imgLineSize;
 
@@ -469,7 +529,8 @@ ImageStream::ImageStream(Stream *strA, int widthA, int nCompsA, int nBitsA) {
   if (nBits == 8) {
     imgLine = (Guchar *)inputLine;
   } else {
-    if (nBits == 1) {
+    if (nBits < 8) {
+      // the 1-, 2-, and 4-bit unpackers write whole input bytes
       imgLineSize = (nVals + 7) & ~7;
     } else {
       imgLineSize = nVals;
@@ -507,6 +568,10 @@ GBool ImageStream::getPixel(Guchar *pix) {
     }
     imgIdx = 0;
   }
+  if (nComps == 1) {
+    pix[0] = imgLine[imgIdx++];
+    return gTrue;
+  }
   for (i = 0; i < nComps; ++i) {
     pix[i] = imgLine[imgIdx++];
   }
@@ -529,15 +594,19 @@ Guchar *ImageStream::getLine() {
   if (nBits == 1) {
     p = inputLine;
     for (i = 0; i < nVals; i += 8) {
+      memcpy(imgLine + i, imgUnpack1[*p++], 8);
+    }
+  } else if (nBits == 2) {
+    p = inputLine;
+    for (i = 0; i < nVals; i += 4) {
+      memcpy(imgLine + i, imgUnpack2[*p++], 4);
+    }
+  } else if (nBits == 4) {
+    p = inputLine;
+    for (i = 0; i < nVals; i += 2) {
       c = *p++;
-      imgLine[i+0] = (Guchar)((c >> 7) & 1);
-      imgLine[i+1] = (Guchar)((c >> 6) & 1);
-      imgLine[i+2] = (Guchar)((c >> 5) & 1);
-      imgLine[i+3] = (Guchar)((c >> 4) & 1);
-      imgLine[i+4] = (Guchar)((c >> 3) & 1);
-      imgLine[i+5] = (Guchar)((c >> 2) & 1);
-      imgLine[i+6] = (Guchar)((c >> 1) & 1);
-      imgLine[i+7] = (Guchar)(c & 1);
+      imgLine[i] = (Guchar)(c >> 4);
+      imgLine[i+1] = (Guchar)(c & 0x0f);
     }
   } else if (nBits == 8) {
     // special case: imgLine == inputLine
@@ -583,7 +652,7 @@ StreamPredictor::StreamPredictor(Stream *strA, int predictorA,
   width = widthA;
   nComps = nCompsA;
   nBits = nBitsA;
-  predLine = NULL;
+  predLine = upLine = NULL;
   ok = gFalse;
 
   nVals = width * nComps;
@@ -598,6 +667,8 @@ StreamPredictor::StreamPredictor(Stream *strA, int predictorA,
   }
   predLine = (Guchar *)gmalloc(rowBytes);
   memset(predLine, 0, rowBytes);
+  upLine = (Guchar *)gmalloc(rowBytes);
+  memset(upLine, 0, rowBytes);
   predIdx = rowBytes;
 
   ok = gTrue;
@@ -605,6 +676,7 @@ StreamPredictor::StreamPredictor(Stream *strA, int predictorA,
 
 StreamPredictor::~StreamPredictor() {
   gfree(predLine);
+  gfree(upLine);
 }
 
 int StreamPredictor::lookChar() {
@@ -648,12 +720,12 @@ int StreamPredictor::getChars(int nChars, Guchar *buffer) {
 
 GBool StreamPredictor::getNextLine() {
   int curPred;
+  Guchar *cur, *up, *p;
   Guchar upLeftBuf[gfxColorMaxComps * 2 + 1];
-  int left, up, upLeft, p, pa, pb, pc;
-  int c;
+  int left, upLeft, a, b, c, pa, pb, pc;
   Gulong inBuf, outBuf, bitMask;
   int inBits, outBits;
-  int i, j, k, kk;
+  int n, i, j, k, kk;
 
   // get PNG optimum predictor number
   if (predictor >= 10) {
@@ -665,61 +737,70 @@ GBool StreamPredictor::getNextLine() {
     curPred = predictor;
   }
 
-  // read the raw line, apply PNG (byte) predictor
-  int *rawCharLine = new int[rowBytes - pixBytes];
-  str->getRawChars(rowBytes - pixBytes, rawCharLine);
-  memset(upLeftBuf, 0, pixBytes + 1);
-  for (i = pixBytes; i < rowBytes; ++i) {
-    for (j = pixBytes; j > 0; --j) {
-      upLeftBuf[j] = upLeftBuf[j-1];
-    }
-    upLeftBuf[0] = predLine[i];
-    if ((c = rawCharLine[i - pixBytes]) == EOF) {
-      if (i > pixBytes) {
-	// this ought to return false, but some (broken) PDF files
-	// contain truncated image data, and Adobe apparently reads the
-	// last partial line
-	break;
-      }
-      delete[] rawCharLine;
+  // the previous line becomes the reference line for the PNG
+  // predictors, and the raw line is read straight into the other
+  // buffer and un-filtered in place
+  p = upLine;
+  upLine = predLine;
+  predLine = p;
+  cur = predLine + pixBytes;
+  up = upLine + pixBytes;
+  n = rowBytes - pixBytes;
+  if ((i = str->getRawChars(n, cur)) < n) {
+    if (i == 0) {
+      p = upLine;
+      upLine = predLine;
+      predLine = p;
       return gFalse;
     }
-    switch (curPred) {
-    case 11:			// PNG sub
-      predLine[i] = predLine[i - pixBytes] + (Guchar)c;
-      break;
-    case 12:			// PNG up
-      predLine[i] = predLine[i] + (Guchar)c;
-      break;
-    case 13:			// PNG average
-      predLine[i] = ((predLine[i - pixBytes] + predLine[i]) >> 1) +
-	            (Guchar)c;
-      break;
-    case 14:			// PNG Paeth
-      left = predLine[i - pixBytes];
-      up = predLine[i];
-      upLeft = upLeftBuf[pixBytes];
-      p = left + up - upLeft;
-      if ((pa = p - left) < 0)
-	pa = -pa;
-      if ((pb = p - up) < 0)
-	pb = -pb;
-      if ((pc = p - upLeft) < 0)
-	pc = -pc;
-      if (pa <= pb && pa <= pc)
-	predLine[i] = left + (Guchar)c;
-      else if (pb <= pc)
-	predLine[i] = up + (Guchar)c;
-      else
-	predLine[i] = upLeft + (Guchar)c;
-      break;
-    case 10:			// PNG none
-    default:			// no predictor or TIFF predictor
-      predLine[i] = (Guchar)c;
-      break;
+    // this ought to return false, but some (broken) PDF files contain
+    // truncated image data, and Adobe apparently reads the last
+    // partial line -- the rest of the line is left unchanged
+    memcpy(cur + i, up + i, n - i);
+    n = i;
+  }
+
+  // apply PNG (byte) predictor; cur[-pixBytes .. -1] and
+  // up[-pixBytes .. -1] are always zero
+  switch (curPred) {
+  case 11:			// PNG sub
+    for (i = 0; i < n; ++i) {
+      cur[i] = (Guchar)(cur[i] + cur[i - pixBytes]);
+    }
+    break;
+  case 12:			// PNG up
+    for (i = 0; i < n; ++i) {
+      cur[i] = (Guchar)(cur[i] + up[i]);
+    }
+    break;
+  case 13:			// PNG average
+    for (i = 0; i < n; ++i) {
+      cur[i] = (Guchar)(cur[i] + ((cur[i - pixBytes] + up[i]) >> 1));
+    }
+    break;
+  case 14:			// PNG Paeth
+    for (i = 0; i < n; ++i) {
+      left = cur[i - pixBytes];
+      upLeft = up[i - pixBytes];
+      a = up[i] - upLeft;	// = p - left
+      b = left - upLeft;	// = p - up
+      c = a + b;		// = p - upLeft
+      pa = a < 0 ? -a : a;
+      pb = b < 0 ? -b : b;
+      pc = c < 0 ? -c : c;
+      if (pa <= pb && pa <= pc) {
+	cur[i] = (Guchar)(cur[i] + left);
+      } else if (pb <= pc) {
+	cur[i] = (Guchar)(cur[i] + up[i]);
+      } else {
+	cur[i] = (Guchar)(cur[i] + upLeft);
+      }
     }
+    break;
+  case 10:			// PNG none
+  default:			// no predictor or TIFF predictor
+    break;
   }
-  delete[] rawCharLine;
 
   // apply TIFF (component) predictor
   if (predictor == 2) {
@@ -840,6 +921,52 @@ GBool FileStream::fillBuf() {
   return gTrue;
 }
 
+int FileStream::getChars(int nChars, Guchar *buffer) {
+  Goffset avail;
+  int n, m;
+
+  n = 0;
+  while (n < nChars) {
+    if (bufPtr >= bufEnd) {
+      // large requests are read straight into the caller's buffer
+      // instead of <fileStreamBufSize> bytes at a time
+      if (nChars - n >= fileStreamBufSize) {
+	bufPos += bufEnd - buf;
+	bufPtr = bufEnd = buf;
+	m = nChars - n;
+	if (limited) {
+	  avail = start + length - bufPos;
+	  if (avail <= 0) {
+	    break;
+	  }
+	  if (m > avail) {
+	    m = (int)avail;
+	  }
+	}
+	m = file->read((char *)buffer + n, m, offset);
+	if (m <= 0) {
+	  break;
+	}
+	offset += m;
+	bufPos += m;
+	n += m;
+	continue;
+      }
+      if (!fillBuf()) {
+	break;
+      }
+    }
+    m = (int)(bufEnd - bufPtr);
+    if (m > nChars - n) {
+      m = nChars - n;
+    }
+    memcpy(buffer + n, bufPtr, m);
+    bufPtr += m;
+    n += m;
+  }
+  return n;
+}
+
 void FileStream::setPos(Goffset pos, int dir) {
   Goffset size;
 
@@ -937,6 +1064,26 @@ GBool CachedFileStream::fillBuf()
   return gTrue;
 }
 
+int CachedFileStream::getChars(int nChars, Guchar *buffer)
+{
+  int n, m;
+
+  n = 0;
+  while (n < nChars) {
+    if (bufPtr >= bufEnd && !fillBuf()) {
+      break;
+    }
+    m = (int)(bufEnd - bufPtr);
+    if (m > nChars - n) {
+      m = nChars - n;
+    }
+    memcpy(buffer + n, bufPtr, m);
+    bufPtr += m;
+    n += m;
+  }
+  return n;
+}
+
 void CachedFileStream::setPos(Goffset pos, int dir)
 {
   Guint size;
@@ -1027,7 +1174,7 @@ int MemStream::getChars(int nChars, Guchar *buffer) {
 }
 
 void MemStream::setPos(Goffset pos, int dir) {
-  Guint i;
+  Goffset i;
 
   if (dir >= 0) {
     i = pos;
@@ -1048,6 +1195,59 @@ void MemStream::moveStart(Goffset delta) {
   bufPtr = buf + start;
 }
 
+//------------------------------------------------------------------------
+// MmapStream
+//------------------------------------------------------------------------
+
+MmapStream *MmapStream::open(GooString *fileNameA) {
+#if HAVE_FCNTL_H && HAVE_SYS_MMAN_H && HAVE_SYS_STAT_H
+  struct stat st;
+  void *mapA;
+  size_t len;
+  int fd;
+  Object obj;
+
+  if ((fd = ::open(fileNameA->getCString(), O_RDONLY)) < 0) {
+    return NULL;
+  }
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+    ::close(fd);
+    return NULL;
+  }
+  len = (size_t)st.st_size;
+  if ((Goffset)len != (Goffset)st.st_size) {
+    // too large for the address space
+    ::close(fd);
+    return NULL;
+  }
+  mapA = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+  if (mapA == MAP_FAILED) {
+    return NULL;
+  }
+  obj.initNull();
+  return new MmapStream((char *)mapA, st.st_size, fileNameA->copy(), &obj);
+#else
+  return NULL;
+#endif
+}
+
+MmapStream::MmapStream(char *mapA, Goffset mapLenA, GooString *fileNameA,
+		       Object *dictA):
+    MemStream(mapA, 0, mapLenA, dictA) {
+  map = mapA;
+  mapLen = mapLenA;
+  fileName = fileNameA;
+}
+
+MmapStream::~MmapStream() {
+#if HAVE_FCNTL_H && HAVE_SYS_MMAN_H && HAVE_SYS_STAT_H
+  munmap(map, (size_t)mapLen);
+#endif
+  delete fileName;
+}
+
 //------------------------------------------------------------------------
 // EmbedStream
 //------------------------------------------------------------------------
@@ -1117,7 +1317,7 @@ void EmbedStream::moveStart(Goffset delta) {
 //------------------------------------------------------------------------
 
 ASCIIHexStream::ASCIIHexStream(Stream *strA):
-    FilterStream(strA) {
+    FilterStream(strA), input(strA) {
   buf = EOF;
   eof = gFalse;
 }
@@ -1128,6 +1328,7 @@ ASCIIHexStream::~ASCIIHexStream() {
 
 void ASCIIHexStream::reset() {
   str->reset();
+  input.reset();
   buf = EOF;
   eof = gFalse;
 }
@@ -1142,7 +1343,7 @@ int ASCIIHexStream::lookChar() {
     return EOF;
   }
   do {
-    c1 = str->getChar();
+    c1 = input.getChar();
   } while (isspace(c1));
   if (c1 == '>') {
     eof = gTrue;
@@ -1150,7 +1351,7 @@ int ASCIIHexStream::lookChar() {
     return buf;
   }
   do {
-    c2 = str->getChar();
+    c2 = input.getChar();
   } while (isspace(c2));
   if (c2 == '>') {
     eof = gTrue;
@@ -1187,6 +1388,20 @@ int ASCIIHexStream::lookChar() {
   return buf;
 }
 
+int ASCIIHexStream::getChars(int nChars, Guchar *buffer) {
+  int n, c;
+
+  n = 0;
+  while (n < nChars) {
+    if ((c = ASCIIHexStream::lookChar()) == EOF) {
+      break;
+    }
+    buffer[n++] = (Guchar)c;
+    buf = EOF;
+  }
+  return n;
+}
+
 GooString *ASCIIHexStream::getPSFilter(int psLevel, const char *indent) {
   GooString *s;
 
@@ -1209,7 +1424,7 @@ GBool ASCIIHexStream::isBinary(GBool last) {
 //------------------------------------------------------------------------
 
 ASCII85Stream::ASCII85Stream(Stream *strA):
-    FilterStream(strA) {
+    FilterStream(strA), input(strA) {
   index = n = 0;
   eof = gFalse;
 }
@@ -1220,52 +1435,75 @@ ASCII85Stream::~ASCII85Stream() {
 
 void ASCII85Stream::reset() {
   str->reset();
+  input.reset();
   index = n = 0;
   eof = gFalse;
 }
 
 int ASCII85Stream::lookChar() {
-  int k;
-  Gulong t;
-
   if (index >= n) {
-    if (eof)
+    if (eof || !readTuple())
       return EOF;
-    index = 0;
+  }
+  return b[index];
+}
+
+int ASCII85Stream::getChars(int nChars, Guchar *buffer) {
+  int i;
+
+  i = 0;
+  while (i < nChars) {
+    if (index >= n) {
+      if (eof || !readTuple())
+	break;
+    }
     do {
-      c[0] = str->getChar();
-    } while (Lexer::isSpace(c[0]));
-    if (c[0] == '~' || c[0] == EOF) {
+      buffer[i++] = (Guchar)b[index++];
+    } while (index < n && i < nChars);
+  }
+  return i;
+}
+
+// Decode the next group of (up to) five characters into b[0..n-1].
+// Returns false at end of data.
+GBool ASCII85Stream::readTuple() {
+  int k;
+  Gulong t;
+
+  index = 0;
+  do {
+    c[0] = input.getChar();
+  } while (Lexer::isSpace(c[0]));
+  if (c[0] == '~' || c[0] == EOF) {
+    eof = gTrue;
+    n = 0;
+    return gFalse;
+  } else if (c[0] == 'z') {
+    b[0] = b[1] = b[2] = b[3] = 0;
+    n = 4;
+  } else {
+    for (k = 1; k < 5; ++k) {
+      do {
+	c[k] = input.getChar();
+      } while (Lexer::isSpace(c[k]));
+      if (c[k] == '~' || c[k] == EOF)
+	break;
+    }
+    n = k - 1;
+    if (k < 5 && (c[k] == '~' || c[k] == EOF)) {
+      for (++k; k < 5; ++k)
+	c[k] = 0x21 + 84;
       eof = gTrue;
-      n = 0;
-      return EOF;
-    } else if (c[0] == 'z') {
-      b[0] = b[1] = b[2] = b[3] = 0;
-      n = 4;
-    } else {
-      for (k = 1; k < 5; ++k) {
-	do {
-	  c[k] = str->getChar();
-	} while (Lexer::isSpace(c[k]));
-	if (c[k] == '~' || c[k] == EOF)
-	  break;
-      }
-      n = k - 1;
-      if (k < 5 && (c[k] == '~' || c[k] == EOF)) {
-	for (++k; k < 5; ++k)
-	  c[k] = 0x21 + 84;
-	eof = gTrue;
-      }
-      t = 0;
-      for (k = 0; k < 5; ++k)
-	t = t * 85 + (c[k] - 0x21);
-      for (k = 3; k >= 0; --k) {
-	b[k] = (int)(t & 0xff);
-	t >>= 8;
-      }
+    }
+    t = 0;
+    for (k = 0; k < 5; ++k)
+      t = t * 85 + (c[k] - 0x21);
+    for (k = 3; k >= 0; --k) {
+      b[k] = (int)(t & 0xff);
+      t >>= 8;
     }
   }
-  return b[index];
+  return gTrue;
 }
 
 GooString *ASCII85Stream::getPSFilter(int psLevel, const char *indent) {
@@ -1344,21 +1582,20 @@ int LZWStream::lookChar() {
   return seqBuf[seqIndex];
 }
 
-void LZWStream::getRawChars(int nChars, int *buffer) {
-  for (int i = 0; i < nChars; ++i)
-    buffer[i] = doGetRawChar();
-}
-
 int LZWStream::getRawChar() {
   return doGetRawChar();
 }
 
 int LZWStream::getChars(int nChars, Guchar *buffer) {
-  int n, m;
-
   if (pred) {
     return pred->getChars(nChars, buffer);
   }
+  return getRawChars(nChars, buffer);
+}
+
+int LZWStream::getRawChars(int nChars, Guchar *buffer) {
+  int n, m;
+
   if (eof) {
     return 0;
   }
@@ -1591,7 +1828,7 @@ GBool RunLengthStream::fillBuf() {
 CCITTFaxStream::CCITTFaxStream(Stream *strA, int encodingA, GBool endOfLineA,
 			       GBool byteAlignA, int columnsA, int rowsA,
 			       GBool endOfBlockA, GBool blackA):
-    FilterStream(strA) {
+    FilterStream(strA), input(strA) {
   encoding = encodingA;
   endOfLine = endOfLineA;
   byteAlign = byteAlignA;
@@ -1637,6 +1874,7 @@ void CCITTFaxStream::ccittReset(GBool unfiltered) {
     str->unfilteredReset();
   else
     str->reset();
+  input.reset();
 
   row = 0;
   nextLine2D = encoding < 0;
@@ -2163,6 +2401,39 @@ int CCITTFaxStream::lookChar() {
   return buf;
 }
 
+int CCITTFaxStream::getChars(int nChars, Guchar *buffer) {
+  int n, k, c;
+
+  n = 0;
+  while (n < nChars) {
+    // runs of whole bytes of one color are filled in directly
+    if (buf == EOF && outputBits >= 8) {
+      k = outputBits >> 3;
+      if (k > nChars - n) {
+	k = nChars - n;
+      }
+      c = (a0i & 1) ? 0x00 : 0xff;
+      if (black) {
+	c ^= 0xff;
+      }
+      memset(buffer + n, c, k);
+      n += k;
+      outputBits -= k << 3;
+      if (outputBits == 0 && codingLine[a0i] < columns) {
+	++a0i;
+	outputBits = codingLine[a0i] - codingLine[a0i - 1];
+      }
+      continue;
+    }
+    if ((c = CCITTFaxStream::lookChar()) == EOF) {
+      break;
+    }
+    buffer[n++] = (Guchar)c;
+    buf = EOF;
+  }
+  return n;
+}
+
 short CCITTFaxStream::getTwoDimCode() {
   int code;
   const CCITTCode *p;
@@ -2335,7 +2606,7 @@ short CCITTFaxStream::lookBits(int n) {
   int c;
 
   while (inputBits < n) {
-    if ((c = str->getChar()) == EOF) {
+    if ((c = input.getChar()) == EOF) {
       if (inputBits == 0) {
 	return EOF;
       }
@@ -2664,6 +2935,39 @@ int DCTStream::lookChar() {
   }
 }
 
+int DCTStream::getChars(int nChars, Guchar *buffer) {
+  int n, m, c;
+
+  n = 0;
+  while (n < nChars) {
+    // single-component rows are copied straight out of the MCU row
+    if (!progressive && interleaved && numComps == 1 &&
+	y < height && dy < mcuHeight) {
+      m = width - x;
+      if (m > nChars - n) {
+	m = nChars - n;
+      }
+      memcpy(buffer + n, rowBuf[0][dy] + x, m);
+      n += m;
+      x += m;
+      if (x == width) {
+	x = 0;
+	++y;
+	++dy;
+	if (y == height) {
+	  readTrailer();
+	}
+      }
+      continue;
+    }
+    if ((c = DCTStream::getChar()) == EOF) {
+      break;
+    }
+    buffer[n++] = (Guchar)c;
+  }
+  return n;
+}
+
 void DCTStream::restart() {
   int i;
 
@@ -3945,564 +4249,6 @@ FlateDecode FlateStream::distDecode[flateMaxDistCodes] = {
   {13, 24577}
 };
 
-static FlateCode flateFixedLitCodeTabCodes[512] = {
-  {7, 0x0100},
-  {8, 0x0050},
-  {8, 0x0010},
-  {8, 0x0118},
-  {7, 0x0110},
-  {8, 0x0070},
-  {8, 0x0030},
-  {9, 0x00c0},
-  {7, 0x0108},
-  {8, 0x0060},
-  {8, 0x0020},
-  {9, 0x00a0},
-  {8, 0x0000},
-  {8, 0x0080},
-  {8, 0x0040},
-  {9, 0x00e0},
-  {7, 0x0104},
-  {8, 0x0058},
-  {8, 0x0018},
-  {9, 0x0090},
-  {7, 0x0114},
-  {8, 0x0078},
-  {8, 0x0038},
-  {9, 0x00d0},
-  {7, 0x010c},
-  {8, 0x0068},
-  {8, 0x0028},
-  {9, 0x00b0},
-  {8, 0x0008},
-  {8, 0x0088},
-  {8, 0x0048},
-  {9, 0x00f0},
-  {7, 0x0102},
-  {8, 0x0054},
-  {8, 0x0014},
-  {8, 0x011c},
-  {7, 0x0112},
-  {8, 0x0074},
-  {8, 0x0034},
-  {9, 0x00c8},
-  {7, 0x010a},
-  {8, 0x0064},
-  {8, 0x0024},
-  {9, 0x00a8},
-  {8, 0x0004},
-  {8, 0x0084},
-  {8, 0x0044},
-  {9, 0x00e8},
-  {7, 0x0106},
-  {8, 0x005c},
-  {8, 0x001c},
-  {9, 0x0098},
-  {7, 0x0116},
-  {8, 0x007c},
-  {8, 0x003c},
-  {9, 0x00d8},
-  {7, 0x010e},
-  {8, 0x006c},
-  {8, 0x002c},
-  {9, 0x00b8},
-  {8, 0x000c},
-  {8, 0x008c},
-  {8, 0x004c},
-  {9, 0x00f8},
-  {7, 0x0101},
-  {8, 0x0052},
-  {8, 0x0012},
-  {8, 0x011a},
-  {7, 0x0111},
-  {8, 0x0072},
-  {8, 0x0032},
-  {9, 0x00c4},
-  {7, 0x0109},
-  {8, 0x0062},
-  {8, 0x0022},
-  {9, 0x00a4},
-  {8, 0x0002},
-  {8, 0x0082},
-  {8, 0x0042},
-  {9, 0x00e4},
-  {7, 0x0105},
-  {8, 0x005a},
-  {8, 0x001a},
-  {9, 0x0094},
-  {7, 0x0115},
-  {8, 0x007a},
-  {8, 0x003a},
-  {9, 0x00d4},
-  {7, 0x010d},
-  {8, 0x006a},
-  {8, 0x002a},
-  {9, 0x00b4},
-  {8, 0x000a},
-  {8, 0x008a},
-  {8, 0x004a},
-  {9, 0x00f4},
-  {7, 0x0103},
-  {8, 0x0056},
-  {8, 0x0016},
-  {8, 0x011e},
-  {7, 0x0113},
-  {8, 0x0076},
-  {8, 0x0036},
-  {9, 0x00cc},
-  {7, 0x010b},
-  {8, 0x0066},
-  {8, 0x0026},
-  {9, 0x00ac},
-  {8, 0x0006},
-  {8, 0x0086},
-  {8, 0x0046},
-  {9, 0x00ec},
-  {7, 0x0107},
-  {8, 0x005e},
-  {8, 0x001e},
-  {9, 0x009c},
-  {7, 0x0117},
-  {8, 0x007e},
-  {8, 0x003e},
-  {9, 0x00dc},
-  {7, 0x010f},
-  {8, 0x006e},
-  {8, 0x002e},
-  {9, 0x00bc},
-  {8, 0x000e},
-  {8, 0x008e},
-  {8, 0x004e},
-  {9, 0x00fc},
-  {7, 0x0100},
-  {8, 0x0051},
-  {8, 0x0011},
-  {8, 0x0119},
-  {7, 0x0110},
-  {8, 0x0071},
-  {8, 0x0031},
-  {9, 0x00c2},
-  {7, 0x0108},
-  {8, 0x0061},
-  {8, 0x0021},
-  {9, 0x00a2},
-  {8, 0x0001},
-  {8, 0x0081},
-  {8, 0x0041},
-  {9, 0x00e2},
-  {7, 0x0104},
-  {8, 0x0059},
-  {8, 0x0019},
-  {9, 0x0092},
-  {7, 0x0114},
-  {8, 0x0079},
-  {8, 0x0039},
-  {9, 0x00d2},
-  {7, 0x010c},
-  {8, 0x0069},
-  {8, 0x0029},
-  {9, 0x00b2},
-  {8, 0x0009},
-  {8, 0x0089},
-  {8, 0x0049},
-  {9, 0x00f2},
-  {7, 0x0102},
-  {8, 0x0055},
-  {8, 0x0015},
-  {8, 0x011d},
-  {7, 0x0112},
-  {8, 0x0075},
-  {8, 0x0035},
-  {9, 0x00ca},
-  {7, 0x010a},
-  {8, 0x0065},
-  {8, 0x0025},
-  {9, 0x00aa},
-  {8, 0x0005},
-  {8, 0x0085},
-  {8, 0x0045},
-  {9, 0x00ea},
-  {7, 0x0106},
-  {8, 0x005d},
-  {8, 0x001d},
-  {9, 0x009a},
-  {7, 0x0116},
-  {8, 0x007d},
-  {8, 0x003d},
-  {9, 0x00da},
-  {7, 0x010e},
-  {8, 0x006d},
-  {8, 0x002d},
-  {9, 0x00ba},
-  {8, 0x000d},
-  {8, 0x008d},
-  {8, 0x004d},
-  {9, 0x00fa},
-  {7, 0x0101},
-  {8, 0x0053},
-  {8, 0x0013},
-  {8, 0x011b},
-  {7, 0x0111},
-  {8, 0x0073},
-  {8, 0x0033},
-  {9, 0x00c6},
-  {7, 0x0109},
-  {8, 0x0063},
-  {8, 0x0023},
-  {9, 0x00a6},
-  {8, 0x0003},
-  {8, 0x0083},
-  {8, 0x0043},
-  {9, 0x00e6},
-  {7, 0x0105},
-  {8, 0x005b},
-  {8, 0x001b},
-  {9, 0x0096},
-  {7, 0x0115},
-  {8, 0x007b},
-  {8, 0x003b},
-  {9, 0x00d6},
-  {7, 0x010d},
-  {8, 0x006b},
-  {8, 0x002b},
-  {9, 0x00b6},
-  {8, 0x000b},
-  {8, 0x008b},
-  {8, 0x004b},
-  {9, 0x00f6},
-  {7, 0x0103},
-  {8, 0x0057},
-  {8, 0x0017},
-  {8, 0x011f},
-  {7, 0x0113},
-  {8, 0x0077},
-  {8, 0x0037},
-  {9, 0x00ce},
-  {7, 0x010b},
-  {8, 0x0067},
-  {8, 0x0027},
-  {9, 0x00ae},
-  {8, 0x0007},
-  {8, 0x0087},
-  {8, 0x0047},
-  {9, 0x00ee},
-  {7, 0x0107},
-  {8, 0x005f},
-  {8, 0x001f},
-  {9, 0x009e},
-  {7, 0x0117},
-  {8, 0x007f},
-  {8, 0x003f},
-  {9, 0x00de},
-  {7, 0x010f},
-  {8, 0x006f},
-  {8, 0x002f},
-  {9, 0x00be},
-  {8, 0x000f},
-  {8, 0x008f},
-  {8, 0x004f},
-  {9, 0x00fe},
-  {7, 0x0100},
-  {8, 0x0050},
-  {8, 0x0010},
-  {8, 0x0118},
-  {7, 0x0110},
-  {8, 0x0070},
-  {8, 0x0030},
-  {9, 0x00c1},
-  {7, 0x0108},
-  {8, 0x0060},
-  {8, 0x0020},
-  {9, 0x00a1},
-  {8, 0x0000},
-  {8, 0x0080},
-  {8, 0x0040},
-  {9, 0x00e1},
-  {7, 0x0104},
-  {8, 0x0058},
-  {8, 0x0018},
-  {9, 0x0091},
-  {7, 0x0114},
-  {8, 0x0078},
-  {8, 0x0038},
-  {9, 0x00d1},
-  {7, 0x010c},
-  {8, 0x0068},
-  {8, 0x0028},
-  {9, 0x00b1},
-  {8, 0x0008},
-  {8, 0x0088},
-  {8, 0x0048},
-  {9, 0x00f1},
-  {7, 0x0102},
-  {8, 0x0054},
-  {8, 0x0014},
-  {8, 0x011c},
-  {7, 0x0112},
-  {8, 0x0074},
-  {8, 0x0034},
-  {9, 0x00c9},
-  {7, 0x010a},
-  {8, 0x0064},
-  {8, 0x0024},
-  {9, 0x00a9},
-  {8, 0x0004},
-  {8, 0x0084},
-  {8, 0x0044},
-  {9, 0x00e9},
-  {7, 0x0106},
-  {8, 0x005c},
-  {8, 0x001c},
-  {9, 0x0099},
-  {7, 0x0116},
-  {8, 0x007c},
-  {8, 0x003c},
-  {9, 0x00d9},
-  {7, 0x010e},
-  {8, 0x006c},
-  {8, 0x002c},
-  {9, 0x00b9},
-  {8, 0x000c},
-  {8, 0x008c},
-  {8, 0x004c},
-  {9, 0x00f9},
-  {7, 0x0101},
-  {8, 0x0052},
-  {8, 0x0012},
-  {8, 0x011a},
-  {7, 0x0111},
-  {8, 0x0072},
-  {8, 0x0032},
-  {9, 0x00c5},
-  {7, 0x0109},
-  {8, 0x0062},
-  {8, 0x0022},
-  {9, 0x00a5},
-  {8, 0x0002},
-  {8, 0x0082},
-  {8, 0x0042},
-  {9, 0x00e5},
-  {7, 0x0105},
-  {8, 0x005a},
-  {8, 0x001a},
-  {9, 0x0095},
-  {7, 0x0115},
-  {8, 0x007a},
-  {8, 0x003a},
-  {9, 0x00d5},
-  {7, 0x010d},
-  {8, 0x006a},
-  {8, 0x002a},
-  {9, 0x00b5},
-  {8, 0x000a},
-  {8, 0x008a},
-  {8, 0x004a},
-  {9, 0x00f5},
-  {7, 0x0103},
-  {8, 0x0056},
-  {8, 0x0016},
-  {8, 0x011e},
-  {7, 0x0113},
-  {8, 0x0076},
-  {8, 0x0036},
-  {9, 0x00cd},
-  {7, 0x010b},
-  {8, 0x0066},
-  {8, 0x0026},
-  {9, 0x00ad},
-  {8, 0x0006},
-  {8, 0x0086},
-  {8, 0x0046},
-  {9, 0x00ed},
-  {7, 0x0107},
-  {8, 0x005e},
-  {8, 0x001e},
-  {9, 0x009d},
-  {7, 0x0117},
-  {8, 0x007e},
-  {8, 0x003e},
-  {9, 0x00dd},
-  {7, 0x010f},
-  {8, 0x006e},
-  {8, 0x002e},
-  {9, 0x00bd},
-  {8, 0x000e},
-  {8, 0x008e},
-  {8, 0x004e},
-  {9, 0x00fd},
-  {7, 0x0100},
-  {8, 0x0051},
-  {8, 0x0011},
-  {8, 0x0119},
-  {7, 0x0110},
-  {8, 0x0071},
-  {8, 0x0031},
-  {9, 0x00c3},
-  {7, 0x0108},
-  {8, 0x0061},
-  {8, 0x0021},
-  {9, 0x00a3},
-  {8, 0x0001},
-  {8, 0x0081},
-  {8, 0x0041},
-  {9, 0x00e3},
-  {7, 0x0104},
-  {8, 0x0059},
-  {8, 0x0019},
-  {9, 0x0093},
-  {7, 0x0114},
-  {8, 0x0079},
-  {8, 0x0039},
-  {9, 0x00d3},
-  {7, 0x010c},
-  {8, 0x0069},
-  {8, 0x0029},
-  {9, 0x00b3},
-  {8, 0x0009},
-  {8, 0x0089},
-  {8, 0x0049},
-  {9, 0x00f3},
-  {7, 0x0102},
-  {8, 0x0055},
-  {8, 0x0015},
-  {8, 0x011d},
-  {7, 0x0112},
-  {8, 0x0075},
-  {8, 0x0035},
-  {9, 0x00cb},
-  {7, 0x010a},
-  {8, 0x0065},
-  {8, 0x0025},
-  {9, 0x00ab},
-  {8, 0x0005},
-  {8, 0x0085},
-  {8, 0x0045},
-  {9, 0x00eb},
-  {7, 0x0106},
-  {8, 0x005d},
-  {8, 0x001d},
-  {9, 0x009b},
-  {7, 0x0116},
-  {8, 0x007d},
-  {8, 0x003d},
-  {9, 0x00db},
-  {7, 0x010e},
-  {8, 0x006d},
-  {8, 0x002d},
-  {9, 0x00bb},
-  {8, 0x000d},
-  {8, 0x008d},
-  {8, 0x004d},
-  {9, 0x00fb},
-  {7, 0x0101},
-  {8, 0x0053},
-  {8, 0x0013},
-  {8, 0x011b},
-  {7, 0x0111},
-  {8, 0x0073},
-  {8, 0x0033},
-  {9, 0x00c7},
-  {7, 0x0109},
-  {8, 0x0063},
-  {8, 0x0023},
-  {9, 0x00a7},
-  {8, 0x0003},
-  {8, 0x0083},
-  {8, 0x0043},
-  {9, 0x00e7},
-  {7, 0x0105},
-  {8, 0x005b},
-  {8, 0x001b},
-  {9, 0x0097},
-  {7, 0x0115},
-  {8, 0x007b},
-  {8, 0x003b},
-  {9, 0x00d7},
-  {7, 0x010d},
-  {8, 0x006b},
-  {8, 0x002b},
-  {9, 0x00b7},
-  {8, 0x000b},
-  {8, 0x008b},
-  {8, 0x004b},
-  {9, 0x00f7},
-  {7, 0x0103},
-  {8, 0x0057},
-  {8, 0x0017},
-  {8, 0x011f},
-  {7, 0x0113},
-  {8, 0x0077},
-  {8, 0x0037},
-  {9, 0x00cf},
-  {7, 0x010b},
-  {8, 0x0067},
-  {8, 0x0027},
-  {9, 0x00af},
-  {8, 0x0007},
-  {8, 0x0087},
-  {8, 0x0047},
-  {9, 0x00ef},
-  {7, 0x0107},
-  {8, 0x005f},
-  {8, 0x001f},
-  {9, 0x009f},
-  {7, 0x0117},
-  {8, 0x007f},
-  {8, 0x003f},
-  {9, 0x00df},
-  {7, 0x010f},
-  {8, 0x006f},
-  {8, 0x002f},
-  {9, 0x00bf},
-  {8, 0x000f},
-  {8, 0x008f},
-  {8, 0x004f},
-  {9, 0x00ff}
-};
-
-FlateHuffmanTab FlateStream::fixedLitCodeTab = {
-  flateFixedLitCodeTabCodes, 9
-};
-
-static FlateCode flateFixedDistCodeTabCodes[32] = {
-  {5, 0x0000},
-  {5, 0x0010},
-  {5, 0x0008},
-  {5, 0x0018},
-  {5, 0x0004},
-  {5, 0x0014},
-  {5, 0x000c},
-  {5, 0x001c},
-  {5, 0x0002},
-  {5, 0x0012},
-  {5, 0x000a},
-  {5, 0x001a},
-  {5, 0x0006},
-  {5, 0x0016},
-  {5, 0x000e},
-  {0, 0x0000},
-  {5, 0x0001},
-  {5, 0x0011},
-  {5, 0x0009},
-  {5, 0x0019},
-  {5, 0x0005},
-  {5, 0x0015},
-  {5, 0x000d},
-  {5, 0x001d},
-  {5, 0x0003},
-  {5, 0x0013},
-  {5, 0x000b},
-  {5, 0x001b},
-  {5, 0x0007},
-  {5, 0x0017},
-  {5, 0x000f},
-  {0, 0x0000}
-};
-
-FlateHuffmanTab FlateStream::fixedDistCodeTab = {
-  flateFixedDistCodeTabCodes, 5
-};
-
 FlateStream::FlateStream(Stream *strA, int predictor, int columns,
 			 int colors, int bits):
     FilterStream(strA) {
@@ -4515,18 +4261,11 @@ FlateStream::FlateStream(Stream *strA, int predictor, int columns,
   } else {
     pred = NULL;
   }
-  litCodeTab.codes = NULL;
-  distCodeTab.codes = NULL;
+  fixedCodes = gFalse;
   memset(buf, 0, flateWindow);
 }
 
 FlateStream::~FlateStream() {
-  if (litCodeTab.codes != fixedLitCodeTab.codes) {
-    gfree(litCodeTab.codes);
-  }
-  if (distCodeTab.codes != fixedDistCodeTab.codes) {
-    gfree(distCodeTab.codes);
-  }
   if (pred) {
     delete pred;
   }
@@ -4541,6 +4280,9 @@ void FlateStream::flateReset(GBool unfiltered) {
 
   index = 0;
   remain = 0;
+  inPos = 0;
+  inLen = 0;
+  readAhead = str->allowsReadAhead();
   codeBuf = 0;
   codeSize = 0;
   compressedBlock = gFalse;
@@ -4590,14 +4332,32 @@ int FlateStream::getChar() {
 int FlateStream::getChars(int nChars, Guchar *buffer) {
   if (pred) {
     return pred->getChars(nChars, buffer);
-  } else {
-    for (int i = 0; i < nChars; ++i) {
-      const int c = doGetRawChar();
-      if (likely(c != EOF)) buffer[i] = c;
-      else return i;
+  }
+  return getRawChars(nChars, buffer);
+}
+
+int FlateStream::getRawChars(int nChars, Guchar *buffer) {
+  int n, k;
+
+  for (n = 0; n < nChars; n += k) {
+    while (remain == 0) {
+      if (endOfBlock && eof) {
+	return n;
+      }
+      readSome();
+    }
+    k = nChars - n;
+    if (k > remain) {
+      k = remain;
     }
-    return nChars;
+    if (k > flateWindow - index) {
+      k = flateWindow - index;
+    }
+    memcpy(buffer + n, buf + index, k);
+    index = (index + k) & flateMask;
+    remain -= k;
   }
+  return nChars;
 }
 
 int FlateStream::lookChar() {
@@ -4615,11 +4375,6 @@ int FlateStream::lookChar() {
   return c;
 }
 
-void FlateStream::getRawChars(int nChars, int *buffer) {
-  for (int i = 0; i < nChars; ++i)
-    buffer[i] = doGetRawChar();
-}
-
 int FlateStream::getRawChar() {
   return doGetRawChar();
 }
@@ -4641,27 +4396,51 @@ GBool FlateStream::isBinary(GBool last) {
   return str->isBinary(gTrue);
 }
 
+// Decode as much as fits in the window.  This is only called with an
+// empty window (remain == 0), so everything from the write position on
+// is history that may be overwritten.
 void FlateStream::readSome() {
+  FlateCode *code;
   int code1, code2;
   int len, dist;
-  int i, j, k;
-  int c;
+  int i, j, k, n;
 
   if (endOfBlock) {
     if (!startBlock())
       return;
   }
 
+  i = (index + remain) & flateMask;
   if (compressedBlock) {
-    if ((code1 = getHuffmanCodeWord(&litCodeTab)) == EOF)
-      goto err;
-    if (code1 < 256) {
-      buf[index] = code1;
-      remain = 1;
-    } else if (code1 == 256) {
-      endOfBlock = gTrue;
-      remain = 0;
-    } else {
+    // leave room for one more match or pair of literals
+    while (remain <= flateWindow - flateMaxMatch) {
+      needBits(flateMaxHuffman);
+      code = &litCodeTab.codes[codeBuf & flateLookupMask];
+      if (code->len && code->len <= codeSize) {
+	codeBuf >>= code->len;
+	codeSize -= code->len;
+	if (code->nSyms == 2) {
+	  buf[i] = (Guchar)code->val;
+	  i = (i + 1) & flateMask;
+	  buf[i] = (Guchar)(code->val >> 8);
+	  i = (i + 1) & flateMask;
+	  remain += 2;
+	  continue;
+	}
+	code1 = code->val;
+      } else if ((code1 = getLongHuffmanCodeWord(&litCodeTab)) == EOF) {
+	goto err;
+      }
+      if (code1 < 256) {
+	buf[i] = code1;
+	i = (i + 1) & flateMask;
+	++remain;
+	continue;
+      }
+      if (code1 == 256) {
+	endOfBlock = gTrue;
+	break;
+      }
       code1 -= 257;
       code2 = lengthDecode[code1].bits;
       if (code2 > 0 && (code2 = getCodeWord(code2)) == EOF)
@@ -4673,29 +4452,38 @@ void FlateStream::readSome() {
       if (code2 > 0 && (code2 = getCodeWord(code2)) == EOF)
 	goto err;
       dist = distDecode[code1].first + code2;
-      i = index;
-      j = (index - dist) & flateMask;
-      for (k = 0; k < len; ++k) {
-	buf[i] = buf[j];
-	i = (i + 1) & flateMask;
-	j = (j + 1) & flateMask;
+      j = (i - dist) & flateMask;
+      if (i + len <= flateWindow && j + len <= flateWindow &&
+	  (j + len <= i || i + len <= j)) {
+	memcpy(buf + i, buf + j, len);
+	i = (i + len) & flateMask;
+      } else {
+	for (k = 0; k < len; ++k) {
+	  buf[i] = buf[j];
+	  i = (i + 1) & flateMask;
+	  j = (j + 1) & flateMask;
+	}
       }
-      remain = len;
+      remain += len;
     }
 
   } else {
-    len = (blockLen < flateWindow) ? blockLen : flateWindow;
-    for (i = 0, j = index; i < len; ++i, j = (j + 1) & flateMask) {
-      if ((c = str->getChar()) == EOF) {
-	endOfBlock = eof = gTrue;
-	break;
-      }
-      buf[j] = c & 0xff;
-    }
-    remain = i;
-    blockLen -= len;
-    if (blockLen == 0)
+    len = (blockLen < flateWindow - i) ? blockLen : flateWindow - i;
+    n = 0;
+    // whole bytes left in the bit buffer come first
+    while (n < len && codeSize >= 8) {
+      buf[i + n++] = (Guchar)codeBuf;
+      codeBuf >>= 8;
+      codeSize -= 8;
+    }
+    n += getInput(buf + i + n, len - n);
+    remain = n;
+    blockLen -= n;
+    if (n < len) {
+      endOfBlock = eof = gTrue;
+    } else if (blockLen == 0) {
       endOfBlock = gTrue;
+    }
   }
 
   return;
@@ -4703,24 +4491,12 @@ void FlateStream::readSome() {
 err:
   error(errSyntaxError, getPos(), "Unexpected end of file in flate stream");
   endOfBlock = eof = gTrue;
-  remain = 0;
 }
 
 GBool FlateStream::startBlock() {
   int blockHdr;
-  int c;
   int check;
 
-  // free the code tables from the previous block
-  if (litCodeTab.codes != fixedLitCodeTab.codes) {
-    gfree(litCodeTab.codes);
-  }
-  litCodeTab.codes = NULL;
-  if (distCodeTab.codes != fixedDistCodeTab.codes) {
-    gfree(distCodeTab.codes);
-  }
-  distCodeTab.codes = NULL;
-
   // read block header
   blockHdr = getCodeWord(3);
   if (blockHdr & 1)
@@ -4730,22 +4506,14 @@ GBool FlateStream::startBlock() {
   // uncompressed block
   if (blockHdr == 0) {
     compressedBlock = gFalse;
-    if ((c = str->getChar()) == EOF)
-      goto err;
-    blockLen = c & 0xff;
-    if ((c = str->getChar()) == EOF)
+    codeBuf >>= codeSize & 7;
+    codeSize &= ~7;
+    if ((blockLen = getCodeWord(16)) == EOF)
       goto err;
-    blockLen |= (c & 0xff) << 8;
-    if ((c = str->getChar()) == EOF)
-      goto err;
-    check = c & 0xff;
-    if ((c = str->getChar()) == EOF)
+    if ((check = getCodeWord(16)) == EOF)
       goto err;
-    check |= (c & 0xff) << 8;
     if (check != (~blockLen & 0xffff))
       error(errSyntaxError, getPos(), "Bad uncompressed block length in flate stream");
-    codeBuf = 0;
-    codeSize = 0;
 
   // compressed block with fixed codes
   } else if (blockHdr == 1) {
@@ -4774,10 +4542,29 @@ err:
 }
 
 void FlateStream::loadFixedCodes() {
-  litCodeTab.codes = fixedLitCodeTab.codes;
-  litCodeTab.maxLen = fixedLitCodeTab.maxLen;
-  distCodeTab.codes = fixedDistCodeTab.codes;
-  distCodeTab.maxLen = fixedDistCodeTab.maxLen;
+  int i;
+
+  if (fixedCodes) {
+    return;
+  }
+  for (i = 0; i < 144; ++i) {
+    codeLengths[i] = 8;
+  }
+  for (i = 144; i < 256; ++i) {
+    codeLengths[i] = 9;
+  }
+  for (i = 256; i < 280; ++i) {
+    codeLengths[i] = 7;
+  }
+  for (i = 280; i < flateMaxLitCodes; ++i) {
+    codeLengths[i] = 8;
+  }
+  compHuffmanCodes(codeLengths, flateMaxLitCodes, &litCodeTab, gTrue);
+  for (i = 0; i < flateMaxDistCodes; ++i) {
+    codeLengths[i] = 5;
+  }
+  compHuffmanCodes(codeLengths, flateMaxDistCodes, &distCodeTab, gFalse);
+  fixedCodes = gTrue;
 }
 
 GBool FlateStream::readDynamicCodes() {
@@ -4789,7 +4576,7 @@ GBool FlateStream::readDynamicCodes() {
   int len, repeat, code;
   int i;
 
-  codeLenCodeTab.codes = NULL;
+  fixedCodes = gFalse;
 
   // read lengths
   if ((numLitCodes = getCodeWord(5)) == EOF) {
@@ -4819,7 +4606,8 @@ GBool FlateStream::readDynamicCodes() {
       goto err;
     }
   }
-  compHuffmanCodes(codeLenCodeLengths, flateMaxCodeLenCodes, &codeLenCodeTab);
+  compHuffmanCodes(codeLenCodeLengths, flateMaxCodeLenCodes, &codeLenCodeTab,
+		   gFalse);
 
   // build the literal and distance code tables
   len = 0;
@@ -4868,63 +4656,85 @@ GBool FlateStream::readDynamicCodes() {
       codeLengths[i++] = len = code;
     }
   }
-  compHuffmanCodes(codeLengths, numLitCodes, &litCodeTab);
-  compHuffmanCodes(codeLengths + numLitCodes, numDistCodes, &distCodeTab);
+  compHuffmanCodes(codeLengths, numLitCodes, &litCodeTab, gTrue);
+  compHuffmanCodes(codeLengths + numLitCodes, numDistCodes, &distCodeTab,
+		   gFalse);
 
-  gfree(codeLenCodeTab.codes);
   return gTrue;
 
 err:
   error(errSyntaxError, getPos(), "Bad dynamic code table in flate stream");
-  gfree(codeLenCodeTab.codes);
   return gFalse;
 }
 
 // Convert an array <lengths> of <n> lengths, in value order, into a
-// Huffman code lookup table.
-void FlateStream::compHuffmanCodes(int *lengths, int n, FlateHuffmanTab *tab) {
-  int tabSize, len, code, code2, skip, val, i, t;
-
-  // find max code length
-  tab->maxLen = 0;
+// Huffman code lookup table.  Codes up to flateLookupBits long are
+// decoded with one lookup; longer ones go through the canonical code
+// in <count> and <syms>.  If <pairs> is set, entries whose bits hold
+// two complete literal codes decode both at once.
+void FlateStream::compHuffmanCodes(int *lengths, int n, FlateHuffmanTab *tab,
+				   GBool pairs) {
+  FlateCode single[1 << flateLookupBits];
+  FlateCode *code, *code2;
+  int offsets[flateMaxHuffman + 2];
+  int len, val, rev, c, i, t;
+
+  // count the codes of each length, and list the symbols in canonical
+  // order
+  for (len = 0; len <= flateMaxHuffman; ++len) {
+    tab->count[len] = 0;
+  }
+  for (val = 0; val < n; ++val) {
+    tab->count[lengths[val]]++;
+  }
+  tab->count[0] = 0;
+  offsets[1] = 0;
+  for (len = 1; len <= flateMaxHuffman; ++len) {
+    offsets[len + 1] = offsets[len] + tab->count[len];
+  }
   for (val = 0; val < n; ++val) {
-    if (lengths[val] > tab->maxLen) {
-      tab->maxLen = lengths[val];
+    if (lengths[val]) {
+      tab->syms[offsets[lengths[val]]++] = (Gushort)val;
     }
   }
 
-  // allocate the table
-  tabSize = 1 << tab->maxLen;
-  tab->codes = (FlateCode *)gmallocn(tabSize, sizeof(FlateCode));
-
-  // clear the table
-  for (i = 0; i < tabSize; ++i) {
-    tab->codes[i].len = 0;
-    tab->codes[i].val = 0;
+  // fill in the lookup table
+  memset(tab->codes, 0, sizeof(tab->codes));
+  c = 0;
+  i = 0;
+  for (len = 1; len <= flateLookupBits; ++len) {
+    for (t = 0; t < tab->count[len]; ++t, ++c, ++i) {
+      if (c >= (1 << len)) {
+	// over-subscribed set of lengths
+	break;
+      }
+      // bit-reverse the code
+      rev = 0;
+      for (val = 0; val < len; ++val) {
+	rev |= ((c >> val) & 1) << (len - 1 - val);
+      }
+      for (; rev < (1 << flateLookupBits); rev += 1 << len) {
+	tab->codes[rev].len = (Guchar)len;
+	tab->codes[rev].nSyms = 1;
+	tab->codes[rev].val = tab->syms[i];
+      }
+    }
+    c <<= 1;
   }
 
-  // build the table
-  for (len = 1, code = 0, skip = 2;
-       len <= tab->maxLen;
-       ++len, code <<= 1, skip <<= 1) {
-    for (val = 0; val < n; ++val) {
-      if (lengths[val] == len) {
-
-	// bit-reverse the code
-	code2 = 0;
-	t = code;
-	for (i = 0; i < len; ++i) {
-	  code2 = (code2 << 1) | (t & 1);
-	  t >>= 1;
-	}
-
-	// fill in the table entries
-	for (i = code2; i < tabSize; i += skip) {
-	  tab->codes[i].len = (Gushort)len;
-	  tab->codes[i].val = (Gushort)val;
-	}
-
-	++code;
+  if (!pairs) {
+    return;
+  }
+  memcpy(single, tab->codes, sizeof(single));
+  for (i = 0; i < (1 << flateLookupBits); ++i) {
+    code = &single[i];
+    if (code->len && code->val < 256) {
+      code2 = &single[i >> code->len];
+      if (code2->len && code2->val < 256 &&
+	  code->len + code2->len <= flateLookupBits) {
+	tab->codes[i].len = code->len + code2->len;
+	tab->codes[i].nSyms = 2;
+	tab->codes[i].val = code->val | (code2->val << 8);
       }
     }
   }
@@ -4932,38 +4742,99 @@ void FlateStream::compHuffmanCodes(int *lengths, int n, FlateHuffmanTab *tab) {
 
 int FlateStream::getHuffmanCodeWord(FlateHuffmanTab *tab) {
   FlateCode *code;
-  int c;
 
-  while (codeSize < tab->maxLen) {
-    if ((c = str->getChar()) == EOF) {
-      break;
-    }
-    codeBuf |= (c & 0xff) << codeSize;
-    codeSize += 8;
-  }
-  code = &tab->codes[codeBuf & ((1 << tab->maxLen) - 1)];
-  if (codeSize == 0 || codeSize < code->len || code->len == 0) {
-    return EOF;
+  needBits(flateMaxHuffman);
+  code = &tab->codes[codeBuf & flateLookupMask];
+  if (code->len == 0 || code->len > codeSize) {
+    return getLongHuffmanCodeWord(tab);
   }
   codeBuf >>= code->len;
   codeSize -= code->len;
   return (int)code->val;
 }
 
+// Decode a code that is not in the lookup table, one bit at a time.
+int FlateStream::getLongHuffmanCodeWord(FlateHuffmanTab *tab) {
+  int code, first, idx, count, len;
+
+  code = first = idx = 0;
+  for (len = 1; len <= flateMaxHuffman && len <= codeSize; ++len) {
+    code |= (codeBuf >> (len - 1)) & 1;
+    count = tab->count[len];
+    if (code - first < count) {
+      codeBuf >>= len;
+      codeSize -= len;
+      return tab->syms[idx + code - first];
+    }
+    idx += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+  return EOF;
+}
+
 int FlateStream::getCodeWord(int bits) {
   int c;
 
-  while (codeSize < bits) {
-    if ((c = str->getChar()) == EOF)
-      return EOF;
-    codeBuf |= (c & 0xff) << codeSize;
-    codeSize += 8;
+  needBits(bits);
+  if (codeSize < bits) {
+    return EOF;
   }
   c = codeBuf & ((1 << bits) - 1);
   codeBuf >>= bits;
   codeSize -= bits;
   return c;
 }
+
+// Top up the bit buffer.  If the input may be read ahead, fill it as
+// far as it goes; otherwise read only the bytes needed for <n> bits.
+void FlateStream::fillBits(int n) {
+  int c;
+
+  if (readAhead) {
+    n = 32 - 7;
+  }
+  while (codeSize < n) {
+    if (inPos == inLen) {
+      if (!readAhead) {
+	if ((c = str->getChar()) == EOF) {
+	  return;
+	}
+	codeBuf |= (Guint)(c & 0xff) << codeSize;
+	codeSize += 8;
+	continue;
+      }
+      inPos = 0;
+      inLen = str->doGetChars(flateInBufSize, inBuf);
+      if (inLen == 0) {
+	return;
+      }
+    }
+    codeBuf |= (Guint)inBuf[inPos++] << codeSize;
+    codeSize += 8;
+  }
+}
+
+// The position of the input that has been decoded: bytes still in the
+// input buffer, or whole bytes in the bit buffer, have only been read
+// ahead.  readSome() decodes up to a window of output at a time, so
+// this can be ahead of the data returned so far.
+Goffset FlateStream::getPos() {
+  return str->getPos() - (inLen - inPos) - (codeSize >> 3);
+}
+
+// Read <n> bytes of input, past the bit buffer.
+int FlateStream::getInput(Guchar *p, int n) {
+  int k;
+
+  k = inLen - inPos;
+  if (k > n) {
+    k = n;
+  }
+  memcpy(p, inBuf + inPos, k);
+  inPos += k;
+  return k + str->doGetChars(n - k, p + k);
+}
 #endif
 
 //------------------------------------------------------------------------
@@ -176,7 +176,11 @@ public:
   // Get next char from stream without using the predictor.
   // This is only used by StreamPredictor.
   virtual int getRawChar();
-  virtual void getRawChars(int nChars, int *buffer);
+
+  // Get up to <nChars> chars from stream without using the predictor.
+  // Returns the number of chars read, which is less than <nChars>
+  // only at end of stream.  This is only used by StreamPredictor.
+  virtual int getRawChars(int nChars, Guchar *buffer);
 
   // Get next char directly from stream source, without filtering it
   virtual int getUnfilteredChar () = 0;
@@ -216,10 +220,24 @@ public:
   // Is this an encoding filter?
   virtual GBool isEncoder() { return gFalse; }
 
+  // May a filter read past the data it needs?  Not if the stream runs
+  // on into data that belongs to someone else, as for in-line images.
+  virtual GBool allowsReadAhead() { return gTrue; }
+
   // Get image parameters which are defined by the stream contents.
   virtual void getImageParams(int * /*bitsPerComponent*/,
 			      StreamColorSpaceMode * /*csMode*/) {}
 
+  // Ask an image stream to decode at a reduced resolution, no smaller
+  // than <minWidth> x <minHeight> pixels.  On entry, <width> and
+  // <height> hold the size given in the image dictionary.  If the
+  // stream can decode at a lower resolution it sets them to the
+  // reduced size and returns true.  This must be called before the
+  // stream is reset, and remains in effect for later resets.
+  virtual GBool reduceResolution(int /*minWidth*/, int /*minHeight*/,
+				 int * /*width*/, int * /*height*/)
+    { return gFalse; }
+
   // Return the next stream in the "stack".
   virtual Stream *getNextStream() { return NULL; }
 
@@ -318,6 +336,11 @@ public:
   virtual GooString *getFileName() { return NULL; }
   virtual Goffset getLength() { return length; }
 
+  // Can sub-streams made by makeSubStream() be read by several threads
+  // at once?  This is true when they only share read-only state, e.g.
+  // memory or a file read with positional reads.
+  virtual GBool hasConcurrentSubStreams() { return gFalse; }
+
   // Get/set position of first byte of stream within the file.
   virtual Goffset getStart() = 0;
   virtual void moveStart(Goffset delta) = 0;
@@ -349,12 +372,48 @@ public:
 
   virtual int getUnfilteredChar () { return str->getUnfilteredChar(); }
   virtual void unfilteredReset () { str->unfilteredReset(); }
+  virtual GBool allowsReadAhead() { return str->allowsReadAhead(); }
 
 protected:
 
   Stream *str;
 };
 
+//------------------------------------------------------------------------
+// StreamInput
+//
+// Input buffer for filters which consume their source a byte at a
+// time.  The source is read in blocks through doGetChars unless it
+// must not be read ahead, in which case bytes are fetched singly.
+//------------------------------------------------------------------------
+
+#define streamInputBufSize 1024
+
+class StreamInput {
+public:
+
+  StreamInput(Stream *strA) { str = strA; pos = len = 0; readAhead = gFalse; }
+
+  // Discard any buffered input.  Call after resetting the source.
+  void reset() { pos = len = 0; readAhead = str->allowsReadAhead(); }
+
+  int getChar()
+    { return pos < len ? buf[pos++] : fill(); }
+
+  // Position in the source of the next byte getChar will return.  The
+  // bytes read ahead into the buffer don't count.
+  Goffset getPos() { return str->getPos() - (len - pos); }
+
+private:
+
+  int fill();
+
+  Stream *str;
+  Guchar buf[streamInputBufSize];
+  int pos, len;
+  GBool readAhead;
+};
+
 //------------------------------------------------------------------------
 // ImageStream
 //------------------------------------------------------------------------
@@ -379,8 +438,10 @@ public:
   // at least nComps elements.  Returns false at end of file.
   GBool getPixel(Guchar *pix);
 
-  // Returns a pointer to the next line of pixels.  Returns NULL at
-  // end of file.
+  // Returns a pointer to the next line of pixels, one component per
+  // byte.  For 8-bit images this is the input buffer itself, with no
+  // unpacking or copying.  The line is only valid until the next call.
+  // Returns NULL at end of file.
   Guchar *getLine();
 
   // Skip an entire line from the image.
@@ -432,6 +493,7 @@ private:
   int pixBytes;			// bytes per pixel
   int rowBytes;			// bytes per line
   Guchar *predLine;		// line buffer
+  Guchar *upLine;		// previous line, for the PNG predictors
   int predIdx;			// current index in predLine
   GBool ok;
 };
@@ -452,6 +514,7 @@ public:
   virtual Stream *makeSubStream(Goffset startA, GBool limitedA,
 				Goffset lengthA, Object *dictA);
   virtual StreamKind getKind() { return strFile; }
+  virtual GBool hasConcurrentSubStreams() { return gTrue; }
   virtual void reset();
   virtual void close();
   virtual int getChar()
@@ -471,27 +534,7 @@ private:
   GBool fillBuf();
   
   virtual GBool hasGetChars() { return true; }
-  virtual int getChars(int nChars, Guchar *buffer)
-    {
-      int n, m;
-
-      n = 0;
-      while (n < nChars) {
-        if (bufPtr >= bufEnd) {
-          if (!fillBuf()) {
-            break;
-          }
-        }
-        m = (int)(bufEnd - bufPtr);
-        if (m > nChars - n) {
-          m = nChars - n;
-        }
-        memcpy(buffer + n, bufPtr, m);
-        bufPtr += m;
-        n += m;
-      }
-      return n;
-    }
+  virtual int getChars(int nChars, Guchar *buffer);
 
 private:
   GooFile* file;
@@ -538,6 +581,8 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
   GBool fillBuf();
 
   CachedFile *cc;
@@ -565,13 +610,14 @@ public:
   virtual Stream *makeSubStream(Goffset start, GBool limited,
 				Goffset lengthA, Object *dictA);
   virtual StreamKind getKind() { return strWeird; }
+  virtual GBool hasConcurrentSubStreams() { return gTrue; }
   virtual void reset();
   virtual void close();
   virtual int getChar()
     { return (bufPtr < bufEnd) ? (*bufPtr++ & 0xff) : EOF; }
   virtual int lookChar()
     { return (bufPtr < bufEnd) ? (*bufPtr & 0xff) : EOF; }
-  virtual Goffset getPos() { return (int)(bufPtr - buf); }
+  virtual Goffset getPos() { return bufPtr - buf; }
   virtual void setPos(Goffset pos, int dir = 0);
   virtual Goffset getStart() { return start; }
   virtual void moveStart(Goffset delta);
@@ -595,6 +641,36 @@ private:
   GBool needFree;
 };
 
+//------------------------------------------------------------------------
+// MmapStream
+//
+// A MemStream over a read-only memory mapping of a local file.  Reads
+// go straight to the mapped pages instead of through a file buffer.
+// Copies and sub-streams are MemStreams sharing the mapping, so, like
+// the sub-streams of a FileStream, they must not outlive it.
+//------------------------------------------------------------------------
+
+class MmapStream: public MemStream {
+public:
+
+  // Map the file <fileNameA>.  Returns NULL if the file can't be
+  // mapped, in which case the caller should fall back to a
+  // FileStream.
+  static MmapStream *open(GooString *fileNameA);
+
+  virtual ~MmapStream();
+  virtual GooString *getFileName() { return fileName; }
+
+private:
+
+  MmapStream(char *mapA, Goffset mapLenA, GooString *fileNameA,
+	     Object *dictA);
+
+  char *map;
+  Goffset mapLen;
+  GooString *fileName;
+};
+
 //------------------------------------------------------------------------
 // EmbedStream
 //
@@ -624,6 +700,7 @@ public:
 
   virtual int getUnfilteredChar () { return str->getUnfilteredChar(); }
   virtual void unfilteredReset () { str->unfilteredReset(); }
+  virtual GBool allowsReadAhead() { return limited; }
 
 
 private:
@@ -649,11 +726,16 @@ public:
   virtual int getChar()
     { int c = lookChar(); buf = EOF; return c; }
   virtual int lookChar();
+  virtual Goffset getPos() { return input.getPos(); }
   virtual GooString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
+  StreamInput input;
   int buf;
   GBool eof;
 };
@@ -672,11 +754,17 @@ public:
   virtual int getChar()
     { int ch = lookChar(); ++index; return ch; }
   virtual int lookChar();
+  virtual Goffset getPos() { return input.getPos(); }
   virtual GooString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+  GBool readTuple();
+
+  StreamInput input;
   int c[5];
   int b[4];
   int index, n;
@@ -698,7 +786,7 @@ public:
   virtual int getChar();
   virtual int lookChar();
   virtual int getRawChar();
-  virtual void getRawChars(int nChars, int *buffer);
+  virtual int getRawChars(int nChars, Guchar *buffer);
   virtual GooString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
 
@@ -792,6 +880,7 @@ public:
   virtual int getChar()
     { int c = lookChar(); buf = EOF; return c; }
   virtual int lookChar();
+  virtual Goffset getPos() { return input.getPos(); }
   virtual GooString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
 
@@ -804,6 +893,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   void ccittReset(GBool unfiltered);
   int encoding;			// 'K' parameter
   GBool endOfLine;		// 'EndOfLine' parameter
@@ -812,6 +904,7 @@ private:
   int rows;			// 'Rows' parameter
   GBool endOfBlock;		// 'EndOfBlock' parameter
   GBool black;			// 'BlackIs1' parameter
+  StreamInput input;		// buffered source data
   GBool eof;			// true if at eof
   GBool nextLine2D;		// true if next line uses 2D encoding
   int row;			// current row
@@ -881,6 +974,9 @@ public:
 
 private:
 
+  virtual GBool hasGetChars() { return true; }
+  virtual int getChars(int nChars, Guchar *buffer);
+
   void dctReset(GBool unfiltered);  
   GBool progressive;		// set if in progressive mode
   GBool interleaved;		// set if in interleaved mode
@@ -953,16 +1049,24 @@ private:
 #define flateMaxCodeLenCodes    19    // max # code length codes
 #define flateMaxLitCodes       288    // max # literal codes
 #define flateMaxDistCodes       30    // max # distance codes
+#define flateMaxMatch          258    // max match length
+#define flateLookupBits         10    // # bits decoded by one table lookup
+#define flateLookupMask      ((1 << flateLookupBits) - 1)
+#define flateInBufSize        4096    // input buffer size
 
-// Huffman code table entry
+// Huffman code lookup table entry, indexed by the next flateLookupBits
+// bits of input
 struct FlateCode {
-  Gushort len;			// code length, in bits
-  Gushort val;			// value represented by this code
+  Guchar len;			// # bits used, or 0 if the code is longer
+				//   than flateLookupBits (or invalid)
+  Guchar nSyms;			// 1, or 2 for a pair of literals
+  Gushort val;			// symbol, or first | (second << 8)
 };
 
 struct FlateHuffmanTab {
-  FlateCode *codes;
-  int maxLen;
+  FlateCode codes[1 << flateLookupBits];
+  Gushort count[flateMaxHuffman + 1];	// # codes of each length
+  Gushort syms[flateMaxLitCodes];	// symbols in canonical order
 };
 
 // Decoding info for length and distance code words
@@ -982,7 +1086,8 @@ public:
   virtual int getChar();
   virtual int lookChar();
   virtual int getRawChar();
-  virtual void getRawChars(int nChars, int *buffer);
+  virtual int getRawChars(int nChars, Guchar *buffer);
+  virtual Goffset getPos();
   virtual GooString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
   virtual void unfilteredReset ();
@@ -1003,6 +1108,14 @@ private:
     return c;
   }
 
+  // Make sure there are at least <n> bits in codeBuf, unless the
+  // input runs out.
+  inline void needBits(int n) {
+    if (codeSize < n) {
+      fillBits(n);
+    }
+  }
+
   virtual GBool hasGetChars() { return true; }
   virtual int getChars(int nChars, Guchar *buffer);
 
@@ -1010,12 +1123,17 @@ private:
   Guchar buf[flateWindow];	// output data buffer
   int index;			// current index into output buffer
   int remain;			// number valid bytes in output buffer
-  int codeBuf;			// input buffer
-  int codeSize;			// number of bits in input buffer
+  Guchar inBuf[flateInBufSize];	// input buffer
+  int inPos;			// current index into input buffer
+  int inLen;			// number of valid bytes in input buffer
+  GBool readAhead;		// set if the input may be read in blocks
+  Guint codeBuf;		// bit buffer
+  int codeSize;			// number of bits in bit buffer
   int				// literal and distance code lengths
     codeLengths[flateMaxLitCodes + flateMaxDistCodes];
   FlateHuffmanTab litCodeTab;	// literal code table
   FlateHuffmanTab distCodeTab;	// distance code table
+  GBool fixedCodes;		// set if the tables hold the fixed codes
   GBool compressedBlock;	// set if reading a compressed block
   int blockLen;			// remaining length of uncompressed block
   GBool endOfBlock;		// set when end of block is reached
@@ -1027,18 +1145,18 @@ private:
     lengthDecode[flateMaxLitCodes-257];
   static FlateDecode		// distance decoding info
     distDecode[flateMaxDistCodes];
-  static FlateHuffmanTab	// fixed literal code table
-    fixedLitCodeTab;
-  static FlateHuffmanTab	// fixed distance code table
-    fixedDistCodeTab;
 
   void readSome();
   GBool startBlock();
   void loadFixedCodes();
   GBool readDynamicCodes();
-  void compHuffmanCodes(int *lengths, int n, FlateHuffmanTab *tab);
+  void compHuffmanCodes(int *lengths, int n, FlateHuffmanTab *tab,
+			GBool pairs);
   int getHuffmanCodeWord(FlateHuffmanTab *tab);
+  int getLongHuffmanCodeWord(FlateHuffmanTab *tab);
   int getCodeWord(int bits);
+  void fillBits(int n);
+  int getInput(Guchar *p, int n);
 };
 #endif
 
@@ -45,6 +45,7 @@
 #include <float.h>
 #include "goo/gfile.h"
 #include "goo/gmem.h"
+#include "goo/GooLRUCache.h"
 #include "Object.h"
 #include "Stream.h"
 #include "Lexer.h"
@@ -52,8 +53,11 @@
 #include "Dict.h"
 #include "Error.h"
 #include "ErrorCodes.h"
+#include "GlobalParams.h"
 #include "XRef.h"
 #include "PopplerCache.h"
+#include "JBIG2Stream.h"
+#include "DecodedImageCache.h"
 
 //------------------------------------------------------------------------
 // Permission bits
@@ -73,9 +77,26 @@
 #if MULTITHREADED
 #  define xrefLocker()   MutexLocker locker(&mutex)
 #  define xrefCondLocker(X)  MutexLocker locker(&mutex, (X))
+#  define xrefCondUnlocker(X)  MutexUnlocker unlocker(&mutex, (X))
 #else
 #  define xrefLocker()
 #  define xrefCondLocker(X)
+#  define xrefCondUnlocker(X)
+#endif
+
+#if MULTITHREADED
+// Releases a mutex held by the caller for the lifetime of the object,
+// if <unlockA> is true.
+class MutexUnlocker {
+public:
+  MutexUnlocker(GooMutex *mutexA, GBool unlockA): mutex(mutexA), unlock(unlockA)
+    { if (unlock) gUnlockMutex(mutex); }
+  ~MutexUnlocker() { if (unlock) gLockMutex(mutex); }
+
+private:
+  GooMutex *mutex;
+  GBool unlock;
+};
 #endif
 
 //------------------------------------------------------------------------
@@ -273,6 +294,113 @@ Object *ObjectStream::getObject(int objIdx, int objNum, Object *obj) {
   return objs[objIdx].copy(obj);
 }
 
+//------------------------------------------------------------------------
+// FetchCache
+//------------------------------------------------------------------------
+
+// LRU cache of objects returned by XRef::fetch, keyed by object number
+// and bounded by an estimate of the memory held by the cached objects.
+// It is only accessed with the XRef mutex held.
+class FetchCache {
+public:
+
+  FetchCache(Goffset maxBytesA): cache(maxBytesA) {}
+
+  // Copy the cached object <num>, generation <gen>, into <obj>.
+  // Returns false if it is not cached.
+  GBool lookup(int num, int gen, Object *obj);
+
+  // Add a copy of <obj>, evicting the least recently used objects
+  // if the memory budget is exceeded.
+  void put(int num, int gen, Object *obj);
+
+  // Drop object <num> (any generation).
+  void remove(int num) { cache.remove(num); }
+
+  // Drop all the objects.
+  void clear() { cache.clear(); }
+
+  void setMaxBytes(Goffset maxBytesA) { cache.setMaxBytes(maxBytesA); }
+
+private:
+
+  struct Entry {
+    int gen;
+    Object obj;
+    ~Entry() { obj.free(); }
+  };
+
+  static Goffset objectSize(Object *obj, int recursion);
+
+  GooLRUCache<int, Entry> cache;	// keyed by object number
+};
+
+// Rough estimate of the memory used by a parsed object and the direct
+// objects it contains.
+Goffset FetchCache::objectSize(Object *obj, int recursion) {
+  Object obj1;
+  Goffset n;
+  int i;
+
+  n = sizeof(Object);
+  if (recursion > 32) {
+    return n;
+  }
+  switch (obj->getType()) {
+  case objString:
+    n += sizeof(GooString) + obj->getString()->getLength();
+    break;
+  case objName:
+    n += strlen(obj->getName()) + 1;
+    break;
+  case objCmd:
+    n += strlen(obj->getCmd()) + 1;
+    break;
+  case objArray:
+    n += sizeof(Array);
+    for (i = 0; i < obj->arrayGetLength(); ++i) {
+      n += objectSize(obj->arrayGetNF(i, &obj1), recursion + 1);
+      obj1.free();
+    }
+    break;
+  case objDict:
+    n += sizeof(Dict);
+    for (i = 0; i < obj->dictGetLength(); ++i) {
+      n += sizeof(DictEntry) + strlen(obj->dictGetKey(i)) + 1;
+      n += objectSize(obj->dictGetValNF(i, &obj1), recursion + 1) - sizeof(Object);
+      obj1.free();
+    }
+    break;
+  default:
+    break;
+  }
+  return n;
+}
+
+GBool FetchCache::lookup(int num, int gen, Object *obj) {
+  Entry *entry;
+
+  if (!(entry = cache.lookup(num)) || entry->gen != gen) {
+    return gFalse;
+  }
+  entry->obj.copy(obj);
+  return gTrue;
+}
+
+void FetchCache::put(int num, int gen, Object *obj) {
+  Entry *entry;
+
+  // streams keep a read position, so they can't be shared
+  if (cache.getMaxBytes() <= 0 || obj->isStream() || obj->isNull() ||
+      obj->isError() || obj->isEOF() || obj->isNone()) {
+    return;
+  }
+  entry = new Entry;
+  entry->gen = gen;
+  obj->copy(&entry->obj);
+  cache.put(num, entry, objectSize(obj, 0) + sizeof(Entry));
+}
+
 //------------------------------------------------------------------------
 // XRef
 //------------------------------------------------------------------------
@@ -289,6 +417,12 @@ void XRef::init() {
   streamEnds = NULL;
   streamEndsLen = 0;
   objStrs = new PopplerCache(5);
+  fetchCacheSize = globalParams ? globalParams->getFetchCacheSize() : 0;
+  fetchCache = fetchCacheSize > 0 ? new FetchCache(fetchCacheSize) : NULL;
+  jbig2GlobalsCache = NULL;
+  decodedImageCache = NULL;
+  decodedImageCacheSize =
+      globalParams ? globalParams->getDecodedImageCacheSize() : 0;
   mainXRefEntriesOffset = 0;
   xRefStream = gFalse;
   scannedSpecialFlags = gFalse;
@@ -329,15 +463,17 @@ XRef::XRef(BaseStream *strA, Goffset pos, Goffset mainXRefEntriesOffsetA, GBool
   else
   {
     // if there was a problem with the 'startxref' position, try to
-    // reconstruct the xref table
-    if (prevXRefOffset == 0) {
+    // reconstruct the xref table -- unless it was rebuilt above, since
+    // scanning the file a second time would not pick up the /Root it
+    // has just found
+    if (!reconstruct && prevXRefOffset == 0) {
       if (!(ok = constructXRef(wasReconstructed))) {
         errCode = errDamaged;
         return;
       }
 
     // read the xref table
-    } else {
+    } else if (prevXRefOffset != 0) {
       std::vector<Goffset> followedXRefStm;
       readXRef(&prevXRefOffset, &followedXRefStm, NULL);
 
@@ -400,6 +536,9 @@ XRef::~XRef() {
   if (objStrs) {
     delete objStrs;
   }
+  delete fetchCache;
+  delete jbig2GlobalsCache;
+  delete decodedImageCache;
   if (strOwner) {
     delete str;
   }
@@ -432,6 +571,8 @@ XRef *XRef::copy() {
   for (int i = 0; i < 32; i++) {
     xref->fileKey[i] = fileKey[i];
   }
+  xref->setFetchCacheSize(fetchCacheSize);
+  xref->setDecodedImageCacheSize(decodedImageCacheSize);
 
   if (xref->reserve(size) == 0) {
     error(errSyntaxError, -1, "unable to allocate {0:d} entries", size);
@@ -890,6 +1031,105 @@ GBool XRef::readXRefStreamSection(Stream *xrefStr, int *w, int first, int n) {
   return gTrue;
 }
 
+//------------------------------------------------------------------------
+// XRefLineReader
+//------------------------------------------------------------------------
+
+#define xrefLineReaderBufSize 65536
+
+// Splits a stream into lines exactly like Stream::getLine, but reads
+// the stream in large blocks and looks for the end of line with
+// memchr instead of one virtual getChar() call per byte.  Used for the
+// whole-file scan in constructXRef.
+class XRefLineReader {
+public:
+
+  XRefLineReader(Stream *strA);
+  ~XRefLineReader();
+
+  // Position of the next line in the stream.
+  Goffset getPos() { return bufPos + (bufPtr - buf); }
+
+  char *getLine(char *line, int size);
+
+private:
+
+  GBool fill(int size);
+
+  Stream *str;
+  char *buf;
+  char *bufPtr;
+  char *bufEnd;
+  Goffset bufPos;		// stream position of buf[0]
+  GBool eof;
+};
+
+XRefLineReader::XRefLineReader(Stream *strA) {
+  str = strA;
+  buf = (char *)gmalloc(xrefLineReaderBufSize);
+  bufPtr = bufEnd = buf;
+  bufPos = str->getPos();
+  eof = gFalse;
+}
+
+XRefLineReader::~XRefLineReader() {
+  gfree(buf);
+}
+
+// Make at least <size> bytes available, unless the stream ends first.
+// Returns false if there is nothing left to read.
+GBool XRefLineReader::fill(int size) {
+  int n;
+
+  if (bufEnd - bufPtr < size && !eof) {
+    n = (int)(bufEnd - bufPtr);
+    memmove(buf, bufPtr, n);
+    bufPos += bufPtr - buf;
+    bufPtr = buf;
+    bufEnd = buf + n;
+    while (!eof && bufEnd - buf < xrefLineReaderBufSize) {
+      n = str->doGetChars((int)(buf + xrefLineReaderBufSize - bufEnd),
+			  (Guchar *)bufEnd);
+      if (n <= 0) {
+	eof = gTrue;
+      }
+      bufEnd += n > 0 ? n : 0;
+    }
+  }
+  return bufPtr < bufEnd;
+}
+
+char *XRefLineReader::getLine(char *line, int size) {
+  char *cr, *lf, *end;
+  int n;
+
+  if (size <= 0 || !fill(size)) {
+    return NULL;
+  }
+  n = (int)(bufEnd - bufPtr);
+  if (n > size - 1) {
+    n = size - 1;
+  }
+  lf = (char *)memchr(bufPtr, '\n', n);
+  cr = (char *)memchr(bufPtr, '\r', lf ? lf - bufPtr : n);
+  end = cr ? cr : lf;
+  if (end) {
+    n = (int)(end - bufPtr);
+  }
+  memcpy(line, bufPtr, n);
+  line[n] = '\0';
+  bufPtr += n;
+  if (end) {
+    ++bufPtr;
+    // fill() made <size> bytes available, so the '\n' of a "\r\n"
+    // pair is already in the buffer
+    if (end == cr && bufPtr < bufEnd && *bufPtr == '\n') {
+      ++bufPtr;
+    }
+  }
+  return line;
+}
+
 // Attempt to construct an xref table for a damaged file.
 GBool XRef::constructXRef(GBool *wasReconstructed, GBool needCatalogDict) {
   Parser *parser;
@@ -905,6 +1145,15 @@ GBool XRef::constructXRef(GBool *wasReconstructed, GBool needCatalogDict) {
   bool oneCycle = true;
   int offset = 0;
 
+  if (fetchCache) {
+    fetchCache->clear();
+  }
+  if (jbig2GlobalsCache) {
+    jbig2GlobalsCache->clear();
+  }
+  if (decodedImageCache) {
+    decodedImageCache->clear();
+  }
   gfree(entries);
   capacity = 0;
   size = 0;
@@ -919,9 +1168,10 @@ GBool XRef::constructXRef(GBool *wasReconstructed, GBool needCatalogDict) {
   }
 
   str->reset();
+  XRefLineReader lineReader(str);
   while (1) {
-    pos = str->getPos();
-    if (!str->getLine(buf, 256)) {
+    pos = lineReader.getPos();
+    if (!lineReader.getLine(buf, 256)) {
       break;
     }
     p = buf;
@@ -1059,6 +1309,17 @@ void XRef::setEncryption(int permFlagsA, GBool ownerPasswordOkA,
   encVersion = encVersionA;
   encRevision = encRevisionA;
   encAlgorithm = encAlgorithmA;
+
+  // objects fetched so far were not decrypted
+  if (fetchCache) {
+    fetchCache->clear();
+  }
+  if (jbig2GlobalsCache) {
+    jbig2GlobalsCache->clear();
+  }
+  if (decodedImageCache) {
+    decodedImageCache->clear();
+  }
 }
 
 void XRef::getEncryptionParameters(Guchar **fileKeyA, CryptAlgorithm *encAlgorithmA,
@@ -1135,6 +1396,8 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
   XRefEntry *e;
   Parser *parser;
   Object obj1, obj2, obj3;
+  Goffset offset;
+  GBool decrypt;
 
   xrefLocker();
   // check for bogus ref - this can happen in corrupted PDF files
@@ -1148,16 +1411,29 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
     return obj;
   }
 
+  if (fetchCache && fetchCache->lookup(num, gen, obj)) {
+    return obj;
+  }
+
   switch (e->type) {
 
   case xrefEntryUncompressed:
+  {
     if (e->gen != gen) {
       goto err;
     }
+    offset = e->offset;
+    decrypt = encrypted && !e->getFlag(XRefEntry::Unencrypted);
+
+    // The object is parsed from its own sub-stream.  If those can be
+    // read concurrently, let other threads use the xref meanwhile;
+    // nested fetches and xref updates take the lock themselves.
+    xrefCondUnlocker(str->hasConcurrentSubStreams());
+
     obj1.initNull();
     parser = new Parser(this,
 	       new Lexer(this,
-		 str->makeSubStream(start + e->offset, gFalse, 0, &obj1)),
+		 str->makeSubStream(start + offset, gFalse, 0, &obj1)),
 	       gTrue);
     parser->getObj(&obj1, recursion);
     parser->getObj(&obj2, recursion);
@@ -1195,13 +1471,20 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
       delete parser;
       goto err;
     }
-    parser->getObj(obj, gFalse, (encrypted && !e->getFlag(XRefEntry::Unencrypted)) ? fileKey : NULL,
+    parser->getObj(obj, gFalse, decrypt ? fileKey : NULL,
 		   encAlgorithm, keyLength, num, gen, recursion);
     obj1.free();
     obj2.free();
     obj3.free();
     delete parser;
-    break;
+  }
+  // another thread may have changed the entry while it was unlocked
+  e = getEntry(num);
+  if (fetchCache && e->obj.isNull() && e->type == xrefEntryUncompressed &&
+      e->offset == offset && e->gen == gen) {
+    fetchCache->put(num, gen, obj);
+  }
+  return obj;
 
   case xrefEntryCompressed:
   {
@@ -1245,13 +1528,56 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
   default:
     goto err;
   }
-  
+
+  if (fetchCache) {
+    fetchCache->put(num, gen, obj);
+  }
   return obj;
 
  err:
   return obj->initNull();
 }
 
+void XRef::setFetchCacheSize(Goffset maxBytes) {
+  xrefLocker();
+  fetchCacheSize = maxBytes;
+  if (maxBytes <= 0) {
+    delete fetchCache;
+    fetchCache = NULL;
+  } else if (fetchCache) {
+    fetchCache->setMaxBytes(maxBytes);
+  } else {
+    fetchCache = new FetchCache(maxBytes);
+  }
+}
+
+JBIG2GlobalsCache *XRef::getJBIG2GlobalsCache() {
+  xrefLocker();
+  if (!jbig2GlobalsCache) {
+    jbig2GlobalsCache = new JBIG2GlobalsCache();
+  }
+  return jbig2GlobalsCache;
+}
+
+DecodedImageCache *XRef::getDecodedImageCache() {
+  xrefLocker();
+  if (!decodedImageCache && decodedImageCacheSize > 0) {
+    decodedImageCache = new DecodedImageCache(this, decodedImageCacheSize);
+  }
+  return decodedImageCache;
+}
+
+void XRef::setDecodedImageCacheSize(Goffset maxBytes) {
+  xrefLocker();
+  decodedImageCacheSize = maxBytes;
+  if (maxBytes <= 0) {
+    delete decodedImageCache;
+    decodedImageCache = NULL;
+  } else if (decodedImageCache) {
+    decodedImageCache->setMaxBytes(maxBytes);
+  }
+}
+
 void XRef::lock() {
 #if MULTITHREADED
   gLockMutex(&mutex);
@@ -1276,6 +1602,7 @@ Object *XRef::getDocInfoNF(Object *obj) {
 GBool XRef::getStreamEnd(Goffset streamStart, Goffset *streamEnd) {
   int a, b, m;
 
+  xrefLocker();
   if (streamEndsLen == 0 ||
       streamStart > streamEnds[streamEndsLen - 1]) {
     return gFalse;
@@ -1298,6 +1625,7 @@ GBool XRef::getStreamEnd(Goffset streamStart, Goffset *streamEnd) {
 
 int XRef::getNumEntry(Goffset offset)
 {
+  xrefLocker();
   if (size > 0)
   {
     int res = 0;
@@ -1333,6 +1661,9 @@ void XRef::add(int num, int gen, Goffset offs, GBool used) {
     }
     size = num + 1;
   }
+  if (fetchCache) {
+    fetchCache->remove(num);
+  }
   XRefEntry *e = getEntry(num);
   e->gen = gen;
   e->obj.initNull ();
@@ -1352,6 +1683,9 @@ void XRef::setModifiedObject (Object* o, Ref r) {
     error(errInternal, -1,"XRef::setModifiedObject on unknown ref: {0:d}, {1:d}\n", r.num, r.gen);
     return;
   }
+  if (fetchCache) {
+    fetchCache->remove(r.num);
+  }
   XRefEntry *e = getEntry(r.num);
   e->obj.free();
   o->copy(&(e->obj));
@@ -1398,6 +1732,9 @@ void XRef::removeIndirectObject(Ref r) {
   if (e->type == xrefEntryFree) {
     return;
   }
+  if (fetchCache) {
+    fetchCache->remove(r.num);
+  }
   e->obj.free();
   e->type = xrefEntryFree;
   e->gen++;
@@ -1676,6 +2013,9 @@ void XRef::markUnencrypted(Object *obj) {
       if (e->getFlag(XRefEntry::Unencrypted))
         return; // We've already been here: prevent infinite recursion
       e->setFlag(XRefEntry::Unencrypted, gTrue);
+      if (fetchCache) {
+        fetchCache->remove(ref.num);
+      }
       fetch(ref.num, ref.gen, &obj1);
       markUnencrypted(&obj1);
       obj1.free();
@@ -1734,6 +2074,9 @@ void XRef::markUnencrypted() {
   if (obj.isRef()) {
     XRefEntry *e = getEntry(obj.getRefNum());
     e->setFlag(XRefEntry::Unencrypted, gTrue);
+    if (fetchCache) {
+      fetchCache->remove(obj.getRefNum());
+    }
   }
   obj.free();
 }
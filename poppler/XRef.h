@@ -47,6 +47,9 @@ class Dict;
 class Stream;
 class Parser;
 class PopplerCache;
+class FetchCache;
+class JBIG2GlobalsCache;
+class DecodedImageCache;
 
 //------------------------------------------------------------------------
 // XRef
@@ -145,6 +148,28 @@ public:
   // Fetch an indirect reference.
   Object *fetch(int num, int gen, Object *obj, int recursion = 0);
 
+  // Set the memory budget, in bytes, of the cache of parsed objects
+  // returned by fetch().  Streams are never cached.  Callers that
+  // modify a fetched Dict or Array in place must report the change
+  // through setModifiedObject().  The budget starts out as
+  // GlobalParams::getFetchCacheSize(); 0 (the default) disables the
+  // cache.
+  void setFetchCacheSize(Goffset maxBytes);
+  Goffset getFetchCacheSize() { return fetchCacheSize; }
+
+  // Return the cache of decoded JBIG2Globals streams, which is shared
+  // by all the JBIG2 images in the document.
+  JBIG2GlobalsCache *getJBIG2GlobalsCache();
+
+  // Return the cache of decoded image XObjects, which output devices
+  // share across pages, or NULL if it is disabled.  Its memory budget
+  // starts out as GlobalParams::getDecodedImageCacheSize (0 by
+  // default), and is set with setDecodedImageCacheSize (zero disables
+  // it).
+  DecodedImageCache *getDecodedImageCache();
+  void setDecodedImageCacheSize(Goffset maxBytes);
+  Goffset getDecodedImageCacheSize() { return decodedImageCacheSize; }
+
   // Return the document's Info dictionary (if any).
   Object *getDocInfo(Object *obj);
   Object *getDocInfoNF(Object *obj);
@@ -206,6 +231,13 @@ private:
 				//   damaged files
   int streamEndsLen;		// number of valid entries in streamEnds
   PopplerCache *objStrs;	// cached object streams
+  FetchCache *fetchCache;	// cached parsed objects (may be NULL)
+  Goffset fetchCacheSize;	// memory budget of <fetchCache>
+  JBIG2GlobalsCache		// decoded JBIG2Globals streams (may be NULL)
+    *jbig2GlobalsCache;
+  DecodedImageCache		// decoded image XObjects (may be NULL)
+    *decodedImageCache;
+  Goffset decodedImageCacheSize;// memory budget of <decodedImageCache>
   GBool encrypted;		// true if file is encrypted
   int encRevision;		
   int encVersion;		// encryption algorithm
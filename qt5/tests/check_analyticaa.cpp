@@ -0,0 +1,248 @@
+#include <QtTest/QtTest>
+
+#include <math.h>
+
+#include "splash/Splash.h"
+#include "splash/SplashBitmap.h"
+#include "splash/SplashPath.h"
+#include "splash/SplashPattern.h"
+
+class TestAnalyticAA : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testRect_data();
+    void testRect();
+    void testWinding_data();
+    void testWinding();
+    void testTriangle();
+    void testSupersample();
+
+private:
+    SplashBitmap *render(SplashAAMode mode, SplashPath *path,
+                         GBool eo);
+};
+
+// Paths are filled in opaque white over a transparent bitmap, so the
+// alpha of each pixel is the shape value, i.e. its coverage.
+
+static const int width = 64;
+static const int height = 48;
+
+static void addRect(SplashPath *path, double x0, double y0,
+                    double x1, double y1)
+{
+    path->moveTo(x0, y0);
+    path->lineTo(x1, y0);
+    path->lineTo(x1, y1);
+    path->lineTo(x0, y1);
+    path->close();
+}
+
+// The length of [<a0>, <a1>] inside [<b>, <b> + 1].
+static double overlap(double a0, double a1, int b)
+{
+    double lo = a0 > b ? a0 : b;
+    double hi = a1 < b + 1 ? a1 : b + 1;
+    return hi > lo ? hi - lo : 0;
+}
+
+// The exact coverage of pixel (<x>, <y>) by a rectangle.
+static double rectCoverage(const double *r, int x, int y)
+{
+    return overlap(r[0], r[2], x) * overlap(r[1], r[3], y);
+}
+
+SplashBitmap *TestAnalyticAA::render(SplashAAMode mode,
+                                     SplashPath *path, GBool eo)
+{
+    SplashColor color;
+
+    SplashBitmap *bitmap = new SplashBitmap(width, height, 1,
+                                            splashModeMono8, gTrue);
+    Splash *splash = new Splash(bitmap, gTrue);
+    splash->setAAMode(mode);
+    color[0] = 0;
+    splash->clear(color, 0);
+    color[0] = 255;
+    splash->setFillPattern(new SplashSolidColor(color));
+    splash->fill(path, eo);
+    delete splash;
+    return bitmap;
+}
+
+static int alphaAt(SplashBitmap *bitmap, int x, int y)
+{
+    return bitmap->getAlphaPtr()[y * width + x];
+}
+
+void TestAnalyticAA::testRect_data()
+{
+    QTest::addColumn<double>("x0");
+    QTest::addColumn<double>("y0");
+    QTest::addColumn<double>("x1");
+    QTest::addColumn<double>("y1");
+
+    QTest::newRow("pixel aligned") << 4.0 << 3.0 << 20.0 << 11.0;
+    QTest::newRow("half pixels") << 10.5 << 5.5 << 30.5 << 20.5;
+    QTest::newRow("quarters") << 10.25 << 5.75 << 40.75 << 30.25;
+    QTest::newRow("inside a pixel") << 7.2 << 9.1 << 7.7 << 9.9;
+    QTest::newRow("inside a row") << 3.3 << 17.25 << 50.6 << 17.5;
+    QTest::newRow("inside a column") << 33.4 << 2.6 << 33.45 << 41.3;
+    QTest::newRow("thin") << 2.9 << 20.1 << 60.1 << 21.05;
+}
+
+// Every pixel of a rectangle with fractional edges has its exact area.
+void TestAnalyticAA::testRect()
+{
+    QFETCH(double, x0);
+    QFETCH(double, y0);
+    QFETCH(double, x1);
+    QFETCH(double, y1);
+    const double r[4] = { x0, y0, x1, y1 };
+    SplashPath path;
+
+    addRect(&path, x0, y0, x1, y1);
+    SplashBitmap *bitmap = render(splashAAAnalytic, &path, gFalse);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double expected = rectCoverage(r, x, y) * 255;
+            QVERIFY2(fabs(alphaAt(bitmap, x, y) - expected) <= 0.5 + 1e-6,
+                     QByteArray("pixel ") + QByteArray::number(x) + "," +
+                     QByteArray::number(y));
+        }
+    }
+    delete bitmap;
+}
+
+void TestAnalyticAA::testWinding_data()
+{
+    QTest::addColumn<bool>("eo");
+    QTest::addColumn<bool>("reversed");
+
+    QTest::newRow("nonzero") << false << false;
+    QTest::newRow("nonzero, reversed") << false << true;
+    QTest::newRow("even-odd") << true << false;
+    QTest::newRow("even-odd, reversed") << true << true;
+}
+
+// A rectangle inside another one is filled or left as a hole,
+// depending on the fill rule and on its direction.
+void TestAnalyticAA::testWinding()
+{
+    QFETCH(bool, eo);
+    QFETCH(bool, reversed);
+    const double outer[4] = { 5.5, 4.25, 50.75, 40.5 };
+    const double inner[4] = { 15.25, 12.5, 30.5, 25.75 };
+    SplashPath path;
+
+    addRect(&path, outer[0], outer[1], outer[2], outer[3]);
+    if (reversed) {
+        addRect(&path, inner[2], inner[1], inner[0], inner[3]);
+    } else {
+        addRect(&path, inner[0], inner[1], inner[2], inner[3]);
+    }
+    bool hole = eo || reversed;
+
+    SplashBitmap *bitmap = render(splashAAAnalytic, &path, eo);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double c = rectCoverage(outer, x, y);
+            if (hole) {
+                c -= rectCoverage(inner, x, y);
+            }
+            QVERIFY2(fabs(alphaAt(bitmap, x, y) - c * 255) <= 0.5 + 1e-6,
+                     QByteArray("pixel ") + QByteArray::number(x) + "," +
+                     QByteArray::number(y));
+        }
+    }
+    delete bitmap;
+}
+
+// Slanted edges: with its corners on pixel rows, the area of a triangle
+// in each row is its width half way down the row.
+void TestAnalyticAA::testTriangle()
+{
+    const double ax = 3.3, ay = 2, bx = 60.6, by = 30, cx = 17.8, cy = 45;
+    SplashPath path;
+
+    path.moveTo(ax, ay);
+    path.lineTo(bx, by);
+    path.lineTo(cx, cy);
+    path.close();
+    SplashBitmap *bitmap = render(splashAAAnalytic, &path, gFalse);
+
+    for (int y = 0; y < height; ++y) {
+        double ym = y + 0.5, expected = 0;
+        if (ym > ay && ym < cy) {
+            // x of the edges a-c and a-b or b-c at ym
+            double xac = ax + (cx - ax) * (ym - ay) / (cy - ay);
+            double xb = ym < by ? ax + (bx - ax) * (ym - ay) / (by - ay)
+                                : bx + (cx - bx) * (ym - by) / (cy - by);
+            expected = fabs(xb - xac);
+        }
+        int sum = 0, partial = 0;
+        for (int x = 0; x < width; ++x) {
+            int a = alphaAt(bitmap, x, y);
+            sum += a;
+            if (a != 0 && a != 255) {
+                ++partial;
+            }
+        }
+        // each pixel is rounded to 1/255
+        QVERIFY2(fabs(sum / 255.0 - expected) <= (partial * 0.5 + 1e-3) / 255,
+                 QByteArray("row ") + QByteArray::number(y));
+    }
+    delete bitmap;
+}
+
+// The analytic coverage is close to the 4x4 supersampled coverage.
+// Supersampling also counts the samples on the right and bottom edges
+// of a span, which makes shapes a quarter pixel wider and taller, so
+// it may only exceed the analytic coverage, and by no more than a
+// quarter of the edge length in total.
+void TestAnalyticAA::testSupersample()
+{
+    static const double star[] = { 31, 1.5, 45.2, 46, 4.4, 16.3,
+                                   59.7, 15.8, 17.1, 45.6 };
+    double edges = 0;
+
+    for (int i = 0; i < 5; ++i) {
+        int j = (i + 1) % 5;
+        edges += fabs(star[2 * j] - star[2 * i]) +
+                 fabs(star[2 * j + 1] - star[2 * i + 1]);
+    }
+    for (int eo = 0; eo < 2; ++eo) {
+        SplashPath path;
+        path.moveTo(star[0], star[1]);
+        for (int i = 1; i < 5; ++i) {
+            path.lineTo(star[2 * i], star[2 * i + 1]);
+        }
+        path.close();
+        SplashBitmap *analytic = render(splashAAAnalytic, &path, eo);
+        SplashBitmap *supersampled = render(splashAASupersample, &path, eo);
+
+        double analyticSum = 0, supersampledSum = 0;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                double a = alphaAt(analytic, x, y) / 255.0;
+                // undo the supersampling gamma
+                double s = pow(alphaAt(supersampled, x, y) / 255.0, 1 / 1.5);
+                QVERIFY2(s - a >= -2 / 16.0 && s - a <= 6 / 16.0,
+                         QByteArray("pixel ") + QByteArray::number(x) + "," +
+                         QByteArray::number(y));
+                analyticSum += a;
+                supersampledSum += s;
+            }
+        }
+        QVERIFY(analyticSum > 100);
+        QVERIFY(supersampledSum >= analyticSum);
+        QVERIFY(supersampledSum <= analyticSum + edges / 4);
+
+        delete analytic;
+        delete supersampled;
+    }
+}
+
+QTEST_MAIN(TestAnalyticAA)
+#include "check_analyticaa.moc"
@@ -0,0 +1,146 @@
+#include <QtTest/QtTest>
+
+#include <string.h>
+
+#include "GlobalParams.h"
+#include "PDFDoc.h"
+#include "Page.h"
+#include "SplashOutputDev.h"
+#include "splash/SplashBitmap.h"
+#include "testpdf.h"
+
+class TestBands : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void testBands_data();
+    void testBands();
+
+private:
+    PDFDoc *openPdf(QByteArray *data);
+    SplashBitmap *render(PDFDoc *doc, int threads, GBool antialias);
+};
+
+// A page with strokes, fills, a clip, a scaled image, text and a
+// transparency group, which SplashOutputDev can rasterize in bands.
+static const char pageContent[] =
+    "q 0.8 0 0 RG 3 w 10 10 m 190 150 l 30 180 l h S Q\n"
+    "q 0 0.5 1 rg 20 20 120 60 re f Q\n"
+    "q 0.2 0.6 0.2 rg 100 100 m 150 190 l 190 90 l h f Q\n"
+    "q 40 40 60 60 re W n 1 0 1 rg 0 0 200 200 re f Q\n"
+    "q 150 0 0 110 30 70 cm /Im1 Do Q\n"
+    "q /GS1 gs /Fm1 Do Q\n"
+    "BT /F1 24 Tf 20 160 Td (Bands) Tj ET\n";
+
+static const char formContent[] =
+    "1 0.5 0 rg 60 30 100 100 re f 0 0 0 RG 2 w 0 0 m 200 200 l S\n";
+
+void TestBands::initTestCase()
+{
+    globalParams = new GlobalParams();
+}
+
+void TestBands::cleanupTestCase()
+{
+    delete globalParams;
+}
+
+PDFDoc *TestBands::openPdf(QByteArray *data)
+{
+    TestPdf pdf;
+    QByteArray image;
+
+    // a 16x16 RGB gradient
+    for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < 16; ++x) {
+            image.append((char)(x * 16));
+            image.append((char)(y * 16));
+            image.append((char)((x + y) * 8));
+        }
+    }
+
+    pdf.addObject("<< /Type /Catalog /Pages 2 0 R >>");
+    pdf.addObject("<< /Type /Pages /Count 1 /Kids [3 0 R] >>");
+    pdf.addObject("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 200 200]"
+                  " /Contents 4 0 R /Resources << /XObject << /Im1 5 0 R /Fm1 6 0 R >>"
+                  " /ExtGState << /GS1 << /ca 0.5 /CA 0.5 >> >>"
+                  " /Font << /F1 << /Type /Font /Subtype /Type1"
+                  " /BaseFont /Helvetica >> >> >> >>");
+    pdf.addStream("", pageContent);
+    pdf.addStream("/Type /XObject /Subtype /Image /Width 16 /Height 16"
+                  " /ColorSpace /DeviceRGB /BitsPerComponent 8", image);
+    pdf.addStream("/Type /XObject /Subtype /Form /BBox [0 0 200 200]"
+                  " /Group << /S /Transparency >>", formContent);
+    *data = pdf.data();
+    return TestPdf::open(data);
+}
+
+SplashBitmap *TestBands::render(PDFDoc *doc, int threads, GBool antialias)
+{
+    SplashColor paper;
+    SplashOutputDev *out;
+    SplashBitmap *bitmap;
+
+    paper[0] = paper[1] = paper[2] = 0xff;
+    out = new SplashOutputDev(splashModeRGB8, 4, gFalse, paper);
+    out->setVectorAntialias(antialias);
+    out->setFontAntialias(antialias);
+    out->setRasterThreads(threads);
+    out->startDoc(doc);
+
+    // 97 dpi makes the bands uneven
+    if (threads > 1) {
+        // the page must really be drawn in bands
+        if (out->checkPageSlice(doc->getPage(1), 97, 97, 0, gFalse, gTrue,
+                                -1, -1, -1, -1, gFalse)) {
+            delete out;
+            return NULL;
+        }
+    } else {
+        doc->displayPage(out, 1, 97, 97, 0, gFalse, gTrue, gFalse);
+    }
+    bitmap = out->takeBitmap();
+    delete out;
+    return bitmap;
+}
+
+void TestBands::testBands_data()
+{
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<bool>("antialias");
+
+    QTest::newRow("2 bands") << 2 << true;
+    QTest::newRow("3 bands") << 3 << true;
+    QTest::newRow("7 bands") << 7 << true;
+    QTest::newRow("3 bands, no antialias") << 3 << false;
+}
+
+// Bands must produce the same bitmap as drawing the page in one go.
+void TestBands::testBands()
+{
+    QFETCH(int, threads);
+    QFETCH(bool, antialias);
+    QByteArray data;
+
+    PDFDoc *doc = openPdf(&data);
+    QVERIFY(doc->isOk());
+
+    SplashBitmap *serial = render(doc, 1, antialias);
+    SplashBitmap *banded = render(doc, threads, antialias);
+    QVERIFY(serial);
+    QVERIFY(banded);
+    QCOMPARE(banded->getWidth(), serial->getWidth());
+    QCOMPARE(banded->getHeight(), serial->getHeight());
+    QCOMPARE(banded->getRowSize(), serial->getRowSize());
+    QVERIFY(!memcmp(banded->getDataPtr(), serial->getDataPtr(),
+                    serial->getRowSize() * serial->getHeight()));
+
+    delete serial;
+    delete banded;
+    delete doc;
+}
+
+QTEST_MAIN(TestBands)
+#include "check_bands.moc"
@@ -0,0 +1,148 @@
+#include <QtTest/QtTest>
+
+#include "Object.h"
+#include "Stream.h"
+#include "Decrypt.h"
+
+class TestDecrypt : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testAESV2();
+    void testAESV3();
+    void testRoundTrip();
+
+private:
+    void checkDecrypt(const QByteArray &cipher, Guchar *fileKey,
+                      CryptAlgorithm algo, int keyLength,
+                      const QByteArray &plain);
+    QByteArray readAll(Stream *str, GBool bulk);
+};
+
+static const char plainText[] =
+    "Streams encrypted with AESV2 or AESV3 start with a 16-byte IV "
+    "and end with PKCS#5 padding.\n";
+
+// plainText encrypted by an independent AES implementation, as object
+// 7 0 R with the file key 00 01 ... 0f, in AES-128 CBC mode.  The first
+// 16 bytes are the IV.
+static const char aesv2Cipher[] =
+    "\xf0\xf1\xf2\xf3\xf4\xf5\xf6\xf7\xf8\xf9\xfa\xfb\xfc\xfd\xfe\xff"
+    "\xb5\xe7\x8d\xef\x1a\x1b\xbe\x10\xe8\x7b\xcf\xae\x28\x52\xce\x3c"
+    "\xd8\xfe\x95\x33\xcc\xfa\x36\x52\xfc\xc8\xcc\x11\xb1\x50\xbd\x7a"
+    "\xbd\x1c\xf8\xcd\x99\xd7\x50\x3e\xb5\x61\x1f\xaf\x8e\x3e\x59\xdf"
+    "\xe8\xb1\x70\x01\xfa\x9a\x8e\xac\x4d\x3e\x56\x8f\xcd\xf5\xe1\x84"
+    "\x57\x37\x7b\x01\x7a\x01\xa9\xf0\x58\xb2\x67\xb6\x04\x80\xd7\x6a"
+    "\xe2\xdf\xf8\x01\x7f\xb0\xd7\xc0\xbb\xc1\x73\xb0\xee\xae\xb2\x49";
+
+// The same, in AES-256 CBC mode with the file key 00 01 ... 1f, which
+// AESV3 uses as it is.
+static const char aesv3Cipher[] =
+    "\xf0\xf1\xf2\xf3\xf4\xf5\xf6\xf7\xf8\xf9\xfa\xfb\xfc\xfd\xfe\xff"
+    "\x00\x41\x82\xbe\x5d\x92\x90\xc7\xfe\xf3\x10\x05\x1c\x4f\xa7\x0b"
+    "\x78\xc4\x71\xb3\xaf\xc2\xf6\x89\x4d\xdd\x37\xb9\x8b\x78\xc2\x82"
+    "\x9d\x9f\x71\x7e\x3b\xe9\x50\x75\x3c\x2c\xe7\xeb\x30\x2d\xfe\x84"
+    "\xf4\x2e\xff\xa6\xdf\x08\x73\x32\x74\x15\x6d\xdd\x7d\x26\x1c\x9a"
+    "\x16\xce\x1d\x85\x4b\x51\x55\xf0\x64\x8f\x91\x40\x3f\x19\x85\xb1"
+    "\x37\x0d\xb7\x84\x42\x47\xaf\x3d\x6b\x45\x16\x94\xc5\x9b\x27\xe6";
+
+static const int objNum = 7;
+static const int objGen = 0;
+
+// Read <str> to the end, a byte at a time or through doGetChars.
+QByteArray TestDecrypt::readAll(Stream *str, GBool bulk)
+{
+    QByteArray data;
+    Guchar buf[7];
+    int c, n;
+
+    if (bulk) {
+        while ((n = str->doGetChars(sizeof(buf), buf)) > 0) {
+            data.append(QByteArray((const char *)buf, n));
+        }
+    } else {
+        while ((c = str->getChar()) != EOF) {
+            data.append((char)c);
+        }
+    }
+    return data;
+}
+
+void TestDecrypt::checkDecrypt(const QByteArray &cipher, Guchar *fileKey,
+                               CryptAlgorithm algo, int keyLength,
+                               const QByteArray &plain)
+{
+    QByteArray data = cipher;
+    Object obj;
+
+    obj.initNull();
+    DecryptStream *str =
+        new DecryptStream(new MemStream(data.data(), 0, data.size(), &obj),
+                          fileKey, algo, keyLength, objNum, objGen);
+    for (int bulk = 0; bulk < 2; ++bulk) {
+        str->reset();
+        QVERIFY(readAll(str, bulk) == plain);
+        QCOMPARE(str->getPos(), (Goffset)plain.size());
+        str->close();
+    }
+    delete str;
+}
+
+void TestDecrypt::testAESV2()
+{
+    Guchar fileKey[16];
+
+    for (int i = 0; i < 16; ++i) {
+        fileKey[i] = i;
+    }
+    checkDecrypt(QByteArray(aesv2Cipher, sizeof(aesv2Cipher) - 1),
+                 fileKey, cryptAES, 16, plainText);
+}
+
+void TestDecrypt::testAESV3()
+{
+    Guchar fileKey[32];
+
+    for (int i = 0; i < 32; ++i) {
+        fileKey[i] = i;
+    }
+    checkDecrypt(QByteArray(aesv3Cipher, sizeof(aesv3Cipher) - 1),
+                 fileKey, cryptAES256, 32, plainText);
+}
+
+// Encrypt and decrypt again, with lengths around the block size.
+void TestDecrypt::testRoundTrip()
+{
+    static const int lengths[] = { 0, 1, 15, 16, 17, 32, 1000 };
+    static const CryptAlgorithm algos[] = { cryptAES, cryptAES256 };
+    static const int keyLengths[] = { 16, 32 };
+    Guchar fileKey[32];
+    Object obj;
+
+    for (int i = 0; i < 32; ++i) {
+        fileKey[i] = 0xa5 ^ (i * 7);
+    }
+    for (int a = 0; a < 2; ++a) {
+        for (unsigned int l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+            QByteArray plain;
+            for (int i = 0; i < lengths[l]; ++i) {
+                plain.append((char)(i * 13));
+            }
+
+            obj.initNull();
+            EncryptStream *enc =
+                new EncryptStream(new MemStream(plain.data(), 0, plain.size(), &obj),
+                                  fileKey, algos[a], keyLengths[a], objNum, objGen);
+            enc->reset();
+            QByteArray cipher = readAll(enc, gFalse);
+            delete enc;
+
+            // IV, then the data padded to a whole number of blocks
+            QCOMPARE(cipher.size(), 16 + (lengths[l] / 16 + 1) * 16);
+            checkDecrypt(cipher, fileKey, algos[a], keyLengths[a], plain);
+        }
+    }
+}
+
+QTEST_MAIN(TestDecrypt)
+#include "check_decrypt.moc"
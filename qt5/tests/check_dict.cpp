@@ -0,0 +1,192 @@
+#include <QtTest/QtTest>
+
+#include "goo/gmem.h"
+#include "goo/GooThreadPool.h"
+#include "Object.h"
+#include "Dict.h"
+
+class TestDict : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testLookup();
+    void testRemove();
+    void testSet();
+    void testConcurrentLookup();
+
+private:
+    void addInt(Dict *dict, int i);
+    void checkKeys(Dict *dict, int n, int step);
+};
+
+// Dicts of 16 entries or more are looked up through a hash index; these
+// tests grow and shrink dicts across that size.
+
+void TestDict::addInt(Dict *dict, int i)
+{
+    QByteArray key = "Key" + QByteArray::number(i);
+    Object obj;
+
+    obj.initInt(i);
+    dict->add(copyString(key.constData()), &obj);
+}
+
+// Check that exactly the keys 0, step, 2 * step, ... below n are found.
+void TestDict::checkKeys(Dict *dict, int n, int step)
+{
+    Object obj;
+
+    for (int i = 0; i < n + 2; ++i) {
+        QByteArray key = "Key" + QByteArray::number(i);
+        if (i < n && i % step == 0) {
+            QVERIFY(dict->hasKey(key.constData()));
+            dict->lookupNF(key.constData(), &obj);
+            QCOMPARE(obj.getType(), objInt);
+            QCOMPARE(obj.getInt(), i);
+        } else {
+            QVERIFY(!dict->hasKey(key.constData()));
+            dict->lookupNF(key.constData(), &obj);
+            QCOMPARE(obj.getType(), objNull);
+        }
+        obj.free();
+    }
+}
+
+void TestDict::testLookup()
+{
+    Dict *dict = new Dict((XRef *)NULL);
+
+    for (int i = 0; i < 40; ++i) {
+        addInt(dict, i);
+        QCOMPARE(dict->getLength(), i + 1);
+        checkKeys(dict, i + 1, 1);
+    }
+    delete dict;
+}
+
+void TestDict::testRemove()
+{
+    Dict *dict = new Dict((XRef *)NULL);
+
+    for (int i = 0; i < 40; ++i) {
+        addInt(dict, i);
+    }
+    checkKeys(dict, 40, 1);
+
+    // drop the odd keys, going from 40 entries down to 20
+    for (int i = 1; i < 40; i += 2) {
+        QByteArray key = "Key" + QByteArray::number(i);
+        dict->remove(key.constData());
+        QVERIFY(!dict->hasKey(key.constData()));
+    }
+    QCOMPARE(dict->getLength(), 20);
+    checkKeys(dict, 40, 2);
+
+    // and the keys that are not multiples of 4, down to 10 entries
+    for (int i = 2; i < 40; i += 4) {
+        QByteArray key = "Key" + QByteArray::number(i);
+        dict->remove(key.constData());
+    }
+    QCOMPARE(dict->getLength(), 10);
+    checkKeys(dict, 40, 4);
+
+    // removing a missing key changes nothing
+    dict->remove("Key1");
+    QCOMPARE(dict->getLength(), 10);
+
+    // grow back over the threshold
+    for (int i = 1; i < 40; i += 2) {
+        addInt(dict, i);
+    }
+    QCOMPARE(dict->getLength(), 30);
+    for (int i = 0; i < 40; ++i) {
+        QByteArray key = "Key" + QByteArray::number(i);
+        QCOMPARE((bool)dict->hasKey(key.constData()), i % 2 == 1 || i % 4 == 0);
+    }
+    delete dict;
+}
+
+void TestDict::testSet()
+{
+    Dict *dict = new Dict((XRef *)NULL);
+    Object obj;
+
+    for (int i = 0; i < 20; ++i) {
+        addInt(dict, i);
+    }
+
+    // replace an existing entry
+    obj.initInt(100);
+    dict->set("Key5", &obj);
+    QCOMPARE(dict->getLength(), 20);
+    dict->lookupNF("Key5", &obj);
+    QCOMPARE(obj.getInt(), 100);
+    obj.free();
+
+    // add a new one
+    obj.initInt(200);
+    dict->set("New", &obj);
+    QCOMPARE(dict->getLength(), 21);
+    dict->lookupNF("New", &obj);
+    QCOMPARE(obj.getInt(), 200);
+    obj.free();
+
+    // setting null removes the entry
+    for (int i = 0; i < 20; ++i) {
+        QByteArray key = "Key" + QByteArray::number(i);
+        obj.initNull();
+        dict->set(key.constData(), &obj);
+        QVERIFY(!dict->hasKey(key.constData()));
+    }
+    QCOMPARE(dict->getLength(), 1);
+    dict->lookupNF("New", &obj);
+    QCOMPARE(obj.getInt(), 200);
+    obj.free();
+    delete dict;
+}
+
+struct ConcurrentLookup {
+    Dict *dict;
+    int n;
+    int nFound[8];
+};
+
+static void lookupAll(void *data, int idx)
+{
+    ConcurrentLookup *c = (ConcurrentLookup *)data;
+    Object obj;
+
+    c->nFound[idx] = 0;
+    for (int i = 0; i < c->n; ++i) {
+        QByteArray key = "Key" + QByteArray::number(i);
+        c->dict->lookupNF(key.constData(), &obj);
+        if (obj.isInt() && obj.getInt() == i) {
+            ++c->nFound[idx];
+        }
+        obj.free();
+    }
+}
+
+// Threads looking up keys in a dict whose index isn't built yet race
+// to build it; all of them must find every key.
+void TestDict::testConcurrentLookup()
+{
+    ConcurrentLookup c;
+
+    c.n = 5000;
+    for (int iter = 0; iter < 50; ++iter) {
+        c.dict = new Dict((XRef *)NULL);
+        for (int i = 0; i < c.n; ++i) {
+            addInt(c.dict, i);
+        }
+        GooThreadPool::get()->run(8, &lookupAll, &c, 8);
+        for (int j = 0; j < 8; ++j) {
+            QCOMPARE(c.nFound[j], c.n);
+        }
+        checkKeys(c.dict, c.n, 1);
+        delete c.dict;
+    }
+}
+
+QTEST_MAIN(TestDict)
+#include "check_dict.moc"
@@ -0,0 +1,190 @@
+#include <QtTest/QtTest>
+
+#include "GlobalParams.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "XRef.h"
+#include "testpdf.h"
+
+class TestFetchCache : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void testHit();
+    void testUncached();
+    void testModified();
+    void testRemoved();
+    void testStream();
+    void testNoGlobalParams();
+
+private:
+    PDFDoc *openPdf(QByteArray *data, Goffset cacheSize);
+};
+
+void TestFetchCache::initTestCase()
+{
+    globalParams = new GlobalParams();
+}
+
+void TestFetchCache::cleanupTestCase()
+{
+    delete globalParams;
+}
+
+// Object 3 is a dictionary, object 4 a stream.
+PDFDoc *TestFetchCache::openPdf(QByteArray *data, Goffset cacheSize)
+{
+    TestPdf pdf;
+
+    pdf.addObject("<< /Type /Catalog /Pages 2 0 R >>");
+    pdf.addObject("<< /Type /Pages /Count 0 /Kids [] >>");
+    pdf.addObject("<< /Name /First /Array [1 2 3] >>");
+    pdf.addStream("", "stream data");
+    *data = pdf.data();
+
+    globalParams->setFetchCacheSize(cacheSize);
+    PDFDoc *doc = TestPdf::open(data);
+    globalParams->setFetchCacheSize(0);
+    return doc;
+}
+
+static bool hasName(Object *obj, const char *name)
+{
+    Object obj1;
+    bool ret;
+
+    ret = obj->isDict() && obj->dictLookup("Name", &obj1)->isName(name);
+    obj1.free();
+    return ret;
+}
+
+// A second fetch returns the cached object, not a new parse.
+void TestFetchCache::testHit()
+{
+    QByteArray data;
+    Object obj1, obj2;
+
+    PDFDoc *doc = openPdf(&data, 1024 * 1024);
+    XRef *xref = doc->getXRef();
+    QCOMPARE(xref->getFetchCacheSize(), (Goffset)(1024 * 1024));
+
+    xref->fetch(3, 0, &obj1);
+    xref->fetch(3, 0, &obj2);
+    QVERIFY(hasName(&obj1, "First"));
+    QVERIFY(obj1.getDict() == obj2.getDict());
+    obj1.free();
+    obj2.free();
+
+    // the generation is part of the key
+    xref->fetch(3, 1, &obj1);
+    QVERIFY(obj1.isNull());
+    obj1.free();
+
+    delete doc;
+}
+
+void TestFetchCache::testUncached()
+{
+    QByteArray data;
+    Object obj1, obj2;
+
+    PDFDoc *doc = openPdf(&data, 0);
+    XRef *xref = doc->getXRef();
+    QCOMPARE(xref->getFetchCacheSize(), (Goffset)0);
+
+    xref->fetch(3, 0, &obj1);
+    xref->fetch(3, 0, &obj2);
+    QVERIFY(hasName(&obj1, "First"));
+    QVERIFY(hasName(&obj2, "First"));
+    QVERIFY(obj1.getDict() != obj2.getDict());
+    obj1.free();
+    obj2.free();
+
+    delete doc;
+}
+
+// setModifiedObject drops the cached copy.
+void TestFetchCache::testModified()
+{
+    QByteArray data;
+    Object obj, obj1;
+    Ref ref = { 3, 0 };
+
+    PDFDoc *doc = openPdf(&data, 1024 * 1024);
+    XRef *xref = doc->getXRef();
+
+    xref->fetch(3, 0, &obj);
+    QVERIFY(hasName(&obj, "First"));
+    obj.free();
+
+    obj.initDict(xref);
+    obj1.initName(copyString("Second"));
+    obj.dictSet("Name", &obj1);
+    xref->setModifiedObject(&obj, ref);
+    obj.free();
+
+    xref->fetch(3, 0, &obj);
+    QVERIFY(hasName(&obj, "Second"));
+    obj.free();
+
+    delete doc;
+}
+
+// removeIndirectObject drops the cached copy.
+void TestFetchCache::testRemoved()
+{
+    QByteArray data;
+    Object obj;
+    Ref ref = { 3, 0 };
+
+    PDFDoc *doc = openPdf(&data, 1024 * 1024);
+    XRef *xref = doc->getXRef();
+
+    xref->fetch(3, 0, &obj);
+    QVERIFY(hasName(&obj, "First"));
+    obj.free();
+
+    xref->removeIndirectObject(ref);
+    xref->fetch(3, 0, &obj);
+    QVERIFY(!obj.isDict());
+    obj.free();
+
+    delete doc;
+}
+
+// Streams keep a read position, so each fetch gets its own.
+void TestFetchCache::testStream()
+{
+    QByteArray data;
+    Object obj1, obj2;
+
+    PDFDoc *doc = openPdf(&data, 1024 * 1024);
+    XRef *xref = doc->getXRef();
+
+    xref->fetch(4, 0, &obj1);
+    xref->fetch(4, 0, &obj2);
+    QVERIFY(obj1.isStream());
+    QVERIFY(obj2.isStream());
+    QVERIFY(obj1.getStream() != obj2.getStream());
+    obj1.free();
+    obj2.free();
+
+    delete doc;
+}
+
+// XRef can be used without GlobalParams; the cache is off then.
+void TestFetchCache::testNoGlobalParams()
+{
+    GlobalParams *savedGlobalParams = globalParams;
+
+    globalParams = NULL;
+    XRef *xref = new XRef();
+    QCOMPARE(xref->getFetchCacheSize(), (Goffset)0);
+    delete xref;
+    globalParams = savedGlobalParams;
+}
+
+QTEST_MAIN(TestFetchCache)
+#include "check_fetchcache.moc"
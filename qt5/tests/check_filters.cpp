@@ -0,0 +1,119 @@
+#include <QtTest/QtTest>
+
+#include <stdlib.h>
+
+#include "Object.h"
+#include "Stream.h"
+
+class TestFilters : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testASCIIHexPos();
+    void testASCII85Pos();
+    void testCCITTFaxPos();
+
+private:
+    Stream *openSource(QByteArray *data);
+};
+
+// The filters below read their source through a 1024-byte buffer; the
+// data is several times larger, and getPos must report how far it has
+// been decoded, not how far it has been read ahead.
+
+Stream *TestFilters::openSource(QByteArray *data)
+{
+    Object obj;
+
+    obj.initNull();
+    return new MemStream(data->data(), 0, data->size(), &obj);
+}
+
+static QByteArray sampleData(int n)
+{
+    QByteArray data;
+
+    // no zero bytes, so ASCII85 doesn't use 'z'
+    for (int i = 0; i < n; ++i) {
+        data.append((char)(1 + (i * 37) % 255));
+    }
+    return data;
+}
+
+// Two hex digits per byte: after <i> bytes, 2 * <i> bytes were used.
+void TestFilters::testASCIIHexPos()
+{
+    QByteArray expected = sampleData(3000);
+    QByteArray hex;
+    char digits[3];
+
+    for (int i = 0; i < expected.size(); ++i) {
+        sprintf(digits, "%02x", (unsigned char)expected[i]);
+        hex.append(digits);
+    }
+    hex.append(">");
+
+    Stream *str = new ASCIIHexStream(openSource(&hex));
+    str->reset();
+    QCOMPARE(str->getPos(), (Goffset)0);
+    for (int i = 0; i < expected.size(); ++i) {
+        QCOMPARE(str->getChar(), (int)(unsigned char)expected[i]);
+        QCOMPARE(str->getPos(), (Goffset)(2 * (i + 1)));
+    }
+    QCOMPARE(str->getChar(), EOF);
+    QCOMPARE(str->getPos(), (Goffset)hex.size());
+    delete str;
+}
+
+// Five characters per four bytes, decoded a group at a time.
+void TestFilters::testASCII85Pos()
+{
+    QByteArray expected = sampleData(2400);
+    QByteArray a85;
+
+    for (int i = 0; i < expected.size(); i += 4) {
+        Gulong t = 0;
+        char group[5];
+        for (int k = 0; k < 4; ++k) {
+            t = (t << 8) | (unsigned char)expected[i + k];
+        }
+        for (int k = 4; k >= 0; --k) {
+            group[k] = (char)('!' + t % 85);
+            t /= 85;
+        }
+        a85.append(QByteArray(group, 5));
+    }
+    a85.append("~>");
+
+    Stream *str = new ASCII85Stream(openSource(&a85));
+    str->reset();
+    for (int i = 0; i < expected.size(); ++i) {
+        QCOMPARE(str->getChar(), (int)(unsigned char)expected[i]);
+        QCOMPARE(str->getPos(), (Goffset)(5 * (i / 4 + 1)));
+    }
+    QCOMPARE(str->getChar(), EOF);
+    delete str;
+}
+
+// Group 4 data for 8-pixel white rows is one bit per row.  The decoder
+// looks ahead a few bytes through its bit buffer, but no further.
+void TestFilters::testCCITTFaxPos()
+{
+    const int rows = 24000;
+    QByteArray g4(rows / 8, (char)0xff);
+
+    Stream *str = new CCITTFaxStream(openSource(&g4), -1, gFalse, gFalse,
+                                     8, rows, gFalse, gFalse);
+    str->reset();
+    for (int row = 0; row < rows; ++row) {
+        QCOMPARE(str->getChar(), 0xff);
+        Goffset pos = str->getPos();
+        QVERIFY(pos >= row / 8);
+        QVERIFY(pos <= row / 8 + 4);
+    }
+    QCOMPARE(str->getChar(), EOF);
+    delete str;
+}
+
+QTEST_MAIN(TestFilters)
+#include "check_filters.moc"
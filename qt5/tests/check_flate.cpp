@@ -0,0 +1,268 @@
+#include <QtTest/QtTest>
+
+#include "goo/gmem.h"
+#include "Object.h"
+#include "Stream.h"
+
+class TestFlate : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testBlockReads();
+    void testCharReads();
+    void testReset();
+    void testTruncated();
+    void testPos();
+
+private:
+    QByteArray compressed();
+    QByteArray decompressed();
+    Stream *openFlate(QByteArray *data);
+    QByteArray readAll(Stream *str, int chunkSize);
+};
+
+// A zlib stream with a fixed Huffman block, a dynamic Huffman block and
+// a stored block, in that order, decompressing to decompressed().  The
+// dynamic block's matches reach back across the 32 KB window.  The
+// stored block and the Adler-32 trailer are appended by compressed().
+static const unsigned char flateData[] = {
+    0x78, 0xda, 0x4a, 0xcb, 0xac, 0x48, 0x4d, 0x51, 0x48, 0xca, 0xc9, 0x4f,
+    0xce, 0x56, 0x30, 0xe0, 0x4a, 0x43, 0xe2, 0x19, 0xa2, 0xf0, 0x8c, 0x50,
+    0x78, 0xc6, 0x28, 0x3c, 0x13, 0x14, 0x9e, 0x29, 0x0a, 0xcf, 0x0c, 0x85,
+    0x67, 0x8e, 0xc2, 0xb3, 0x40, 0xe1, 0x59, 0xa2, 0xda, 0x8e, 0xe6, 0x18,
+    0x54, 0xd7, 0x18, 0xa2, 0x3a, 0xc7, 0x10, 0xd5, 0x3d, 0x86, 0xa8, 0x0e,
+    0x32, 0x44, 0x75, 0x91, 0x21, 0xaa, 0x93, 0x0c, 0x51, 0xdd, 0x64, 0x88,
+    0xea, 0x28, 0x43, 0x4b, 0xae, 0xc4, 0x51, 0x40, 0x34, 0x00, 0x00, 0x00,
+    0x00, 0xff, 0xff, 0xec, 0xcf, 0x5b, 0x8e, 0xa0, 0x20, 0x00, 0x00, 0xc1,
+    0xb3, 0x0a, 0xa2, 0xe2, 0x63, 0x44, 0xd1, 0x11, 0x3d, 0xfd, 0xce, 0x3d,
+    0xb6, 0xfe, 0x3b, 0x9d, 0x54, 0x4d, 0xe7, 0x1e, 0xfa, 0x69, 0xdc, 0xca,
+    0x76, 0xe6, 0x30, 0xbc, 0x5f, 0x9c, 0x72, 0xe8, 0xaf, 0xed, 0x5c, 0xee,
+    0xed, 0xba, 0xa7, 0xf7, 0x3d, 0x73, 0x6e, 0x7d, 0x0c, 0x79, 0xbe, 0x8e,
+    0x39, 0x7d, 0x5d, 0x98, 0xd2, 0xb7, 0xce, 0x25, 0xc6, 0xfd, 0x69, 0x6f,
+    0x18, 0x86, 0x3e, 0xa5, 0x77, 0xbd, 0xc7, 0xb2, 0xc5, 0x5c, 0xca, 0xd8,
+    0x3f, 0x7b, 0x39, 0xeb, 0xfc, 0x3b, 0x2e, 0xfd, 0x72, 0x2f, 0xd3, 0xd1,
+    0x5d, 0xf1, 0x0e, 0x6f, 0x3a, 0xdf, 0xad, 0xb6, 0x56, 0xf3, 0x9d, 0x86,
+    0xa9, 0x3f, 0xd7, 0x21, 0xd5, 0xfb, 0x88, 0xef, 0x94, 0x96, 0xa5, 0x7e,
+    0xb1, 0x74, 0xdb, 0xd3, 0xf2, 0x7c, 0x5f, 0xe9, 0xef, 0x51, 0x97, 0x72,
+    0x8e, 0xd3, 0x76, 0xc4, 0xa7, 0xfd, 0x86, 0x92, 0x63, 0x7f, 0xec, 0x57,
+    0x1e, 0xe2, 0x4f, 0xb8, 0x6a, 0x58, 0xe7, 0xd8, 0xca, 0xfd, 0x86, 0x5c,
+    0x9f, 0xdf, 0xf2, 0x1e, 0xa5, 0xfb, 0xbe, 0x2f, 0xed, 0x43, 0x8e, 0x35,
+    0xb5, 0x98, 0xc3, 0x57, 0xf6, 0x3a, 0xce, 0x6b, 0x5b, 0xe6, 0x6e, 0xf9,
+    0x4b, 0xbf, 0x9a, 0x9e, 0x65, 0xdf, 0x9e, 0x72, 0x75, 0x7d, 0x7f, 0x9c,
+    0xf3, 0x75, 0xe7, 0x29, 0xdc, 0xfb, 0xb7, 0xb6, 0xf8, 0xb5, 0xb9, 0xdc,
+    0x3f, 0xcb, 0x5c, 0x87, 0x36, 0x56, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e, 0x7e,
+    0x7e, 0x7e, 0x7e, 0x7e, 0xfe, 0xff, 0xc6, 0xff, 0x0f, 0x00, 0x00, 0xff,
+    0xff,
+};
+
+static const char storedText[] = "stored block\n";
+#define storedRepeat 10
+
+static unsigned int adler32(const QByteArray &data)
+{
+    unsigned int a = 1, b = 0;
+
+    for (int i = 0; i < data.size(); ++i) {
+        a = (a + (unsigned char)data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+QByteArray TestFlate::decompressed()
+{
+    QByteArray fixedText, dynamicText, block;
+    unsigned int x = 12345;
+
+    for (int i = 0; i < 20; ++i) {
+        fixedText += "fixed block " + QByteArray::number(i) + "\n";
+    }
+    fixedText += QByteArray("a").repeated(300);
+    for (int i = 0; i < 256; ++i) {
+        x = (x * 1103515245 + 12345) & 0x7fffffff;
+        block.append((char)('a' + (x >> 16) % 26));
+    }
+    dynamicText = block.repeated(400);
+    return fixedText + dynamicText + QByteArray(storedText).repeated(storedRepeat);
+}
+
+QByteArray TestFlate::compressed()
+{
+    QByteArray data((const char *)flateData, sizeof(flateData));
+    QByteArray stored = QByteArray(storedText).repeated(storedRepeat);
+    unsigned int check = adler32(decompressed());
+
+    // final stored block: header, LEN, NLEN, data
+    data.append((char)1);
+    data.append((char)(stored.size() & 0xff));
+    data.append((char)(stored.size() >> 8));
+    data.append((char)(~stored.size() & 0xff));
+    data.append((char)((~stored.size() >> 8) & 0xff));
+    data += stored;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        data.append((char)((check >> shift) & 0xff));
+    }
+    return data;
+}
+
+Stream *TestFlate::openFlate(QByteArray *data)
+{
+    Object dict, obj;
+
+    dict.initDict((XRef *)NULL);
+    obj.initName("FlateDecode");
+    dict.dictAdd(copyString("Filter"), &obj);
+    Stream *str = new MemStream(data->data(), 0, data->size(), &dict);
+    return str->addFilters(&dict);
+}
+
+QByteArray TestFlate::readAll(Stream *str, int chunkSize)
+{
+    QByteArray result;
+    Guchar *buf = (Guchar *)gmalloc(chunkSize);
+    int n;
+
+    str->reset();
+    while ((n = str->doGetChars(chunkSize, buf)) > 0) {
+        result += QByteArray((const char *)buf, n);
+    }
+    gfree(buf);
+    return result;
+}
+
+void TestFlate::testBlockReads()
+{
+    QByteArray data = compressed();
+    QByteArray expected = decompressed();
+    const int chunkSizes[] = { 1, 7, 300, 4096, 65536, 200000 };
+
+    for (unsigned int i = 0; i < sizeof(chunkSizes) / sizeof(chunkSizes[0]); ++i) {
+        Stream *str = openFlate(&data);
+        QVERIFY(readAll(str, chunkSizes[i]) == expected);
+        QCOMPARE(str->getChar(), EOF);
+        delete str;
+    }
+}
+
+void TestFlate::testCharReads()
+{
+    QByteArray data = compressed();
+    QByteArray expected = decompressed();
+    Stream *str = openFlate(&data);
+    Guchar buf[100];
+    int i, c;
+
+    // mix getChar, lookChar and getChars
+    str->reset();
+    i = 0;
+    while (i < expected.size()) {
+        if (i % 1000 < 900) {
+            QCOMPARE(str->lookChar(), (int)(unsigned char)expected[i]);
+            QCOMPARE(str->getChar(), (int)(unsigned char)expected[i]);
+            ++i;
+        } else {
+            c = str->doGetChars(100, buf);
+            QVERIFY(c > 0);
+            QVERIFY(QByteArray((const char *)buf, c) == expected.mid(i, c));
+            i += c;
+        }
+    }
+    QCOMPARE(str->lookChar(), EOF);
+    QCOMPARE(str->getChar(), EOF);
+    delete str;
+}
+
+void TestFlate::testReset()
+{
+    QByteArray data = compressed();
+    QByteArray expected = decompressed();
+    Stream *str = openFlate(&data);
+    Guchar buf[50000];
+
+    str->reset();
+    QCOMPARE(str->doGetChars(50000, buf), 50000);
+    QVERIFY(readAll(str, 4096) == expected);
+    delete str;
+}
+
+// Decoding a truncated stream must stop cleanly after a prefix of the
+// data.
+void TestFlate::testTruncated()
+{
+    QByteArray data = compressed();
+    QByteArray expected = decompressed();
+
+    for (int len = 0; len < data.size(); len += 7) {
+        QByteArray truncated = data.left(len);
+        Stream *str = openFlate(&truncated);
+        QByteArray result = readAll(str, 4096);
+        QVERIFY(result.size() <= expected.size());
+        QVERIFY(result == expected.left(result.size()));
+        QCOMPARE(str->getChar(), EOF);
+        delete str;
+    }
+}
+
+// getPos reports how far the compressed data has been decoded, not how
+// far it has been read ahead.
+void TestFlate::testPos()
+{
+    QByteArray data = compressed();
+    QByteArray expected = decompressed();
+    Stream *str = openFlate(&data);
+    Goffset pos, lastPos;
+    int i;
+
+    str->reset();
+    QCOMPARE(str->getChar(), (int)(unsigned char)expected[0]);
+    lastPos = str->getPos();
+    // the first block is a small part of the data, which is read ahead
+    // all at once
+    QVERIFY(lastPos > 2 && lastPos < data.size() / 4);
+    for (i = 1; i < expected.size(); ++i) {
+        QCOMPARE(str->getChar(), (int)(unsigned char)expected[i]);
+        pos = str->getPos();
+        QVERIFY(pos >= lastPos);
+        lastPos = pos;
+    }
+    QCOMPARE(str->getChar(), EOF);
+
+    // everything but the Adler-32 trailer was decoded
+    QCOMPARE(str->getPos(), (Goffset)data.size() - 4);
+    delete str;
+}
+
+QTEST_MAIN(TestFlate)
+#include "check_flate.moc"
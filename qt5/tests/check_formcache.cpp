@@ -0,0 +1,151 @@
+#include <QtTest/QtTest>
+
+#include <string.h>
+
+#include "GlobalParams.h"
+#include "Gfx.h"
+#include "PDFDoc.h"
+#include "SplashOutputDev.h"
+#include "splash/SplashBitmap.h"
+#include "testpdf.h"
+
+class TestFormCache : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void testReplay();
+    void testNoGlobalParams();
+
+private:
+    PDFDoc *openPdf(QByteArray *data, Goffset cacheSize);
+    SplashBitmap *render(PDFDoc *doc, int page);
+};
+
+static const Ref formRef = { 6, 0 };
+
+// A form with paths, a clip, text and a nested form, so that most
+// kinds of operators are replayed.
+static const char formContent[] =
+    "q 0.8 0 0 RG 3 w 0 0 m 100 80 l 20 90 l h S Q\n"
+    "q 0 0.5 1 rg 10 10 60 30 re f Q\n"
+    "q 20 20 40 40 re W n 1 0 1 rg 0 0 100 100 re f Q\n"
+    "BT /F1 12 Tf 5 60 Td (Form) Tj ET\n"
+    "q 0.5 0 0 0.5 50 50 cm /Fm2 Do Q\n";
+
+static const char nestedContent[] =
+    "0.2 0.6 0.2 rg 0 0 m 50 100 l 100 0 l h f\n";
+
+void TestFormCache::initTestCase()
+{
+    globalParams = new GlobalParams();
+}
+
+void TestFormCache::cleanupTestCase()
+{
+    delete globalParams;
+}
+
+// Two pages; the first draws form 6 0 R twice at different sizes, the
+// second once more.
+PDFDoc *TestFormCache::openPdf(QByteArray *data, Goffset cacheSize)
+{
+    TestPdf pdf;
+
+    pdf.addObject("<< /Type /Catalog /Pages 2 0 R >>");
+    pdf.addObject("<< /Type /Pages /Count 2 /Kids [3 0 R 4 0 R]"
+                  " /MediaBox [0 0 200 200]"
+                  " /Resources << /XObject << /Fm1 6 0 R >> >> >>");
+    pdf.addObject("<< /Type /Page /Parent 2 0 R /Contents 5 0 R >>");
+    pdf.addObject("<< /Type /Page /Parent 2 0 R /Contents 7 0 R >>");
+    pdf.addStream("", "q /Fm1 Do Q\n"
+                      "q 0.7 0.2 -0.2 0.7 110 60 cm /Fm1 Do Q\n");
+    pdf.addStream("/Type /XObject /Subtype /Form /BBox [0 0 100 100]"
+                  " /Resources << /XObject << /Fm2 8 0 R >>"
+                  " /Font << /F1 << /Type /Font /Subtype /Type1"
+                  " /BaseFont /Helvetica >> >> >>", formContent);
+    pdf.addStream("", "q 1.5 0 0 1.5 20 30 cm /Fm1 Do Q\n");
+    pdf.addStream("/Type /XObject /Subtype /Form /BBox [0 0 100 100]",
+                  nestedContent);
+    *data = pdf.data();
+
+    globalParams->setFormCacheSize(cacheSize);
+    PDFDoc *doc = TestPdf::open(data);
+    globalParams->setFormCacheSize(0);
+    return doc;
+}
+
+SplashBitmap *TestFormCache::render(PDFDoc *doc, int page)
+{
+    SplashColor paper;
+    SplashOutputDev *out;
+    SplashBitmap *bitmap;
+
+    paper[0] = paper[1] = paper[2] = 0xff;
+    out = new SplashOutputDev(splashModeRGB8, 4, gFalse, paper);
+    out->startDoc(doc);
+    doc->displayPage(out, page, 97, 97, 0, gFalse, gTrue, gFalse);
+    bitmap = out->takeBitmap();
+    delete out;
+    return bitmap;
+}
+
+static bool sameBitmap(SplashBitmap *a, SplashBitmap *b)
+{
+    return a->getWidth() == b->getWidth() &&
+           a->getHeight() == b->getHeight() &&
+           a->getRowSize() == b->getRowSize() &&
+           !memcmp(a->getDataPtr(), b->getDataPtr(),
+                   a->getRowSize() * a->getHeight());
+}
+
+// Replaying a cached form draws the same as parsing it again.
+void TestFormCache::testReplay()
+{
+    QByteArray data1, data2;
+
+    PDFDoc *uncached = openPdf(&data1, 0);
+    PDFDoc *cached = openPdf(&data2, 1024 * 1024);
+    QVERIFY(uncached->isOk());
+    QVERIFY(cached->isOk());
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int page = 1; page <= 2; ++page) {
+            SplashBitmap *expected = render(uncached, page);
+            SplashBitmap *replayed = render(cached, page);
+            QVERIFY(sameBitmap(replayed, expected));
+            delete expected;
+            delete replayed;
+
+            // the form was recorded the first time it was drawn
+            GfxContentTokens *tokens = cached->getFormCache()->lookup(formRef);
+            QVERIFY(tokens);
+            tokens->decRefCnt();
+            QVERIFY(!uncached->getFormCache()->lookup(formRef));
+        }
+    }
+
+    delete uncached;
+    delete cached;
+}
+
+// PDFDoc can be created without GlobalParams; the cache is off then.
+void TestFormCache::testNoGlobalParams()
+{
+    GlobalParams *savedGlobalParams = globalParams;
+    TestPdf pdf;
+
+    pdf.addObject("<< /Type /Catalog /Pages 2 0 R >>");
+    pdf.addObject("<< /Type /Pages /Count 0 /Kids [] >>");
+    QByteArray data = pdf.data();
+
+    globalParams = NULL;
+    PDFDoc *doc = TestPdf::open(&data);
+    QCOMPARE(doc->getFormCache()->getMaxBytes(), (Goffset)0);
+    delete doc;
+    globalParams = savedGlobalParams;
+}
+
+QTEST_MAIN(TestFormCache)
+#include "check_formcache.moc"
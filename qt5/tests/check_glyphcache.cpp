@@ -0,0 +1,399 @@
+#include <QtTest/QtTest>
+
+#include <string.h>
+
+#include "GlobalParams.h"
+#include "PDFDoc.h"
+#include "SplashOutputDev.h"
+#include "goo/GooString.h"
+#include "splash/SplashBitmap.h"
+#include "splash/SplashFontFile.h"
+#include "splash/SplashGlyphBitmap.h"
+#include "splash/SplashGlyphCache.h"
+#include "testpdf.h"
+
+class TestGlyphCache : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void testFontProgramIDs();
+    void testUnusedFontPrograms();
+    void testSharedAcrossDocuments();
+    void testSameLengthDifferentFont();
+    void testEviction();
+
+private:
+    PDFDoc *openPdf(QByteArray *data, const unsigned char *font,
+                    int fontLen, int padding);
+    SplashBitmap *render(PDFDoc *doc);
+};
+
+// Two TrueType fonts of the same length with glyphs for 'A' and 'B'.
+// 'A' is a square in both; 'B' is a triangle pointing up in the first
+// and down in the second.
+static const unsigned char fontAData[] = {
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x08, 0x00, 0x40, 0x00, 0x03, 0x00, 0x40,
+    0x63, 0x6d, 0x61, 0x70, 0x02, 0x6d, 0x02, 0x40, 0x00, 0x00, 0x00, 0x8c,
+    0x00, 0x00, 0x01, 0x3a, 0x67, 0x6c, 0x79, 0x66, 0xf0, 0x17, 0x15, 0x0f,
+    0x00, 0x00, 0x01, 0xc8, 0x00, 0x00, 0x00, 0x40, 0x68, 0x65, 0x61, 0x64,
+    0x61, 0x6b, 0x43, 0xa2, 0x00, 0x00, 0x02, 0x08, 0x00, 0x00, 0x00, 0x36,
+    0x68, 0x68, 0x65, 0x61, 0x05, 0x7a, 0x01, 0x94, 0x00, 0x00, 0x02, 0x40,
+    0x00, 0x00, 0x00, 0x24, 0x68, 0x6d, 0x74, 0x78, 0x07, 0x08, 0x00, 0x00,
+    0x00, 0x00, 0x02, 0x64, 0x00, 0x00, 0x00, 0x0c, 0x6c, 0x6f, 0x63, 0x61,
+    0x00, 0x00, 0x00, 0x62, 0x00, 0x00, 0x02, 0x70, 0x00, 0x00, 0x00, 0x10,
+    0x6d, 0x61, 0x78, 0x70, 0x00, 0x05, 0x00, 0x06, 0x00, 0x00, 0x02, 0x80,
+    0x00, 0x00, 0x00, 0x20, 0x70, 0x6f, 0x73, 0x74, 0x00, 0x03, 0x00, 0x00,
+    0x00, 0x00, 0x02, 0xa0, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x14, 0x00, 0x03, 0x00, 0x01,
+    0x00, 0x00, 0x01, 0x1a, 0x00, 0x00, 0x01, 0x06, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x04, 0x00, 0x20, 0x00, 0x00, 0x00, 0x04, 0x00, 0x04,
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x42, 0xff, 0xff, 0x00, 0x00, 0x00, 0x41,
+    0xff, 0xff, 0xff, 0xc0, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x64, 0x00, 0x00, 0x01, 0xf4, 0x02, 0xbc, 0x00, 0x03,
+    0x00, 0x00, 0x01, 0x01, 0x01, 0x01, 0x00, 0x64, 0x00, 0x00, 0x01, 0x90,
+    0x00, 0x00, 0x00, 0x00, 0x02, 0xbc, 0x00, 0x00, 0xfd, 0x44, 0x00, 0x01,
+    0x00, 0x64, 0x00, 0x00, 0x01, 0xf4, 0x02, 0xbc, 0x00, 0x02, 0x00, 0x00,
+    0x01, 0x01, 0x01, 0x00, 0x64, 0x00, 0xc8, 0x00, 0xc8, 0x00, 0x00, 0x02,
+    0xbc, 0xfd, 0x44, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x5f, 0x0f, 0x3c, 0xf5, 0x00, 0x00, 0x03, 0xe8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x58, 0x02, 0xbc,
+    0x00, 0x00, 0x00, 0x08, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x00, 0x03, 0x20, 0xff, 0x38, 0x00, 0x00, 0x02, 0x58,
+    0x00, 0x00, 0x00, 0x00, 0x02, 0x58, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+    0x02, 0x58, 0x00, 0x00, 0x02, 0x58, 0x00, 0x00, 0x02, 0x58, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x22,
+    0x00, 0x00, 0x00, 0x40, 0x00, 0x01, 0x00, 0x00, 0x00, 0x03, 0x00, 0x04,
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static const unsigned char fontBData[] = {
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x08, 0x00, 0x40, 0x00, 0x03, 0x00, 0x40,
+    0x63, 0x6d, 0x61, 0x70, 0x02, 0x6d, 0x02, 0x40, 0x00, 0x00, 0x00, 0x8c,
+    0x00, 0x00, 0x01, 0x3a, 0x67, 0x6c, 0x79, 0x66, 0xa4, 0x1a, 0x9a, 0x0c,
+    0x00, 0x00, 0x01, 0xc8, 0x00, 0x00, 0x00, 0x40, 0x68, 0x65, 0x61, 0x64,
+    0x61, 0x6b, 0x43, 0xa2, 0x00, 0x00, 0x02, 0x08, 0x00, 0x00, 0x00, 0x36,
+    0x68, 0x68, 0x65, 0x61, 0x05, 0x7a, 0x01, 0x94, 0x00, 0x00, 0x02, 0x40,
+    0x00, 0x00, 0x00, 0x24, 0x68, 0x6d, 0x74, 0x78, 0x07, 0x08, 0x00, 0x00,
+    0x00, 0x00, 0x02, 0x64, 0x00, 0x00, 0x00, 0x0c, 0x6c, 0x6f, 0x63, 0x61,
+    0x00, 0x00, 0x00, 0x62, 0x00, 0x00, 0x02, 0x70, 0x00, 0x00, 0x00, 0x10,
+    0x6d, 0x61, 0x78, 0x70, 0x00, 0x05, 0x00, 0x06, 0x00, 0x00, 0x02, 0x80,
+    0x00, 0x00, 0x00, 0x20, 0x70, 0x6f, 0x73, 0x74, 0x00, 0x03, 0x00, 0x00,
+    0x00, 0x00, 0x02, 0xa0, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x14, 0x00, 0x03, 0x00, 0x01,
+    0x00, 0x00, 0x01, 0x1a, 0x00, 0x00, 0x01, 0x06, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x04, 0x00, 0x20, 0x00, 0x00, 0x00, 0x04, 0x00, 0x04,
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x42, 0xff, 0xff, 0x00, 0x00, 0x00, 0x41,
+    0xff, 0xff, 0xff, 0xc0, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x64, 0x00, 0x00, 0x01, 0xf4, 0x02, 0xbc, 0x00, 0x03,
+    0x00, 0x00, 0x01, 0x01, 0x01, 0x01, 0x00, 0x64, 0x00, 0x00, 0x01, 0x90,
+    0x00, 0x00, 0x00, 0x00, 0x02, 0xbc, 0x00, 0x00, 0xfd, 0x44, 0x00, 0x01,
+    0x00, 0x64, 0x00, 0x00, 0x01, 0xf4, 0x02, 0xbc, 0x00, 0x02, 0x00, 0x00,
+    0x01, 0x01, 0x01, 0x00, 0x64, 0x01, 0x90, 0xff, 0x38, 0x02, 0xbc, 0x00,
+    0x00, 0xfd, 0x44, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x5f, 0x0f, 0x3c, 0xf5, 0x00, 0x00, 0x03, 0xe8,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x58, 0x02, 0xbc,
+    0x00, 0x00, 0x00, 0x08, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x00, 0x03, 0x20, 0xff, 0x38, 0x00, 0x00, 0x02, 0x58,
+    0x00, 0x00, 0x00, 0x00, 0x02, 0x58, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+    0x02, 0x58, 0x00, 0x00, 0x02, 0x58, 0x00, 0x00, 0x02, 0x58, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x22,
+    0x00, 0x00, 0x00, 0x40, 0x00, 0x01, 0x00, 0x00, 0x00, 0x03, 0x00, 0x04,
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+void TestGlyphCache::initTestCase()
+{
+    globalParams = new GlobalParams();
+}
+
+void TestGlyphCache::cleanupTestCase()
+{
+    delete globalParams;
+}
+
+// A page showing "ABAB" in the given embedded font.  <padding> unused
+// objects are added in front, so that the documents differ.
+PDFDoc *TestGlyphCache::openPdf(QByteArray *data, const unsigned char *font,
+                                int fontLen, int padding)
+{
+    TestPdf pdf;
+    int fontFileObj = 7 + padding;
+
+    pdf.addObject("<< /Type /Catalog /Pages 2 0 R >>");
+    pdf.addObject("<< /Type /Pages /Count 1 /Kids [3 0 R]"
+                  " /MediaBox [0 0 200 60] >>");
+    pdf.addObject("<< /Type /Page /Parent 2 0 R /Contents 4 0 R"
+                  " /Resources << /Font << /F1 5 0 R >> >> >>");
+    pdf.addStream("", "BT /F1 40 Tf 10 15 Td (ABAB) Tj ET\n");
+    pdf.addObject("<< /Type /Font /Subtype /TrueType /BaseFont /Test"
+                  " /FirstChar 65 /LastChar 66 /Widths [1000 1000]"
+                  " /FontDescriptor 6 0 R >>");
+    pdf.addObject("<< /Type /FontDescriptor /FontName /Test /Flags 4"
+                  " /FontBBox [0 0 1000 1000] /ItalicAngle 0 /Ascent 1000"
+                  " /Descent 0 /CapHeight 1000 /StemV 80 /FontFile2 " +
+                  QByteArray::number(fontFileObj) + " 0 R >>");
+    for (int i = 0; i < padding; ++i) {
+        pdf.addObject("<< /Unused true >>");
+    }
+    pdf.addStream("/Length1 " + QByteArray::number(fontLen),
+                  QByteArray((const char *)font, fontLen));
+    *data = pdf.data();
+    return TestPdf::open(data);
+}
+
+SplashBitmap *TestGlyphCache::render(PDFDoc *doc)
+{
+    SplashColor paper;
+    SplashOutputDev *out;
+    SplashBitmap *bitmap;
+
+    paper[0] = 0xff;
+    out = new SplashOutputDev(splashModeMono8, 4, gFalse, paper);
+    out->startDoc(doc);
+    doc->displayPage(out, 1, 72, 72, 0, gFalse, gTrue, gFalse);
+    bitmap = out->takeBitmap();
+    delete out;
+    return bitmap;
+}
+
+static bool sameBitmap(SplashBitmap *a, SplashBitmap *b)
+{
+    return a->getWidth() == b->getWidth() &&
+           a->getHeight() == b->getHeight() &&
+           a->getRowSize() == b->getRowSize() &&
+           !memcmp(a->getDataPtr(), b->getDataPtr(),
+                   a->getRowSize() * a->getHeight());
+}
+
+static bool isBlank(SplashBitmap *bitmap)
+{
+    SplashColorPtr p = bitmap->getDataPtr();
+
+    for (int i = 0; i < bitmap->getRowSize() * bitmap->getHeight(); ++i) {
+        if (p[i] != 0xff) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static SplashFontSrc *makeSrc(const unsigned char *font, int fontLen)
+{
+    SplashFontSrc *src = new SplashFontSrc();
+    char *buf = (char *)gmalloc(fontLen);
+
+    memcpy(buf, font, fontLen);
+    src->setBuf(buf, fontLen, gTrue);
+    return src;
+}
+
+// Numbers are given by the font bytes, not by the buffer.
+void TestGlyphCache::testFontProgramIDs()
+{
+    SplashGlyphCache cache(1024 * 1024);
+    SplashFontSrc *srcA1 = makeSrc(fontAData, sizeof(fontAData));
+    SplashFontSrc *srcA2 = makeSrc(fontAData, sizeof(fontAData));
+    SplashFontSrc *srcB = makeSrc(fontBData, sizeof(fontBData));
+
+    QCOMPARE((int)sizeof(fontAData), (int)sizeof(fontBData));
+    int idA1 = cache.getFontProgramID(srcA1);
+    int idA2 = cache.getFontProgramID(srcA2);
+    int idB = cache.getFontProgramID(srcB);
+    QCOMPARE(idA1, idA2);
+    QVERIFY(idA1 != idB);
+
+    // a font which is still used keeps its number
+    cache.releaseFontProgram(idA1);
+    QCOMPARE(cache.getFontProgramID(srcA1), idA1);
+    cache.releaseFontProgram(idA1);
+    cache.releaseFontProgram(idA2);
+    cache.releaseFontProgram(idB);
+
+    srcA1->unref();
+    srcA2->unref();
+    srcB->unref();
+}
+
+// Released programs are kept within the budget, least recently
+// released first out; a dropped program gets a new number.
+void TestGlyphCache::testUnusedFontPrograms()
+{
+    SplashGlyphCache cache(sizeof(fontAData) + sizeof(fontBData) / 2);
+    SplashFontSrc *srcA = makeSrc(fontAData, sizeof(fontAData));
+    SplashFontSrc *srcB = makeSrc(fontBData, sizeof(fontBData));
+
+    int idA = cache.getFontProgramID(srcA);
+    int idB = cache.getFontProgramID(srcB);
+    cache.releaseFontProgram(idA);
+    QCOMPARE(cache.getFontProgramID(srcA), idA);
+    cache.releaseFontProgram(idA);
+
+    // both don't fit: releasing B drops A
+    cache.releaseFontProgram(idB);
+    int idB2 = cache.getFontProgramID(srcB);
+    QCOMPARE(idB2, idB);
+    int idA2 = cache.getFontProgramID(srcA);
+    QVERIFY(idA2 != idA);
+    QVERIFY(idA2 != idB);
+
+    // no budget, nothing is kept
+    cache.setMaxBytes(0);
+    cache.releaseFontProgram(idA2);
+    QVERIFY(cache.getFontProgramID(srcA) != idA2);
+
+    srcA->unref();
+    srcB->unref();
+}
+
+// A second document embedding the same font uses the glyphs the first
+// one rasterized, even after the first one is closed.
+void TestGlyphCache::testSharedAcrossDocuments()
+{
+    SplashGlyphCache *cache = SplashGlyphCache::getGlobalCache();
+    QByteArray data1, data2;
+
+    cache->clear();
+    PDFDoc *doc1 = openPdf(&data1, fontAData, sizeof(fontAData), 0);
+    QVERIFY(doc1->isOk());
+    SplashBitmap *bitmap1 = render(doc1);
+    delete doc1;
+    Goffset bytes = cache->getBytes();
+    QVERIFY(bytes > 0);
+    QVERIFY(!isBlank(bitmap1));
+
+    PDFDoc *doc2 = openPdf(&data2, fontAData, sizeof(fontAData), 3);
+    QVERIFY(doc2->isOk());
+    QVERIFY(data1 != data2);
+    SplashBitmap *bitmap2 = render(doc2);
+    QCOMPARE(cache->getBytes(), bytes);
+    QVERIFY(sameBitmap(bitmap1, bitmap2));
+
+    delete bitmap1;
+    delete bitmap2;
+    delete doc2;
+}
+
+// A font of the same length doesn't pick up the other font's glyphs.
+void TestGlyphCache::testSameLengthDifferentFont()
+{
+    SplashGlyphCache *cache = SplashGlyphCache::getGlobalCache();
+    Goffset maxBytes = cache->getMaxBytes();
+    QByteArray dataA, dataB;
+
+    PDFDoc *docA = openPdf(&dataA, fontAData, sizeof(fontAData), 0);
+    PDFDoc *docB = openPdf(&dataB, fontBData, sizeof(fontBData), 0);
+    SplashBitmap *bitmapA = render(docA);
+    SplashBitmap *bitmapB = render(docB);
+    QVERIFY(!sameBitmap(bitmapA, bitmapB));
+
+    cache->setMaxBytes(0);
+    SplashBitmap *uncached = render(docB);
+    cache->setMaxBytes(maxBytes);
+    QVERIFY(sameBitmap(bitmapB, uncached));
+
+    delete bitmapA;
+    delete bitmapB;
+    delete uncached;
+    delete docA;
+    delete docB;
+}
+
+// The cache stays within its budget, dropping the least recently
+// used glyphs.
+void TestGlyphCache::testEviction()
+{
+    const Goffset maxBytes = 8 * 1024;
+    SplashGlyphCache cache(maxBytes);
+    SplashGlyphBitmap bitmap, found;
+    Guchar data[16 * 16];
+    int i;
+
+    memset(data, 0x80, sizeof(data));
+    bitmap.x = bitmap.y = 0;
+    bitmap.w = bitmap.h = 16;
+    bitmap.aa = gTrue;
+    bitmap.data = data;
+    bitmap.freeData = gFalse;
+    for (i = 0; i < 200; ++i) {
+        GooString *key = GooString::format("glyph{0:d}", i);
+        data[0] = (Guchar)i;
+        cache.put(key, &bitmap);
+        delete key;
+        QVERIFY(cache.getBytes() <= maxBytes);
+    }
+    QVERIFY(cache.getBytes() > 0);
+
+    GooString *first = new GooString("glyph0");
+    QVERIFY(!cache.lookup(first, &found));
+    delete first;
+
+    GooString *last = new GooString("glyph199");
+    QVERIFY(cache.lookup(last, &found));
+    QCOMPARE(found.w, 16);
+    QCOMPARE(found.h, 16);
+    QCOMPARE((int)found.data[0], 199);
+    gfree(found.data);
+    delete last;
+
+    cache.setMaxBytes(0);
+    QCOMPARE(cache.getBytes(), (Goffset)0);
+}
+
+QTEST_MAIN(TestGlyphCache)
+#include "check_glyphcache.moc"
@@ -0,0 +1,310 @@
+#include <QtTest/QtTest>
+
+#include <string.h>
+
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#include "GlobalParams.h"
+#include "GfxState.h"
+#include "PDFDoc.h"
+#include "XRef.h"
+#include "DecodedImageCache.h"
+#include "SplashOutputDev.h"
+#include "splash/SplashBitmap.h"
+#include "testpdf.h"
+
+class TestImageCache : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void testRender();
+    void testKeys();
+    void testEviction();
+    void testModified();
+    void testNoGlobalParams();
+
+private:
+    PDFDoc *openPdf(QByteArray *data, Goffset cacheSize);
+    SplashBitmap *render(PDFDoc *doc, int page);
+    DecodedImage *makeImage(int width, int height);
+};
+
+static const int imageWidth = 16;
+static const int imageHeight = 12;
+static const Ref imageRef = { 6, 0 };
+
+void TestImageCache::initTestCase()
+{
+    globalParams = new GlobalParams();
+}
+
+void TestImageCache::cleanupTestCase()
+{
+    delete globalParams;
+}
+
+// Two pages which draw the RGB image XObject 6 0 R, the second one
+// twice and at different sizes.
+PDFDoc *TestImageCache::openPdf(QByteArray *data, Goffset cacheSize)
+{
+    TestPdf pdf;
+    QByteArray image;
+
+    for (int y = 0; y < imageHeight; ++y) {
+        for (int x = 0; x < imageWidth; ++x) {
+            image.append((char)(x * 16));
+            image.append((char)(y * 20));
+            image.append((char)((x ^ y) * 16));
+        }
+    }
+
+    pdf.addObject("<< /Type /Catalog /Pages 2 0 R >>");
+    pdf.addObject("<< /Type /Pages /Count 2 /Kids [3 0 R 4 0 R]"
+                  " /MediaBox [0 0 100 100]"
+                  " /Resources << /XObject << /Im1 6 0 R >> >> >>");
+    pdf.addObject("<< /Type /Page /Parent 2 0 R /Contents 5 0 R >>");
+    pdf.addObject("<< /Type /Page /Parent 2 0 R /Contents 7 0 R >>");
+    pdf.addStream("", "q 80 0 0 60 10 20 cm /Im1 Do Q\n");
+    pdf.addStream("/Type /XObject /Subtype /Image /Width " +
+                  QByteArray::number(imageWidth) +
+                  " /Height " + QByteArray::number(imageHeight) +
+                  " /ColorSpace /DeviceRGB /BitsPerComponent 8", image);
+    pdf.addStream("", "q 40 0 0 30 5 5 cm /Im1 Do Q\n"
+                      "q 50 0 0 50 45 45 cm /Im1 Do Q\n");
+    *data = pdf.data();
+
+    globalParams->setDecodedImageCacheSize(cacheSize);
+    PDFDoc *doc = TestPdf::open(data);
+    globalParams->setDecodedImageCacheSize(0);
+    return doc;
+}
+
+SplashBitmap *TestImageCache::render(PDFDoc *doc, int page)
+{
+    SplashColor paper;
+    SplashOutputDev *out;
+    SplashBitmap *bitmap;
+
+    paper[0] = paper[1] = paper[2] = 0xff;
+    out = new SplashOutputDev(splashModeRGB8, 4, gFalse, paper);
+    out->startDoc(doc);
+    doc->displayPage(out, page, 72, 72, 0, gFalse, gTrue, gFalse);
+    bitmap = out->takeBitmap();
+    delete out;
+    return bitmap;
+}
+
+DecodedImage *TestImageCache::makeImage(int width, int height)
+{
+    Guchar *data = (Guchar *)gmallocn(height, width);
+
+    memset(data, 0x80, width * height);
+    return new DecodedImage(width, height, width, data);
+}
+
+static bool sameBitmap(SplashBitmap *a, SplashBitmap *b)
+{
+    return a->getWidth() == b->getWidth() &&
+           a->getHeight() == b->getHeight() &&
+           a->getRowSize() == b->getRowSize() &&
+           !memcmp(a->getDataPtr(), b->getDataPtr(),
+                   a->getRowSize() * a->getHeight());
+}
+
+// Drawing the pages from the cache gives the same bitmaps as decoding
+// the image each time.
+void TestImageCache::testRender()
+{
+    QByteArray data1, data2, data3;
+    Goffset imageSize = imageWidth * imageHeight * 3;
+
+    PDFDoc *uncached = openPdf(&data1, 0);
+    PDFDoc *cached = openPdf(&data2, 1024 * 1024);
+    PDFDoc *tooSmall = openPdf(&data3, imageSize - 1);
+    QVERIFY(!uncached->getXRef()->getDecodedImageCache());
+    DecodedImageCache *cache = cached->getXRef()->getDecodedImageCache();
+    QVERIFY(cache);
+    QCOMPARE(cache->getBytes(), (Goffset)0);
+
+    for (int page = 1; page <= 2; ++page) {
+        SplashBitmap *expected = render(uncached, page);
+        SplashBitmap *fromCache = render(cached, page);
+        SplashBitmap *notCached = render(tooSmall, page);
+        QVERIFY(sameBitmap(fromCache, expected));
+        QVERIFY(sameBitmap(notCached, expected));
+        delete expected;
+        delete fromCache;
+        delete notCached;
+
+        // the image is decoded once, then drawn from the cache
+        QCOMPARE(cache->getBytes(), imageSize);
+        QCOMPARE(tooSmall->getXRef()->getDecodedImageCache()->getBytes(),
+                 (Goffset)0);
+    }
+
+    // and again, now that the first page's image is cached too
+    SplashBitmap *expected = render(uncached, 1);
+    SplashBitmap *fromCache = render(cached, 1);
+    QVERIFY(sameBitmap(fromCache, expected));
+    delete expected;
+    delete fromCache;
+
+    delete uncached;
+    delete cached;
+    delete tooSmall;
+}
+
+// The key tells apart decoded sizes, pixel formats and color spaces.
+void TestImageCache::testKeys()
+{
+    QByteArray data;
+    PDFRectangle box(0, 0, 100, 100);
+    Object decode;
+
+    PDFDoc *doc = openPdf(&data, 1024 * 1024);
+    DecodedImageCache *cache = doc->getXRef()->getDecodedImageCache();
+    GfxState *state = new GfxState(72, 72, &box, 0, gTrue);
+    decode.initNull();
+    GfxImageColorMap *rgb = new GfxImageColorMap(8, &decode, new GfxDeviceRGBColorSpace());
+    GfxImageColorMap *gray = new GfxImageColorMap(8, &decode, new GfxDeviceGrayColorSpace());
+    GfxImageColorMap *gray4 = new GfxImageColorMap(4, &decode, new GfxDeviceGrayColorSpace());
+
+    GooString *keys[6];
+    keys[0] = cache->makeKey(imageRef, 16, 12, 1, rgb, state);
+    keys[1] = cache->makeKey(imageRef, 8, 6, 1, rgb, state);
+    keys[2] = cache->makeKey(imageRef, 16, 12, 2, rgb, state);
+    keys[3] = cache->makeKey(imageRef, 16, 12, 1, gray, state);
+    keys[4] = cache->makeKey(imageRef, 16, 12, 1, gray4, state);
+    keys[5] = cache->makeKey(imageRef, 16, 12, 1, rgb, state);
+    for (int i = 0; i < 6; ++i) {
+        QVERIFY(keys[i]);
+    }
+    for (int i = 0; i < 5; ++i) {
+        for (int j = i + 1; j < 5; ++j) {
+            QVERIFY(keys[i]->cmp(keys[j]) != 0);
+        }
+    }
+    QCOMPARE(keys[5]->cmp(keys[0]), 0);
+
+    // a hit returns the image that was put under the same key
+    DecodedImage *image = makeImage(16, 12);
+    cache->put(keys[0], image);
+    QVERIFY(cache->lookup(keys[5]) == image);
+    image->decRefCnt();
+    for (int i = 1; i < 5; ++i) {
+        QVERIFY(!cache->lookup(keys[i]));
+    }
+    image->decRefCnt();
+
+    for (int i = 0; i < 6; ++i) {
+        delete keys[i];
+    }
+    delete rgb;
+    delete gray;
+    delete gray4;
+    delete state;
+    delete doc;
+}
+
+// The least recently used images are dropped first, and images bigger
+// than the budget are not kept.
+void TestImageCache::testEviction()
+{
+    QByteArray data;
+    GooString *keys[4];
+    DecodedImage *images[4];
+
+    PDFDoc *doc = openPdf(&data, 300);
+    DecodedImageCache *cache = doc->getXRef()->getDecodedImageCache();
+    for (int i = 0; i < 4; ++i) {
+        keys[i] = GooString::format("image {0:d}", i);
+        images[i] = makeImage(10, 10);
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        cache->put(keys[i], images[i]);
+    }
+    QCOMPARE(cache->getBytes(), (Goffset)300);
+
+    // use image 0 again, so that image 1 is the one to go
+    QVERIFY(cache->lookup(keys[0]) == images[0]);
+    images[0]->decRefCnt();
+    cache->put(keys[3], images[3]);
+    QCOMPARE(cache->getBytes(), (Goffset)300);
+    QVERIFY(!cache->lookup(keys[1]));
+    for (int i = 0; i < 4; ++i) {
+        if (i != 1) {
+            QVERIFY(cache->lookup(keys[i]) == images[i]);
+            images[i]->decRefCnt();
+        }
+    }
+
+    // an evicted image stays alive as long as it is used
+    QCOMPARE(images[1]->getWidth(), 10);
+
+    DecodedImage *big = makeImage(20, 20);
+    GooString *bigKey = new GooString("big");
+    cache->put(bigKey, big);
+    QVERIFY(!cache->lookup(bigKey));
+    QCOMPARE(cache->getBytes(), (Goffset)300);
+
+    // shrinking the budget evicts too
+    cache->setMaxBytes(100);
+    QCOMPARE(cache->getBytes(), (Goffset)100);
+    QVERIFY(cache->lookup(keys[3]) == images[3]);
+    images[3]->decRefCnt();
+
+    big->decRefCnt();
+    delete bigKey;
+    for (int i = 0; i < 4; ++i) {
+        images[i]->decRefCnt();
+        delete keys[i];
+    }
+    delete doc;
+}
+
+// Images which were modified since the document was loaded are never
+// cached.
+void TestImageCache::testModified()
+{
+    QByteArray data;
+    PDFRectangle box(0, 0, 100, 100);
+    Object obj, decode;
+
+    PDFDoc *doc = openPdf(&data, 1024 * 1024);
+    XRef *xref = doc->getXRef();
+    DecodedImageCache *cache = xref->getDecodedImageCache();
+    GfxState *state = new GfxState(72, 72, &box, 0, gTrue);
+    decode.initNull();
+    GfxImageColorMap *rgb = new GfxImageColorMap(8, &decode, new GfxDeviceRGBColorSpace());
+
+    GooString *key = cache->makeKey(imageRef, 16, 12, 1, rgb, state);
+    QVERIFY(key);
+    delete key;
+
+    xref->fetch(imageRef.num, imageRef.gen, &obj);
+    xref->setModifiedObject(&obj, imageRef);
+    obj.free();
+    QVERIFY(!cache->makeKey(imageRef, 16, 12, 1, rgb, state));
+
+    delete rgb;
+    delete state;
+    delete doc;
+}
+
+// XRef can be used without GlobalParams; the cache is off then.
+void TestImageCache::testNoGlobalParams()
+{
+    GlobalParams *savedGlobalParams = globalParams;
+
+    globalParams = NULL;
+    XRef *xref = new XRef();
+    QVERIFY(!xref->getDecodedImageCache());
+    delete xref;
+    globalParams = savedGlobalParams;
+}
+
+QTEST_MAIN(TestImageCache)
+#include "check_imagecache.moc"
@@ -0,0 +1,197 @@
+#include <QtTest/QtTest>
+
+#include "Object.h"
+#include "Stream.h"
+
+class TestImageStream : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testGetLine_data();
+    void testGetLine();
+    void testGetPixel_data();
+    void testGetPixel();
+    void testShortRow_data();
+    void testShortRow();
+
+private:
+    void addRows();
+};
+
+// Rows of packed samples, each row starting on a byte boundary, as in
+// PDF image data.  Widths are chosen so that rows end part way through
+// a byte.
+
+static int rowBytes(int width, int nComps, int nBits)
+{
+    return (width * nComps * nBits + 7) / 8;
+}
+
+// Deterministic samples, using the full range of each sample size.
+static QList<int> makeSamples(int n, int nBits)
+{
+    QList<int> samples;
+    unsigned int seed = 4321;
+
+    for (int i = 0; i < n; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        samples.append((seed >> 12) & ((1 << nBits) - 1));
+    }
+    return samples;
+}
+
+// Pack <samples> into <height> rows of <nVals> samples.  Padding bits
+// at the end of each row are set, so that they show up if they are
+// unpacked as samples.
+static QByteArray pack(const QList<int> &samples, int height, int nVals,
+                       int nBits)
+{
+    QByteArray data;
+
+    for (int y = 0; y < height; ++y) {
+        unsigned int buf = 0;
+        int bits = 0;
+        for (int i = 0; i < nVals; ++i) {
+            buf = (buf << nBits) | samples[y * nVals + i];
+            bits += nBits;
+            while (bits >= 8) {
+                data.append((char)(buf >> (bits - 8)));
+                bits -= 8;
+            }
+        }
+        if (bits > 0) {
+            data.append((char)((buf << (8 - bits)) | (0xff >> bits)));
+        }
+    }
+    return data;
+}
+
+static Stream *openData(QByteArray *data)
+{
+    Object obj;
+
+    obj.initNull();
+    return new MemStream(data->data(), 0, data->size(), &obj);
+}
+
+void TestImageStream::addRows()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("nComps");
+    QTest::addColumn<int>("nBits");
+
+    const int widths[] = { 1, 3, 7, 9, 13, 31 };
+    const int bits[] = { 1, 2, 4, 8 };
+    for (int b = 0; b < 4; ++b) {
+        for (int w = 0; w < 6; ++w) {
+            for (int nComps = 1; nComps <= 3; nComps += 2) {
+                QByteArray name = QByteArray::number(bits[b]) + " bit, " +
+                                  QByteArray::number(widths[w]) + "x" +
+                                  QByteArray::number(nComps);
+                QTest::newRow(name.constData())
+                    << widths[w] << nComps << bits[b];
+            }
+        }
+    }
+}
+
+void TestImageStream::testGetLine_data()
+{
+    addRows();
+}
+
+void TestImageStream::testGetLine()
+{
+    QFETCH(int, width);
+    QFETCH(int, nComps);
+    QFETCH(int, nBits);
+    const int height = 5;
+    int nVals = width * nComps;
+    QList<int> samples = makeSamples(height * nVals, nBits);
+    QByteArray data = pack(samples, height, nVals, nBits);
+    QCOMPARE(data.size(), height * rowBytes(width, nComps, nBits));
+
+    Stream *str = openData(&data);
+    ImageStream *img = new ImageStream(str, width, nComps, nBits);
+    img->reset();
+    for (int y = 0; y < height; ++y) {
+        Guchar *line = img->getLine();
+        QVERIFY(line);
+        for (int i = 0; i < nVals; ++i) {
+            QCOMPARE((int)line[i], samples[y * nVals + i]);
+        }
+    }
+    img->close();
+    delete img;
+    delete str;
+}
+
+void TestImageStream::testGetPixel_data()
+{
+    addRows();
+}
+
+void TestImageStream::testGetPixel()
+{
+    QFETCH(int, width);
+    QFETCH(int, nComps);
+    QFETCH(int, nBits);
+    const int height = 4;
+    int nVals = width * nComps;
+    QList<int> samples = makeSamples(height * nVals, nBits);
+    QByteArray data = pack(samples, height, nVals, nBits);
+    Guchar pix[3];
+
+    Stream *str = openData(&data);
+    ImageStream *img = new ImageStream(str, width, nComps, nBits);
+    img->reset();
+    for (int i = 0; i < height * width; ++i) {
+        QVERIFY(img->getPixel(pix));
+        for (int k = 0; k < nComps; ++k) {
+            QCOMPARE((int)pix[k], samples[i * nComps + k]);
+        }
+    }
+    img->close();
+    delete img;
+    delete str;
+}
+
+void TestImageStream::testShortRow_data()
+{
+    addRows();
+}
+
+// Samples missing from the end of the data read as all ones.
+void TestImageStream::testShortRow()
+{
+    QFETCH(int, width);
+    QFETCH(int, nComps);
+    QFETCH(int, nBits);
+    int nVals = width * nComps;
+    int n = rowBytes(width, nComps, nBits);
+    QList<int> samples = makeSamples(2 * nVals, nBits);
+    QByteArray full = pack(samples, 2, nVals, nBits);
+
+    // keep the first row and half of the second
+    QByteArray data = full.left(n + n / 2);
+    int kept = (n / 2) * 8 / nBits;
+
+    Stream *str = openData(&data);
+    ImageStream *img = new ImageStream(str, width, nComps, nBits);
+    img->reset();
+    Guchar *line = img->getLine();
+    for (int i = 0; i < nVals; ++i) {
+        QCOMPARE((int)line[i], samples[i]);
+    }
+    line = img->getLine();
+    for (int i = 0; i < nVals; ++i) {
+        QCOMPARE((int)line[i],
+                 i < kept ? samples[nVals + i] : (1 << nBits) - 1);
+    }
+    img->close();
+    delete img;
+    delete str;
+}
+
+QTEST_MAIN(TestImageStream)
+#include "check_imagestream.moc"
@@ -0,0 +1,296 @@
+#include <QtTest/QtTest>
+
+#include "GlobalParams.h"
+#include "Object.h"
+#include "Stream.h"
+#include "XRef.h"
+#include "PDFDoc.h"
+#include "JBIG2Stream.h"
+#include "testpdf.h"
+
+class TestJBIG2 : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void testSharedGlobals();
+    void testReset();
+
+private:
+    PDFDoc *openPdf(QByteArray *data);
+    void checkImage(PDFDoc *doc, int num, const QByteArray &expected);
+};
+
+// Two images use the same JBIG2Globals stream, which holds a symbol
+// dictionary with three 5-pixel high symbols.  Both images are 32x16
+// pages built from an immediate text region that places those symbols.
+// Everything is Huffman coded, using the standard tables.
+
+static const int pageWidth = 32;
+static const int pageHeight = 16;
+
+static const int symHeight = 5;
+static const int symWidths[3] = { 3, 4, 5 };
+static const char *symRows[3][symHeight] = {
+    { "111", "010", "010", "010", "111" },
+    { "1001", "1001", "1111", "1001", "1001" },
+    { "10001", "01010", "00100", "01010", "10001" }
+};
+
+// symbol, x, y of the instances in the text region
+static const int instances[5][3] = {
+    { 0, 1, 2 }, { 1, 5, 2 }, { 2, 10, 2 },
+    { 2, 4, 9 }, { 0, 10, 9 }
+};
+
+static void appendULong(QByteArray *data, unsigned int x)
+{
+    data->append((char)(x >> 24));
+    data->append((char)(x >> 16));
+    data->append((char)(x >> 8));
+    data->append((char)x);
+}
+
+// Append a string of '0' and '1' characters (spaces are skipped) as
+// bits, padding the last byte with zeros.
+static void appendBits(QByteArray *data, const char *bits)
+{
+    int byte = 0, n = 0;
+
+    for (const char *p = bits; *p; ++p) {
+        if (*p == ' ') {
+            continue;
+        }
+        byte = (byte << 1) | (*p == '1');
+        if (++n == 8) {
+            data->append((char)byte);
+            byte = n = 0;
+        }
+    }
+    if (n > 0) {
+        data->append((char)(byte << (8 - n)));
+    }
+}
+
+static void appendSegment(QByteArray *data, unsigned int segNum, int type,
+                          int refSeg, int page, const QByteArray &segData)
+{
+    appendULong(data, segNum);
+    data->append((char)type);
+    if (refSeg >= 0) {
+        data->append((char)0x20);
+        data->append((char)refSeg);
+    } else {
+        data->append((char)0);
+    }
+    data->append((char)page);
+    appendULong(data, segData.size());
+    data->append(segData);
+}
+
+// Segment 0: the symbol dictionary.
+static QByteArray globalsData()
+{
+    QByteArray seg, data;
+
+    seg.append((char)0);        // flags: Huffman, tables D, B and A
+    seg.append((char)1);
+    appendULong(&seg, 3);       // exported symbols
+    appendULong(&seg, 3);       // new symbols
+    appendBits(&seg,
+               "1110 001"       // delta height 5
+               " 1110 000"      // delta width 3
+               " 10"            // delta width 1
+               " 10"            // delta width 1
+               " 111111"        // OOB
+               " 0 0000");      // uncompressed collective bitmap
+    for (int row = 0; row < symHeight; ++row) {
+        QByteArray bits;
+        for (int i = 0; i < 3; ++i) {
+            bits += symRows[i][row];
+        }
+        appendBits(&seg, bits.constData());
+    }
+    appendBits(&seg,
+               "0 0000"         // no symbols skipped
+               " 0 0011");      // then three exported
+    appendSegment(&data, 0, 0, -1, 0, seg);
+    return data;
+}
+
+// Segment 1: page information, segment 2: the text region.
+static QByteArray pageData()
+{
+    QByteArray seg, data;
+
+    appendULong(&seg, pageWidth);
+    appendULong(&seg, pageHeight);
+    appendULong(&seg, 0);
+    appendULong(&seg, 0);
+    seg.append((char)0);
+    seg.append((char)0);
+    seg.append((char)0);
+    appendSegment(&data, 1, 48, -1, 1, seg);
+
+    seg.clear();
+    appendULong(&seg, pageWidth);
+    appendULong(&seg, pageHeight);
+    appendULong(&seg, 0);
+    appendULong(&seg, 0);
+    seg.append((char)0);
+    seg.append((char)0);        // flags: Huffman, top left corner
+    seg.append((char)0x11);
+    seg.append((char)0);        // tables F, H and K
+    seg.append((char)0);
+    appendULong(&seg, 5);       // instances
+    // the symbol ID table: only run code 2 is used, with a 1-bit
+    // prefix, and each symbol has a 2-bit code
+    appendBits(&seg,
+               "0000 0000 0001 0000 0000 0000 0000 0000"
+               " 0000 0000 0000 0000 0000 0000 0000 0000"
+               " 0000 0000 0000 0000 0000 0000 0000 0000"
+               " 0000 0000 0000 0000 0000 0000 0000 0000"
+               " 0000 0000 0000"
+               " 0 0 0");
+    appendBits(&seg,
+               "0"              // initial T 1
+               " 10 1"          // delta T 3: first strip at y = 2
+               " 00 0000001"    // first S 1
+               " 00"            // symbol 0
+               " 11010"         // delta S 2
+               " 01"            // symbol 1
+               " 11010"         // delta S 2
+               " 10"            // symbol 2
+               " 01"            // OOB
+               " 11100 0"       // delta T 7: second strip at y = 9
+               " 00 0000011"    // first S 3 (relative)
+               " 10"            // symbol 2
+               " 11010"         // delta S 2
+               " 00"            // symbol 0
+               " 01");          // OOB
+    appendSegment(&data, 2, 6, 0, 1, seg);
+    return data;
+}
+
+// The decoded image: 1 bits are black, and come out of the stream as 0.
+static QByteArray expectedImage()
+{
+    int rowSize = (pageWidth + 7) / 8;
+    QByteArray image(rowSize * pageHeight, (char)0xff);
+    char *p = image.data();
+
+    for (int i = 0; i < 5; ++i) {
+        int sym = instances[i][0];
+        for (int y = 0; y < symHeight; ++y) {
+            for (int x = 0; x < symWidths[sym]; ++x) {
+                if (symRows[sym][y][x] == '1') {
+                    int px = instances[i][1] + x;
+                    int py = instances[i][2] + y;
+                    p[py * rowSize + px / 8] &= ~(0x80 >> (px % 8));
+                }
+            }
+        }
+    }
+    return image;
+}
+
+void TestJBIG2::initTestCase()
+{
+    globalParams = new GlobalParams();
+}
+
+void TestJBIG2::cleanupTestCase()
+{
+    delete globalParams;
+}
+
+// Objects 3 and 4 are the images, object 5 their JBIG2Globals.
+PDFDoc *TestJBIG2::openPdf(QByteArray *data)
+{
+    TestPdf pdf;
+    QByteArray imageEntries =
+        "/Type /XObject /Subtype /Image /Width " + QByteArray::number(pageWidth) +
+        " /Height " + QByteArray::number(pageHeight) +
+        " /ColorSpace /DeviceGray /BitsPerComponent 1"
+        " /Filter /JBIG2Decode /DecodeParms << /JBIG2Globals 5 0 R >>";
+
+    pdf.addObject("<< /Type /Catalog /Pages 2 0 R >>");
+    pdf.addObject("<< /Type /Pages /Count 0 /Kids [] >>");
+    pdf.addStream(imageEntries, pageData());
+    pdf.addStream(imageEntries, pageData());
+    pdf.addStream("", globalsData());
+    *data = pdf.data();
+    return TestPdf::open(data);
+}
+
+void TestJBIG2::checkImage(PDFDoc *doc, int num, const QByteArray &expected)
+{
+    Object obj;
+    Guchar buf[256];
+
+    doc->getXRef()->fetch(num, 0, &obj);
+    QVERIFY(obj.isStream());
+    Stream *str = obj.getStream();
+    QCOMPARE(str->getKind(), strJBIG2);
+
+    // decode it twice, to go through reset() again
+    for (int pass = 0; pass < 2; ++pass) {
+        str->reset();
+        int n = str->doGetChars(sizeof(buf), buf);
+        QCOMPARE(n, expected.size());
+        QVERIFY(QByteArray((const char *)buf, n) == expected);
+        QCOMPARE(str->getChar(), EOF);
+        str->close();
+    }
+    obj.free();
+}
+
+void TestJBIG2::testSharedGlobals()
+{
+    QByteArray data;
+    QByteArray expected = expectedImage();
+    Ref globalsRef = { 5, 0 };
+
+    PDFDoc *doc = openPdf(&data);
+    QVERIFY(doc->isOk());
+    JBIG2GlobalsCache *cache = doc->getXRef()->getJBIG2GlobalsCache();
+    QVERIFY(cache);
+    QVERIFY(!cache->lookup(globalsRef));
+
+    checkImage(doc, 3, expected);
+
+    // the first image leaves the decoded globals in the cache...
+    JBIG2Globals *globals = cache->lookup(globalsRef);
+    QVERIFY(globals);
+    globals->decRefCnt();
+
+    // ...which the second one decodes with
+    checkImage(doc, 4, expected);
+    QVERIFY(cache->lookup(globalsRef) == globals);
+    globals->decRefCnt();
+
+    delete doc;
+}
+
+// Decoding the same image again, after its globals were dropped from
+// the cache, reads them from the stream once more.
+void TestJBIG2::testReset()
+{
+    QByteArray data;
+    QByteArray expected = expectedImage();
+
+    PDFDoc *doc = openPdf(&data);
+    QVERIFY(doc->isOk());
+    JBIG2GlobalsCache *cache = doc->getXRef()->getJBIG2GlobalsCache();
+
+    checkImage(doc, 3, expected);
+    cache->clear();
+    checkImage(doc, 3, expected);
+    checkImage(doc, 4, expected);
+
+    delete doc;
+}
+
+QTEST_MAIN(TestJBIG2)
+#include "check_jbig2.moc"
@@ -0,0 +1,288 @@
+#include <QtTest/QtTest>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "GlobalParams.h"
+#include "GooThreadPool.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "Stream.h"
+#include "testpdf.h"
+
+class TestJPXThreads : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void testDefault();
+    void testThreaded_data();
+    void testThreaded();
+
+private:
+    PDFDoc *openPdf(QByteArray *data);
+    QByteArray decode(PDFDoc *doc, int num, GBool reduce, int nThreads);
+};
+
+static const int imageWidth = 64;
+static const int imageHeight = 32;
+
+// A 64x32 RGB image: red and green ramps, and a sine pattern in blue.
+// Two 32x32 tiles, 8x8 code-blocks, 2 decomposition levels, 2 layers,
+// lossy 5/3 wavelet, RPCL progression.
+static const unsigned char jpx53Data[] = {
+    0xff, 0x4f, 0xff, 0x51, 0x00, 0x2f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40,
+    0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x07, 0x01, 0x01, 0x07, 0x01, 0x01,
+    0x07, 0x01, 0x01, 0xff, 0x52, 0x00, 0x0c, 0x00, 0x02, 0x00, 0x02, 0x00,
+    0x02, 0x01, 0x01, 0x00, 0x01, 0xff, 0x5c, 0x00, 0x0a, 0x40, 0x40, 0x48,
+    0x48, 0x50, 0x48, 0x48, 0x50, 0xff, 0x64, 0x00, 0x25, 0x00, 0x01, 0x43,
+    0x72, 0x65, 0x61, 0x74, 0x65, 0x64, 0x20, 0x62, 0x79, 0x20, 0x4f, 0x70,
+    0x65, 0x6e, 0x4a, 0x50, 0x45, 0x47, 0x20, 0x76, 0x65, 0x72, 0x73, 0x69,
+    0x6f, 0x6e, 0x20, 0x32, 0x2e, 0x35, 0x2e, 0x34, 0xff, 0x90, 0x00, 0x0a,
+    0x00, 0x00, 0x00, 0x00, 0x01, 0x4c, 0x00, 0x01, 0xff, 0x93, 0xdf, 0x49,
+    0x90, 0x11, 0x6a, 0xa1, 0xe2, 0x11, 0x10, 0x94, 0xcf, 0x39, 0xb5, 0xac,
+    0x2a, 0x50, 0x38, 0x60, 0x2c, 0xb7, 0x23, 0x2a, 0x2b, 0x6f, 0x44, 0x76,
+    0x40, 0xd1, 0xfc, 0x03, 0x00, 0x8e, 0xe3, 0xd4, 0x7d, 0xff, 0x7f, 0xdf,
+    0x31, 0x00, 0x12, 0x8e, 0x2a, 0xd0, 0xf6, 0x0a, 0xdb, 0xc0, 0xd8, 0xde,
+    0xce, 0xea, 0xd5, 0x75, 0xfe, 0x6e, 0xfc, 0x62, 0x80, 0x67, 0x02, 0x16,
+    0x5c, 0x16, 0xa1, 0xfd, 0x0b, 0x2a, 0x7f, 0xcf, 0x88, 0xc8, 0x17, 0xb4,
+    0xe8, 0x44, 0x4a, 0x3d, 0x47, 0xca, 0xee, 0x34, 0x15, 0x40, 0x00, 0x23,
+    0x7e, 0x70, 0xb8, 0x8e, 0xb3, 0x13, 0xb7, 0x7b, 0x42, 0x36, 0x3e, 0xfc,
+    0x87, 0xc0, 0xc4, 0xa7, 0x67, 0x3e, 0x61, 0xb6, 0xac, 0x45, 0x12, 0x35,
+    0x3e, 0x60, 0x04, 0x5f, 0x2d, 0x05, 0x40, 0xa4, 0xbe, 0x76, 0xc4, 0x8f,
+    0x95, 0x0b, 0x15, 0xe6, 0xcc, 0x09, 0x35, 0x7f, 0x1f, 0x80, 0xc0, 0xf8,
+    0x04, 0x00, 0x36, 0xa1, 0x99, 0xae, 0xa0, 0x8c, 0x3d, 0xa6, 0x34, 0xbe,
+    0x50, 0x80, 0x5b, 0x10, 0xdc, 0x57, 0xc3, 0x85, 0x00, 0x36, 0x7d, 0x83,
+    0xe1, 0xe9, 0xfc, 0xc7, 0xe0, 0xf9, 0x8f, 0xc0, 0x42, 0x54, 0xb5, 0x68,
+    0x91, 0xdd, 0xdf, 0xc8, 0x6a, 0x37, 0x16, 0xcc, 0xf2, 0x10, 0x99, 0x86,
+    0x85, 0xf3, 0x12, 0xda, 0xde, 0x61, 0xb9, 0xdf, 0xbb, 0x98, 0xdc, 0x78,
+    0x5c, 0xf6, 0x63, 0x22, 0x42, 0xc1, 0x3f, 0xa2, 0xf4, 0x09, 0x3c, 0x3d,
+    0x17, 0x26, 0xa4, 0xc1, 0x83, 0x72, 0xdd, 0x3a, 0x62, 0xe8, 0x05, 0x65,
+    0xe7, 0x71, 0x96, 0x4b, 0xd1, 0x2d, 0xa2, 0x4b, 0xb3, 0x49, 0x0b, 0x61,
+    0x80, 0xd0, 0x1f, 0x80, 0x47, 0xe0, 0x10, 0x36, 0xa1, 0x99, 0xbf, 0x36,
+    0xa1, 0x99, 0xbf, 0x80, 0xa4, 0x0f, 0xc6, 0x13, 0xf1, 0x84, 0x00, 0x3d,
+    0xa6, 0x34, 0x5f, 0x3d, 0xa6, 0x34, 0x5f, 0x80, 0xd0, 0x7e, 0x31, 0x2f,
+    0xcc, 0x5e, 0x40, 0xfc, 0x03, 0x7e, 0x01, 0x80, 0x36, 0x8d, 0x4a, 0x8f,
+    0x32, 0x13, 0x1f, 0x95, 0xb6, 0x34, 0x9b, 0x4c, 0x5d, 0xc2, 0x60, 0x84,
+    0xdd, 0xdc, 0x33, 0x4c, 0x97, 0xa6, 0x69, 0x24, 0x7e, 0x62, 0x85, 0x7c,
+    0xbc, 0x06, 0x50, 0xbf, 0x47, 0xe6, 0xf4, 0xd4, 0x2b, 0x2c, 0x48, 0xa4,
+    0x05, 0x62, 0xf7, 0x76, 0xff, 0x90, 0x00, 0x0a, 0x00, 0x01, 0x00, 0x00,
+    0x01, 0x51, 0x00, 0x01, 0xff, 0x93, 0xcf, 0x98, 0xb8, 0x27, 0x35, 0x0f,
+    0x26, 0x80, 0x26, 0x1b, 0x34, 0x1b, 0x94, 0x89, 0xf4, 0x9d, 0xa1, 0x8e,
+    0xd7, 0xab, 0xfa, 0xcd, 0x91, 0x93, 0x92, 0x47, 0xfc, 0x03, 0x00, 0x28,
+    0xa0, 0x9a, 0xcf, 0xff, 0x7f, 0xdf, 0x31, 0x00, 0x12, 0x8e, 0x2a, 0xd0,
+    0xf6, 0x0a, 0xdb, 0xc0, 0xd8, 0xde, 0xce, 0xea, 0xd5, 0x75, 0xfe, 0x6e,
+    0xfc, 0x62, 0x80, 0x67, 0x02, 0x16, 0x5c, 0x16, 0xa1, 0xfd, 0x0b, 0x2a,
+    0x7f, 0xcf, 0x88, 0xe0, 0x17, 0xb4, 0xbd, 0x69, 0x94, 0x87, 0x27, 0xf7,
+    0x88, 0x1b, 0x1c, 0x4a, 0x7f, 0x8a, 0x2a, 0x8a, 0xd8, 0x78, 0xd6, 0x31,
+    0x25, 0x93, 0x1c, 0xc5, 0x0a, 0x65, 0x95, 0x8f, 0xfc, 0x87, 0xc0, 0x67,
+    0x1c, 0x2e, 0x8a, 0xdd, 0xb3, 0x5c, 0x24, 0xe5, 0xd5, 0x8f, 0x4e, 0x6e,
+    0xbc, 0x6b, 0xc0, 0x2d, 0x78, 0x02, 0x8f, 0xe6, 0xd2, 0xd8, 0x63, 0x08,
+    0xab, 0x5f, 0x1b, 0xfe, 0xd2, 0x7f, 0x80, 0xc0, 0xf8, 0x04, 0x00, 0x36,
+    0xa1, 0x99, 0xae, 0xa0, 0x8c, 0x3d, 0xa6, 0x34, 0xbe, 0x50, 0x80, 0x5b,
+    0x10, 0xdc, 0x57, 0xc3, 0x85, 0x00, 0x36, 0x7d, 0x83, 0xe1, 0xe9, 0xfc,
+    0xc8, 0x20, 0xf9, 0x8f, 0xc0, 0x44, 0x53, 0xc0, 0x89, 0x1b, 0xc9, 0x11,
+    0xc1, 0x35, 0x9a, 0xef, 0x1a, 0x4e, 0xa5, 0x6a, 0x16, 0x52, 0x8a, 0xc6,
+    0x6c, 0x93, 0xfb, 0x79, 0x84, 0xd8, 0x6b, 0xf2, 0xe2, 0xf4, 0x8a, 0x43,
+    0xcb, 0x83, 0x42, 0xc1, 0x3f, 0xa2, 0xe9, 0xc0, 0xa9, 0xd9, 0x30, 0xdc,
+    0xc6, 0x7e, 0x87, 0x91, 0xe4, 0x3d, 0x6e, 0xbf, 0x96, 0x60, 0xd1, 0xb7,
+    0x35, 0x82, 0x20, 0xd8, 0xed, 0x4b, 0xc2, 0x3a, 0x3f, 0x61, 0xef, 0x80,
+    0xd0, 0x1f, 0x80, 0x47, 0xe0, 0x10, 0x36, 0xa1, 0x99, 0xbf, 0x36, 0xa1,
+    0x99, 0xbf, 0x80, 0xa4, 0x0f, 0xc6, 0x13, 0xf1, 0x84, 0x00, 0x3d, 0xa6,
+    0x34, 0x5f, 0x3d, 0xa6, 0x34, 0x5f, 0x80, 0xe0, 0x89, 0xbf, 0x18, 0x87,
+    0xe7, 0x2b, 0x20, 0x7e, 0x20, 0xdf, 0x0a, 0x18, 0x12, 0x59, 0x05, 0x43,
+    0xf0, 0x36, 0x8d, 0x4a, 0xc0, 0x48, 0xfa, 0xf6, 0x3d, 0x34, 0x9b, 0x4c,
+    0x5d, 0x81, 0x15, 0x3d, 0xed, 0x17, 0x6c, 0xc4, 0xff, 0x11, 0x98, 0x7a,
+    0xe5, 0x05, 0x28, 0x78, 0x08, 0xf7, 0x47, 0xe6, 0xf4, 0xd4, 0x32, 0x9a,
+    0x48, 0xa3, 0x38, 0x98, 0x9a, 0xff, 0xd9
+};
+
+// The same image with the 9/7 wavelet and LRCP progression.
+static const unsigned char jpx97Data[] = {
+    0xff, 0x4f, 0xff, 0x51, 0x00, 0x2f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40,
+    0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x07, 0x01, 0x01, 0x07, 0x01, 0x01,
+    0x07, 0x01, 0x01, 0xff, 0x52, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x02, 0x00,
+    0x02, 0x01, 0x01, 0x00, 0x00, 0xff, 0x5c, 0x00, 0x11, 0x42, 0x5f, 0x52,
+    0x50, 0x05, 0x50, 0x05, 0x50, 0x47, 0x57, 0xd3, 0x57, 0xd3, 0x57, 0x62,
+    0xff, 0x64, 0x00, 0x25, 0x00, 0x01, 0x43, 0x72, 0x65, 0x61, 0x74, 0x65,
+    0x64, 0x20, 0x62, 0x79, 0x20, 0x4f, 0x70, 0x65, 0x6e, 0x4a, 0x50, 0x45,
+    0x47, 0x20, 0x76, 0x65, 0x72, 0x73, 0x69, 0x6f, 0x6e, 0x20, 0x32, 0x2e,
+    0x35, 0x2e, 0x34, 0xff, 0x90, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x02, 0x00, 0x01, 0xff, 0x93, 0xcf, 0x10, 0x11, 0x6a, 0xa1, 0xe2, 0x11,
+    0x10, 0x94, 0xcf, 0xc6, 0x40, 0x11, 0x1d, 0xf6, 0x99, 0xe2, 0x83, 0x80,
+    0x84, 0xc5, 0x58, 0x18, 0x12, 0x35, 0xac, 0xcb, 0xe8, 0xc8, 0x58, 0x0c,
+    0xff, 0x22, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0xfd, 0x44, 0xe0, 0x39,
+    0xb5, 0xac, 0x29, 0x4b, 0x93, 0x30, 0x16, 0x5b, 0x91, 0x95, 0x15, 0xba,
+    0xe2, 0x3c, 0x9a, 0x8c, 0x1b, 0xf3, 0x73, 0xf1, 0xff, 0x6b, 0x01, 0xaf,
+    0xc5, 0x00, 0x4f, 0xc4, 0x12, 0xf1, 0x9a, 0xab, 0x8a, 0xb0, 0xfa, 0x2f,
+    0x61, 0x34, 0xfc, 0xe7, 0x40, 0x7f, 0x0d, 0x14, 0x90, 0x39, 0xbd, 0xf4,
+    0x43, 0x5f, 0x43, 0xfc, 0x3a, 0xcc, 0xcd, 0xa4, 0x7e, 0x23, 0xc0, 0xcf,
+    0x6c, 0x2a, 0x46, 0xa8, 0xaf, 0x2b, 0x78, 0x47, 0x5f, 0x8f, 0xfd, 0x04,
+    0xe0, 0x23, 0x49, 0x6c, 0x9b, 0xf8, 0x01, 0x7b, 0x7a, 0xa9, 0xf3, 0xf5,
+    0xa6, 0x01, 0x54, 0x3c, 0x68, 0xdc, 0x98, 0x68, 0x20, 0xda, 0x94, 0x7b,
+    0x36, 0xa3, 0x62, 0x39, 0x36, 0x1c, 0xd2, 0x36, 0x87, 0x0d, 0x8d, 0xaf,
+    0x0a, 0x38, 0xae, 0x9a, 0xc0, 0x7c, 0x23, 0x80, 0x36, 0xa1, 0x81, 0xcf,
+    0x5d, 0x61, 0x15, 0xa0, 0x7c, 0x23, 0x80, 0x3d, 0xa6, 0x2e, 0x88, 0x66,
+    0xd9, 0x64, 0xc3, 0xe5, 0x1d, 0x07, 0xc6, 0x2c, 0x36, 0xc6, 0xfb, 0xff,
+    0x28, 0xeb, 0xcb, 0x08, 0xc3, 0x45, 0x21, 0x8d, 0x46, 0xf8, 0x42, 0xc1,
+    0x3f, 0xa2, 0xf3, 0xc7, 0x91, 0x23, 0x27, 0x24, 0xde, 0x80, 0xa4, 0x03,
+    0x1e, 0x30, 0x3d, 0xa6, 0x2e, 0x3d, 0xa6, 0x2e, 0xd0, 0x3e, 0x11, 0xf8,
+    0x05, 0x90, 0x18, 0xf8, 0x80, 0x36, 0x83, 0x93, 0xf1, 0x37, 0x48, 0x47,
+    0x60, 0x5f, 0x47, 0xe6, 0xfa, 0x48, 0xa3, 0x37, 0xd8, 0xff, 0x90, 0x00,
+    0x0a, 0x00, 0x01, 0x00, 0x00, 0x01, 0x01, 0x00, 0x01, 0xff, 0x93, 0xc6,
+    0x28, 0x27, 0x35, 0x0f, 0x26, 0x80, 0xc6, 0x40, 0x11, 0x1d, 0xf6, 0x99,
+    0xe2, 0x83, 0x80, 0x84, 0xc6, 0x78, 0x17, 0xb4, 0xbd, 0x69, 0x94, 0x87,
+    0x27, 0xf7, 0x88, 0x1b, 0x1c, 0x4a, 0x7f, 0x8a, 0x2a, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0xfd, 0x44, 0x80, 0x26, 0x1b, 0x34, 0x1b, 0x94, 0x89,
+    0xf4, 0x9d, 0xa1, 0x8e, 0xd7, 0xab, 0xfa, 0xcd, 0x91, 0x93, 0x8d, 0xdf,
+    0xd6, 0x79, 0xad, 0x70, 0xbe, 0x6d, 0x59, 0xcd, 0x67, 0xf9, 0xc0, 0xa5,
+    0x03, 0x44, 0xde, 0x47, 0xde, 0x6b, 0xfc, 0xe7, 0x40, 0x7f, 0x0d, 0x14,
+    0x90, 0x39, 0xbd, 0xf4, 0x43, 0x5f, 0x43, 0xfc, 0x3a, 0xcc, 0xcd, 0xa4,
+    0x7e, 0x23, 0xc0, 0xcf, 0x6c, 0x2a, 0x46, 0xa8, 0xaf, 0x2b, 0x78, 0x47,
+    0x5f, 0x8f, 0xfd, 0x28, 0xc0, 0xcc, 0x3a, 0xc2, 0xc3, 0xa1, 0x90, 0xaf,
+    0x85, 0x5b, 0x46, 0x5a, 0x19, 0xb4, 0x63, 0x46, 0xa0, 0x46, 0x3a, 0x20,
+    0x1f, 0xdb, 0x11, 0x3a, 0x54, 0x59, 0x33, 0xc1, 0x83, 0x1c, 0x58, 0x54,
+    0x7a, 0xf1, 0xad, 0x22, 0xc0, 0x7c, 0x23, 0x80, 0x36, 0xa1, 0x81, 0xcf,
+    0x5d, 0x61, 0x15, 0xa0, 0x7c, 0x23, 0x80, 0x3d, 0xa6, 0x2e, 0x88, 0x66,
+    0xd9, 0x64, 0xc3, 0xe5, 0x1d, 0x07, 0xc6, 0x32, 0x02, 0x20, 0x36, 0x7d,
+    0x84, 0x08, 0x73, 0xf0, 0xe6, 0x43, 0x13, 0xcd, 0xa3, 0x43, 0xc4, 0xf1,
+    0x42, 0xba, 0x08, 0x5b, 0x5a, 0xd4, 0xc1, 0x77, 0xe5, 0x79, 0x9a, 0x49,
+    0x62, 0x02, 0x80, 0xa4, 0x03, 0x1e, 0x30, 0x3d, 0xa6, 0x2e, 0x3d, 0xa6,
+    0x2e, 0xd0, 0x3e, 0x11, 0xf0, 0x92, 0x03, 0xc2, 0x78, 0x40, 0x36, 0x83,
+    0x93, 0xf1, 0x37, 0x48, 0x47, 0x60, 0x47, 0xe5, 0x5f, 0x7b, 0x48, 0xa3,
+    0x38, 0x38, 0xff, 0xd9
+};
+
+static const int jpx53Obj = 3;
+static const int jpx97Obj = 4;
+
+void TestJPXThreads::initTestCase()
+{
+    globalParams = new GlobalParams();
+}
+
+void TestJPXThreads::cleanupTestCase()
+{
+    delete globalParams;
+}
+
+PDFDoc *TestJPXThreads::openPdf(QByteArray *data)
+{
+    TestPdf pdf;
+
+    pdf.addObject("<< /Type /Catalog /Pages 2 0 R >>");
+    pdf.addObject("<< /Type /Pages /Count 0 /Kids [] >>");
+    pdf.addStream("/Type /XObject /Subtype /Image /Width 64 /Height 32"
+                  " /ColorSpace /DeviceRGB /BitsPerComponent 8"
+                  " /Filter /JPXDecode",
+                  QByteArray((const char *)jpx53Data, sizeof(jpx53Data)));
+    pdf.addStream("/Type /XObject /Subtype /Image /Width 64 /Height 32"
+                  " /ColorSpace /DeviceRGB /BitsPerComponent 8"
+                  " /Filter /JPXDecode",
+                  QByteArray((const char *)jpx97Data, sizeof(jpx97Data)));
+    *data = pdf.data();
+    return TestPdf::open(data);
+}
+
+// Decode image <num> with up to <nThreads> threads, at half size if
+// <reduce> is set.
+QByteArray TestJPXThreads::decode(PDFDoc *doc, int num, GBool reduce,
+                                  int nThreads)
+{
+    QByteArray samples;
+    Object obj;
+    int width, height, c;
+
+    globalParams->setJPXDecodeThreads(nThreads);
+    doc->getXRef()->fetch(num, 0, &obj);
+    Stream *str = obj.getStream();
+    width = imageWidth;
+    height = imageHeight;
+    if (reduce) {
+        str->reduceResolution(imageWidth / 2, imageHeight / 2, &width, &height);
+    }
+    str->reset();
+    while ((c = str->getChar()) != EOF) {
+        samples.append((char)c);
+    }
+    str->close();
+    obj.free();
+    globalParams->setJPXDecodeThreads(1);
+    return samples;
+}
+
+// By default images are decoded on the calling thread, and the shared
+// pool doesn't start any workers.
+void TestJPXThreads::testDefault()
+{
+    QByteArray data;
+
+    QCOMPARE(globalParams->getJPXDecodeThreads(), 1);
+    PDFDoc *doc = openPdf(&data);
+    QVERIFY(doc->isOk());
+    QCOMPARE(decode(doc, jpx53Obj, gFalse, 1).size(),
+             imageWidth * imageHeight * 3);
+    QCOMPARE(decode(doc, jpx97Obj, gFalse, 1).size(),
+             imageWidth * imageHeight * 3);
+    QCOMPARE(GooThreadPool::get()->getNumThreads(), 1);
+    delete doc;
+}
+
+void TestJPXThreads::testThreaded_data()
+{
+    QTest::addColumn<int>("num");
+    QTest::addColumn<bool>("reduce");
+
+    QTest::newRow("5/3") << jpx53Obj << false;
+    QTest::newRow("5/3 reduced") << jpx53Obj << true;
+    QTest::newRow("9/7") << jpx97Obj << false;
+    QTest::newRow("9/7 reduced") << jpx97Obj << true;
+}
+
+// Decoding on several threads gives the same bytes as on one.
+void TestJPXThreads::testThreaded()
+{
+    QFETCH(int, num);
+    QFETCH(bool, reduce);
+    QByteArray data;
+    int scale = reduce ? 2 : 1;
+    int width = imageWidth / scale;
+    int height = imageHeight / scale;
+
+    PDFDoc *doc = openPdf(&data);
+    QByteArray serial = decode(doc, num, reduce, 1);
+    QByteArray threaded = decode(doc, num, reduce, 4);
+    QCOMPARE(serial.size(), width * height * 3);
+    QVERIFY(threaded == serial);
+#if GOO_THREAD_POOL_PTHREADS
+    QCOMPARE(GooThreadPool::get()->getNumThreads(), 4);
+#endif
+
+    // and the decoder isn't producing the same garbage both times; the
+    // reduced image is filtered, so it's further from the samples
+    int maxMeanDiff = reduce ? 6 : 2;
+    int sumDiff = 0;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double cx = x * scale + (scale - 1) / 2.0;
+            double cy = y * scale + (scale - 1) / 2.0;
+            int expected[3];
+            expected[0] = (int)(cx * 4);
+            expected[1] = (int)(cy * 8);
+            expected[2] = (int)(128 + 100 * sin(cx / 5) * cos(cy / 7));
+            for (int i = 0; i < 3; ++i) {
+                sumDiff += abs(expected[i] - (unsigned char)serial[(y * width + x) * 3 + i]);
+            }
+        }
+    }
+    QVERIFY(sumDiff <= maxMeanDiff * width * height * 3);
+    delete doc;
+}
+
+QTEST_MAIN(TestJPXThreads)
+#include "check_jpxthreads.moc"
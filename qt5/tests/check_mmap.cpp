@@ -0,0 +1,202 @@
+#include <QtTest/QtTest>
+
+#include "goo/GooString.h"
+#include "ErrorCodes.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "PDFDocFactory.h"
+#include "Stream.h"
+#include "XRef.h"
+#include "testpdf.h"
+
+class TestMmap : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void testMapped();
+    void testFileURI();
+    void testDefault();
+    void testFallback();
+    void testNoGlobalParams();
+
+private:
+    PDFDoc *openFile(const QByteArray &fileName, GBool mapLocalFiles);
+};
+
+void TestMmap::initTestCase()
+{
+    globalParams = new GlobalParams();
+}
+
+void TestMmap::cleanupTestCase()
+{
+    delete globalParams;
+}
+
+// Write a small PDF with a few streams to <file>.
+static bool writePdf(QTemporaryFile *file)
+{
+    TestPdf pdf;
+
+    pdf.addObject("<< /Type /Catalog /Pages 2 0 R >>");
+    pdf.addObject("<< /Type /Pages /Count 1 /Kids [3 0 R] >>");
+    pdf.addObject("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 100 100]"
+                  " /Contents 4 0 R >>");
+    pdf.addStream("", "0 0 1 rg 10 10 80 80 re f\n");
+    pdf.addStream("", QByteArray("0123456789abcdef").repeated(300));
+    pdf.addObject("<< /Name /Last >>");
+    QByteArray data = pdf.data();
+
+    return file->open() &&
+           file->write(data) == data.size() &&
+           file->flush();
+}
+
+PDFDoc *TestMmap::openFile(const QByteArray &fileName, GBool mapLocalFiles)
+{
+    GooString name(fileName.constData());
+    PDFDoc *doc;
+
+    globalParams->setMapLocalFiles(mapLocalFiles);
+    doc = PDFDocFactory().createPDFDoc(name);
+    globalParams->setMapLocalFiles(gFalse);
+    return doc;
+}
+
+static bool isMapped(PDFDoc *doc)
+{
+    return dynamic_cast<MmapStream *>(doc->getBaseStream()) != NULL;
+}
+
+static QByteArray readStream(Stream *str)
+{
+    QByteArray data;
+    int c;
+
+    str->reset();
+    while ((c = str->getChar()) != EOF) {
+        data.append((char)c);
+    }
+    str->close();
+    return data;
+}
+
+// Check that <doc> reads the same objects and stream data as <expected>.
+static bool sameObjects(PDFDoc *doc, PDFDoc *expected)
+{
+    XRef *xref = doc->getXRef();
+    XRef *expectedXRef = expected->getXRef();
+    Object obj1, obj2;
+    bool same;
+
+    if (xref->getNumObjects() != expectedXRef->getNumObjects()) {
+        return false;
+    }
+    same = true;
+    for (int num = 1; same && num < xref->getNumObjects(); ++num) {
+        xref->fetch(num, 0, &obj1);
+        expectedXRef->fetch(num, 0, &obj2);
+        if (obj1.getType() != obj2.getType()) {
+            same = false;
+        } else if (obj1.isStream()) {
+            same = readStream(obj1.getStream()) ==
+                   readStream(obj2.getStream());
+        } else if (obj1.isDict()) {
+            same = obj1.dictGetLength() == obj2.dictGetLength();
+        }
+        obj1.free();
+        obj2.free();
+    }
+    return same;
+}
+
+// With the setting on, a local file is read through a mapping, and
+// reads the same as through a FileStream.
+void TestMmap::testMapped()
+{
+    QTemporaryFile file;
+    QVERIFY(writePdf(&file));
+    QByteArray fileName = file.fileName().toLocal8Bit();
+
+    PDFDoc *mapped = openFile(fileName, gTrue);
+    PDFDoc *unmapped = openFile(fileName, gFalse);
+    QVERIFY(mapped->isOk());
+    QVERIFY(unmapped->isOk());
+    QVERIFY(isMapped(mapped));
+    QVERIFY(!isMapped(unmapped));
+    QCOMPARE(QByteArray(mapped->getFileName()->getCString()), fileName);
+    QCOMPARE(mapped->getNumPages(), 1);
+    QVERIFY(sameObjects(mapped, unmapped));
+
+    delete mapped;
+    delete unmapped;
+}
+
+void TestMmap::testFileURI()
+{
+    QTemporaryFile file;
+    QVERIFY(writePdf(&file));
+    QByteArray fileName = file.fileName().toLocal8Bit();
+
+    PDFDoc *doc = openFile("file://" + fileName, gTrue);
+    QVERIFY(doc->isOk());
+    QVERIFY(isMapped(doc));
+    QCOMPARE(QByteArray(doc->getFileName()->getCString()), fileName);
+    delete doc;
+}
+
+// Mapping is off unless asked for.
+void TestMmap::testDefault()
+{
+    QTemporaryFile file;
+    QVERIFY(writePdf(&file));
+
+    QVERIFY(!globalParams->getMapLocalFiles());
+    GooString name(file.fileName().toLocal8Bit().constData());
+    PDFDoc *doc = PDFDocFactory().createPDFDoc(name);
+    QVERIFY(doc->isOk());
+    QVERIFY(!isMapped(doc));
+    QCOMPARE(doc->getBaseStream()->getKind(), strFile);
+    delete doc;
+}
+
+// A file which can't be mapped is opened the usual way.
+void TestMmap::testFallback()
+{
+    QTemporaryFile file;
+    QVERIFY(file.open());
+
+    // empty files can't be mapped
+    PDFDoc *doc = openFile(file.fileName().toLocal8Bit(), gTrue);
+    QVERIFY(!doc->isOk());
+    QVERIFY(!isMapped(doc));
+    delete doc;
+
+    doc = openFile("/nonexistent/file.pdf", gTrue);
+    QVERIFY(!doc->isOk());
+    QCOMPARE(doc->getErrorCode(), errOpenFile);
+    delete doc;
+}
+
+// The builder can be used without GlobalParams; files aren't mapped
+// then.
+void TestMmap::testNoGlobalParams()
+{
+    GlobalParams *savedGlobalParams = globalParams;
+    QTemporaryFile file;
+    QVERIFY(writePdf(&file));
+
+    GooString name(file.fileName().toLocal8Bit().constData());
+    globalParams = NULL;
+    PDFDoc *doc = PDFDocFactory().createPDFDoc(name);
+    globalParams = savedGlobalParams;
+    QVERIFY(doc->isOk());
+    QVERIFY(!isMapped(doc));
+    delete doc;
+}
+
+QTEST_MAIN(TestMmap)
+#include "check_mmap.moc"
@@ -0,0 +1,208 @@
+#include <QtTest/QtTest>
+
+#include "GlobalParams.h"
+#include "PDFDoc.h"
+#include "Page.h"
+#include "testpdf.h"
+
+class TestPageTree : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void testCountTooLarge();
+    void testCountTooSmall();
+    void testNestedCounts();
+    void testSkippedSubtrees();
+    void testDeepCountError();
+
+private:
+    PDFDoc *openPdf(QByteArray *data, const char **objects, int nObjects);
+    void checkPages(const char **objects, int nObjects, int numPages,
+		    const int *pageObjs, int nPageObjs);
+};
+
+void TestPageTree::initTestCase()
+{
+    globalParams = new GlobalParams();
+}
+
+void TestPageTree::cleanupTestCase()
+{
+    delete globalParams;
+}
+
+// Build a PDF file in <data> from the bodies of objects 1, 2, ...;
+// object 1 is the catalog.
+PDFDoc *TestPageTree::openPdf(QByteArray *data, const char **objects, int nObjects)
+{
+    TestPdf pdf;
+
+    for (int i = 0; i < nObjects; ++i) {
+        pdf.addObject(objects[i]);
+    }
+    *data = pdf.data();
+    return TestPdf::open(data);
+}
+
+// Pages must be numbered in the order of the page tree's leaves, no
+// matter what the /Count entries say or which page is looked up first.
+// <pageObjs> are the object numbers of the leaves.
+void TestPageTree::checkPages(const char **objects, int nObjects, int numPages,
+			      const int *pageObjs, int nPageObjs)
+{
+    for (int reverse = 0; reverse < 2; ++reverse) {
+        QByteArray data;
+        PDFDoc *doc = openPdf(&data, objects, nObjects);
+        QVERIFY(doc->isOk());
+        QCOMPARE(doc->getNumPages(), numPages);
+
+        for (int j = 0; j < numPages; ++j) {
+            int i = reverse ? numPages - j : j + 1;
+            Page *page = doc->getPage(i);
+            if (i <= nPageObjs) {
+                QVERIFY(page);
+                QCOMPARE(page->getNum(), i);
+                QCOMPARE(page->getRef().num, pageObjs[i - 1]);
+            } else {
+                QVERIFY(!page);
+            }
+        }
+        delete doc;
+    }
+}
+
+void TestPageTree::testCountTooLarge()
+{
+    const char *objects[] = {
+        "<< /Type /Catalog /Pages 2 0 R >>",
+        "<< /Type /Pages /Count 3 /Kids [3 0 R 5 0 R] /MediaBox [0 0 100 100] >>",
+        "<< /Type /Pages /Parent 2 0 R /Count 2 /Kids [4 0 R] >>",
+        "<< /Type /Page /Parent 3 0 R >>",
+        "<< /Type /Page /Parent 2 0 R >>"
+    };
+    const int pageObjs[] = { 4, 5 };
+
+    checkPages(objects, 5, 3, pageObjs, 2);
+}
+
+void TestPageTree::testCountTooSmall()
+{
+    const char *objects[] = {
+        "<< /Type /Catalog /Pages 2 0 R >>",
+        "<< /Type /Pages /Count 2 /Kids [3 0 R 6 0 R] /MediaBox [0 0 100 100] >>",
+        "<< /Type /Pages /Parent 2 0 R /Count 1 /Kids [4 0 R 5 0 R] >>",
+        "<< /Type /Page /Parent 3 0 R >>",
+        "<< /Type /Page /Parent 3 0 R >>",
+        "<< /Type /Page /Parent 2 0 R >>"
+    };
+    const int pageObjs[] = { 4, 5, 6 };
+
+    checkPages(objects, 6, 2, pageObjs, 3);
+}
+
+void TestPageTree::testNestedCounts()
+{
+    const char *objects[] = {
+        "<< /Type /Catalog /Pages 2 0 R >>",
+        "<< /Type /Pages /Count 5 /Kids [3 0 R 8 0 R] /MediaBox [0 0 100 100] >>",
+        "<< /Type /Pages /Parent 2 0 R /Count 5 /Kids [4 0 R 5 0 R] >>",
+        "<< /Type /Page /Parent 3 0 R >>",
+        "<< /Type /Pages /Parent 3 0 R /Count 5 /Kids [6 0 R 7 0 R] >>",
+        "<< /Type /Page /Parent 5 0 R >>",
+        "<< /Type /Page /Parent 5 0 R >>",
+        "<< /Type /Page /Parent 2 0 R >>"
+    };
+    const int pageObjs[] = { 4, 6, 7, 8 };
+
+    checkPages(objects, 8, 5, pageObjs, 4);
+}
+
+// A tree of 3 levels with 4 kids per node and correct /Count entries,
+// so that looking up a page skips the subtrees before it.
+void TestPageTree::testSkippedSubtrees()
+{
+    static const int orders[][4] = {
+        { 64, 1, 33, 17 }, { 40, 10, 63, 2 }, { 1, 64, 16, 48 }
+    };
+    TestPdf pdf;
+    QByteArray data;
+    int pageObjs[64];
+
+    // object 2 is the root, objects 3-6 its kids, 7-22 their kids, and
+    // 23-86 the pages
+    pdf.addObject("<< /Type /Catalog /Pages 2 0 R >>");
+    for (int level = 0, first = 2, parentFirst = 0; level < 4; ++level) {
+        int nNodes = 1 << (2 * level);
+        for (int i = 0; i < nNodes; ++i) {
+            int num = first + i;
+            QByteArray parent;
+            if (level > 0) {
+                parent = " /Parent " + QByteArray::number(parentFirst + i / 4) + " 0 R";
+            }
+            if (level == 3) {
+                pageObjs[i] = num;
+                pdf.addObject("<< /Type /Page" + parent + " >>");
+            } else {
+                QByteArray kids;
+                for (int j = 0; j < 4; ++j) {
+                    kids += QByteArray::number(first + nNodes + 4 * i + j) + " 0 R ";
+                }
+                pdf.addObject("<< /Type /Pages" + parent + " /Count " +
+                              QByteArray::number(64 >> (2 * level)) +
+                              " /Kids [" + kids + "] /MediaBox [0 0 100 100] >>");
+            }
+        }
+        parentFirst = first;
+        first += nNodes;
+    }
+    data = pdf.data();
+
+    for (int k = 0; k < 3; ++k) {
+        PDFDoc *doc = TestPdf::open(&data);
+        QCOMPARE(doc->getNumPages(), 64);
+        for (int j = 0; j < 4; ++j) {
+            int i = orders[k][j];
+            Page *page = doc->getPage(i);
+            QVERIFY(page);
+            QCOMPARE(page->getNum(), i);
+            QCOMPARE(page->getRef().num, pageObjs[i - 1]);
+        }
+        for (int i = 1; i <= 64; ++i) {
+            QCOMPARE(doc->findPage(pageObjs[i - 1], 0), i);
+            QCOMPARE(doc->getPage(i)->getRef().num, pageObjs[i - 1]);
+        }
+        delete doc;
+    }
+}
+
+// A wrong /Count two levels below the root is only found when the
+// subtree is walked.  A page looked up before that may have had the
+// wrong number, but from then on pages are numbered in order.
+void TestPageTree::testDeepCountError()
+{
+    const char *objects[] = {
+        "<< /Type /Catalog /Pages 2 0 R >>",
+        "<< /Type /Pages /Count 3 /Kids [3 0 R 6 0 R] /MediaBox [0 0 100 100] >>",
+        "<< /Type /Pages /Parent 2 0 R /Count 2 /Kids [4 0 R] >>",
+        "<< /Type /Pages /Parent 3 0 R /Count 2 /Kids [5 0 R] >>",
+        "<< /Type /Page /Parent 4 0 R >>",
+        "<< /Type /Page /Parent 2 0 R >>"
+    };
+    QByteArray data;
+
+    PDFDoc *doc = openPdf(&data, objects, 6);
+    QCOMPARE(doc->getNumPages(), 3);
+    QVERIFY(doc->getPage(3));
+    QVERIFY(doc->getPage(1));
+    QCOMPARE(doc->getPage(1)->getRef().num, 5);
+    QCOMPARE(doc->getPage(2)->getRef().num, 6);
+    QCOMPARE(doc->getPage(2)->getNum(), 2);
+    QVERIFY(!doc->getPage(3));
+    QCOMPARE(doc->findPage(6, 0), 2);
+    delete doc;
+}
+
+QTEST_MAIN(TestPageTree)
+#include "check_pagetree.moc"
@@ -0,0 +1,254 @@
+#include <QtTest/QtTest>
+
+#include <stdlib.h>
+
+#include "goo/gmem.h"
+#include "Object.h"
+#include "Stream.h"
+
+class TestPredictor : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testRows_data();
+    void testRows();
+    void testTruncated_data();
+    void testTruncated();
+
+private:
+    Stream *openPredicted(QByteArray *data, int colors, int bits, int columns);
+    QByteArray readAll(Stream *str, int chunkSize);
+};
+
+// Image rows are PNG-filtered in the test, stored in an uncompressed
+// zlib stream, and decoded through FlateDecode with a /Predictor of 15,
+// which reads the filter type from each row.
+
+// Bytes per pixel for the PNG filters, and bytes per row of samples.
+static int pixelBytes(int colors, int bits)
+{
+    return (colors * bits + 7) / 8;
+}
+
+static int rowBytes(int colors, int bits, int columns)
+{
+    return (colors * bits * columns + 7) / 8;
+}
+
+// Deterministic sample data: smooth rows alternate with noisy ones, so
+// that the predictors see both small and large differences, and the
+// Paeth predictor sees ties.
+static QByteArray sampleRows(int nRows, int n)
+{
+    QByteArray data;
+    unsigned int seed = 12345;
+
+    for (int y = 0; y < nRows; ++y) {
+        for (int x = 0; x < n; ++x) {
+            seed = seed * 1103515245u + 12345u;
+            int v = (x * 7 + y * 13) + ((seed >> 16) & (y & 1 ? 0xff : 0x07));
+            data.append((char)v);
+        }
+    }
+    return data;
+}
+
+static int paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+
+    if (pa <= pb && pa <= pc) {
+        return a;
+    } else if (pb <= pc) {
+        return b;
+    }
+    return c;
+}
+
+// PNG-filter <raw> (<nRows> rows of <n> bytes), using filter type
+// <types>[row % 5] for each row.
+static QByteArray pngFilter(const QByteArray &raw, int nRows, int n, int bpp,
+                            const int *types)
+{
+    QByteArray out;
+
+    for (int y = 0; y < nRows; ++y) {
+        int type = types[y % 5];
+        out.append((char)type);
+        for (int x = 0; x < n; ++x) {
+            int cur = (unsigned char)raw[y * n + x];
+            int left = x >= bpp ? (unsigned char)raw[y * n + x - bpp] : 0;
+            int up = y > 0 ? (unsigned char)raw[(y - 1) * n + x] : 0;
+            int upLeft = (x >= bpp && y > 0) ?
+                         (unsigned char)raw[(y - 1) * n + x - bpp] : 0;
+            int pred;
+            switch (type) {
+            case 1: pred = left; break;
+            case 2: pred = up; break;
+            case 3: pred = (left + up) / 2; break;
+            case 4: pred = paeth(left, up, upLeft); break;
+            default: pred = 0; break;
+            }
+            out.append((char)(cur - pred));
+        }
+    }
+    return out;
+}
+
+// An uncompressed zlib stream holding <data>.
+static QByteArray zlibStored(const QByteArray &data)
+{
+    QByteArray out("\x78\x01", 2);
+    unsigned int a = 1, b = 0;
+    int pos = 0;
+
+    do {
+        int len = data.size() - pos > 65535 ? 65535 : data.size() - pos;
+        char header[5];
+        header[0] = pos + len == data.size() ? 1 : 0;
+        header[1] = (char)(len & 0xff);
+        header[2] = (char)(len >> 8);
+        header[3] = (char)(~len & 0xff);
+        header[4] = (char)((~len >> 8) & 0xff);
+        out.append(QByteArray(header, 5));
+        out.append(data.mid(pos, len));
+        pos += len;
+    } while (pos < data.size());
+
+    for (int i = 0; i < data.size(); ++i) {
+        a = (a + (unsigned char)data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    char adler[4] = { (char)(b >> 8), (char)b, (char)(a >> 8), (char)a };
+    out.append(QByteArray(adler, 4));
+    return out;
+}
+
+Stream *TestPredictor::openPredicted(QByteArray *data, int colors, int bits,
+                                     int columns)
+{
+    Object dict, parms, obj;
+
+    parms.initDict((XRef *)NULL);
+    obj.initInt(15);
+    parms.dictAdd(copyString("Predictor"), &obj);
+    obj.initInt(colors);
+    parms.dictAdd(copyString("Colors"), &obj);
+    obj.initInt(bits);
+    parms.dictAdd(copyString("BitsPerComponent"), &obj);
+    obj.initInt(columns);
+    parms.dictAdd(copyString("Columns"), &obj);
+
+    dict.initDict((XRef *)NULL);
+    obj.initName("FlateDecode");
+    dict.dictAdd(copyString("Filter"), &obj);
+    dict.dictAdd(copyString("DecodeParms"), &parms);
+    Stream *str = new MemStream(data->data(), 0, data->size(), &dict);
+    return str->addFilters(&dict);
+}
+
+QByteArray TestPredictor::readAll(Stream *str, int chunkSize)
+{
+    QByteArray result;
+    Guchar *buf = (Guchar *)gmalloc(chunkSize);
+    int n, c;
+
+    str->reset();
+    if (chunkSize == 1) {
+        while ((c = str->getChar()) != EOF) {
+            result.append((char)c);
+        }
+    } else {
+        while ((n = str->doGetChars(chunkSize, buf)) > 0) {
+            result += QByteArray((const char *)buf, n);
+        }
+    }
+    gfree(buf);
+    return result;
+}
+
+void TestPredictor::testRows_data()
+{
+    QTest::addColumn<int>("colors");
+    QTest::addColumn<int>("bits");
+    QTest::addColumn<int>("columns");
+
+    QTest::newRow("gray 8") << 1 << 8 << 17;
+    QTest::newRow("rgb 8") << 3 << 8 << 13;
+    QTest::newRow("cmyk 8") << 4 << 8 << 6;
+    QTest::newRow("gray 16") << 1 << 16 << 9;
+    QTest::newRow("rgb 16") << 3 << 16 << 5;
+    QTest::newRow("gray 1") << 1 << 1 << 21;
+    QTest::newRow("gray 4") << 1 << 4 << 7;
+    QTest::newRow("cmyk 2") << 4 << 2 << 5;
+}
+
+// Every PNG filter type, in every order, un-filters to the original
+// rows, both through getChar and through block reads.
+void TestPredictor::testRows()
+{
+    QFETCH(int, colors);
+    QFETCH(int, bits);
+    QFETCH(int, columns);
+    const int nRows = 40;
+    const int types[3][5] = {
+        { 0, 1, 2, 3, 4 }, { 4, 3, 2, 1, 0 }, { 2, 4, 1, 4, 3 }
+    };
+    const int chunkSizes[] = { 1, 3, 1000 };
+    int n = rowBytes(colors, bits, columns);
+    QByteArray raw = sampleRows(nRows, n);
+
+    for (int t = 0; t < 3; ++t) {
+        QByteArray data = zlibStored(pngFilter(raw, nRows, n,
+                                               pixelBytes(colors, bits),
+                                               types[t]));
+        for (int c = 0; c < 3; ++c) {
+            Stream *str = openPredicted(&data, colors, bits, columns);
+            QVERIFY(readAll(str, chunkSizes[c]) == raw);
+            delete str;
+        }
+    }
+}
+
+void TestPredictor::testTruncated_data()
+{
+    QTest::addColumn<int>("type");
+
+    QTest::newRow("none") << 0;
+    QTest::newRow("sub") << 1;
+    QTest::newRow("up") << 2;
+    QTest::newRow("average") << 3;
+    QTest::newRow("paeth") << 4;
+}
+
+// A last row cut short is still returned whole: the bytes present are
+// un-filtered, and the rest repeats the row above.  A row with only its
+// filter type byte is dropped.
+void TestPredictor::testTruncated()
+{
+    QFETCH(int, type);
+    const int colors = 3, bits = 8, columns = 11, nRows = 6;
+    const int types[5] = { type, type, type, type, type };
+    int n = rowBytes(colors, bits, columns);
+    QByteArray raw = sampleRows(nRows, n);
+    QByteArray filtered = pngFilter(raw, nRows, n, pixelBytes(colors, bits),
+                                    types);
+
+    for (int cut = 0; cut < n; cut += 5) {
+        // keep <cut> sample bytes of the last row
+        QByteArray data = zlibStored(filtered.left((nRows - 1) * (n + 1) +
+                                                   1 + cut));
+        QByteArray expected = raw.left((nRows - 1) * n);
+        if (cut > 0) {
+            expected += raw.mid((nRows - 1) * n, cut);
+            expected += raw.mid((nRows - 2) * n + cut, n - cut);
+        }
+        Stream *str = openPredicted(&data, colors, bits, columns);
+        QVERIFY(readAll(str, 1000) == expected);
+        delete str;
+    }
+}
+
+QTEST_MAIN(TestPredictor)
+#include "check_predictor.moc"
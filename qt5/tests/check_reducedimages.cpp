@@ -0,0 +1,394 @@
+#include <QtTest/QtTest>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "GlobalParams.h"
+#include "Object.h"
+#include "PDFDoc.h"
+#include "Stream.h"
+#include "SplashOutputDev.h"
+#include "splash/SplashBitmap.h"
+#include "testpdf.h"
+
+class TestReducedImages : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void testReduced_data();
+    void testReduced();
+    void testSticky_data();
+    void testSticky();
+    void testDevice();
+
+private:
+    PDFDoc *openPdf(QByteArray *data);
+    GBool decode(PDFDoc *doc, int num, int minWidth, int minHeight,
+                 int *width, int *height, QByteArray *samples);
+    SplashBitmap *render(PDFDoc *doc, GBool reducedImages);
+};
+
+static const int imageWidth = 64;
+static const int imageHeight = 48;
+
+// A 64x48 RGB image: red and green ramps, and a sine pattern in blue.
+// Written by libjpeg at quality 90.
+static const unsigned char jpegData[] = {
+    0xff, 0xd8, 0xff, 0xe0, 0x00, 0x10, 0x4a, 0x46, 0x49, 0x46, 0x00, 0x01,
+    0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0xff, 0xdb, 0x00, 0x43,
+    0x00, 0x03, 0x02, 0x02, 0x03, 0x02, 0x02, 0x03, 0x03, 0x03, 0x03, 0x04,
+    0x03, 0x03, 0x04, 0x05, 0x08, 0x05, 0x05, 0x04, 0x04, 0x05, 0x0a, 0x07,
+    0x07, 0x06, 0x08, 0x0c, 0x0a, 0x0c, 0x0c, 0x0b, 0x0a, 0x0b, 0x0b, 0x0d,
+    0x0e, 0x12, 0x10, 0x0d, 0x0e, 0x11, 0x0e, 0x0b, 0x0b, 0x10, 0x16, 0x10,
+    0x11, 0x13, 0x14, 0x15, 0x15, 0x15, 0x0c, 0x0f, 0x17, 0x18, 0x16, 0x14,
+    0x18, 0x12, 0x14, 0x15, 0x14, 0xff, 0xdb, 0x00, 0x43, 0x01, 0x03, 0x04,
+    0x04, 0x05, 0x04, 0x05, 0x09, 0x05, 0x05, 0x09, 0x14, 0x0d, 0x0b, 0x0d,
+    0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14,
+    0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14,
+    0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14,
+    0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14,
+    0x14, 0x14, 0xff, 0xc0, 0x00, 0x11, 0x08, 0x00, 0x30, 0x00, 0x40, 0x03,
+    0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01, 0xff, 0xc4, 0x00,
+    0x1a, 0x00, 0x01, 0x00, 0x02, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x04, 0x05, 0x02, 0x03, 0x07,
+    0x08, 0xff, 0xc4, 0x00, 0x23, 0x10, 0x00, 0x01, 0x03, 0x04, 0x01, 0x05,
+    0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+    0x02, 0x05, 0x03, 0x04, 0x06, 0x11, 0x21, 0x12, 0x13, 0x22, 0x31, 0x32,
+    0xa1, 0x42, 0xff, 0xc4, 0x00, 0x19, 0x01, 0x01, 0x01, 0x00, 0x03, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05,
+    0x07, 0x04, 0x06, 0x09, 0x08, 0xff, 0xc4, 0x00, 0x26, 0x11, 0x00, 0x00,
+    0x04, 0x04, 0x05, 0x05, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x05, 0x11, 0x02, 0x03, 0x04, 0x13, 0x06, 0x12,
+    0x14, 0x16, 0x24, 0x07, 0x21, 0x22, 0x23, 0x61, 0x26, 0xff, 0xda, 0x00,
+    0x0c, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11, 0x00, 0x3f, 0x00, 0xf0,
+    0x14, 0x5c, 0x58, 0xa6, 0x06, 0xc2, 0x43, 0x42, 0x3d, 0xae, 0x00, 0x69,
+    0x49, 0x64, 0x59, 0xa4, 0x78, 0x0a, 0xce, 0xc6, 0xc5, 0xce, 0x70, 0x1a,
+    0x5e, 0x80, 0x9b, 0xd4, 0x02, 0xa1, 0x2d, 0x1b, 0xfc, 0x00, 0xa6, 0xd5,
+    0xe6, 0x68, 0x9c, 0x54, 0x18, 0x3e, 0xef, 0xa6, 0xa9, 0x16, 0xd8, 0xcb,
+    0x8b, 0x87, 0x8a, 0x77, 0x15, 0x07, 0xdd, 0xd6, 0xda, 0x94, 0x59, 0xe2,
+    0xed, 0x2d, 0x07, 0xa5, 0x6b, 0x75, 0x09, 0x47, 0x88, 0x0f, 0x52, 0x46,
+    0x2a, 0xc9, 0x8b, 0x36, 0x9a, 0x17, 0x00, 0xa2, 0x60, 0x0d, 0x32, 0x36,
+    0xd4, 0xc6, 0x3a, 0x38, 0x31, 0xa0, 0x10, 0xae, 0xdb, 0x8f, 0x8a, 0x5f,
+    0xca, 0xdb, 0x4a, 0x3c, 0xb0, 0x8e, 0x10, 0xd1, 0xaf, 0x6d, 0x4f, 0x59,
+    0x98, 0xaa, 0xa6, 0xa8, 0xdf, 0x63, 0x71, 0x1d, 0x91, 0xa1, 0xed, 0xf9,
+    0x59, 0x0c, 0x7c, 0xd4, 0x3c, 0x35, 0x21, 0x8e, 0x8e, 0x35, 0x08, 0x1a,
+    0x4b, 0xa2, 0xf1, 0xe1, 0x50, 0x0f, 0x1f, 0xc4, 0x15, 0x4a, 0xc6, 0xed,
+    0xf1, 0x23, 0x15, 0x54, 0xc5, 0x2b, 0x0d, 0xdc, 0x79, 0xe5, 0xb8, 0xe9,
+    0xa8, 0x7e, 0x55, 0x95, 0x86, 0x32, 0xe6, 0xb8, 0x1e, 0x95, 0xd0, 0x63,
+    0x31, 0xd1, 0x50, 0x0d, 0xb5, 0x20, 0xa1, 0x8c, 0x35, 0xa0, 0x1e, 0x9f,
+    0xc5, 0x9d, 0x3b, 0x0e, 0xeb, 0xb9, 0x8f, 0xf4, 0x72, 0x99, 0x31, 0x6f,
+    0x2b, 0x42, 0xe0, 0x5c, 0x4c, 0x2f, 0x6b, 0x5b, 0x6a, 0x55, 0x67, 0x62,
+    0xd0, 0xd1, 0xc2, 0xb1, 0x10, 0xdd, 0xaf, 0xe5, 0x49, 0xb5, 0xb1, 0x70,
+    0x70, 0x1a, 0x42, 0x4e, 0xc6, 0x7b, 0x7f, 0x8c, 0xe2, 0xaa, 0x9b, 0x5b,
+    0x75, 0xa2, 0x71, 0x0c, 0x44, 0x8a, 0xa3, 0x86, 0xad, 0x94, 0xb1, 0xa2,
+    0xf3, 0xc3, 0x52, 0xe8, 0xa8, 0x93, 0x54, 0x8d, 0xb5, 0x2e, 0x8e, 0xc6,
+    0x83, 0xda, 0x0f, 0x4a, 0x06, 0x7f, 0xea, 0xfd, 0x8e, 0x2a, 0xc9, 0xaa,
+    0xd6, 0x18, 0x9c, 0x73, 0xe8, 0xdc, 0x6c, 0xb0, 0x8d, 0xb1, 0x30, 0x8a,
+    0x8a, 0x14, 0x80, 0xd8, 0x4a, 0x69, 0xe3, 0x61, 0x83, 0x7d, 0x3f, 0x8b,
+    0x60, 0x8a, 0x34, 0xcf, 0xca, 0x0a, 0x74, 0xed, 0xa5, 0xe4, 0xe2, 0xaa,
+    0x9a, 0xab, 0x7d, 0xbb, 0x8e, 0x3b, 0x17, 0x18, 0x29, 0x81, 0xb6, 0xa4,
+    0x14, 0x2c, 0x5a, 0xe6, 0xfa, 0x52, 0xc4, 0x59, 0xa6, 0x78, 0x0a, 0xca,
+    0xc2, 0x3d, 0xce, 0x70, 0xe1, 0x66, 0xcf, 0xea, 0x01, 0xd0, 0xf0, 0xdf,
+    0xe0, 0xe5, 0x3a, 0x6d, 0x5e, 0x66, 0x89, 0xc5, 0x50, 0x83, 0xee, 0xfa,
+    0x6a, 0x95, 0x6d, 0x8b, 0xb8, 0xb8, 0x1e, 0x94, 0xe2, 0x26, 0x0f, 0xba,
+    0x06, 0xda, 0x95, 0x59, 0xe3, 0x0d, 0x2d, 0x1e, 0x08, 0x79, 0xa9, 0x45,
+    0x88, 0x39, 0x26, 0x62, 0xa8, 0x9a, 0xb3, 0x69, 0x89, 0xc0, 0x18, 0xbc,
+    0x7c, 0xd2, 0x23, 0x6d, 0x4b, 0xa3, 0xa3, 0xc3, 0x00, 0x1a, 0x57, 0xc2,
+    0x00, 0x53, 0x1f, 0x2b, 0x3a, 0x71, 0xc5, 0x8e, 0xd6, 0x90, 0x15, 0x0b,
+    0xdb, 0x53, 0xd6, 0x46, 0x2a, 0xc9, 0x8a, 0x17, 0xd8, 0xdc, 0x46, 0xa7,
+    0x1c, 0x2a, 0x0f, 0x4b, 0x6b, 0x71, 0xe3, 0x54, 0xf0, 0xd5, 0x7f, 0x19,
+    0x1a, 0x5e, 0x46, 0xc2, 0x63, 0x15, 0x8f, 0x0a, 0x80, 0x6d, 0xa8, 0x29,
+    0x8b, 0x1b, 0xb7, 0xc4, 0xcc, 0x55, 0x53, 0x54, 0xac, 0x37, 0x71, 0xff,
+    0xd9
+};
+
+// The green channel of the same image, losslessly coded in a bare
+// JPEG 2000 codestream with 3 decomposition levels.
+static const unsigned char jpxData[] = {
+    0xff, 0x4f, 0xff, 0x51, 0x00, 0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40,
+    0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x07, 0x01, 0x01, 0xff, 0x52, 0x00,
+    0x0c, 0x00, 0x00, 0x00, 0x01, 0x00, 0x03, 0x04, 0x04, 0x00, 0x01, 0xff,
+    0x5c, 0x00, 0x0d, 0x40, 0x40, 0x48, 0x48, 0x50, 0x48, 0x48, 0x50, 0x48,
+    0x48, 0x50, 0xff, 0x64, 0x00, 0x25, 0x00, 0x01, 0x43, 0x72, 0x65, 0x61,
+    0x74, 0x65, 0x64, 0x20, 0x62, 0x79, 0x20, 0x4f, 0x70, 0x65, 0x6e, 0x4a,
+    0x50, 0x45, 0x47, 0x20, 0x76, 0x65, 0x72, 0x73, 0x69, 0x6f, 0x6e, 0x20,
+    0x32, 0x2e, 0x35, 0x2e, 0x34, 0xff, 0x90, 0x00, 0x0a, 0x00, 0x00, 0x00,
+    0x00, 0x02, 0x76, 0x00, 0x01, 0xff, 0x93, 0xcf, 0xb4, 0xb4, 0x11, 0x1d,
+    0xf0, 0x76, 0xd7, 0x1e, 0x54, 0xe8, 0x06, 0xbe, 0x5e, 0xef, 0x92, 0x91,
+    0x26, 0x4d, 0x1f, 0x6e, 0x2b, 0x38, 0x7b, 0xcf, 0xb0, 0x33, 0x4e, 0x75,
+    0x8e, 0xf1, 0xdb, 0xe9, 0x38, 0xa9, 0x7f, 0xb0, 0x44, 0xec, 0x1e, 0x8d,
+    0xe2, 0x95, 0xd9, 0x1d, 0x04, 0x51, 0x2f, 0xc0, 0xf9, 0x0b, 0x41, 0xf3,
+    0x9a, 0x80, 0x7c, 0x29, 0x80, 0x38, 0x14, 0xa2, 0xd2, 0xb0, 0xd2, 0x2b,
+    0x8d, 0x21, 0xf9, 0xc2, 0x7b, 0x7c, 0x26, 0x63, 0x5b, 0xd8, 0x8b, 0x7f,
+    0xf0, 0xf1, 0xd7, 0x5f, 0x24, 0x86, 0xa3, 0x66, 0x48, 0x62, 0xb3, 0x42,
+    0x44, 0x7c, 0xb7, 0x38, 0xf1, 0x3b, 0xf2, 0xfc, 0x89, 0x2c, 0xe4, 0x83,
+    0xd2, 0x8f, 0xdf, 0x2f, 0x50, 0x82, 0xcb, 0x3d, 0x05, 0x29, 0x40, 0xe4,
+    0x9b, 0x74, 0xb1, 0x3d, 0x72, 0xcd, 0x13, 0xb7, 0xac, 0x7c, 0xdb, 0x77,
+    0xc0, 0x7c, 0x35, 0xf0, 0x3e, 0x46, 0x30, 0x07, 0x6b, 0x00, 0x62, 0x00,
+    0x95, 0xec, 0x6a, 0x95, 0xe0, 0xc5, 0xe7, 0x1b, 0xf6, 0x25, 0x7b, 0x9c,
+    0x5c, 0x25, 0x1e, 0x3b, 0x44, 0xd3, 0x7b, 0x54, 0xdb, 0xa5, 0x1d, 0xee,
+    0x1f, 0xf0, 0xf8, 0x84, 0xa8, 0xea, 0x19, 0x7b, 0xfc, 0x9e, 0x48, 0x86,
+    0x10, 0x59, 0xeb, 0xba, 0x2a, 0x39, 0x09, 0xff, 0x7f, 0x91, 0xf6, 0x74,
+    0xc1, 0xae, 0x36, 0x30, 0xed, 0xa9, 0xd6, 0xc6, 0x71, 0x21, 0xa3, 0xee,
+    0x42, 0x5c, 0x94, 0x22, 0x22, 0x13, 0xc1, 0x43, 0xbf, 0xd7, 0xbd, 0xa1,
+    0x33, 0x50, 0x83, 0xa1, 0x48, 0x60, 0x3d, 0xea, 0xf1, 0x5c, 0x4f, 0xd5,
+    0xea, 0xf1, 0x69, 0xdd, 0x0b, 0x16, 0x63, 0x43, 0xd2, 0x20, 0x09, 0xc9,
+    0x74, 0xd2, 0xc0, 0x97, 0xed, 0xa0, 0x02, 0x58, 0x34, 0x5f, 0xf7, 0xf1,
+    0xb0, 0xf8, 0x6b, 0x73, 0xde, 0xe7, 0x86, 0x13, 0x5d, 0x85, 0x0f, 0xe0,
+    0xcc, 0x3c, 0xb3, 0xbc, 0x71, 0xe7, 0xa1, 0xd7, 0xb0, 0xe3, 0x05, 0x61,
+    0xcd, 0xd0, 0x03, 0x08, 0x15, 0x29, 0xc0, 0x3b, 0xb6, 0xc0, 0x7c, 0x3b,
+    0xa4, 0x00, 0xbd, 0xa8, 0xad, 0x71, 0x80, 0xf9, 0xa2, 0x7e, 0xef, 0x69,
+    0x89, 0xa0, 0x7d, 0x26, 0x75, 0xba, 0x01, 0x65, 0x13, 0x3c, 0xab, 0x84,
+    0x4f, 0xbc, 0x8d, 0x80, 0x80, 0x42, 0x76, 0x3d, 0xe6, 0x8c, 0x81, 0x6d,
+    0xde, 0x4f, 0x86, 0x39, 0x6b, 0x01, 0x4b, 0x8d, 0x44, 0x22, 0xc3, 0x89,
+    0x9a, 0x3e, 0x2a, 0xb8, 0x11, 0xcc, 0x13, 0x02, 0xa0, 0x02, 0x38, 0x6b,
+    0x23, 0x6c, 0x6e, 0x56, 0x2b, 0x13, 0xad, 0x4f, 0xa2, 0x1d, 0xe1, 0x51,
+    0xf0, 0x43, 0x44, 0xd0, 0x36, 0x02, 0xe1, 0x22, 0x44, 0xae, 0x5d, 0xbf,
+    0x24, 0x9e, 0x30, 0x3e, 0xf8, 0xfa, 0x32, 0x0f, 0x47, 0x44, 0xa7, 0x37,
+    0x77, 0x69, 0x01, 0x56, 0xbc, 0xa0, 0x75, 0x4e, 0xf1, 0xa4, 0xf3, 0xff,
+    0x0c, 0x08, 0x8f, 0xa3, 0x4c, 0xd8, 0x35, 0x51, 0xe1, 0xec, 0x56, 0x87,
+    0x89, 0xee, 0xba, 0x69, 0x40, 0x3f, 0x80, 0xc0, 0x7d, 0x18, 0xbd, 0xbb,
+    0x7b, 0x3e, 0x79, 0xdc, 0x05, 0x96, 0xdf, 0x54, 0x4b, 0x72, 0x02, 0x40,
+    0xde, 0x50, 0x73, 0xeb, 0xf1, 0xa7, 0xb0, 0x48, 0x01, 0x8a, 0x0a, 0xad,
+    0x9c, 0x22, 0x39, 0x2b, 0x56, 0x87, 0xec, 0x0a, 0x9c, 0xf4, 0xc8, 0x9f,
+    0x75, 0x59, 0x79, 0xdb, 0x53, 0x91, 0x46, 0xb1, 0xaa, 0xb4, 0x40, 0xcd,
+    0x5c, 0x3d, 0x56, 0xeb, 0x10, 0x37, 0x90, 0x42, 0x37, 0x4d, 0xd3, 0x00,
+    0x10, 0x76, 0xcb, 0x16, 0x24, 0xab, 0x53, 0xfd, 0x9c, 0x08, 0xc5, 0x2d,
+    0x96, 0xd0, 0xa8, 0xf0, 0xa3, 0x76, 0x6b, 0xb9, 0x3e, 0x6e, 0xa2, 0xb8,
+    0xda, 0x31, 0x42, 0xe0, 0x2a, 0x4d, 0x80, 0xbe, 0xb1, 0x41, 0x20, 0x67,
+    0xb5, 0x04, 0x46, 0xdb, 0x87, 0x55, 0x48, 0xc2, 0x0d, 0xbf, 0x51, 0x39,
+    0x84, 0x1d, 0xff, 0x65, 0x54, 0xda, 0xc0, 0xf9, 0x83, 0xe5, 0x79, 0x80,
+    0xf0, 0x42, 0x21, 0x1e, 0x08, 0xfc, 0x5c, 0x68, 0xe4, 0x26, 0xd8, 0xfd,
+    0x6a, 0x1b, 0x3f, 0x77, 0x85, 0x62, 0x2f, 0x90, 0x12, 0x9d, 0x1b, 0x73,
+    0x1c, 0xe7, 0x65, 0x69, 0x8c, 0xc4, 0xaf, 0x02, 0xbb, 0x45, 0xdc, 0x87,
+    0x0b, 0xb2, 0x2e, 0x61, 0xa6, 0x6b, 0x8a, 0x19, 0x46, 0x31, 0x26, 0xcc,
+    0x50, 0x72, 0xec, 0x6f, 0x53, 0xcf, 0x34, 0xc6, 0xb4, 0xc7, 0xe7, 0x8b,
+    0x7b, 0x01, 0x76, 0x56, 0xdd, 0x64, 0x1a, 0x61, 0xd3, 0xab, 0x8b, 0x38,
+    0x0a, 0x50, 0xc4, 0x6c, 0x79, 0x53, 0x8d, 0xd8, 0xa2, 0xf7, 0x47, 0xff,
+    0xd9
+};
+
+static const int jpegObj = 4;
+static const int jpxObj = 5;
+
+void TestReducedImages::initTestCase()
+{
+    globalParams = new GlobalParams();
+}
+
+void TestReducedImages::cleanupTestCase()
+{
+    delete globalParams;
+}
+
+// One page, which draws both images at a quarter of their size.
+PDFDoc *TestReducedImages::openPdf(QByteArray *data)
+{
+    TestPdf pdf;
+
+    pdf.addObject("<< /Type /Catalog /Pages 2 0 R >>");
+    pdf.addObject("<< /Type /Pages /Count 1 /Kids [3 0 R] >>");
+    pdf.addObject("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 40 20]"
+                  " /Contents 6 0 R"
+                  " /Resources << /XObject << /Im1 4 0 R /Im2 5 0 R >> >> >>");
+    pdf.addStream("/Type /XObject /Subtype /Image /Width 64 /Height 48"
+                  " /ColorSpace /DeviceRGB /BitsPerComponent 8"
+                  " /Filter /DCTDecode",
+                  QByteArray((const char *)jpegData, sizeof(jpegData)));
+    pdf.addStream("/Type /XObject /Subtype /Image /Width 64 /Height 48"
+                  " /ColorSpace /DeviceGray /BitsPerComponent 8"
+                  " /Filter /JPXDecode",
+                  QByteArray((const char *)jpxData, sizeof(jpxData)));
+    pdf.addStream("", "q 16 0 0 12 2 4 cm /Im1 Do Q\n"
+                      "q 16 0 0 12 22 4 cm /Im2 Do Q\n");
+    *data = pdf.data();
+    return TestPdf::open(data);
+}
+
+// Decode image <num>, at a reduced resolution no smaller than
+// <minWidth> x <minHeight> if <minWidth> is not 0.  Returns true if the
+// stream did reduce the resolution.
+GBool TestReducedImages::decode(PDFDoc *doc, int num, int minWidth, int minHeight,
+                                int *width, int *height, QByteArray *samples)
+{
+    Object obj;
+    GBool reduced;
+    int c;
+
+    doc->getXRef()->fetch(num, 0, &obj);
+    Stream *str = obj.getStream();
+    *width = imageWidth;
+    *height = imageHeight;
+    reduced = minWidth && str->reduceResolution(minWidth, minHeight, width, height);
+    str->reset();
+    while ((c = str->getChar()) != EOF) {
+        samples->append((char)c);
+    }
+    str->close();
+    obj.free();
+    return reduced;
+}
+
+void TestReducedImages::testReduced_data()
+{
+    QTest::addColumn<int>("num");
+    QTest::addColumn<int>("nComps");
+    QTest::addColumn<int>("maxMeanDiff");
+    QTest::addColumn<int>("maxDiff");
+
+    QTest::newRow("DCT") << jpegObj << 3 << 2 << 12;
+    QTest::newRow("JPX") << jpxObj << 1 << 8 << 16;
+}
+
+// The reduced decode is close to, but not the same as, the full decode
+// box-filtered down to the same size.  JPX is further off, since the
+// wavelet low-pass filter is wider than the box.
+void TestReducedImages::testReduced()
+{
+    QFETCH(int, num);
+    QFETCH(int, nComps);
+    QFETCH(int, maxMeanDiff);
+    QFETCH(int, maxDiff);
+    QByteArray data, full, reduced;
+    int width, height, fullWidth, fullHeight;
+
+    PDFDoc *doc = openPdf(&data);
+    QVERIFY(doc->isOk());
+    QVERIFY(!decode(doc, num, 0, 0, &fullWidth, &fullHeight, &full));
+    QCOMPARE(full.size(), imageWidth * imageHeight * nComps);
+
+    if (!decode(doc, num, 16, 12, &width, &height, &reduced)) {
+        // the decoder built into this library can't reduce
+        delete doc;
+        return;
+    }
+    QCOMPARE(width, 16);
+    QCOMPARE(height, 12);
+    QCOMPARE(reduced.size(), width * height * nComps);
+
+    int sumDiff = 0, worstDiff = 0;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            for (int i = 0; i < nComps; ++i) {
+                int sum = 0;
+                for (int yy = 0; yy < 4; ++yy) {
+                    for (int xx = 0; xx < 4; ++xx) {
+                        sum += (unsigned char)full[((y * 4 + yy) * imageWidth + x * 4 + xx) * nComps + i];
+                    }
+                }
+                int diff = abs((sum + 8) / 16 - (unsigned char)reduced[(y * width + x) * nComps + i]);
+                sumDiff += diff;
+                if (diff > worstDiff) {
+                    worstDiff = diff;
+                }
+            }
+        }
+    }
+    QVERIFY(sumDiff <= maxMeanDiff * width * height * nComps);
+    QVERIFY(worstDiff <= maxDiff);
+    delete doc;
+}
+
+void TestReducedImages::testSticky_data()
+{
+    QTest::addColumn<int>("num");
+
+    QTest::newRow("DCT") << jpegObj;
+    QTest::newRow("JPX") << jpxObj;
+}
+
+// reduceResolution stays in effect when the stream is reset again.
+void TestReducedImages::testSticky()
+{
+    QFETCH(int, num);
+    QByteArray data;
+    Object obj;
+    int width, height, c;
+
+    PDFDoc *doc = openPdf(&data);
+    doc->getXRef()->fetch(num, 0, &obj);
+    Stream *str = obj.getStream();
+    width = imageWidth;
+    height = imageHeight;
+    if (!str->reduceResolution(16, 12, &width, &height)) {
+        obj.free();
+        delete doc;
+        return;
+    }
+
+    QByteArray passes[3];
+    for (int pass = 0; pass < 3; ++pass) {
+        str->reset();
+        // stop half way through once, which must not matter either
+        while ((pass != 1 || passes[pass].size() < 100) &&
+               (c = str->getChar()) != EOF) {
+            passes[pass].append((char)c);
+        }
+        str->close();
+    }
+    QVERIFY(passes[0].size() == width * height * (num == jpegObj ? 3 : 1));
+    QVERIFY(passes[2] == passes[0]);
+    QVERIFY(passes[1] == passes[0].left(100));
+    obj.free();
+    delete doc;
+}
+
+SplashBitmap *TestReducedImages::render(PDFDoc *doc, GBool reducedImages)
+{
+    SplashColor paper;
+    SplashOutputDev *out;
+    SplashBitmap *bitmap;
+
+    paper[0] = paper[1] = paper[2] = 0xff;
+    out = new SplashOutputDev(splashModeRGB8, 4, gFalse, paper);
+    if (reducedImages) {
+        out->setReducedImages(gTrue);
+    }
+    out->startDoc(doc);
+    doc->displayPage(out, 1, 72, 72, 0, gFalse, gTrue, gFalse);
+    bitmap = out->takeBitmap();
+    delete out;
+    return bitmap;
+}
+
+// Reduced decoding is off unless asked for, and changes the rendered
+// page only slightly.
+void TestReducedImages::testDevice()
+{
+    QByteArray data;
+    SplashColor paper;
+
+    paper[0] = paper[1] = paper[2] = 0xff;
+    SplashOutputDev *out = new SplashOutputDev(splashModeRGB8, 4, gFalse, paper);
+    QVERIFY(!out->useReducedImages());
+    out->setReducedImages(gTrue);
+    QVERIFY(out->useReducedImages());
+    delete out;
+
+    PDFDoc *doc = openPdf(&data);
+    SplashBitmap *full = render(doc, gFalse);
+    SplashBitmap *reduced = render(doc, gTrue);
+    QCOMPARE(reduced->getWidth(), full->getWidth());
+    QCOMPARE(reduced->getHeight(), full->getHeight());
+    int worstDiff = 0;
+    for (int y = 0; y < full->getHeight(); ++y) {
+        SplashColorPtr p = full->getDataPtr() + y * full->getRowSize();
+        SplashColorPtr q = reduced->getDataPtr() + y * reduced->getRowSize();
+        for (int x = 0; x < full->getWidth() * 3; ++x) {
+            if (abs(p[x] - q[x]) > worstDiff) {
+                worstDiff = abs(p[x] - q[x]);
+            }
+        }
+    }
+    QVERIFY(worstDiff <= 24);
+    delete full;
+    delete reduced;
+    delete doc;
+}
+
+QTEST_MAIN(TestReducedImages)
+#include "check_reducedimages.moc"
@@ -0,0 +1,213 @@
+#include <QtTest/QtTest>
+
+#include <string.h>
+
+#include "splash/Splash.h"
+#include "splash/SplashBitmap.h"
+#include "splash/SplashGlyphBitmap.h"
+#include "splash/SplashPath.h"
+#include "splash/SplashPattern.h"
+
+class TestSpans : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testSpans_data();
+    void testSpans();
+
+private:
+    SplashBitmap *render(SplashColorMode mode, GBool antialias,
+                         SplashCoord alpha, GBool spans);
+};
+
+// Each scene is drawn twice, compositing whole spans and compositing
+// one pixel at a time, and the two bitmaps must be identical.
+
+static const int width = 61;
+static const int height = 47;
+
+static int pixelBytes(SplashColorMode mode)
+{
+    switch (mode) {
+    case splashModeMono8:
+        return 1;
+    case splashModeRGB8:
+    case splashModeBGR8:
+        return 3;
+    case splashModeXBGR8:
+        return 4;
+#if SPLASH_CMYK
+    case splashModeCMYK8:
+        return 4;
+    case splashModeDeviceN8:
+        return SPOT_NCOMPS + 4;
+#endif
+    default:
+        return 0;
+    }
+}
+
+// Set every component of <color>, so that each one is checked.
+static void makeColor(SplashColor color, int seed)
+{
+    for (int i = 0; i < splashMaxColorComps; ++i) {
+        color[i] = (Guchar)(seed * 37 + i * 71 + 13);
+    }
+}
+
+static void setFillColor(Splash *splash, int seed)
+{
+    SplashColor color;
+
+    makeColor(color, seed);
+    splash->setFillPattern(new SplashSolidColor(color));
+}
+
+static void fillPolygon(Splash *splash, const SplashCoord *points, int n,
+                        GBool eo)
+{
+    SplashPath path;
+
+    path.moveTo(points[0], points[1]);
+    for (int i = 1; i < n; ++i) {
+        path.lineTo(points[2 * i], points[2 * i + 1]);
+    }
+    path.close();
+    splash->fill(&path, eo);
+}
+
+// An anti-aliased glyph with every shape value from 0 to 255.
+static void fillGlyph(Splash *splash, SplashCoord x, SplashCoord y)
+{
+    Guchar data[16 * 16];
+    SplashGlyphBitmap glyph;
+
+    for (int i = 0; i < 16 * 16; ++i) {
+        data[i] = (Guchar)i;
+    }
+    glyph.x = 0;
+    glyph.y = 0;
+    glyph.w = 16;
+    glyph.h = 16;
+    glyph.aa = gTrue;
+    glyph.data = data;
+    glyph.freeData = gFalse;
+    splash->fillGlyph(x, y, &glyph);
+}
+
+SplashBitmap *TestSpans::render(SplashColorMode mode, GBool antialias,
+                                SplashCoord alpha, GBool spans)
+{
+    // spans of every length, pixel and sub-pixel edges, overlapping
+    // fills over a partly transparent background
+    static const SplashCoord triangle[] = { 2, 3, 58, 9, 20, 44 };
+    static const SplashCoord sliver[] = { 5, 40, 55.3, 2, 55.7, 2.4, 5.4, 40.4 };
+    static const SplashCoord rect[] = { 10.5, 10.25, 40.75, 10.25,
+                                        40.75, 30.5, 10.5, 30.5 };
+    static const SplashCoord star[] = { 30, 2, 42, 44, 8, 16, 52, 16, 18, 44 };
+    static const SplashCoord wide[] = { -5, 20, 70, 21, 70, 26, -5, 25 };
+    SplashBitmap *bitmap;
+    Splash *splash;
+    SplashColor color;
+
+    bitmap = new SplashBitmap(width, height, 1, mode, gTrue);
+    splash = new Splash(bitmap, antialias);
+    splash->setSpanCompositing(spans);
+    makeColor(color, 0);
+    splash->clear(color, 0x40);
+
+    splash->setFillAlpha(alpha);
+    setFillColor(splash, 1);
+    fillPolygon(splash, triangle, 3, gFalse);
+    setFillColor(splash, 2);
+    fillPolygon(splash, sliver, 4, gFalse);
+    setFillColor(splash, 3);
+    fillPolygon(splash, rect, 4, gFalse);
+    setFillColor(splash, 4);
+    fillPolygon(splash, star, 5, gTrue);
+    setFillColor(splash, 5);
+    fillPolygon(splash, wide, 4, gFalse);
+    setFillColor(splash, 6);
+    fillGlyph(splash, 3, 28);
+    fillGlyph(splash, 40, 5);
+
+    // the same fills inside a clip
+    splash->saveState();
+    splash->clipToRect(15.5, 5.5, 45.5, 35.5);
+    splash->setFillAlpha(1 - alpha / 2);
+    setFillColor(splash, 7);
+    fillPolygon(splash, star, 5, gFalse);
+    setFillColor(splash, 8);
+    fillPolygon(splash, sliver, 4, gFalse);
+    splash->restoreState();
+
+    delete splash;
+    return bitmap;
+}
+
+void TestSpans::testSpans_data()
+{
+    QTest::addColumn<int>("mode");
+    QTest::addColumn<bool>("antialias");
+    QTest::addColumn<double>("alpha");
+
+    const SplashColorMode modes[] = {
+        splashModeMono8, splashModeRGB8, splashModeBGR8, splashModeXBGR8,
+#if SPLASH_CMYK
+        splashModeCMYK8, splashModeDeviceN8,
+#endif
+    };
+    const char *names[] = {
+        "mono8", "rgb8", "bgr8", "xbgr8",
+#if SPLASH_CMYK
+        "cmyk8", "devicen8",
+#endif
+    };
+    const double alphas[] = { 1, 0.6 };
+    for (unsigned int m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+        for (int aa = 0; aa < 2; ++aa) {
+            for (int a = 0; a < 2; ++a) {
+                QByteArray name = QByteArray(names[m]) +
+                                  (aa ? " aa" : "") +
+                                  (a ? " alpha" : "");
+                QTest::newRow(name.constData())
+                    << (int)modes[m] << (bool)aa << alphas[a];
+            }
+        }
+    }
+}
+
+void TestSpans::testSpans()
+{
+    QFETCH(int, mode);
+    QFETCH(bool, antialias);
+    QFETCH(double, alpha);
+    SplashColorMode colorMode = (SplashColorMode)mode;
+    int n = width * pixelBytes(colorMode);
+
+    SplashBitmap *spans = render(colorMode, antialias, alpha, gTrue);
+    SplashBitmap *pixels = render(colorMode, antialias, alpha, gFalse);
+
+    // ignore the row padding, which isn't drawn
+    bool drawn = false;
+    for (int y = 0; y < height; ++y) {
+        SplashColorPtr p = spans->getDataPtr() + y * spans->getRowSize();
+        SplashColorPtr q = pixels->getDataPtr() + y * pixels->getRowSize();
+        QVERIFY2(memcmp(p, q, n) == 0,
+                 QByteArray("color differs in row ") + QByteArray::number(y));
+        Guchar *pa = spans->getAlphaPtr() + y * width;
+        Guchar *qa = pixels->getAlphaPtr() + y * width;
+        QVERIFY2(memcmp(pa, qa, width) == 0,
+                 QByteArray("alpha differs in row ") + QByteArray::number(y));
+        for (int x = 0; x < width; ++x) {
+            drawn = drawn || pa[x] != 0x40;
+        }
+    }
+    QVERIFY(drawn);
+
+    delete spans;
+    delete pixels;
+}
+
+QTEST_MAIN(TestSpans)
+#include "check_spans.moc"
@@ -0,0 +1,246 @@
+#include <QtTest/QtTest>
+
+#include <string.h>
+
+#include "splash/SplashBitmap.h"
+#include "splash/SplashPath.h"
+#include "splash/SplashXPath.h"
+#include "splash/SplashXPathScanner.h"
+
+class TestXPathScanner : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testSpans_data();
+    void testSpans();
+    void testAALines_data();
+    void testAALines();
+
+private:
+    void addRows();
+};
+
+// Each path is scanned twice: one line after the other, from the top,
+// which uses the active edge list, and starting with the last line,
+// which makes the scanner compute the intersections for all the lines
+// at once, as it did before the active edge list was added.  Both
+// must find the same spans.
+
+enum TestPath { pathStar, pathPolygon, pathCurves, pathRects };
+
+static unsigned int nextRandom(unsigned int *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 8;
+}
+
+// A coordinate in [<lo>, <hi>), in steps of 1/8, so that many
+// vertices are on pixel and sub-pixel lines.
+static SplashCoord randomCoord(unsigned int *seed, int lo, int hi)
+{
+    return lo + (SplashCoord)(nextRandom(seed) % ((hi - lo) * 8)) / 8;
+}
+
+static SplashPath *makePath(int which)
+{
+    SplashPath *path = new SplashPath();
+    unsigned int seed = 2468;
+
+    switch (which) {
+    case pathStar:
+        path->moveTo(60, 3.5);
+        path->lineTo(95.2, 110);
+        path->lineTo(4.4, 40.3);
+        path->lineTo(119.7, 39.8);
+        path->lineTo(27.1, 109.6);
+        path->close();
+        break;
+    case pathPolygon:
+        // long enough to be radix sorted, and partly at negative
+        // coordinates
+        path->moveTo(randomCoord(&seed, -10, 150), randomCoord(&seed, -10, 120));
+        for (int i = 0; i < 400; ++i) {
+            path->lineTo(randomCoord(&seed, -10, 150),
+                         randomCoord(&seed, -10, 120));
+        }
+        path->close();
+        break;
+    case pathCurves:
+        for (int i = 0; i < 6; ++i) {
+            SplashCoord cx = randomCoord(&seed, 20, 120);
+            SplashCoord cy = randomCoord(&seed, 20, 90);
+            SplashCoord r = randomCoord(&seed, 5, 30);
+            SplashCoord k = r * 0.5523;
+            path->moveTo(cx + r, cy);
+            path->curveTo(cx + r, cy + k, cx + k, cy + r, cx, cy + r);
+            path->curveTo(cx - k, cy + r, cx - r, cy + k, cx - r, cy);
+            path->curveTo(cx - r, cy - k, cx - k, cy - r, cx, cy - r);
+            path->curveTo(cx + k, cy - r, cx + r, cy - k, cx + r, cy);
+            path->close();
+        }
+        break;
+    case pathRects:
+        // horizontal and vertical segments, many on pixel lines
+        for (int i = 0; i < 40; ++i) {
+            SplashCoord x0 = randomCoord(&seed, 0, 100);
+            SplashCoord y0 = randomCoord(&seed, 0, 80);
+            SplashCoord x1 = x0 + randomCoord(&seed, 0, 40);
+            SplashCoord y1 = y0 + randomCoord(&seed, 0, 40);
+            if (i & 1) {
+                x0 = (int)x0;
+                y1 = (int)y1;
+            }
+            path->moveTo(x0, y0);
+            path->lineTo(x1, y0);
+            path->lineTo(x1, y1);
+            path->lineTo(x0, y1);
+            path->close();
+        }
+        break;
+    }
+    return path;
+}
+
+static SplashXPath *makeXPath(int which, GBool aa)
+{
+    SplashCoord matrix[6] = { 1, 0, 0, 1, 0, 0 };
+    SplashPath *path = makePath(which);
+
+    SplashXPath *xPath = new SplashXPath(path, matrix, 0.1, gTrue);
+    if (aa) {
+        xPath->aaScale();
+    }
+    xPath->sort();
+    delete path;
+    return xPath;
+}
+
+// Everything the scanner reports about line <y>.
+static QByteArray scanLine(SplashXPathScanner *scanner, int y,
+                           int xMin, int xMax)
+{
+    QByteArray result;
+    int x0, x1;
+
+    while (scanner->getNextSpan(y, &x0, &x1)) {
+        result += QByteArray::number(x0) + "-" + QByteArray::number(x1) + " ";
+    }
+    scanner->getSpanBounds(y, &x0, &x1);
+    result += "[" + QByteArray::number(x0) + "," + QByteArray::number(x1) +
+              "] ";
+    for (int x = xMin - 1; x <= xMax + 1; ++x) {
+        result.append(scanner->test(x, y) ? '1' : '0');
+    }
+    for (int x = xMin; x <= xMax; x += 7) {
+        result.append(scanner->testSpan(x, x + 6, y) ? '1' : '0');
+    }
+    return result;
+}
+
+void TestXPathScanner::addRows()
+{
+    QTest::addColumn<int>("path");
+    QTest::addColumn<bool>("eo");
+    QTest::addColumn<bool>("clipped");
+
+    const char *names[] = { "star", "polygon", "curves", "rects" };
+    for (int i = 0; i < 4; ++i) {
+        for (int eo = 0; eo < 2; ++eo) {
+            for (int clipped = 0; clipped < 2; ++clipped) {
+                QByteArray name = QByteArray(names[i]) +
+                                  (eo ? " eo" : "") +
+                                  (clipped ? " clipped" : "");
+                QTest::newRow(name.constData())
+                    << i << (bool)eo << (bool)clipped;
+            }
+        }
+    }
+}
+
+void TestXPathScanner::testSpans_data()
+{
+    addRows();
+}
+
+void TestXPathScanner::testSpans()
+{
+    QFETCH(int, path);
+    QFETCH(bool, eo);
+    QFETCH(bool, clipped);
+    SplashXPath *xPath = makeXPath(path, gFalse);
+    int clipYMin = clipped ? 17 : -1000, clipYMax = clipped ? 70 : 1000;
+    int xMin, yMin, xMax, yMax;
+
+    SplashXPathScanner *scanner = new SplashXPathScanner(xPath, eo,
+                                                        clipYMin, clipYMax);
+    SplashXPathScanner *allLines = new SplashXPathScanner(xPath, eo,
+                                                         clipYMin, clipYMax);
+    scanner->getBBox(&xMin, &yMin, &xMax, &yMax);
+    QVERIFY(yMax - yMin > 40);
+    QCOMPARE((bool)scanner->hasPartialClip(), clipped);
+    allLines->test(xMin, yMax);
+    allLines->test(xMin, yMin);
+
+    int nSpans = 0;
+    for (int y = yMin - 1; y <= yMax + 1; ++y) {
+        QByteArray line = scanLine(scanner, y, xMin, xMax);
+        QVERIFY2(line == scanLine(allLines, y, xMin, xMax),
+                 QByteArray("line ") + QByteArray::number(y));
+        nSpans += line.count('-');
+    }
+    QVERIFY(nSpans > (yMax - yMin) / 2);
+
+    delete scanner;
+    delete allLines;
+    delete xPath;
+}
+
+void TestXPathScanner::testAALines_data()
+{
+    addRows();
+}
+
+// renderAALine reads splashAASize lines of intersections per pixel row.
+void TestXPathScanner::testAALines()
+{
+    QFETCH(int, path);
+    QFETCH(bool, eo);
+    QFETCH(bool, clipped);
+    SplashXPath *xPath = makeXPath(path, gTrue);
+    int clipYMin = clipped ? 17 * splashAASize : -1000;
+    int clipYMax = clipped ? 70 * splashAASize - 1 : 1000;
+    int xMin, yMin, xMax, yMax, x0, x1, x0b, x1b;
+    const int width = 200;
+
+    SplashXPathScanner *scanner = new SplashXPathScanner(xPath, eo,
+                                                        clipYMin, clipYMax);
+    SplashXPathScanner *allLines = new SplashXPathScanner(xPath, eo,
+                                                         clipYMin, clipYMax);
+    SplashBitmap *aaBuf = new SplashBitmap(splashAASize * width, splashAASize,
+                                           1, splashModeMono1, gFalse);
+    SplashBitmap *aaBufB = new SplashBitmap(splashAASize * width, splashAASize,
+                                            1, splashModeMono1, gFalse);
+    int size = aaBuf->getRowSize() * splashAASize;
+    scanner->getBBoxAA(&xMin, &yMin, &xMax, &yMax);
+    allLines->renderAALine(aaBufB, &x0b, &x1b, yMax);
+
+    bool drawn = false;
+    for (int y = yMin; y <= yMax; ++y) {
+        scanner->renderAALine(aaBuf, &x0, &x1, y);
+        allLines->renderAALine(aaBufB, &x0b, &x1b, y);
+        QVERIFY2(x0 == x0b && x1 == x1b &&
+                 !memcmp(aaBuf->getDataPtr(), aaBufB->getDataPtr(), size),
+                 QByteArray("line ") + QByteArray::number(y));
+        drawn = drawn || x0 <= x1;
+    }
+    QVERIFY(drawn);
+
+    delete aaBuf;
+    delete aaBufB;
+    delete scanner;
+    delete allLines;
+    delete xPath;
+}
+
+QTEST_MAIN(TestXPathScanner)
+#include "check_xpathscanner.moc"
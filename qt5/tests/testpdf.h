@@ -0,0 +1,83 @@
+//========================================================================
+//
+// testpdf.h
+//
+// Builds small PDF files in memory for the unit tests.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef TESTPDF_H
+#define TESTPDF_H
+
+#include <stdio.h>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+
+#include "Object.h"
+#include "Stream.h"
+#include "PDFDoc.h"
+
+class TestPdf
+{
+public:
+    // Add an object with the body <body>.  Objects are numbered from 1,
+    // in the order they are added; the number is returned.
+    int addObject(const QByteArray &body)
+    {
+        objects.append(body);
+        return objects.size();
+    }
+
+    // Add a stream object with the dictionary entries <entries> (the
+    // /Length entry is added here) and the data <data>.
+    int addStream(const QByteArray &entries, const QByteArray &data)
+    {
+        QByteArray body = "<< " + entries + " /Length " +
+                          QByteArray::number(data.size()) + " >>\nstream\n";
+        return addObject(body + data + "\nendstream");
+    }
+
+    // The whole file, with object <rootNum> as the catalog.
+    QByteArray data(int rootNum = 1) const
+    {
+        QList<int> offsets;
+        QByteArray file = "%PDF-1.4\n";
+        char buf[32];
+
+        for (int i = 0; i < objects.size(); ++i) {
+            offsets.append(file.size());
+            file += QByteArray::number(i + 1) + " 0 obj\n";
+            file += objects[i];
+            file += "\nendobj\n";
+        }
+        int xrefOffset = file.size();
+        file += "xref\n0 " + QByteArray::number(objects.size() + 1) +
+                "\n0000000000 65535 f \n";
+        for (int i = 0; i < offsets.size(); ++i) {
+            sprintf(buf, "%010d 00000 n \n", offsets[i]);
+            file += buf;
+        }
+        file += "trailer\n<< /Size " + QByteArray::number(objects.size() + 1) +
+                " /Root " + QByteArray::number(rootNum) + " 0 R >>\nstartxref\n" +
+                QByteArray::number(xrefOffset) + "\n%%EOF\n";
+        return file;
+    }
+
+    // Open the file in <file>, which must stay alive as long as the
+    // document.
+    static PDFDoc *open(QByteArray *file)
+    {
+        Object obj;
+
+        obj.initNull();
+        return new PDFDoc(new MemStream(file->data(), 0, file->size(), &obj));
+    }
+
+private:
+    QList<QByteArray> objects;
+};
+
+#endif
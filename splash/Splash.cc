@@ -163,6 +163,11 @@ struct SplashPipe {
 
   // the "run" function
   void (Splash::*run)(SplashPipe *pipe);
+
+  // span versions of the "run" function, which composite <n> pixels
+  // at once -- NULL if there is no span version of "run"
+  void (Splash::*runSimpleSpan)(SplashPipe *pipe, int n);
+  void (Splash::*runAASpan)(SplashPipe *pipe, Guchar *shape, int n);
 };
 
 SplashPipeResultColorCtrl Splash::pipeResultColorNoAlphaBlend[] = {
@@ -244,6 +249,28 @@ inline void Splash::updateModY(int y) {
   }
 }
 
+//------------------------------------------------------------------------
+// band
+//------------------------------------------------------------------------
+
+void Splash::setBand(int yMin, int yMax) {
+  bandYMin = yMin < 0 ? 0 : yMin;
+  bandYMax = yMax >= bitmap->height ? bitmap->height - 1 : yMax;
+}
+
+// Trim the <*h> rows drawn at <*yDest> from the rows starting at <*ySrc>
+// of a source bitmap to the band.
+inline void Splash::bandRows(int *ySrc, int *yDest, int *h) {
+  if (*yDest < bandYMin) {
+    *ySrc += bandYMin - *yDest;
+    *h -= bandYMin - *yDest;
+    *yDest = bandYMin;
+  }
+  if (*yDest + *h - 1 > bandYMax) {
+    *h = bandYMax - *yDest + 1;
+  }
+}
+
 //------------------------------------------------------------------------
 // pipeline
 //------------------------------------------------------------------------
@@ -300,22 +327,30 @@ inline void Splash::pipeInit(SplashPipe *pipe, int x, int y,
 
   // select the 'run' function
   pipe->run = &Splash::pipeRun;
+  pipe->runSimpleSpan = NULL;
+  pipe->runAASpan = NULL;
   if (!pipe->pattern && pipe->noTransparency && !state->blendFunc) {
     if (bitmap->mode == splashModeMono1 && !pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunSimpleMono1;
     } else if (bitmap->mode == splashModeMono8 && pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunSimpleMono8;
+      pipe->runSimpleSpan = &Splash::pipeRunSimpleSpanMono8;
     } else if (bitmap->mode == splashModeRGB8 && pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunSimpleRGB8;
+      pipe->runSimpleSpan = &Splash::pipeRunSimpleSpanRGB8;
     } else if (bitmap->mode == splashModeXBGR8 && pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunSimpleXBGR8;
+      pipe->runSimpleSpan = &Splash::pipeRunSimpleSpanXBGR8;
     } else if (bitmap->mode == splashModeBGR8 && pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunSimpleBGR8;
+      pipe->runSimpleSpan = &Splash::pipeRunSimpleSpanBGR8;
 #if SPLASH_CMYK
     } else if (bitmap->mode == splashModeCMYK8 && pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunSimpleCMYK8;
+      pipe->runSimpleSpan = &Splash::pipeRunSimpleSpanCMYK8;
     } else if (bitmap->mode == splashModeDeviceN8 && pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunSimpleDeviceN8;
+      pipe->runSimpleSpan = &Splash::pipeRunSimpleSpanDeviceN8;
 #endif
     }
   } else if (!pipe->pattern && !pipe->noTransparency && !state->softMask &&
@@ -326,20 +361,30 @@ inline void Splash::pipeInit(SplashPipe *pipe, int x, int y,
       pipe->run = &Splash::pipeRunAAMono1;
     } else if (bitmap->mode == splashModeMono8 && pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunAAMono8;
+      pipe->runAASpan = &Splash::pipeRunAASpanMono8;
     } else if (bitmap->mode == splashModeRGB8 && pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunAARGB8;
+      pipe->runAASpan = &Splash::pipeRunAASpanRGB8;
     } else if (bitmap->mode == splashModeXBGR8 && pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunAAXBGR8;
+      pipe->runAASpan = &Splash::pipeRunAASpanXBGR8;
     } else if (bitmap->mode == splashModeBGR8 && pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunAABGR8;
+      pipe->runAASpan = &Splash::pipeRunAASpanBGR8;
 #if SPLASH_CMYK
     } else if (bitmap->mode == splashModeCMYK8 && pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunAACMYK8;
+      pipe->runAASpan = &Splash::pipeRunAASpanCMYK8;
     } else if (bitmap->mode == splashModeDeviceN8 && pipe->destAlphaPtr) {
       pipe->run = &Splash::pipeRunAADeviceN8;
+      pipe->runAASpan = &Splash::pipeRunAASpanDeviceN8;
 #endif
     }
   }
+  if (!spanCompositing) {
+    pipe->runSimpleSpan = NULL;
+    pipe->runAASpan = NULL;
+  }
 }
 
 // general case
@@ -1321,6 +1366,422 @@ void Splash::pipeRunAADeviceN8(SplashPipe *pipe) {
 }
 #endif
 
+// Span versions of the special cases above.  These composite <n>
+// pixels starting at the pipe's current position (which must have
+// been set with pipeSetXY), and leave the pipe just past the span.
+// The source color is fetched, and run through the transfer
+// functions, once per span instead of once per pixel.
+
+// span version of pipeRunSimpleMono8
+void Splash::pipeRunSimpleSpanMono8(SplashPipe *pipe, int n) {
+  memset(pipe->destColorPtr, state->grayTransfer[pipe->cSrc[0]], n);
+  memset(pipe->destAlphaPtr, 255, n);
+  pipe->destColorPtr += n;
+  pipe->destAlphaPtr += n;
+  pipe->x += n;
+}
+
+// span version of pipeRunSimpleRGB8
+void Splash::pipeRunSimpleSpanRGB8(SplashPipe *pipe, int n) {
+  SplashColorPtr p;
+  Guchar cResult0, cResult1, cResult2;
+  int i;
+
+  cResult0 = state->rgbTransferR[pipe->cSrc[0]];
+  cResult1 = state->rgbTransferG[pipe->cSrc[1]];
+  cResult2 = state->rgbTransferB[pipe->cSrc[2]];
+  p = pipe->destColorPtr;
+  for (i = 0; i < n; ++i) {
+    p[0] = cResult0;
+    p[1] = cResult1;
+    p[2] = cResult2;
+    p += 3;
+  }
+  memset(pipe->destAlphaPtr, 255, n);
+  pipe->destColorPtr = p;
+  pipe->destAlphaPtr += n;
+  pipe->x += n;
+}
+
+// span version of pipeRunSimpleXBGR8
+void Splash::pipeRunSimpleSpanXBGR8(SplashPipe *pipe, int n) {
+  SplashColorPtr p;
+  Guchar cResult0, cResult1, cResult2;
+  int i;
+
+  cResult0 = state->rgbTransferR[pipe->cSrc[0]];
+  cResult1 = state->rgbTransferG[pipe->cSrc[1]];
+  cResult2 = state->rgbTransferB[pipe->cSrc[2]];
+  p = pipe->destColorPtr;
+  for (i = 0; i < n; ++i) {
+    p[0] = cResult2;
+    p[1] = cResult1;
+    p[2] = cResult0;
+    p[3] = 255;
+    p += 4;
+  }
+  memset(pipe->destAlphaPtr, 255, n);
+  pipe->destColorPtr = p;
+  pipe->destAlphaPtr += n;
+  pipe->x += n;
+}
+
+// span version of pipeRunSimpleBGR8
+void Splash::pipeRunSimpleSpanBGR8(SplashPipe *pipe, int n) {
+  SplashColorPtr p;
+  Guchar cResult0, cResult1, cResult2;
+  int i;
+
+  cResult0 = state->rgbTransferR[pipe->cSrc[0]];
+  cResult1 = state->rgbTransferG[pipe->cSrc[1]];
+  cResult2 = state->rgbTransferB[pipe->cSrc[2]];
+  p = pipe->destColorPtr;
+  for (i = 0; i < n; ++i) {
+    p[0] = cResult2;
+    p[1] = cResult1;
+    p[2] = cResult0;
+    p += 3;
+  }
+  memset(pipe->destAlphaPtr, 255, n);
+  pipe->destColorPtr = p;
+  pipe->destAlphaPtr += n;
+  pipe->x += n;
+}
+
+#if SPLASH_CMYK
+// span version of pipeRunSimpleCMYK8
+void Splash::pipeRunSimpleSpanCMYK8(SplashPipe *pipe, int n) {
+  SplashColorPtr p;
+  Guchar cResult[4];
+  int i, cp;
+
+  cResult[0] = state->cmykTransferC[pipe->cSrc[0]];
+  cResult[1] = state->cmykTransferM[pipe->cSrc[1]];
+  cResult[2] = state->cmykTransferY[pipe->cSrc[2]];
+  cResult[3] = state->cmykTransferK[pipe->cSrc[3]];
+  for (cp = 0; cp < 4; ++cp) {
+    if (!(state->overprintMask & (1 << cp))) {
+      continue;
+    }
+    p = pipe->destColorPtr + cp;
+    if (state->overprintAdditive) {
+      for (i = 0; i < n; ++i) {
+	*p = std::min<int>(*p + cResult[cp], 255);
+	p += 4;
+      }
+    } else {
+      for (i = 0; i < n; ++i) {
+	*p = cResult[cp];
+	p += 4;
+      }
+    }
+  }
+  memset(pipe->destAlphaPtr, 255, n);
+  pipe->destColorPtr += 4 * n;
+  pipe->destAlphaPtr += n;
+  pipe->x += n;
+}
+
+// span version of pipeRunSimpleDeviceN8
+void Splash::pipeRunSimpleSpanDeviceN8(SplashPipe *pipe, int n) {
+  SplashColorPtr p;
+  Guchar cResult;
+  int i, cp;
+
+  for (cp = 0; cp < SPOT_NCOMPS+4; cp++) {
+    if (!(state->overprintMask & (1 << cp))) {
+      continue;
+    }
+    cResult = state->deviceNTransfer[cp][pipe->cSrc[cp]];
+    p = pipe->destColorPtr + cp;
+    for (i = 0; i < n; ++i) {
+      *p = cResult;
+      p += SPOT_NCOMPS+4;
+    }
+  }
+  memset(pipe->destAlphaPtr, 255, n);
+  pipe->destColorPtr += (SPOT_NCOMPS+4) * n;
+  pipe->destAlphaPtr += n;
+  pipe->x += n;
+}
+#endif
+
+// In the AA span functions, <shape> holds one shape value per pixel.
+// Pixels with a zero shape value are left untouched, exactly as if
+// the caller had skipped them with pipeIncX.  A fully opaque source
+// pixel (aSrc = 255) always gives aResult = 255 and cResult = cSrc,
+// so those are written directly.
+
+// span version of pipeRunAAMono8
+void Splash::pipeRunAASpanMono8(SplashPipe *pipe, Guchar *shape, int n) {
+  Guchar aSrc, aDest, alpha2, aResult;
+  SplashColorPtr p;
+  Guchar *q;
+  Guchar *transfer;
+  Guchar cSrc0, cOpaque0;
+  int i;
+
+  transfer = state->grayTransfer;
+  cSrc0 = pipe->cSrc[0];
+  cOpaque0 = transfer[cSrc0];
+  p = pipe->destColorPtr;
+  q = pipe->destAlphaPtr;
+  for (i = 0; i < n; ++i) {
+    if (shape[i]) {
+      aSrc = div255(pipe->aInput * shape[i]);
+      if (aSrc == 255) {
+	p[i] = cOpaque0;
+	q[i] = 255;
+      } else {
+	aDest = q[i];
+	aResult = aSrc + aDest - div255(aSrc * aDest);
+	alpha2 = aResult;
+	if (alpha2 == 0) {
+	  p[i] = 0;
+	} else {
+	  p[i] = transfer[(Guchar)(((alpha2 - aSrc) * p[i] +
+				    aSrc * cSrc0) / alpha2)];
+	}
+	q[i] = aResult;
+      }
+    }
+  }
+  pipe->destColorPtr += n;
+  pipe->destAlphaPtr += n;
+  pipe->x += n;
+}
+
+// span version of pipeRunAARGB8
+void Splash::pipeRunAASpanRGB8(SplashPipe *pipe, Guchar *shape, int n) {
+  Guchar aSrc, aDest, alpha2, aResult;
+  SplashColorPtr p;
+  Guchar *q;
+  Guchar cSrc0, cSrc1, cSrc2;
+  Guchar cOpaque0, cOpaque1, cOpaque2;
+  int i;
+
+  cSrc0 = pipe->cSrc[0];
+  cSrc1 = pipe->cSrc[1];
+  cSrc2 = pipe->cSrc[2];
+  cOpaque0 = state->rgbTransferR[cSrc0];
+  cOpaque1 = state->rgbTransferG[cSrc1];
+  cOpaque2 = state->rgbTransferB[cSrc2];
+  p = pipe->destColorPtr;
+  q = pipe->destAlphaPtr;
+  for (i = 0; i < n; ++i, p += 3) {
+    if (shape[i]) {
+      aSrc = div255(pipe->aInput * shape[i]);
+      if (aSrc == 255) {
+	p[0] = cOpaque0;
+	p[1] = cOpaque1;
+	p[2] = cOpaque2;
+	q[i] = 255;
+      } else {
+	aDest = q[i];
+	aResult = aSrc + aDest - div255(aSrc * aDest);
+	alpha2 = aResult;
+	if (alpha2 == 0) {
+	  p[0] = 0;
+	  p[1] = 0;
+	  p[2] = 0;
+	} else {
+	  p[0] = state->rgbTransferR[(Guchar)(((alpha2 - aSrc) * p[0] +
+					       aSrc * cSrc0) / alpha2)];
+	  p[1] = state->rgbTransferG[(Guchar)(((alpha2 - aSrc) * p[1] +
+					       aSrc * cSrc1) / alpha2)];
+	  p[2] = state->rgbTransferB[(Guchar)(((alpha2 - aSrc) * p[2] +
+					       aSrc * cSrc2) / alpha2)];
+	}
+	q[i] = aResult;
+      }
+    }
+  }
+  pipe->destColorPtr = p;
+  pipe->destAlphaPtr += n;
+  pipe->x += n;
+}
+
+// span version of pipeRunAAXBGR8
+void Splash::pipeRunAASpanXBGR8(SplashPipe *pipe, Guchar *shape, int n) {
+  Guchar aSrc, aDest, alpha2, aResult;
+  SplashColorPtr p;
+  Guchar *q;
+  Guchar cSrc0, cSrc1, cSrc2;
+  Guchar cOpaque0, cOpaque1, cOpaque2;
+  int i;
+
+  cSrc0 = pipe->cSrc[0];
+  cSrc1 = pipe->cSrc[1];
+  cSrc2 = pipe->cSrc[2];
+  cOpaque0 = state->rgbTransferR[cSrc0];
+  cOpaque1 = state->rgbTransferG[cSrc1];
+  cOpaque2 = state->rgbTransferB[cSrc2];
+  p = pipe->destColorPtr;
+  q = pipe->destAlphaPtr;
+  for (i = 0; i < n; ++i, p += 4) {
+    if (shape[i]) {
+      aSrc = div255(pipe->aInput * shape[i]);
+      if (aSrc == 255) {
+	p[0] = cOpaque2;
+	p[1] = cOpaque1;
+	p[2] = cOpaque0;
+	q[i] = 255;
+      } else {
+	aDest = q[i];
+	aResult = aSrc + aDest - div255(aSrc * aDest);
+	alpha2 = aResult;
+	if (alpha2 == 0) {
+	  p[0] = 0;
+	  p[1] = 0;
+	  p[2] = 0;
+	} else {
+	  p[2] = state->rgbTransferR[(Guchar)(((alpha2 - aSrc) * p[2] +
+					       aSrc * cSrc0) / alpha2)];
+	  p[1] = state->rgbTransferG[(Guchar)(((alpha2 - aSrc) * p[1] +
+					       aSrc * cSrc1) / alpha2)];
+	  p[0] = state->rgbTransferB[(Guchar)(((alpha2 - aSrc) * p[0] +
+					       aSrc * cSrc2) / alpha2)];
+	}
+	q[i] = aResult;
+      }
+      p[3] = 255;
+    }
+  }
+  pipe->destColorPtr = p;
+  pipe->destAlphaPtr += n;
+  pipe->x += n;
+}
+
+// span version of pipeRunAABGR8
+void Splash::pipeRunAASpanBGR8(SplashPipe *pipe, Guchar *shape, int n) {
+  Guchar aSrc, aDest, alpha2, aResult;
+  SplashColorPtr p;
+  Guchar *q;
+  Guchar cSrc0, cSrc1, cSrc2;
+  Guchar cOpaque0, cOpaque1, cOpaque2;
+  int i;
+
+  cSrc0 = pipe->cSrc[0];
+  cSrc1 = pipe->cSrc[1];
+  cSrc2 = pipe->cSrc[2];
+  cOpaque0 = state->rgbTransferR[cSrc0];
+  cOpaque1 = state->rgbTransferG[cSrc1];
+  cOpaque2 = state->rgbTransferB[cSrc2];
+  p = pipe->destColorPtr;
+  q = pipe->destAlphaPtr;
+  for (i = 0; i < n; ++i, p += 3) {
+    if (shape[i]) {
+      aSrc = div255(pipe->aInput * shape[i]);
+      if (aSrc == 255) {
+	p[0] = cOpaque2;
+	p[1] = cOpaque1;
+	p[2] = cOpaque0;
+	q[i] = 255;
+      } else {
+	aDest = q[i];
+	aResult = aSrc + aDest - div255(aSrc * aDest);
+	alpha2 = aResult;
+	if (alpha2 == 0) {
+	  p[0] = 0;
+	  p[1] = 0;
+	  p[2] = 0;
+	} else {
+	  p[2] = state->rgbTransferR[(Guchar)(((alpha2 - aSrc) * p[2] +
+					       aSrc * cSrc0) / alpha2)];
+	  p[1] = state->rgbTransferG[(Guchar)(((alpha2 - aSrc) * p[1] +
+					       aSrc * cSrc1) / alpha2)];
+	  p[0] = state->rgbTransferB[(Guchar)(((alpha2 - aSrc) * p[0] +
+					       aSrc * cSrc2) / alpha2)];
+	}
+	q[i] = aResult;
+      }
+    }
+  }
+  pipe->destColorPtr = p;
+  pipe->destAlphaPtr += n;
+  pipe->x += n;
+}
+
+#if SPLASH_CMYK
+// span version of pipeRunAACMYK8
+void Splash::pipeRunAASpanCMYK8(SplashPipe *pipe, Guchar *shape, int n) {
+  Guchar aSrc, aDest, alpha2, aResult;
+  SplashColorPtr p;
+  Guchar *q;
+  Guchar cResult[4];
+  Guchar *transfer[4];
+  int i, cp;
+
+  transfer[0] = state->cmykTransferC;
+  transfer[1] = state->cmykTransferM;
+  transfer[2] = state->cmykTransferY;
+  transfer[3] = state->cmykTransferK;
+  p = pipe->destColorPtr;
+  q = pipe->destAlphaPtr;
+  for (i = 0; i < n; ++i, p += 4) {
+    if (shape[i]) {
+      aSrc = div255(pipe->aInput * shape[i]);
+      aDest = q[i];
+      aResult = aSrc + aDest - div255(aSrc * aDest);
+      alpha2 = aResult;
+      for (cp = 0; cp < 4; ++cp) {
+	if (alpha2 == 0) {
+	  cResult[cp] = 0;
+	} else {
+	  cResult[cp] = transfer[cp][(Guchar)(((alpha2 - aSrc) * p[cp] +
+					       aSrc * pipe->cSrc[cp]) /
+					      alpha2)];
+	}
+	if (state->overprintMask & (1 << cp)) {
+	  p[cp] = state->overprintAdditive ?
+	              std::min<int>(p[cp] + cResult[cp], 255) :
+	              cResult[cp];
+	}
+      }
+      q[i] = aResult;
+    }
+  }
+  pipe->destColorPtr = p;
+  pipe->destAlphaPtr += n;
+  pipe->x += n;
+}
+
+// span version of pipeRunAADeviceN8
+void Splash::pipeRunAASpanDeviceN8(SplashPipe *pipe, Guchar *shape, int n) {
+  Guchar aSrc, aDest, alpha2, aResult;
+  SplashColorPtr p;
+  Guchar *q;
+  Guchar cResult;
+  int i, cp;
+
+  p = pipe->destColorPtr;
+  q = pipe->destAlphaPtr;
+  for (i = 0; i < n; ++i, p += SPOT_NCOMPS+4) {
+    if (shape[i]) {
+      aSrc = div255(pipe->aInput * shape[i]);
+      aDest = q[i];
+      aResult = aSrc + aDest - div255(aSrc * aDest);
+      alpha2 = aResult;
+      for (cp = 0; cp < SPOT_NCOMPS+4; cp++) {
+	if (state->overprintMask & (1 << cp)) {
+	  if (alpha2 == 0) {
+	    cResult = 0;
+	  } else {
+	    cResult = state->deviceNTransfer[cp][(Guchar)(((alpha2 - aSrc) * p[cp] +
+						   aSrc * pipe->cSrc[cp]) / alpha2)];
+	  }
+	  p[cp] = cResult;
+	}
+      }
+      q[i] = aResult;
+    }
+  }
+  pipe->destColorPtr = p;
+  pipe->destAlphaPtr += n;
+  pipe->x += n;
+}
+#endif
+
 inline void Splash::pipeSetXY(SplashPipe *pipe, int x, int y) {
   pipe->x = x;
   pipe->y = y;
@@ -1406,7 +1867,7 @@ inline void Splash::pipeIncX(SplashPipe *pipe) {
 }
 
 inline void Splash::drawPixel(SplashPipe *pipe, int x, int y, GBool noClip) {
-  if (unlikely(y < 0))
+  if (unlikely(y < bandYMin || y > bandYMax))
     return;
 
   if (noClip || state->clip->test(x, y)) {
@@ -1433,7 +1894,8 @@ inline void Splash::drawAAPixel(SplashPipe *pipe, int x, int y) {
   int x0, x1, t;
 
   if (x < 0 || x >= bitmap->width ||
-      y < state->clip->getYMinI() || y > state->clip->getYMaxI()) {
+      y < state->clip->getYMinI() || y > state->clip->getYMaxI() ||
+      y < bandYMin || y > bandYMax) {
     return;
   }
 
@@ -1483,10 +1945,19 @@ inline void Splash::drawSpan(SplashPipe *pipe, int x0, int x1, int y,
 			     GBool noClip) {
   int x;
 
+  if (y < bandYMin || y > bandYMax) {
+    return;
+  }
   if (noClip) {
     pipeSetXY(pipe, x0, y);
-    for (x = x0; x <= x1; ++x) {
-      (this->*pipe->run)(pipe);
+    if (pipe->runSimpleSpan) {
+      if (x1 >= x0) {
+	(this->*pipe->runSimpleSpan)(pipe, x1 - x0 + 1);
+      }
+    } else {
+      for (x = x0; x <= x1; ++x) {
+	(this->*pipe->run)(pipe);
+      }
     }
     updateModX(x0);
     updateModX(x1);
@@ -1516,23 +1987,33 @@ inline void Splash::drawAALine(SplashPipe *pipe, int x0, int x1, int y, GBool ad
   static int bitCount4[16] = { 0, 1, 1, 2, 1, 2, 2, 3,
 			       1, 2, 2, 3, 2, 3, 3, 4 };
   SplashColorPtr p0, p1, p2, p3;
-  int t;
 #else
   SplashColorPtr p;
-  int xx, yy, t;
+  int xx, yy;
 #endif
-  int x;
+  Guchar shapeLUT[splashAASize * splashAASize + 1];
+  int x, t, xMinMod, xMaxMod;
+
+  if (y < bandYMin || y > bandYMax || x0 > x1) {
+    return;
+  }
+
+  // map coverage counts to shape values
+  shapeLUT[0] = 0;
+  for (t = 1; t <= splashAASize * splashAASize; ++t) {
+    shapeLUT[t] = (adjustLine) ? div255((int) lineOpacity * (double)aaGamma[t]) : (double)aaGamma[t];
+  }
 
+  // compute the shape values for the whole line
 #if splashAASize == 4
   p0 = aaBuf->getDataPtr() + (x0 >> 1);
   p1 = p0 + aaBuf->getRowSize();
   p2 = p1 + aaBuf->getRowSize();
   p3 = p2 + aaBuf->getRowSize();
 #endif
-  pipeSetXY(pipe, x0, y);
+  xMinMod = x1 + 1;
+  xMaxMod = x0 - 1;
   for (x = x0; x <= x1; ++x) {
-
-    // compute the shape value
 #if splashAASize == 4
     if (x & 1) {
       t = bitCount4[*p0 & 0x0f] + bitCount4[*p1 & 0x0f] +
@@ -1552,16 +2033,79 @@ inline void Splash::drawAALine(SplashPipe *pipe, int x0, int x1, int y, GBool ad
       }
     }
 #endif
-
+    aaShape[x - x0] = (Guchar)t;
     if (t != 0) {
-      pipe->shape = (adjustLine) ? div255((int) lineOpacity * (double)aaGamma[t]) : (double)aaGamma[t];
-      (this->*pipe->run)(pipe);
-      updateModX(x);
-      updateModY(y);
-    } else {
-      pipeIncX(pipe);
+      if (xMinMod > x1) {
+	xMinMod = x;
+      }
+      xMaxMod = x;
+    }
+  }
+  if (xMinMod > xMaxMod) {
+    return;
+  }
+
+  // draw the pixels -- drawShapeLine skips pixels with a zero shape,
+  // so it can only be used if every nonzero coverage count gives a
+  // nonzero shape
+  if (shapeLUT[1] != 0) {
+    for (x = xMinMod; x <= xMaxMod; ++x) {
+      aaShape[x - x0] = shapeLUT[aaShape[x - x0]];
+    }
+    drawShapeLine(pipe, aaShape + (xMinMod - x0), xMinMod, xMaxMod, y);
+  } else {
+    pipeSetXY(pipe, xMinMod, y);
+    for (x = xMinMod; x <= xMaxMod; ++x) {
+      t = aaShape[x - x0];
+      if (t != 0) {
+	pipe->shape = shapeLUT[t];
+	(this->*pipe->run)(pipe);
+      } else {
+	pipeIncX(pipe);
+      }
+    }
+    updateModX(xMinMod);
+    updateModX(xMaxMod);
+    updateModY(y);
+  }
+}
+
+// Draw the pixels [<x0>, <x1>] of row <y> with the shape values in
+// <shape> (<shape>[0] is the value for <x0>).  Pixels with a zero
+// shape value are left untouched.
+inline void Splash::drawShapeLine(SplashPipe *pipe, Guchar *shape,
+				  int x0, int x1, int y) {
+  int x;
+
+  if (y < bandYMin || y > bandYMax) {
+    return;
+  }
+  while (x0 <= x1 && !shape[0]) {
+    ++x0;
+    ++shape;
+  }
+  while (x1 >= x0 && !shape[x1 - x0]) {
+    --x1;
+  }
+  if (x0 > x1) {
+    return;
+  }
+  pipeSetXY(pipe, x0, y);
+  if (pipe->runAASpan) {
+    (this->*pipe->runAASpan)(pipe, shape, x1 - x0 + 1);
+  } else {
+    for (x = x0; x <= x1; ++x) {
+      if (shape[x - x0]) {
+	pipe->shape = shape[x - x0];
+	(this->*pipe->run)(pipe);
+      } else {
+	pipeIncX(pipe);
+      }
     }
   }
+  updateModX(x0);
+  updateModX(x1);
+  updateModY(y);
 }
 
 //------------------------------------------------------------------------
@@ -1593,6 +2137,7 @@ Splash::Splash(SplashBitmap *bitmapA, GBool vectorAntialiasA,
   if (vectorAntialias) {
     aaBuf = new SplashBitmap(splashAASize * bitmap->width, splashAASize,
 			     1, splashModeMono1, gFalse);
+    aaShape = (Guchar *)gmallocn(bitmap->width, sizeof(Guchar));
     for (i = 0; i <= splashAASize * splashAASize; ++i) {
       aaGamma[i] = (Guchar)splashRound(
 		       splashPow((SplashCoord)i /
@@ -1601,10 +2146,15 @@ Splash::Splash(SplashBitmap *bitmapA, GBool vectorAntialiasA,
     }
   } else {
     aaBuf = NULL;
+    aaShape = NULL;
   }
   minLineWidth = 0;
   thinLineMode = splashThinLineDefault;
+  aaMode = splashAASupersample;
+  spanCompositing = gTrue;
   clearModRegion();
+  bandYMin = 0;
+  bandYMax = bitmap->height - 1;
   debugMode = gFalse;
   alpha0Bitmap = NULL;
 }
@@ -1621,6 +2171,7 @@ Splash::Splash(SplashBitmap *bitmapA, GBool vectorAntialiasA,
   if (vectorAntialias) {
     aaBuf = new SplashBitmap(splashAASize * bitmap->width, splashAASize,
 			     1, splashModeMono1, gFalse);
+    aaShape = (Guchar *)gmallocn(bitmap->width, sizeof(Guchar));
     for (i = 0; i <= splashAASize * splashAASize; ++i) {
       aaGamma[i] = (Guchar)splashRound(
 		       splashPow((SplashCoord)i /
@@ -1629,10 +2180,15 @@ Splash::Splash(SplashBitmap *bitmapA, GBool vectorAntialiasA,
     }
   } else {
     aaBuf = NULL;
+    aaShape = NULL;
   }
   minLineWidth = 0;
   thinLineMode = splashThinLineDefault;
+  aaMode = splashAASupersample;
+  spanCompositing = gTrue;
   clearModRegion();
+  bandYMin = 0;
+  bandYMax = bitmap->height - 1;
   debugMode = gFalse;
   alpha0Bitmap = NULL;
 }
@@ -1645,6 +2201,7 @@ Splash::~Splash() {
   if (vectorAntialias) {
     delete aaBuf;
   }
+  gfree(aaShape);
 }
 
 //------------------------------------------------------------------------
@@ -1871,37 +2428,46 @@ SplashError Splash::restoreState() {
 void Splash::clear(SplashColorPtr color, Guchar alpha) {
   SplashColorPtr row, p;
   Guchar mono;
-  int x, y;
+  int nRows, x, y;
+
+  // only the rows in the band are cleared
+  nRows = bandYMax - bandYMin + 1;
+  if (nRows <= 0) {
+    return;
+  }
 
   switch (bitmap->mode) {
   case splashModeMono1:
     mono = (color[0] & 0x80) ? 0xff : 0x00;
     if (bitmap->rowSize < 0) {
-      memset(bitmap->data + bitmap->rowSize * (bitmap->height - 1),
-	     mono, -bitmap->rowSize * bitmap->height);
+      memset(bitmap->data + bitmap->rowSize * bandYMax,
+	     mono, -bitmap->rowSize * nRows);
     } else {
-      memset(bitmap->data, mono, bitmap->rowSize * bitmap->height);
+      memset(bitmap->data + bitmap->rowSize * bandYMin, mono,
+	     bitmap->rowSize * nRows);
     }
     break;
   case splashModeMono8:
     if (bitmap->rowSize < 0) {
-      memset(bitmap->data + bitmap->rowSize * (bitmap->height - 1),
-	     color[0], -bitmap->rowSize * bitmap->height);
+      memset(bitmap->data + bitmap->rowSize * bandYMax,
+	     color[0], -bitmap->rowSize * nRows);
     } else {
-      memset(bitmap->data, color[0], bitmap->rowSize * bitmap->height);
+      memset(bitmap->data + bitmap->rowSize * bandYMin, color[0],
+	     bitmap->rowSize * nRows);
     }
     break;
   case splashModeRGB8:
     if (color[0] == color[1] && color[1] == color[2]) {
       if (bitmap->rowSize < 0) {
-	memset(bitmap->data + bitmap->rowSize * (bitmap->height - 1),
-	       color[0], -bitmap->rowSize * bitmap->height);
+	memset(bitmap->data + bitmap->rowSize * bandYMax,
+	       color[0], -bitmap->rowSize * nRows);
       } else {
-	memset(bitmap->data, color[0], bitmap->rowSize * bitmap->height);
+	memset(bitmap->data + bitmap->rowSize * bandYMin, color[0],
+	       bitmap->rowSize * nRows);
       }
     } else {
-      row = bitmap->data;
-      for (y = 0; y < bitmap->height; ++y) {
+      row = bitmap->data + bandYMin * bitmap->rowSize;
+      for (y = bandYMin; y <= bandYMax; ++y) {
 	p = row;
 	for (x = 0; x < bitmap->width; ++x) {
 	  *p++ = color[2];
@@ -1915,14 +2481,15 @@ void Splash::clear(SplashColorPtr color, Guchar alpha) {
   case splashModeXBGR8:
     if (color[0] == color[1] && color[1] == color[2]) {
       if (bitmap->rowSize < 0) {
-	memset(bitmap->data + bitmap->rowSize * (bitmap->height - 1),
-	       color[0], -bitmap->rowSize * bitmap->height);
+	memset(bitmap->data + bitmap->rowSize * bandYMax,
+	       color[0], -bitmap->rowSize * nRows);
       } else {
-	memset(bitmap->data, color[0], bitmap->rowSize * bitmap->height);
+	memset(bitmap->data + bitmap->rowSize * bandYMin, color[0],
+	       bitmap->rowSize * nRows);
       }
     } else {
-      row = bitmap->data;
-      for (y = 0; y < bitmap->height; ++y) {
+      row = bitmap->data + bandYMin * bitmap->rowSize;
+      for (y = bandYMin; y <= bandYMax; ++y) {
 	p = row;
 	for (x = 0; x < bitmap->width; ++x) {
 	  *p++ = color[0];
@@ -1937,14 +2504,15 @@ void Splash::clear(SplashColorPtr color, Guchar alpha) {
   case splashModeBGR8:
     if (color[0] == color[1] && color[1] == color[2]) {
       if (bitmap->rowSize < 0) {
-	memset(bitmap->data + bitmap->rowSize * (bitmap->height - 1),
-	       color[0], -bitmap->rowSize * bitmap->height);
+	memset(bitmap->data + bitmap->rowSize * bandYMax,
+	       color[0], -bitmap->rowSize * nRows);
       } else {
-	memset(bitmap->data, color[0], bitmap->rowSize * bitmap->height);
+	memset(bitmap->data + bitmap->rowSize * bandYMin, color[0],
+	       bitmap->rowSize * nRows);
       }
     } else {
-      row = bitmap->data;
-      for (y = 0; y < bitmap->height; ++y) {
+      row = bitmap->data + bandYMin * bitmap->rowSize;
+      for (y = bandYMin; y <= bandYMax; ++y) {
 	p = row;
 	for (x = 0; x < bitmap->width; ++x) {
 	  *p++ = color[0];
@@ -1959,14 +2527,15 @@ void Splash::clear(SplashColorPtr color, Guchar alpha) {
   case splashModeCMYK8:
     if (color[0] == color[1] && color[1] == color[2] && color[2] == color[3]) {
       if (bitmap->rowSize < 0) {
-	memset(bitmap->data + bitmap->rowSize * (bitmap->height - 1),
-	       color[0], -bitmap->rowSize * bitmap->height);
+	memset(bitmap->data + bitmap->rowSize * bandYMax,
+	       color[0], -bitmap->rowSize * nRows);
       } else {
-	memset(bitmap->data, color[0], bitmap->rowSize * bitmap->height);
+	memset(bitmap->data + bitmap->rowSize * bandYMin, color[0],
+	       bitmap->rowSize * nRows);
       }
     } else {
-      row = bitmap->data;
-      for (y = 0; y < bitmap->height; ++y) {
+      row = bitmap->data + bandYMin * bitmap->rowSize;
+      for (y = bandYMin; y <= bandYMax; ++y) {
 	p = row;
 	for (x = 0; x < bitmap->width; ++x) {
 	  *p++ = color[0];
@@ -1979,8 +2548,8 @@ void Splash::clear(SplashColorPtr color, Guchar alpha) {
     }
     break;
   case splashModeDeviceN8:
-    row = bitmap->data;
-    for (y = 0; y < bitmap->height; ++y) {
+    row = bitmap->data + bandYMin * bitmap->rowSize;
+    for (y = bandYMin; y <= bandYMax; ++y) {
       p = row;
       for (x = 0; x < bitmap->width; ++x) {
         for (int cp = 0; cp < SPOT_NCOMPS+4; cp++)
@@ -1993,13 +2562,14 @@ void Splash::clear(SplashColorPtr color, Guchar alpha) {
   }
 
   if (bitmap->alpha) {
-    memset(bitmap->alpha, alpha, bitmap->width * bitmap->height);
+    memset(bitmap->alpha + bandYMin * bitmap->width, alpha,
+	   bitmap->width * nRows);
   }
 
   updateModX(0);
-  updateModY(0);
+  updateModY(bandYMin);
   updateModX(bitmap->width - 1);
-  updateModY(bitmap->height - 1);
+  updateModY(bandYMax);
 }
 
 SplashError Splash::stroke(SplashPath *path) {
@@ -2453,7 +3023,7 @@ SplashError Splash::fillWithPattern(SplashPath *path, GBool eo,
   SplashPipe pipe;
   SplashXPath *xPath;
   SplashXPathScanner *scanner;
-  int xMinI, yMinI, xMaxI, yMaxI, x0, x1, y;
+  int xMinI, yMinI, xMaxI, yMaxI, yMinB, yMaxB, x0, x1, y;
   SplashClipResult clipRes, clipRes2;
   GBool adjustLine = gFalse; 
   int linePosI = 0;
@@ -2548,9 +3118,25 @@ SplashError Splash::fillWithPattern(SplashPath *path, GBool eo,
     pipeInit(&pipe, 0, yMinI, pattern, NULL, (Guchar)splashRound(alpha * 255),
 	     vectorAntialias && !inShading, gFalse);
 
+    // only the rows in the band are drawn
+    yMinB = yMinI < bandYMin ? bandYMin : yMinI;
+    yMaxB = yMaxI > bandYMax ? bandYMax : yMaxI;
+
     // draw the spans
-    if (vectorAntialias && !inShading) {
-      for (y = yMinI; y <= yMaxI; ++y) {
+    // (stroke adjusted paths are snapped to the pixel grid, so they
+    // are left to the supersampling code)
+    if (vectorAntialias && !inShading && aaMode == splashAAAnalytic &&
+	clipRes == splashClipAllInside && !xPath->strokeAdjusted &&
+	!(thinLineMode != splashThinLineDefault &&
+	  (xMinI == xMaxI || yMinI == yMaxI))) {
+      for (y = yMinB; y <= yMaxB; ++y) {
+	scanner->renderAALineAnalytic(aaShape, bitmap->width, &x0, &x1, y);
+	if (x0 <= x1) {
+	  drawShapeLine(&pipe, aaShape + x0, x0, x1, y);
+	}
+      }
+    } else if (vectorAntialias && !inShading) {
+      for (y = yMinB; y <= yMaxB; ++y) {
 	scanner->renderAALine(aaBuf, &x0, &x1, y, thinLineMode != splashThinLineDefault && xMinI == xMaxI);
 	if (clipRes != splashClipAllInside) {
 	  state->clip->clipAALine(aaBuf, &x0, &x1, y, thinLineMode != splashThinLineDefault && xMinI == xMaxI);
@@ -2568,7 +3154,7 @@ SplashError Splash::fillWithPattern(SplashPath *path, GBool eo,
 	drawAALine(&pipe, x0, x1, y, adjustLine, lineShape);
       }
     } else {
-      for (y = yMinI; y <= yMaxI; ++y) {
+      for (y = yMinB; y <= yMaxB; ++y) {
 	while (scanner->getNextSpan(y, &x0, &x1)) {
 	  if (clipRes == splashClipAllInside) {
 	    drawSpan(&pipe, x0, x1, y, gTrue);
@@ -2691,6 +3277,14 @@ SplashError Splash::xorFill(SplashPath *path, GBool eo) {
     state->blendFunc = &blendXor;
     pipeInit(&pipe, 0, yMinI, state->fillPattern, NULL, 255, gFalse, gFalse);
 
+    // only the rows in the band are drawn
+    if (yMinI < bandYMin) {
+      yMinI = bandYMin;
+    }
+    if (yMaxI > bandYMax) {
+      yMaxI = bandYMax;
+    }
+
     // draw the spans
     for (y = yMinI; y <= yMaxI; ++y) {
       while (scanner->getNextSpan(y, &x0, &x1)) {
@@ -2801,21 +3395,42 @@ void Splash::fillGlyph2(int x0, int y0, SplashGlyphBitmap *glyph, GBool noClip)
   if (xxLimit + xStart >= bitmap->width) xxLimit = bitmap->width - xStart;
   if (yyLimit + yStart >= bitmap->height) yyLimit = bitmap->height - yStart;
 
+  // only the rows in the band are drawn
+  if (yStart < bandYMin) {
+    p += (glyph->aa ? glyph->w : splashCeil(glyph->w / 8.0)) * (bandYMin - yStart);
+    yyLimit -= bandYMin - yStart;
+    yStart = bandYMin;
+  }
+  if (yyLimit + yStart > bandYMax + 1) yyLimit = bandYMax + 1 - yStart;
+
   if (noClip) {
     if (glyph->aa) {
       pipeInit(&pipe, xStart, yStart,
                state->fillPattern, NULL, (Guchar)splashRound(state->fillAlpha * 255), gTrue, gFalse);
       for (yy = 0, y1 = yStart; yy < yyLimit; ++yy, ++y1) {
-        pipeSetXY(&pipe, xStart, y1);
-        for (xx = 0, x1 = xStart; xx < xxLimit; ++xx, ++x1) {
-          alpha = p[xx];
-          if (alpha != 0) {
-            pipe.shape = alpha;
-            (this->*pipe.run)(&pipe);
-            updateModX(x1);
+        if (pipe.runAASpan) {
+          // the glyph row is used directly as the shape values
+          for (xx = 0; xx < xxLimit && !p[xx]; ++xx) ;
+          for (xx1 = xxLimit - 1; xx1 > xx && !p[xx1]; --xx1) ;
+          if (xx < xxLimit) {
+            pipeSetXY(&pipe, xStart + xx, y1);
+            (this->*pipe.runAASpan)(&pipe, p + xx, xx1 - xx + 1);
+            updateModX(xStart + xx);
+            updateModX(xStart + xx1);
             updateModY(y1);
-          } else {
-            pipeIncX(&pipe);
+          }
+        } else {
+          pipeSetXY(&pipe, xStart, y1);
+          for (xx = 0, x1 = xStart; xx < xxLimit; ++xx, ++x1) {
+            alpha = p[xx];
+            if (alpha != 0) {
+              pipe.shape = alpha;
+              (this->*pipe.run)(&pipe);
+              updateModX(x1);
+              updateModY(y1);
+            } else {
+              pipeIncX(&pipe);
+            }
           }
         }
         p += glyph->w;
@@ -3200,6 +3815,9 @@ void Splash::arbitraryTransformMask(SplashImageMaskSource src, void *srcData,
   // scan all pixels inside the target region
   for (i = 0; i < nSections; ++i) {
     for (y = section[i].y0; y <= section[i].y1; ++y) {
+      if (y < bandYMin || y > bandYMax) {
+	continue;
+      }
       xa = imgCoordMungeLowerC(section[i].xa0 +
 			         ((SplashCoord)y + 0.5 - section[i].ya0) *
 			           section[i].dxdya,
@@ -3601,7 +4219,7 @@ void Splash::blitMask(SplashBitmap *src, int xDest, int yDest,
 		      SplashClipResult clipRes) {
   SplashPipe pipe;
   Guchar *p;
-  int w, h, x, y;
+  int w, h, ySrc, x, y;
 
   w = src->getWidth();
   h = src->getHeight();
@@ -3610,6 +4228,12 @@ void Splash::blitMask(SplashBitmap *src, int xDest, int yDest,
     error(errInternal, -1, "src->getDataPtr() is NULL in Splash::blitMask");
     return;    
   }
+  ySrc = 0;
+  bandRows(&ySrc, &yDest, &h);
+  if (h <= 0) {
+    return;
+  }
+  p += ySrc * w;
   if (vectorAntialias && clipRes != splashClipAllInside) {
     pipeInit(&pipe, xDest, yDest, state->fillPattern, NULL,
 	     (Guchar)splashRound(state->fillAlpha * 255), gTrue, gFalse);
@@ -4054,6 +4678,9 @@ SplashError Splash::arbitraryTransformImage(SplashImageSource src, void *srcData
   // scan all pixels inside the target region
   for (i = 0; i < nSections; ++i) {
     for (y = section[i].y0; y <= section[i].y1; ++y) {
+      if (y < bandYMin || y > bandYMax) {
+	continue;
+      }
       xa = imgCoordMungeLower(section[i].xa0 +
 			      ((SplashCoord)y + 0.5 - section[i].ya0) *
 			        section[i].dxdya);
@@ -5052,7 +5679,7 @@ void Splash::blitImage(SplashBitmap *src, GBool srcAlpha, int xDest, int yDest,
   SplashPipe pipe;
   SplashColor pixel;
   Guchar *ap;
-  int w, h, x0, y0, x1, y1, x, y;
+  int w, h, x0, y0, x1, y1, yb0, yb1, x, y;
 
   // split the image into clipped and unclipped regions
   w = src->getWidth();
@@ -5088,12 +5715,14 @@ void Splash::blitImage(SplashBitmap *src, GBool srcAlpha, int xDest, int yDest,
     }
   }
 
-  // draw the unclipped region
-  if (x0 < w && y0 < h && x0 < x1 && y0 < y1) {
-    pipeInit(&pipe, xDest + x0, yDest + y0, NULL, pixel,
+  // draw the unclipped region (only the rows in the band)
+  yb0 = yDest + y0 < bandYMin ? bandYMin - yDest : y0;
+  yb1 = yDest + y1 - 1 > bandYMax ? bandYMax - yDest + 1 : y1;
+  if (x0 < w && y0 < h && x0 < x1 && yb0 < yb1) {
+    pipeInit(&pipe, xDest + x0, yDest + yb0, NULL, pixel,
 	     (Guchar)splashRound(state->fillAlpha * 255), srcAlpha, gFalse);
     if (srcAlpha) {
-      for (y = y0; y < y1; ++y) {
+      for (y = yb0; y < yb1; ++y) {
 	pipeSetXY(&pipe, xDest + x0, yDest + y);
 	ap = src->getAlphaPtr() + y * w + x0;
 	for (x = x0; x < x1; ++x) {
@@ -5103,7 +5732,7 @@ void Splash::blitImage(SplashBitmap *src, GBool srcAlpha, int xDest, int yDest,
 	}
       }
     } else {
-      for (y = y0; y < y1; ++y) {
+      for (y = yb0; y < yb1; ++y) {
 	pipeSetXY(&pipe, xDest + x0, yDest + y);
 	for (x = x0; x < x1; ++x) {
 	  src->getPixel(x, y, pixel);
@@ -5113,8 +5742,8 @@ void Splash::blitImage(SplashBitmap *src, GBool srcAlpha, int xDest, int yDest,
     }
     updateModX(xDest + x0);
     updateModX(xDest + x1 - 1);
-    updateModY(yDest + y0);
-    updateModY(yDest + y1 - 1);
+    updateModY(yDest + yb0);
+    updateModY(yDest + yb1 - 1);
   }
 
   // draw the clipped regions
@@ -5141,6 +5770,10 @@ void Splash::blitImageClipped(SplashBitmap *src, GBool srcAlpha,
   Guchar *ap;
   int x, y;
 
+  bandRows(&ySrc, &yDest, &h);
+  if (h <= 0) {
+    return;
+  }
   if (vectorAntialias) {
     pipeInit(&pipe, xDest, yDest, NULL, pixel,
 	     (Guchar)splashRound(state->fillAlpha * 255), gTrue, gFalse);
@@ -5223,6 +5856,10 @@ SplashError Splash::composite(SplashBitmap *src, int xSrc, int ySrc,
     for (x = bitmap->getSeparationList()->getLength(); x < src->getSeparationList()->getLength(); x++)
       bitmap->getSeparationList()->append(((GfxSeparationColorSpace *)src->getSeparationList()->get(x))->copy());
   }
+  bandRows(&ySrc, &yDest, &h);
+  if (h <= 0) {
+    return splashOk;
+  }
   if (src->alpha) {
     pipeInit(&pipe, xDest, yDest, NULL, pixel,
 	     (Guchar)splashRound(state->fillAlpha * 255), gTrue, nonIsolated,
@@ -5317,7 +5954,7 @@ void Splash::compositeBackground(SplashColorPtr color) {
   switch (bitmap->mode) {
   case splashModeMono1:
     color0 = color[0];
-    for (y = 0; y < bitmap->height; ++y) {
+    for (y = bandYMin; y <= bandYMax; ++y) {
       p = &bitmap->data[y * bitmap->rowSize];
       q = &bitmap->alpha[y * bitmap->width];
       mask = 0x80;
@@ -5340,7 +5977,7 @@ void Splash::compositeBackground(SplashColorPtr color) {
     break;
   case splashModeMono8:
     color0 = color[0];
-    for (y = 0; y < bitmap->height; ++y) {
+    for (y = bandYMin; y <= bandYMax; ++y) {
       p = &bitmap->data[y * bitmap->rowSize];
       q = &bitmap->alpha[y * bitmap->width];
       for (x = 0; x < bitmap->width; ++x) {
@@ -5356,7 +5993,7 @@ void Splash::compositeBackground(SplashColorPtr color) {
     color0 = color[0];
     color1 = color[1];
     color2 = color[2];
-    for (y = 0; y < bitmap->height; ++y) {
+    for (y = bandYMin; y <= bandYMax; ++y) {
       p = &bitmap->data[y * bitmap->rowSize];
       q = &bitmap->alpha[y * bitmap->width];
       for (x = 0; x < bitmap->width; ++x) {
@@ -5382,7 +6019,7 @@ void Splash::compositeBackground(SplashColorPtr color) {
     color0 = color[0];
     color1 = color[1];
     color2 = color[2];
-    for (y = 0; y < bitmap->height; ++y) {
+    for (y = bandYMin; y <= bandYMax; ++y) {
       p = &bitmap->data[y * bitmap->rowSize];
       q = &bitmap->alpha[y * bitmap->width];
       for (x = 0; x < bitmap->width; ++x) {
@@ -5411,7 +6048,7 @@ void Splash::compositeBackground(SplashColorPtr color) {
     color1 = color[1];
     color2 = color[2];
     color3 = color[3];
-    for (y = 0; y < bitmap->height; ++y) {
+    for (y = bandYMin; y <= bandYMax; ++y) {
       p = &bitmap->data[y * bitmap->rowSize];
       q = &bitmap->alpha[y * bitmap->width];
       for (x = 0; x < bitmap->width; ++x) {
@@ -5438,7 +6075,7 @@ void Splash::compositeBackground(SplashColorPtr color) {
   case splashModeDeviceN8:
     for (cp = 0; cp < SPOT_NCOMPS+4; cp++)
       colorsp[cp] = color[cp];
-    for (y = 0; y < bitmap->height; ++y) {
+    for (y = bandYMin; y <= bandYMax; ++y) {
       p = &bitmap->data[y * bitmap->rowSize];
       q = &bitmap->alpha[y * bitmap->width];
       for (x = 0; x < bitmap->width; ++x) {
@@ -5460,7 +6097,10 @@ void Splash::compositeBackground(SplashColorPtr color) {
     break;
 #endif
   }
-  memset(bitmap->alpha, 255, bitmap->width * bitmap->height);
+  if (bandYMin <= bandYMax) {
+    memset(bitmap->alpha + bandYMin * bitmap->width, 255,
+	   bitmap->width * (bandYMax - bandYMin + 1));
+  }
 }
 
 GBool Splash::gouraudTriangleShadedFill(SplashGouraudColor *shading)
@@ -5527,6 +6167,12 @@ GBool Splash::gouraudTriangleShadedFill(SplashGouraudColor *shading)
   SplashPipe pipe;
   SplashColor cSrcVal;
 
+  // the triangles are blitted directly into the bitmap below, which
+  // does not know about bands
+  if (bandYMin > 0 || bandYMax < bitmap->getHeight() - 1) {
+    return gFalse;
+  }
+
   pipeInit(&pipe, 0, 0, NULL, cSrcVal, (Guchar)splashRound(state->strokeAlpha * 255), gFalse, gFalse);
 
   if (vectorAntialias) {
@@ -5792,6 +6438,11 @@ SplashError Splash::blitTransparent(SplashBitmap *src, int xSrc, int ySrc,
     return splashErrZeroImage;
   }
 
+  bandRows(&ySrc, &yDest, &h);
+  if (h <= 0) {
+    return splashOk;
+  }
+
   switch (bitmap->mode) {
   case splashModeMono1:
     for (y = 0; y < h; ++y) {
@@ -5819,7 +6470,7 @@ SplashError Splash::blitTransparent(SplashBitmap *src, int xSrc, int ySrc,
   case splashModeMono8:
     for (y = 0; y < h; ++y) {
       p = &bitmap->data[(yDest + y) * bitmap->rowSize + xDest];
-      sp = &src->data[(ySrc + y) * bitmap->rowSize + xSrc];
+      sp = &src->data[(ySrc + y) * src->rowSize + xSrc];
       for (x = 0; x < w; ++x) {
 	*p++ = *sp++;
       }
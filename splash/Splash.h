@@ -253,6 +253,19 @@ public:
   void setThinLineMode(SplashThinLineMode thinLineModeA) { thinLineMode = thinLineModeA; }
   SplashThinLineMode getThinLineMode() { return thinLineMode; }
 
+  // Setter/Getter for the vector anti-aliasing method.  The analytic
+  // method is used for fills which are entirely inside the clip
+  // region; everything else is supersampled.
+  void setAAMode(SplashAAMode aaModeA) { aaMode = aaModeA; }
+  SplashAAMode getAAMode() { return aaMode; }
+
+  // Setter/Getter for span compositing.  If it is off, every pixel is
+  // composited on its own, as it was before the span functions were
+  // added; the output is the same either way.
+  void setSpanCompositing(GBool spanCompositingA)
+    { spanCompositing = spanCompositingA; }
+  GBool getSpanCompositing() { return spanCompositing; }
+
   // Get a bounding box which includes all modifications since the
   // last call to clearModRegion.
   void getModRegion(int *xMin, int *yMin, int *xMax, int *yMax)
@@ -261,6 +274,16 @@ public:
   // Clear the modified region bounding box.
   void clearModRegion();
 
+  // Restrict all drawing to the rows <yMin>..<yMax> of the bitmap.
+  // Unlike a clip, the band does not change what is drawn in the rows
+  // inside it, so several Splash objects can draw the same page into
+  // disjoint bands of one bitmap, each in its own thread, and the
+  // result is the same as drawing it with one Splash object.  The
+  // band is the whole bitmap by default.
+  void setBand(int yMin, int yMax);
+  int getBandYMin() { return bandYMin; }
+  int getBandYMax() { return bandYMax; }
+
   // Get clipping status for the last drawing operation subject to
   // clipping.
   SplashClipResult getClipRes() { return opClipRes; }
@@ -305,6 +328,22 @@ private:
 #if SPLASH_CMYK
   void pipeRunAACMYK8(SplashPipe *pipe);
   void pipeRunAADeviceN8(SplashPipe *pipe);
+#endif
+  void pipeRunSimpleSpanMono8(SplashPipe *pipe, int n);
+  void pipeRunSimpleSpanRGB8(SplashPipe *pipe, int n);
+  void pipeRunSimpleSpanXBGR8(SplashPipe *pipe, int n);
+  void pipeRunSimpleSpanBGR8(SplashPipe *pipe, int n);
+#if SPLASH_CMYK
+  void pipeRunSimpleSpanCMYK8(SplashPipe *pipe, int n);
+  void pipeRunSimpleSpanDeviceN8(SplashPipe *pipe, int n);
+#endif
+  void pipeRunAASpanMono8(SplashPipe *pipe, Guchar *shape, int n);
+  void pipeRunAASpanRGB8(SplashPipe *pipe, Guchar *shape, int n);
+  void pipeRunAASpanXBGR8(SplashPipe *pipe, Guchar *shape, int n);
+  void pipeRunAASpanBGR8(SplashPipe *pipe, Guchar *shape, int n);
+#if SPLASH_CMYK
+  void pipeRunAASpanCMYK8(SplashPipe *pipe, Guchar *shape, int n);
+  void pipeRunAASpanDeviceN8(SplashPipe *pipe, Guchar *shape, int n);
 #endif
   void pipeSetXY(SplashPipe *pipe, int x, int y);
   void pipeIncX(SplashPipe *pipe);
@@ -313,10 +352,12 @@ private:
   void drawAAPixel(SplashPipe *pipe, int x, int y);
   void drawSpan(SplashPipe *pipe, int x0, int x1, int y, GBool noClip);
   void drawAALine(SplashPipe *pipe, int x0, int x1, int y, GBool adjustLine = gFalse, Guchar lineOpacity = 0);
+  void drawShapeLine(SplashPipe *pipe, Guchar *shape, int x0, int x1, int y);
   void transform(SplashCoord *matrix, SplashCoord xi, SplashCoord yi,
 		 SplashCoord *xo, SplashCoord *yo);
   void updateModX(int x);
   void updateModY(int y);
+  void bandRows(int *ySrc, int *yDest, int *h);
   void strokeNarrow(SplashPath *path);
   void strokeWide(SplashPath *path, SplashCoord w);
   SplashPath *flattenPath(SplashPath *path, SplashCoord *matrix,
@@ -410,13 +451,18 @@ private:
   SplashState *state;
   SplashBitmap *aaBuf;
   int aaBufY;
+  Guchar *aaShape;		// shape values for one row, used by
+				//   drawAALine and the analytic AA mode
   SplashBitmap *alpha0Bitmap;	// for non-isolated groups, this is the
 				//   bitmap containing the alpha0 values
   int alpha0X, alpha0Y;		// offset within alpha0Bitmap
   SplashCoord aaGamma[splashAASize * splashAASize + 1];
   SplashCoord minLineWidth;
   SplashThinLineMode thinLineMode;
+  SplashAAMode aaMode;
+  GBool spanCompositing;
   int modXMin, modYMin, modXMax, modYMax;
+  int bandYMin, bandYMax;	// rows that may be drawn into
   SplashClipResult opClipRes;
   GBool vectorAntialias;
   GBool inShading;
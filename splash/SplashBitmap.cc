@@ -149,6 +149,30 @@ SplashBitmap *SplashBitmap::copy(SplashBitmap *src) {
   return result;
 }
 
+SplashBitmap *SplashBitmap::copyRows(SplashBitmap *src, int yMin, int yMax) {
+  SplashBitmap *result = new SplashBitmap(src->getWidth(), src->getHeight(), src->getRowPad(),
+    src->getMode(), src->getAlphaPtr() != NULL, src->getRowSize() >= 0, src->getSeparationList());
+  int rowSize = src->getRowSize();
+  int y;
+
+  if (yMin < 0) {
+    yMin = 0;
+  }
+  if (yMax >= src->getHeight()) {
+    yMax = src->getHeight() - 1;
+  }
+  for (y = yMin; y <= yMax; ++y) {
+    memcpy(result->getDataPtr() + y * rowSize, src->getDataPtr() + y * rowSize,
+	   rowSize < 0 ? -rowSize : rowSize);
+  }
+  if (src->getAlphaPtr() != NULL && yMin <= yMax) {
+    memcpy(result->getAlphaPtr() + yMin * src->getWidth(),
+	   src->getAlphaPtr() + yMin * src->getWidth(),
+	   src->getWidth() * (yMax - yMin + 1));
+  }
+  return result;
+}
+
 SplashBitmap::~SplashBitmap() {
   if (data) {
     if (rowSize < 0) {
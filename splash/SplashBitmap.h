@@ -55,6 +55,10 @@ public:
 	       GBool topDown = gTrue, GooList *separationList = NULL);
   static SplashBitmap *copy(SplashBitmap *src);
 
+  // Create a bitmap like <src> and copy only its rows <yMin>..<yMax>;
+  // the other rows are left uninitialized.
+  static SplashBitmap *copyRows(SplashBitmap *src, int yMin, int yMax);
+
   ~SplashBitmap();
 
   int getWidth() { return width; }
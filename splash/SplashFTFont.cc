@@ -36,6 +36,7 @@
 #include FT_SIZES_H
 #include FT_GLYPH_H
 #include "goo/gmem.h"
+#include "goo/GooString.h"
 #include "SplashMath.h"
 #include "SplashGlyphBitmap.h"
 #include "SplashPath.h"
@@ -280,11 +281,7 @@ GBool SplashFTFont::makeGlyph(int c, int xFrac, int yFrac,
   FT_Set_Transform(ff->face, &matrix, &offset);
   slot = ff->face->glyph;
 
-  if (ff->codeToGID && c < ff->codeToGIDLen && c >= 0) {
-    gid = (FT_UInt)ff->codeToGID[c];
-  } else {
-    gid = (FT_UInt)c;
-  }
+  gid = getGID(c);
 
   if (FT_Load_Glyph(ff->face, gid, getFTLoadFlags(ff->type1, ff->trueType, aa, enableFreeTypeHinting, enableSlightHinting))) {
     return gFalse;
@@ -343,6 +340,35 @@ GBool SplashFTFont::makeGlyph(int c, int xFrac, int yFrac,
   return gTrue;
 }
 
+FT_UInt SplashFTFont::getGID(int c) {
+  SplashFTFontFile *ff;
+
+  ff = (SplashFTFontFile *)fontFile;
+  if (ff->codeToGID && c < ff->codeToGIDLen && c >= 0) {
+    return (FT_UInt)ff->codeToGID[c];
+  }
+  return (FT_UInt)c;
+}
+
+// The bitmap made by makeGlyph depends only on the face, the glyph
+// ID, the pixel size, the transform, the x offset and the load and
+// render flags -- all of them go into the key.
+GooString *SplashFTFont::getGlyphCacheKey(int c, int xFrac, int yFrac) {
+  SplashFTFontFile *ff;
+  GooString *key;
+
+  ff = (SplashFTFontFile *)fontFile;
+  key = ff->glyphCacheID->copy();
+  key->appendf(" {0:ud} {1:d} {2:d} {3:ld} {4:ld} {5:ld} {6:ld} {7:d} {8:d}",
+	       (Guint)getGID(c), xFrac, size,
+	       (long)matrix.xx, (long)matrix.yx,
+	       (long)matrix.xy, (long)matrix.yy,
+	       (int)getFTLoadFlags(ff->type1, ff->trueType, aa,
+				   enableFreeTypeHinting, enableSlightHinting),
+	       aa ? 1 : 0);
+  return key;
+}
+
 double SplashFTFont::getGlyphAdvance(int c)
 {
   SplashFTFontFile *ff;
@@ -58,6 +58,9 @@ public:
   virtual GBool makeGlyph(int c, int xFrac, int yFrac,
 			  SplashGlyphBitmap *bitmap, int x0, int y0, SplashClip *clip, SplashClipResult *clipRes);
 
+  // Return the key of a glyph in the global SplashGlyphCache.
+  virtual GooString *getGlyphCacheKey(int c, int xFrac, int yFrac);
+
   // Return the path for a glyph.
   virtual SplashPath *getGlyphPath(int c);
 
@@ -66,6 +69,8 @@ public:
 
 private:
 
+  FT_UInt getGID(int c);
+
   FT_Size sizeObj;
   FT_Matrix matrix;
   FT_Matrix textMatrix;
@@ -33,6 +33,7 @@
 #include "SplashFTFontEngine.h"
 #include "SplashFTFont.h"
 #include "SplashFTFontFile.h"
+#include "SplashGlyphCache.h"
 
 //------------------------------------------------------------------------
 // SplashFTFontFile
@@ -125,6 +126,21 @@ SplashFTFontFile::SplashFTFontFile(SplashFTFontEngine *engineA,
   codeToGIDLen = codeToGIDLenA;
   trueType = trueTypeA;
   type1 = type1A;
+
+  // embedded fonts are identified by their contents, so that the
+  // same font embedded in several documents shares its glyphs in the
+  // SplashGlyphCache; installed fonts are identified by their path
+  if (src->isFile) {
+    fontProgramID = -1;
+    glyphCacheID = GooString::format("f{0:d}:{1:t}:{2:d}",
+				     src->fileName->getLength(),
+				     src->fileName, (int)face->face_index);
+  } else {
+    fontProgramID =
+        SplashGlyphCache::getGlobalCache()->getFontProgramID(src);
+    glyphCacheID = GooString::format("b{0:d}:{1:d}",
+				     fontProgramID, (int)face->face_index);
+  }
 }
 
 SplashFTFontFile::~SplashFTFontFile() {
@@ -134,6 +150,10 @@ SplashFTFontFile::~SplashFTFontFile() {
   if (codeToGID) {
     gfree(codeToGID);
   }
+  delete glyphCacheID;
+  if (fontProgramID >= 0) {
+    SplashGlyphCache::getGlobalCache()->releaseFontProgram(fontProgramID);
+  }
 }
 
 SplashFont *SplashFTFontFile::makeFont(SplashCoord *mat,
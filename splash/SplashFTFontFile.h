@@ -77,6 +77,10 @@ private:
   int codeToGIDLen;
   GBool trueType;
   GBool type1;
+  int fontProgramID;		// SplashGlyphCache number of the embedded
+				//   font program, or -1 for a font file
+  GooString *glyphCacheID;	// identifies the font program and face
+				//   in SplashGlyphCache keys
 
   friend class SplashFTFont;
 };
@@ -27,8 +27,10 @@
 #include <limits.h>
 #include <string.h>
 #include "goo/gmem.h"
+#include "goo/GooString.h"
 #include "SplashMath.h"
 #include "SplashGlyphBitmap.h"
+#include "SplashGlyphCache.h"
 #include "SplashFontFile.h"
 #include "SplashFont.h"
 
@@ -122,6 +124,8 @@ SplashFont::~SplashFont() {
 GBool SplashFont::getGlyph(int c, int xFrac, int yFrac,
 			   SplashGlyphBitmap *bitmap, int x0, int y0, SplashClip *clip, SplashClipResult *clipRes) {
   SplashGlyphBitmap bitmap2;
+  SplashGlyphCache *glyphCache;
+  GooString *key;
   int size;
   Guchar *p;
   int i, j, k;
@@ -164,10 +168,24 @@ GBool SplashFont::getGlyph(int c, int xFrac, int yFrac,
     }
   }
 
-  // generate the glyph bitmap
-  if (!makeGlyph(c, xFrac, yFrac, &bitmap2, x0, y0, clip, clipRes)) {
-    return gFalse;
+  // check the global cache, or generate the glyph bitmap
+  glyphCache = SplashGlyphCache::getGlobalCache();
+  key = getGlyphCacheKey(c, xFrac, yFrac);
+  if (key && glyphCache->lookup(key, &bitmap2)) {
+    *clipRes = clip->testRect(x0 - bitmap2.x,
+                              y0 - bitmap2.y,
+                              x0 - bitmap2.x + bitmap2.w - 1,
+                              y0 - bitmap2.y + bitmap2.h - 1);
+  } else {
+    if (!makeGlyph(c, xFrac, yFrac, &bitmap2, x0, y0, clip, clipRes)) {
+      delete key;
+      return gFalse;
+    }
+    if (key && *clipRes != splashClipAllOutside) {
+      glyphCache->put(key, &bitmap2);
+    }
   }
+  delete key;
 
   if (*clipRes == splashClipAllOutside)
   {
@@ -31,6 +31,7 @@
 
 struct SplashGlyphBitmap;
 struct SplashFontCacheTag;
+class GooString;
 class SplashFontFile;
 class SplashPath;
 
@@ -71,8 +72,9 @@ public:
            textMatA[2] == textMat[2] && textMatA[3] == textMat[3];
   }
 
-  // Get a glyph - this does a cache lookup first, and if not found,
-  // creates a new bitmap and adds it to the cache.  The <xFrac> and
+  // Get a glyph - this does a cache lookup first (in this font's
+  // cache, then in the global SplashGlyphCache), and if not found,
+  // creates a new bitmap and adds it to the caches.  The <xFrac> and
   // <yFrac> values are splashFontFractionBits bits each, representing
   // the numerators of fractions in [0, 1), where the denominator is
   // splashFontFraction = 1 << splashFontFractionBits.  Subclasses
@@ -86,6 +88,15 @@ public:
   virtual GBool makeGlyph(int c, int xFrac, int yFrac,
 			  SplashGlyphBitmap *bitmap, int x0, int y0, SplashClip *clip, SplashClipResult *clipRes) = 0;
 
+  // Return the key under which the glyph bitmap is stored in the
+  // global SplashGlyphCache, or NULL if it can't be shared.  The key
+  // must identify the glyph outline, the rasterization settings and
+  // the transform independently of the document, so that any font
+  // returning the same key renders the same bitmap.  The default
+  // implementation returns NULL.
+  virtual GooString *getGlyphCacheKey(int c, int xFrac, int yFrac)
+    { return NULL; }
+
   // Return the path for a glyph.
   virtual SplashPath *getGlyphPath(int c) = 0;
 
@@ -0,0 +1,310 @@
+//========================================================================
+//
+// SplashGlyphCache.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <string.h>
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#include "SplashFontFile.h"
+#include "SplashGlyphBitmap.h"
+#include "SplashGlyphCache.h"
+
+#if MULTITHREADED
+#  define shardLocker(shard)   MutexLocker locker(&(shard)->mutex)
+#  define fontProgramLocker()  MutexLocker locker(&fontProgramMutex)
+#else
+#  define shardLocker(shard)
+#  define fontProgramLocker()
+#endif
+
+// Memory charged for an entry on top of its bitmap and key.
+#define splashGlyphCacheEntryOverhead 64
+
+//------------------------------------------------------------------------
+// SplashGlyphCache
+//------------------------------------------------------------------------
+
+SplashGlyphCache *SplashGlyphCache::getGlobalCache() {
+  static SplashGlyphCache globalCache(splashGlyphCacheDefaultSize);
+
+  return &globalCache;
+}
+
+SplashGlyphCache::SplashGlyphCache(Goffset maxBytesA) {
+  Shard *shard;
+  int i;
+
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &shards[i];
+    shard->cache = new GooLRUCache<std::string, Entry>(
+			   maxBytesA / splashGlyphCacheShards);
+#if MULTITHREADED
+    gInitMutex(&shard->mutex);
+#endif
+  }
+  unusedHead = unusedTail = NULL;
+  unusedBytes = 0;
+  maxUnusedBytes = maxBytesA;
+  nextFontProgramID = 0;
+#if MULTITHREADED
+  gInitMutex(&fontProgramMutex);
+#endif
+}
+
+SplashGlyphCache::~SplashGlyphCache() {
+  int i;
+
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    delete shards[i].cache;
+#if MULTITHREADED
+    gDestroyMutex(&shards[i].mutex);
+#endif
+  }
+  while (!fontProgramsByID.empty()) {
+    deleteFontProgram(fontProgramsByID.begin()->second);
+  }
+#if MULTITHREADED
+  gDestroyMutex(&fontProgramMutex);
+#endif
+}
+
+GBool SplashGlyphCache::lookup(GooString *key, SplashGlyphBitmap *bitmap) {
+  Shard *shard;
+  Entry *entry;
+  Goffset dataSize;
+
+  shard = getShard(key);
+  shardLocker(shard);
+  if (!(entry = shard->cache->lookup(std::string(key->getCString(),
+						 key->getLength())))) {
+    return gFalse;
+  }
+  bitmap->x = entry->x;
+  bitmap->y = entry->y;
+  bitmap->w = entry->w;
+  bitmap->h = entry->h;
+  bitmap->aa = entry->aa;
+  if (entry->aa) {
+    dataSize = (Goffset)entry->w * entry->h;
+  } else {
+    dataSize = (Goffset)((entry->w + 7) >> 3) * entry->h;
+  }
+  bitmap->data = (Guchar *)gmalloc((int)dataSize);
+  memcpy(bitmap->data, entry->data, dataSize);
+  bitmap->freeData = gTrue;
+  return gTrue;
+}
+
+void SplashGlyphCache::put(GooString *key, SplashGlyphBitmap *bitmap) {
+  Shard *shard;
+  Entry *entry;
+  Goffset dataSize, size;
+
+  if (!bitmap->data || bitmap->w <= 0 || bitmap->h <= 0) {
+    return;
+  }
+  if (bitmap->aa) {
+    dataSize = (Goffset)bitmap->w * bitmap->h;
+  } else {
+    dataSize = (Goffset)((bitmap->w + 7) >> 3) * bitmap->h;
+  }
+  size = dataSize + key->getLength() + splashGlyphCacheEntryOverhead;
+
+  std::string k(key->getCString(), key->getLength());
+  shard = getShard(key);
+  shardLocker(shard);
+  if (size > shard->cache->getMaxBytes() || shard->cache->lookup(k)) {
+    return;
+  }
+  entry = new Entry;
+  entry->x = bitmap->x;
+  entry->y = bitmap->y;
+  entry->w = bitmap->w;
+  entry->h = bitmap->h;
+  entry->aa = bitmap->aa;
+  entry->data = (Guchar *)gmalloc((int)dataSize);
+  memcpy(entry->data, bitmap->data, dataSize);
+  shard->cache->put(k, entry, size);
+}
+
+void SplashGlyphCache::clear() {
+  Shard *shard;
+  int i;
+
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &shards[i];
+    shardLocker(shard);
+    shard->cache->clear();
+  }
+}
+
+void SplashGlyphCache::setMaxBytes(Goffset maxBytesA) {
+  Shard *shard;
+  int i;
+
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &shards[i];
+    shardLocker(shard);
+    shard->cache->setMaxBytes(maxBytesA / splashGlyphCacheShards);
+  }
+
+  fontProgramLocker();
+  maxUnusedBytes = maxBytesA;
+  shrinkUnusedFontPrograms();
+}
+
+Goffset SplashGlyphCache::getMaxBytes() {
+  Shard *shard;
+
+  shard = &shards[0];
+  shardLocker(shard);
+  return shard->cache->getMaxBytes() * splashGlyphCacheShards;
+}
+
+Goffset SplashGlyphCache::getBytes() {
+  Shard *shard;
+  Goffset bytes;
+  int i;
+
+  bytes = 0;
+  for (i = 0; i < splashGlyphCacheShards; ++i) {
+    shard = &shards[i];
+    shardLocker(shard);
+    bytes += shard->cache->getBytes();
+  }
+  return bytes;
+}
+
+int SplashGlyphCache::getFontProgramID(SplashFontSrc *src) {
+  std::multimap<unsigned long long, FontProgram *>::iterator it;
+  FontProgram *prog;
+  unsigned long long hash;
+
+  hash = hashFontProgram(src->buf, src->bufLen);
+  fontProgramLocker();
+  for (it = fontPrograms.find(hash);
+       it != fontPrograms.end() && it->first == hash;
+       ++it) {
+    prog = it->second;
+    if (prog->len == src->bufLen &&
+	!memcmp(prog->buf, src->buf, src->bufLen)) {
+      if (prog->refCnt++ == 0) {
+	// take it off the unused list
+	if (prog->prev) {
+	  prog->prev->next = prog->next;
+	} else {
+	  unusedHead = prog->next;
+	}
+	if (prog->next) {
+	  prog->next->prev = prog->prev;
+	} else {
+	  unusedTail = prog->prev;
+	}
+	unusedBytes -= prog->len;
+      }
+      return prog->id;
+    }
+  }
+
+  prog = new FontProgram;
+  prog->buf = (char *)gmalloc(src->bufLen > 0 ? src->bufLen : 1);
+  memcpy(prog->buf, src->buf, src->bufLen);
+  prog->len = src->bufLen;
+  prog->hash = hash;
+  prog->id = nextFontProgramID++;
+  prog->refCnt = 1;
+  prog->prev = prog->next = NULL;
+  fontPrograms.insert(std::make_pair(hash, prog));
+  fontProgramsByID[prog->id] = prog;
+  return prog->id;
+}
+
+void SplashGlyphCache::releaseFontProgram(int id) {
+  std::map<int, FontProgram *>::iterator it;
+  FontProgram *prog;
+
+  fontProgramLocker();
+  if ((it = fontProgramsByID.find(id)) == fontProgramsByID.end() ||
+      --(prog = it->second)->refCnt > 0) {
+    return;
+  }
+  prog->prev = NULL;
+  prog->next = unusedHead;
+  if (unusedHead) {
+    unusedHead->prev = prog;
+  } else {
+    unusedTail = prog;
+  }
+  unusedHead = prog;
+  unusedBytes += prog->len;
+  shrinkUnusedFontPrograms();
+}
+
+// Forget a program.  Any glyphs cached under its number can't be
+// found any more, and age out of the cache.
+void SplashGlyphCache::deleteFontProgram(FontProgram *prog) {
+  std::multimap<unsigned long long, FontProgram *>::iterator it;
+
+  for (it = fontPrograms.find(prog->hash); it->second != prog; ++it) ;
+  fontPrograms.erase(it);
+  fontProgramsByID.erase(prog->id);
+  gfree(prog->buf);
+  delete prog;
+}
+
+// Drop the least recently released programs until the unused ones fit
+// in their budget.
+void SplashGlyphCache::shrinkUnusedFontPrograms() {
+  FontProgram *prog;
+
+  while (unusedTail && unusedBytes > maxUnusedBytes) {
+    prog = unusedTail;
+    unusedTail = prog->prev;
+    if (unusedTail) {
+      unusedTail->next = NULL;
+    } else {
+      unusedHead = NULL;
+    }
+    unusedBytes -= prog->len;
+    deleteFontProgram(prog);
+  }
+}
+
+// 64-bit FNV-1a hash of a font program.
+unsigned long long SplashGlyphCache::hashFontProgram(char *buf, int len) {
+  unsigned long long h;
+  int i;
+
+  h = 14695981039346656037ULL;
+  for (i = 0; i < len; ++i) {
+    h = (h ^ (unsigned long long)(buf[i] & 0xff)) * 1099511628211ULL;
+  }
+  return h;
+}
+
+SplashGlyphCache::Entry::~Entry() {
+  gfree(data);
+}
+
+// Pick the shard with an FNV-1a hash of the key.
+SplashGlyphCache::Shard *SplashGlyphCache::getShard(GooString *key) {
+  const char *p;
+  Guint h;
+  int i;
+
+  h = 2166136261u;
+  for (p = key->getCString(), i = 0; i < key->getLength(); ++p, ++i) {
+    h = (h ^ (Guint)(*p & 0xff)) * 16777619u;
+  }
+  return &shards[h % splashGlyphCacheShards];
+}
@@ -0,0 +1,139 @@
+//========================================================================
+//
+// SplashGlyphCache.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef SPLASHGLYPHCACHE_H
+#define SPLASHGLYPHCACHE_H
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include <map>
+#include <string>
+#include "goo/gtypes.h"
+#include "goo/GooLRUCache.h"
+#include "goo/GooMutex.h"
+
+class GooString;
+class SplashFontSrc;
+struct SplashGlyphBitmap;
+
+//------------------------------------------------------------------------
+
+// Default memory budget of the global glyph cache.
+#define splashGlyphCacheDefaultSize (16 * 1024 * 1024)
+
+// Number of independently locked parts of the cache.
+#define splashGlyphCacheShards 8
+
+//------------------------------------------------------------------------
+// SplashGlyphCache
+//------------------------------------------------------------------------
+
+// LRU cache of rasterized glyph bitmaps, bounded by the memory held by
+// the bitmaps.  Unlike the small per-SplashFont caches, it is shared
+// by all fonts, SplashFontEngines and threads, so a glyph that was
+// rasterized once is reused by later documents and by the other bands
+// of a page.  Fonts which can identify their glyphs independently of
+// the document (see SplashFont::getGlyphCacheKey) use the global
+// instance.
+//
+// The cache is split into splashGlyphCacheShards parts, each with its
+// own lock, LRU list and share of the memory budget, so that threads
+// looking up different glyphs rarely wait for each other.
+//
+// Embedded font programs are identified in keys by a number from
+// getFontProgramID, which compares the font bytes, so that two
+// different fonts can't share glyphs even if their hashes collide.
+class SplashGlyphCache {
+public:
+
+  // Return the process-wide cache.
+  static SplashGlyphCache *getGlobalCache();
+
+  SplashGlyphCache(Goffset maxBytesA);
+  ~SplashGlyphCache();
+
+  // Look up the glyph cached under <key>.  If there is one, set
+  // <bitmap> to a copy of it (with freeData set) and return true.
+  GBool lookup(GooString *key, SplashGlyphBitmap *bitmap);
+
+  // Add a copy of <bitmap> under <key>, evicting the least recently
+  // used glyphs if the memory budget is exceeded.  Does nothing if
+  // <key> is already cached.
+  void put(GooString *key, SplashGlyphBitmap *bitmap);
+
+  // Drop all the glyphs.
+  void clear();
+
+  // Set the memory budget.  Zero turns the cache off.
+  void setMaxBytes(Goffset maxBytesA);
+  Goffset getMaxBytes();
+
+  // Memory held by the cached glyphs.
+  Goffset getBytes();
+
+  // Return the number which identifies the embedded font program in
+  // <src> in glyph keys.  Programs with the same bytes get the same
+  // number, different programs never do, and numbers aren't reused.
+  // Each call must be matched by a call to releaseFontProgram.
+  int getFontProgramID(SplashFontSrc *src);
+
+  // Release a number returned by getFontProgramID.  A program which
+  // is no longer used is kept, within a budget equal to the glyph
+  // budget, so that a document opened later which embeds the same
+  // font finds its glyphs.
+  void releaseFontProgram(int id);
+
+private:
+
+  struct Entry {
+    int x, y, w, h;		// offset and size of glyph
+    GBool aa;
+    Guchar *data;
+    ~Entry();
+  };
+
+  struct Shard {
+    GooLRUCache<std::string, Entry> *cache;
+#if MULTITHREADED
+    GooMutex mutex;
+#endif
+  };
+
+  struct FontProgram {
+    char *buf;			// copy of the font program
+    int len;
+    unsigned long long hash;
+    int id;
+    int refCnt;			// number of getFontProgramID calls
+				//   not yet released
+    FontProgram *prev, *next;	// list of unused programs, most
+				//   recently released first
+  };
+
+  Shard *getShard(GooString *key);
+  static unsigned long long hashFontProgram(char *buf, int len);
+  void deleteFontProgram(FontProgram *prog);
+  void shrinkUnusedFontPrograms();
+
+  Shard shards[splashGlyphCacheShards];
+
+  // by hash
+  std::multimap<unsigned long long, FontProgram *> fontPrograms;
+  std::map<int, FontProgram *> fontProgramsByID;
+  FontProgram *unusedHead, *unusedTail;
+  Goffset unusedBytes;		// size of the unused programs
+  Goffset maxUnusedBytes;	// budget for the unused programs
+  int nextFontProgramID;
+#if MULTITHREADED
+  GooMutex fontProgramMutex;
+#endif
+};
+
+#endif
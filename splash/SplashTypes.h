@@ -46,6 +46,13 @@ typedef double SplashCoord;
 
 #define splashAASize 4
 
+enum SplashAAMode {
+  splashAASupersample,		// count the covered points on a
+				//   splashAASize x splashAASize grid
+  splashAAAnalytic		// compute the exact area of each pixel
+				//   covered by the path
+};
+
 #ifndef SPOT_NCOMPS
 #define SPOT_NCOMPS 4
 #endif
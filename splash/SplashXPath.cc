@@ -28,6 +28,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <algorithm>
 #include "goo/gmem.h"
 #include "SplashMath.h"
@@ -151,6 +152,7 @@ SplashXPath::SplashXPath(SplashPath *path, SplashCoord *matrix,
   }
 
   // perform stroke adjustment
+  strokeAdjusted = adjusts != NULL;
   if (adjusts) {
     for (i = 0, adjust = adjusts; i < path->hintsLength; ++i, ++adjust) {
       for (j = adjust->firstPt; j <= adjust->lastPt; ++j) {
@@ -256,6 +258,7 @@ SplashXPath::SplashXPath(SplashXPath *xPath) {
   size = xPath->size;
   segs = (SplashXPathSeg *)gmallocn(size, sizeof(SplashXPathSeg));
   memcpy(segs, xPath->segs, length * sizeof(SplashXPathSeg));
+  strokeAdjusted = xPath->strokeAdjusted;
 }
 
 SplashXPath::~SplashXPath() {
@@ -467,6 +470,93 @@ void SplashXPath::aaScale() {
   }
 }
 
+// Paths with fewer segments than this are sorted with std::sort;
+// longer ones with a radix sort on their (fixed-point) upper y
+// coordinate.
+#define splashXPathRadixSortMin 64
+
+// Number of fractional bits in the radix sort keys.  The keys only
+// need to order the segments correctly relative to the pixel (and
+// anti-aliasing sub-pixel) lines, which are all at integer
+// coordinates.
+#define splashXPathSortFracBits 4
+
+struct SplashXPathSortEntry {
+  Guint key;
+  int idx;
+};
+
+// Returns the radix sort key for a segment with upper coordinate <y>:
+// y in fixed point, offset so that the keys sort as unsigned
+// integers.
+static inline Guint xPathSortKey(SplashCoord y) {
+  double t;
+
+  t = (double)y * (1 << splashXPathSortFracBits);
+  if (t < -2147483648.0) {
+    return 0;
+  }
+  if (t >= 2147483647.0) {
+    return 0xffffffff;
+  }
+  return (Guint)(int)floor(t) ^ 0x80000000;
+}
+
 void SplashXPath::sort() {
-  std::sort(segs, segs + length, cmpXPathSegsFunctor());
+  SplashXPathSortEntry *ent, *ent2, *t;
+  SplashXPathSeg *segs2;
+  int count[4][256];
+  int pass, shift, sum, n, i;
+
+  if (length < splashXPathRadixSortMin) {
+    std::sort(segs, segs + length, cmpXPathSegsFunctor());
+    return;
+  }
+
+  // compute the keys, and the histograms of their four bytes
+  ent = (SplashXPathSortEntry *)gmallocn(length,
+					 sizeof(SplashXPathSortEntry));
+  ent2 = (SplashXPathSortEntry *)gmallocn(length,
+					  sizeof(SplashXPathSortEntry));
+  memset(count, 0, sizeof(count));
+  for (i = 0; i < length; ++i) {
+    ent[i].key = xPathSortKey((segs[i].flags & splashXPathFlip)
+			      ? segs[i].y1 : segs[i].y0);
+    ent[i].idx = i;
+    ++count[0][ent[i].key & 0xff];
+    ++count[1][(ent[i].key >> 8) & 0xff];
+    ++count[2][(ent[i].key >> 16) & 0xff];
+    ++count[3][ent[i].key >> 24];
+  }
+
+  // stable LSD passes, skipping the bytes which are the same in all
+  // keys (usually the high ones)
+  for (pass = 0; pass < 4; ++pass) {
+    shift = 8 * pass;
+    if (count[pass][(ent[0].key >> shift) & 0xff] == length) {
+      continue;
+    }
+    sum = 0;
+    for (i = 0; i < 256; ++i) {
+      n = count[pass][i];
+      count[pass][i] = sum;
+      sum += n;
+    }
+    for (i = 0; i < length; ++i) {
+      ent2[count[pass][(ent[i].key >> shift) & 0xff]++] = ent[i];
+    }
+    t = ent;
+    ent = ent2;
+    ent2 = t;
+  }
+
+  // move the segments into place
+  segs2 = (SplashXPathSeg *)gmallocn(size, sizeof(SplashXPathSeg));
+  for (i = 0; i < length; ++i) {
+    segs2[i] = segs[ent[i].idx];
+  }
+  gfree(segs);
+  segs = segs2;
+  gfree(ent);
+  gfree(ent2);
 }
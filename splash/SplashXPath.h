@@ -76,7 +76,9 @@ public:
   // anti-aliased rendering.
   void aaScale();
 
-  // Sort by upper coordinate (lower y), in y-major order.
+  // Sort by upper coordinate (lower y), in y-major order.  Long paths
+  // are only sorted by y, to 1/16 pixel, which is all
+  // SplashXPathScanner needs.
   void sort();
 
 protected:
@@ -98,6 +100,8 @@ protected:
 
   SplashXPathSeg *segs;
   int length, size;		// length and size of segs array
+  GBool strokeAdjusted;		// set if stroke adjustment moved the
+				//   points onto the pixel grid
 
   friend class SplashXPathScanner;
   friend class SplashClip;
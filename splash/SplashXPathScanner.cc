@@ -119,15 +119,33 @@ SplashXPathScanner::SplashXPathScanner(SplashXPath *xPathA, GBool eoA,
     }
   }
 
+  // the intersections are computed as the lines are requested --
+  // they aren't needed by renderAALineAnalytic
   allInter = NULL;
+  allInterLen = allInterSize = 0;
   inter = NULL;
-  computeIntersections();
+  lineY = yMin - 1;
+  active = NULL;
+  activeLen = activeSize = 0;
+  nextSeg = 0;
   interY = yMin - 1;
+
+  covAcc = NULL;
+  covAccSize = 0;
+  covXMin = 0;
+  covXMax = -1;
+  covActive = NULL;
+  covActiveLen = covActiveSize = 0;
+  covNextSeg = 0;
+  covY = INT_MIN;
 }
 
 SplashXPathScanner::~SplashXPathScanner() {
   gfree(inter);
   gfree(allInter);
+  gfree(active);
+  gfree(covAcc);
+  gfree(covActive);
 }
 
 void SplashXPathScanner::getBBoxAA(int *xMinA, int *yMinA,
@@ -139,20 +157,16 @@ void SplashXPathScanner::getBBoxAA(int *xMinA, int *yMinA,
 }
 
 void SplashXPathScanner::getSpanBounds(int y, int *spanXMin, int *spanXMax) {
-  int interBegin, interEnd, xx, i;
-
-  if (y < yMin || y > yMax) {
-    interBegin = interEnd = 0;
-  } else {
-    interBegin = inter[y - yMin];
-    interEnd = inter[y - yMin + 1];
-  }
-  if (interBegin < interEnd) {
-    *spanXMin = allInter[interBegin].x0;
-    xx = allInter[interBegin].x1;
-    for (i = interBegin + 1; i < interEnd; ++i) {
-      if (allInter[i].x1 > xx) {
-	xx = allInter[i].x1;
+  SplashIntersect *line;
+  int nInter, xx, i;
+
+  line = getIntersections(y, &nInter);
+  if (nInter > 0) {
+    *spanXMin = line[0].x0;
+    xx = line[0].x1;
+    for (i = 1; i < nInter; ++i) {
+      if (line[i].x1 > xx) {
+	xx = line[i].x1;
       }
     }
     *spanXMax = xx;
@@ -163,50 +177,50 @@ void SplashXPathScanner::getSpanBounds(int y, int *spanXMin, int *spanXMax) {
 }
 
 GBool SplashXPathScanner::test(int x, int y) {
-  int interBegin, interEnd, count, i;
+  SplashIntersect *line;
+  int nInter, count, i;
 
   if (y < yMin || y > yMax) {
     return gFalse;
   }
-  interBegin = inter[y - yMin];
-  interEnd = inter[y - yMin + 1];
+  line = getIntersections(y, &nInter);
   count = 0;
-  for (i = interBegin; i < interEnd && allInter[i].x0 <= x; ++i) {
-    if (x <= allInter[i].x1) {
+  for (i = 0; i < nInter && line[i].x0 <= x; ++i) {
+    if (x <= line[i].x1) {
       return gTrue;
     }
-    count += allInter[i].count;
+    count += line[i].count;
   }
   return eo ? (count & 1) : (count != 0);
 }
 
 GBool SplashXPathScanner::testSpan(int x0, int x1, int y) {
-  int interBegin, interEnd, count, xx1, i;
+  SplashIntersect *line;
+  int nInter, count, xx1, i;
 
   if (y < yMin || y > yMax) {
     return gFalse;
   }
-  interBegin = inter[y - yMin];
-  interEnd = inter[y - yMin + 1];
+  line = getIntersections(y, &nInter);
   count = 0;
-  for (i = interBegin; i < interEnd && allInter[i].x1 < x0; ++i) {
-    count += allInter[i].count;
+  for (i = 0; i < nInter && line[i].x1 < x0; ++i) {
+    count += line[i].count;
   }
 
   // invariant: the subspan [x0,xx1] is inside the path
   xx1 = x0 - 1;
   while (xx1 < x1) {
-    if (i >= interEnd) {
+    if (i >= nInter) {
       return gFalse;
     }
-    if (allInter[i].x0 > xx1 + 1 &&
+    if (line[i].x0 > xx1 + 1 &&
 	!(eo ? (count & 1) : (count != 0))) {
       return gFalse;
     }
-    if (allInter[i].x1 > xx1) {
-      xx1 = allInter[i].x1;
+    if (line[i].x1 > xx1) {
+      xx1 = line[i].x1;
     }
-    count += allInter[i].count;
+    count += line[i].count;
     ++i;
   }
 
@@ -214,31 +228,32 @@ GBool SplashXPathScanner::testSpan(int x0, int x1, int y) {
 }
 
 GBool SplashXPathScanner::getNextSpan(int y, int *x0, int *x1) {
-  int interEnd, xx0, xx1;
+  SplashIntersect *line;
+  int nInter, xx0, xx1;
 
   if (y < yMin || y > yMax) {
     return gFalse;
   }
+  line = getIntersections(y, &nInter);
   if (interY != y) {
     interY = y;
-    interIdx = inter[y - yMin];
+    interIdx = 0;
     interCount = 0;
   }
-  interEnd = inter[y - yMin + 1];
-  if (interIdx >= interEnd) {
+  if (interIdx >= nInter) {
     return gFalse;
   }
-  xx0 = allInter[interIdx].x0;
-  xx1 = allInter[interIdx].x1;
-  interCount += allInter[interIdx].count;
+  xx0 = line[interIdx].x0;
+  xx1 = line[interIdx].x1;
+  interCount += line[interIdx].count;
   ++interIdx;
-  while (interIdx < interEnd &&
-	 (allInter[interIdx].x0 <= xx1 ||
+  while (interIdx < nInter &&
+	 (line[interIdx].x0 <= xx1 ||
 	  (eo ? (interCount & 1) : (interCount != 0)))) {
-    if (allInter[interIdx].x1 > xx1) {
-      xx1 = allInter[interIdx].x1;
+    if (line[interIdx].x1 > xx1) {
+      xx1 = line[interIdx].x1;
     }
-    interCount += allInter[interIdx].count;
+    interCount += line[interIdx].count;
     ++interIdx;
   }
   *x0 = xx0;
@@ -246,87 +261,43 @@ GBool SplashXPathScanner::getNextSpan(int y, int *x0, int *x1) {
   return gTrue;
 }
 
+// Returns the intersections at <y>, sorted by x0, and sets <nInter>
+// to their number.
+SplashIntersect *SplashXPathScanner::getIntersections(int y, int *nInter) {
+  if (y < yMin || y > yMax) {
+    *nInter = 0;
+    return NULL;
+  }
+  if (!inter) {
+    if (y > lineY) {
+      computeLineIntersections(y);
+    } else if (y < lineY) {
+      // the lines are being visited out of order: compute the
+      // intersections for all of them, once
+      computeIntersections();
+    }
+  }
+  if (!inter) {
+    *nInter = allInterLen;
+    return allInter;
+  }
+  *nInter = inter[y - yMin + 1] - inter[y - yMin];
+  return allInter + inter[y - yMin];
+}
+
 void SplashXPathScanner::computeIntersections() {
-  SplashXPathSeg *seg;
-  SplashCoord segXMin, segXMax, segYMin, segYMax, xx0, xx1;
-  int x, y, y0, y1, i;
+  int y, i;
 
-  if (yMin > yMax) {
-    return;
-  }
+  // drop the active segment list used by computeLineIntersections
+  gfree(active);
+  active = NULL;
+  activeLen = activeSize = 0;
 
   // build the list of all intersections
   allInterLen = 0;
-  allInterSize = 16;
-  allInter = (SplashIntersect *)gmallocn(allInterSize,
-					 sizeof(SplashIntersect));
   for (i = 0; i < xPath->length; ++i) {
-    seg = &xPath->segs[i];
-    if (seg->flags & splashXPathFlip) {
-      segYMin = seg->y1;
-      segYMax = seg->y0;
-    } else {
-      segYMin = seg->y0;
-      segYMax = seg->y1;
-    }
-    if (seg->flags & splashXPathHoriz) {
-      y = splashFloor(seg->y0);
-      if (y >= yMin && y <= yMax) {
-	if (!addIntersection(segYMin, segYMax, seg->flags,
-			y, splashFloor(seg->x0), splashFloor(seg->x1)))
-          break;
-      }
-    } else if (seg->flags & splashXPathVert) {
-      y0 = splashFloor(segYMin);
-      if (y0 < yMin) {
-	y0 = yMin;
-      }
-      y1 = splashFloor(segYMax);
-      if (y1 > yMax) {
-	y1 = yMax;
-      }
-      x = splashFloor(seg->x0);
-      for (y = y0; y <= y1; ++y) {
-	if (!addIntersection(segYMin, segYMax, seg->flags, y, x, x))
-          break;
-      }
-    } else {
-      if (seg->x0 < seg->x1) {
-	segXMin = seg->x0;
-	segXMax = seg->x1;
-      } else {
-	segXMin = seg->x1;
-	segXMax = seg->x0;
-      }
-      y0 = splashFloor(segYMin);
-      if (y0 < yMin) {
-	y0 = yMin;
-      }
-      y1 = splashFloor(segYMax);
-      if (y1 > yMax) {
-	y1 = yMax;
-      }
-      // this loop could just add seg->dxdy to xx1 on each iteration,
-      // but that introduces numerical accuracy problems
-      xx1 = seg->x0 + ((SplashCoord)y0 - seg->y0) * seg->dxdy;
-      for (y = y0; y <= y1; ++y) {
-	xx0 = xx1;
-	xx1 = seg->x0 + ((SplashCoord)(y + 1) - seg->y0) * seg->dxdy;
-	// the segment may not actually extend to the top and/or bottom edges
-	if (xx0 < segXMin) {
-	  xx0 = segXMin;
-	} else if (xx0 > segXMax) {
-	  xx0 = segXMax;
-	}
-	if (xx1 < segXMin) {
-	  xx1 = segXMin;
-	} else if (xx1 > segXMax) {
-	  xx1 = segXMax;
-	}
-	if (!addIntersection(segYMin, segYMax, seg->flags, y,
-			splashFloor(xx0), splashFloor(xx1)))
-          break;
-      }
+    if (!addSegIntersections(&xPath->segs[i], yMin, yMax)) {
+      break;
     }
   }
   std::sort(allInter, allInter + allInterLen, cmpIntersectFunctor());
@@ -343,11 +314,125 @@ void SplashXPathScanner::computeIntersections() {
   inter[yMax - yMin + 1] = i;
 }
 
+// Compute the intersections at <y>, which must be below the
+// previously computed line, using an active edge list: the segments
+// are added to the list when the scan reaches their top, and dropped
+// once it has passed their bottom.
+void SplashXPathScanner::computeLineIntersections(int y) {
+  SplashXPathSeg *seg;
+  SplashCoord segYMin, segYMax;
+  int i, j;
+
+  // add the segments which start above the bottom of this line (the
+  // segments are sorted by their top y coordinate)
+  while (nextSeg < xPath->length) {
+    seg = &xPath->segs[nextSeg];
+    segYMin = (seg->flags & splashXPathFlip) ? seg->y1 : seg->y0;
+    if (segYMin >= y + 1) {
+      break;
+    }
+    if (activeLen == activeSize) {
+      activeSize = activeSize ? 2 * activeSize : 16;
+      active = (int *)greallocn(active, activeSize, sizeof(int));
+    }
+    active[activeLen++] = nextSeg++;
+  }
+
+  // intersect the segments with this line, and drop the ones which
+  // end above it
+  allInterLen = 0;
+  for (i = j = 0; i < activeLen; ++i) {
+    seg = &xPath->segs[active[i]];
+    segYMax = (seg->flags & splashXPathFlip) ? seg->y0 : seg->y1;
+    if (segYMax < y) {
+      continue;
+    }
+    active[j++] = active[i];
+    addSegIntersections(seg, y, y);
+  }
+  activeLen = j;
+  std::sort(allInter, allInter + allInterLen, cmpIntersectFunctor());
+  lineY = y;
+}
+
+// Add the intersections of <seg> with the lines in [<y0>, <y1>]
+// (which must be within [yMin, yMax]).
+GBool SplashXPathScanner::addSegIntersections(SplashXPathSeg *seg,
+					      int y0, int y1) {
+  SplashCoord segXMin, segXMax, segYMin, segYMax, xx0, xx1;
+  int x, y;
+
+  if (seg->flags & splashXPathFlip) {
+    segYMin = seg->y1;
+    segYMax = seg->y0;
+  } else {
+    segYMin = seg->y0;
+    segYMax = seg->y1;
+  }
+  if (seg->flags & splashXPathHoriz) {
+    y = splashFloor(seg->y0);
+    if (y >= y0 && y <= y1) {
+      return addIntersection(segYMin, segYMax, seg->flags,
+			     y, splashFloor(seg->x0), splashFloor(seg->x1));
+    }
+  } else if (seg->flags & splashXPathVert) {
+    if (splashFloor(segYMin) > y0) {
+      y0 = splashFloor(segYMin);
+    }
+    if (splashFloor(segYMax) < y1) {
+      y1 = splashFloor(segYMax);
+    }
+    x = splashFloor(seg->x0);
+    for (y = y0; y <= y1; ++y) {
+      if (!addIntersection(segYMin, segYMax, seg->flags, y, x, x)) {
+	return gFalse;
+      }
+    }
+  } else {
+    if (seg->x0 < seg->x1) {
+      segXMin = seg->x0;
+      segXMax = seg->x1;
+    } else {
+      segXMin = seg->x1;
+      segXMax = seg->x0;
+    }
+    if (splashFloor(segYMin) > y0) {
+      y0 = splashFloor(segYMin);
+    }
+    if (splashFloor(segYMax) < y1) {
+      y1 = splashFloor(segYMax);
+    }
+    // this loop could just add seg->dxdy to xx1 on each iteration,
+    // but that introduces numerical accuracy problems
+    xx1 = seg->x0 + ((SplashCoord)y0 - seg->y0) * seg->dxdy;
+    for (y = y0; y <= y1; ++y) {
+      xx0 = xx1;
+      xx1 = seg->x0 + ((SplashCoord)(y + 1) - seg->y0) * seg->dxdy;
+      // the segment may not actually extend to the top and/or bottom edges
+      if (xx0 < segXMin) {
+	xx0 = segXMin;
+      } else if (xx0 > segXMax) {
+	xx0 = segXMax;
+      }
+      if (xx1 < segXMin) {
+	xx1 = segXMin;
+      } else if (xx1 > segXMax) {
+	xx1 = segXMax;
+      }
+      if (!addIntersection(segYMin, segYMax, seg->flags, y,
+			   splashFloor(xx0), splashFloor(xx1))) {
+	return gFalse;
+      }
+    }
+  }
+  return gTrue;
+}
+
 GBool SplashXPathScanner::addIntersection(double segYMin, double segYMax,
 					 Guint segFlags,
 					 int y, int x0, int x1) {
   if (allInterLen == allInterSize) {
-    unsigned int newInterSize = ((unsigned int) allInterSize * 2 > INT_MAX / sizeof(SplashIntersect)) ? allInterSize + 32768 : allInterSize * 2;
+    unsigned int newInterSize = (allInterSize == 0) ? 16 : ((unsigned int) allInterSize * 2 > INT_MAX / sizeof(SplashIntersect)) ? allInterSize + 32768 : allInterSize * 2;
     if (newInterSize >= INT_MAX / sizeof(SplashIntersect)) {
       error(errInternal, -1, "Bogus memory allocation size in SplashXPathScanner::addIntersection {0:d}", newInterSize);
       return gFalse;
@@ -378,77 +463,64 @@ GBool SplashXPathScanner::addIntersection(double segYMin, double segYMax,
 
 void SplashXPathScanner::renderAALine(SplashBitmap *aaBuf,
 				      int *x0, int *x1, int y, GBool adjustVertLine) {
-  int xx0, xx1, xx, xxMin, xxMax, yy, interEnd;
+  SplashIntersect *line;
+  int nInter, xx0, xx1, xx, xxMin, xxMax, yy, i, count;
   Guchar mask;
   SplashColorPtr p;
 
   memset(aaBuf->getDataPtr(), 0, aaBuf->getRowSize() * aaBuf->getHeight());
   xxMin = aaBuf->getWidth();
   xxMax = -1;
-  if (yMin <= yMax) {
-    if (splashAASize * y < yMin) {
-      interIdx = inter[0];
-    } else if (splashAASize * y > yMax) {
-      interIdx = inter[yMax - yMin + 1];
-    } else {
-      interIdx = inter[splashAASize * y - yMin];
-    }
-    for (yy = 0; yy < splashAASize; ++yy) {
-      if (splashAASize * y + yy < yMin) {
-	interEnd = inter[0];
-      } else if (splashAASize * y + yy > yMax) {
-	interEnd = inter[yMax - yMin + 1];
-      } else {
-	interEnd = inter[splashAASize * y + yy - yMin + 1];
-      }
-      interCount = 0;
-      while (interIdx < interEnd) {
-	xx0 = allInter[interIdx].x0;
-	xx1 = allInter[interIdx].x1;
-	interCount += allInter[interIdx].count;
-	++interIdx;
-	while (interIdx < interEnd &&
-	       (allInter[interIdx].x0 <= xx1 ||
-		(eo ? (interCount & 1) : (interCount != 0)))) {
-	  if (allInter[interIdx].x1 > xx1) {
-	    xx1 = allInter[interIdx].x1;
-	  }
-	  interCount += allInter[interIdx].count;
-	  ++interIdx;
-	}
-	if (xx0 < 0) {
-	  xx0 = 0;
-	}
-	++xx1;
-	if (xx1 > aaBuf->getWidth()) {
-	  xx1 = aaBuf->getWidth();
+  for (yy = 0; yy < splashAASize; ++yy) {
+    line = getIntersections(splashAASize * y + yy, &nInter);
+    count = 0;
+    i = 0;
+    while (i < nInter) {
+      xx0 = line[i].x0;
+      xx1 = line[i].x1;
+      count += line[i].count;
+      ++i;
+      while (i < nInter &&
+	     (line[i].x0 <= xx1 ||
+	      (eo ? (count & 1) : (count != 0)))) {
+	if (line[i].x1 > xx1) {
+	  xx1 = line[i].x1;
 	}
-	// set [xx0, xx1) to 1
-	if (xx0 < xx1) {
-	  xx = xx0;
-	  p = aaBuf->getDataPtr() + yy * aaBuf->getRowSize() + (xx >> 3);
-	  if (xx & 7) {
-	    mask = adjustVertLine ? 0xff : 0xff >> (xx & 7);
-	    if (!adjustVertLine && (xx & ~7) == (xx1 & ~7)) {
-	      mask &= (Guchar)(0xff00 >> (xx1 & 7));
-	    }
-	    *p++ |= mask;
-	    xx = (xx & ~7) + 8;
-	  }
-	  for (; xx + 7 < xx1; xx += 8) {
-	    *p++ |= 0xff;
-	  }
-	  if (xx < xx1) {
-	    *p |= adjustVertLine ? 0xff : (Guchar)(0xff00 >> (xx1 & 7));
+	count += line[i].count;
+	++i;
+      }
+      if (xx0 < 0) {
+	xx0 = 0;
+      }
+      ++xx1;
+      if (xx1 > aaBuf->getWidth()) {
+	xx1 = aaBuf->getWidth();
+      }
+      // set [xx0, xx1) to 1
+      if (xx0 < xx1) {
+	xx = xx0;
+	p = aaBuf->getDataPtr() + yy * aaBuf->getRowSize() + (xx >> 3);
+	if (xx & 7) {
+	  mask = adjustVertLine ? 0xff : 0xff >> (xx & 7);
+	  if (!adjustVertLine && (xx & ~7) == (xx1 & ~7)) {
+	    mask &= (Guchar)(0xff00 >> (xx1 & 7));
 	  }
+	  *p++ |= mask;
+	  xx = (xx & ~7) + 8;
 	}
-	if (xx0 < xxMin) {
-	  xxMin = xx0;
+	for (; xx + 7 < xx1; xx += 8) {
+	  *p++ |= 0xff;
 	}
-	if (xx1 > xxMax) {
-	  xxMax = xx1;
+	if (xx < xx1) {
+	  *p |= adjustVertLine ? 0xff : (Guchar)(0xff00 >> (xx1 & 7));
 	}
       }
+      if (xx0 < xxMin) {
+	xxMin = xx0;
+      }
+      if (xx1 > xxMax) {
+	xxMax = xx1;
+      }
     }
   }
   if (xxMin > xxMax) {
@@ -460,65 +532,54 @@ void SplashXPathScanner::renderAALine(SplashBitmap *aaBuf,
 
 void SplashXPathScanner::clipAALine(SplashBitmap *aaBuf,
 				    int *x0, int *x1, int y) {
-  int xx0, xx1, xx, yy, interEnd;
+  SplashIntersect *line;
+  int nInter, xx0, xx1, xx, yy, i, count;
   Guchar mask;
   SplashColorPtr p;
 
   for (yy = 0; yy < splashAASize; ++yy) {
     xx = *x0 * splashAASize;
-    if (yMin <= yMax) {
-      if (splashAASize * y + yy < yMin) {
-	interIdx = interEnd = inter[0];
-      } else if (splashAASize * y + yy > yMax) {
-	interIdx = interEnd = inter[yMax - yMin + 1];
-      } else {
-	interIdx = inter[splashAASize * y + yy - yMin];
-	if (splashAASize * y + yy > yMax) {
-	  interEnd = inter[yMax - yMin + 1];
-	} else {
-	  interEnd = inter[splashAASize * y + yy - yMin + 1];
+    line = getIntersections(splashAASize * y + yy, &nInter);
+    count = 0;
+    i = 0;
+    while (i < nInter && xx < (*x1 + 1) * splashAASize) {
+      xx0 = line[i].x0;
+      xx1 = line[i].x1;
+      count += line[i].count;
+      ++i;
+      while (i < nInter &&
+	     (line[i].x0 <= xx1 ||
+	      (eo ? (count & 1) : (count != 0)))) {
+	if (line[i].x1 > xx1) {
+	  xx1 = line[i].x1;
 	}
+	count += line[i].count;
+	++i;
+      }
+      if (xx0 > aaBuf->getWidth()) {
+	xx0 = aaBuf->getWidth();
       }
-      interCount = 0;
-      while (interIdx < interEnd && xx < (*x1 + 1) * splashAASize) {
-	xx0 = allInter[interIdx].x0;
-	xx1 = allInter[interIdx].x1;
-	interCount += allInter[interIdx].count;
-	++interIdx;
-	while (interIdx < interEnd &&
-	       (allInter[interIdx].x0 <= xx1 ||
-		(eo ? (interCount & 1) : (interCount != 0)))) {
-	  if (allInter[interIdx].x1 > xx1) {
-	    xx1 = allInter[interIdx].x1;
+      // set [xx, xx0) to 0
+      if (xx < xx0) {
+	p = aaBuf->getDataPtr() + yy * aaBuf->getRowSize() + (xx >> 3);
+	if (xx & 7) {
+	  mask = (Guchar)(0xff00 >> (xx & 7));
+	  if ((xx & ~7) == (xx0 & ~7)) {
+	    mask |= 0xff >> (xx0 & 7);
 	  }
-	  interCount += allInter[interIdx].count;
-	  ++interIdx;
+	  *p++ &= mask;
+	  xx = (xx & ~7) + 8;
 	}
-	if (xx0 > aaBuf->getWidth()) {
-	  xx0 = aaBuf->getWidth();
+	for (; xx + 7 < xx0; xx += 8) {
+	  *p++ = 0x00;
 	}
-	// set [xx, xx0) to 0
 	if (xx < xx0) {
-	  p = aaBuf->getDataPtr() + yy * aaBuf->getRowSize() + (xx >> 3);
-	  if (xx & 7) {
-	    mask = (Guchar)(0xff00 >> (xx & 7));
-	    if ((xx & ~7) == (xx0 & ~7)) {
-	      mask |= 0xff >> (xx0 & 7);
-	    }
-	    *p++ &= mask;
-	    xx = (xx & ~7) + 8;
-	  }
-	  for (; xx + 7 < xx0; xx += 8) {
-	    *p++ = 0x00;
-	  }
-	  if (xx < xx0) {
-	    *p &= 0xff >> (xx0 & 7);
-	  }
-	}
-	if (xx1 >= xx) {
-	  xx = xx1 + 1;
+	  *p &= 0xff >> (xx0 & 7);
 	}
       }
+      if (xx1 >= xx) {
+	xx = xx1 + 1;
+      }
     }
     xx0 = (*x1 + 1) * splashAASize;
     if (xx0 > aaBuf->getWidth()) xx0 = aaBuf->getWidth();
@@ -542,3 +603,234 @@ void SplashXPathScanner::clipAALine(SplashBitmap *aaBuf,
     }
   }
 }
+
+// The analytic renderer accumulates, for each segment crossing the
+// line, the signed area it contributes to each cell (as in the
+// libart / font-rs sparse scanline rasterizers).  A running sum along
+// the line then gives the winding-weighted area covered in each
+// pixel.
+
+void SplashXPathScanner::renderAALineAnalytic(Guchar *line, int width,
+					      int *x0, int *x1, int y) {
+  SplashXPathSeg *seg;
+  SplashCoord yTop, yBot, segYMin, segYMax, segXMin, segXMax;
+  SplashCoord ya, yb, xa, xb, d, acc, c;
+  int xLast, x, i, j;
+
+  *x0 = 0;
+  *x1 = -1;
+  if (width <= 0 || xPath->length == 0) {
+    return;
+  }
+  if (covAccSize < width + 2) {
+    gfree(covAcc);
+    covAccSize = width + 2;
+    covAcc = (SplashCoord *)gmallocn(covAccSize, sizeof(SplashCoord));
+    for (x = 0; x < covAccSize; ++x) {
+      covAcc[x] = 0;
+    }
+  }
+
+  // restart the active segment list when going backward
+  if (y <= covY) {
+    covNextSeg = 0;
+    covActiveLen = 0;
+  }
+  covY = y;
+
+  // the path is in splashAASize-scaled coordinates
+  yTop = (SplashCoord)(y * splashAASize);
+  yBot = (SplashCoord)((y + 1) * splashAASize);
+
+  // add the segments which start above the bottom of this line (the
+  // segments are sorted by their top y coordinate)
+  while (covNextSeg < xPath->length) {
+    seg = &xPath->segs[covNextSeg];
+    segYMin = (seg->flags & splashXPathFlip) ? seg->y1 : seg->y0;
+    if (segYMin >= yBot) {
+      break;
+    }
+    if (covActiveLen == covActiveSize) {
+      covActiveSize = covActiveSize ? 2 * covActiveSize : 16;
+      covActive = (int *)greallocn(covActive, covActiveSize, sizeof(int));
+    }
+    covActive[covActiveLen++] = covNextSeg++;
+  }
+
+  // accumulate the area of the segments crossing this line, and drop
+  // the ones which end above it
+  covXMin = width + 1;
+  covXMax = -1;
+  for (i = j = 0; i < covActiveLen; ++i) {
+    seg = &xPath->segs[covActive[i]];
+    if (seg->flags & splashXPathFlip) {
+      segYMin = seg->y1;
+      segYMax = seg->y0;
+    } else {
+      segYMin = seg->y0;
+      segYMax = seg->y1;
+    }
+    if (segYMax <= yTop) {
+      continue;
+    }
+    covActive[j++] = covActive[i];
+    if (seg->flags & splashXPathHoriz) {
+      continue;
+    }
+    ya = segYMin > yTop ? segYMin : yTop;
+    yb = segYMax < yBot ? segYMax : yBot;
+    if (ya >= yb) {
+      continue;
+    }
+    if (seg->flags & splashXPathVert) {
+      xa = xb = seg->x0;
+    } else {
+      if (seg->x0 < seg->x1) {
+	segXMin = seg->x0;
+	segXMax = seg->x1;
+      } else {
+	segXMin = seg->x1;
+	segXMax = seg->x0;
+      }
+      xa = seg->x0 + (ya - seg->y0) * seg->dxdy;
+      xb = seg->x0 + (yb - seg->y0) * seg->dxdy;
+      // the segment may not actually extend to the top and/or bottom
+      // edges
+      if (xa < segXMin) {
+	xa = segXMin;
+      } else if (xa > segXMax) {
+	xa = segXMax;
+      }
+      if (xb < segXMin) {
+	xb = segXMin;
+      } else if (xb > segXMax) {
+	xb = segXMax;
+      }
+    }
+    // d is the signed height of the segment within the line, in pixels
+    d = (yb - ya) / splashAASize;
+    if (seg->flags & splashXPathFlip) {
+      d = -d;
+    }
+    if (xa < xb) {
+      addCoverage(xa / splashAASize, xb / splashAASize, d, width);
+    } else {
+      addCoverage(xb / splashAASize, xa / splashAASize, d, width);
+    }
+  }
+  covActiveLen = j;
+  if (covXMin > covXMax) {
+    return;
+  }
+
+  // sum the cells to get the coverage
+  xLast = covXMax < width ? covXMax : width - 1;
+  acc = 0;
+  for (x = covXMin; x <= xLast; ++x) {
+    acc += covAcc[x];
+    covAcc[x] = 0;
+    c = acc < 0 ? -acc : acc;
+    if (eo) {
+      c -= 2 * splashFloor(c / 2);
+      if (c > 1) {
+	c = 2 - c;
+      }
+    } else if (c > 1) {
+      c = 1;
+    }
+    line[x] = (Guchar)splashRound(c * 255);
+  }
+  for (; x <= covXMax; ++x) {
+    covAcc[x] = 0;
+  }
+
+  // trim the zero pixels at both ends
+  *x0 = covXMin;
+  *x1 = xLast;
+  while (*x0 <= *x1 && !line[*x0]) {
+    ++*x0;
+  }
+  while (*x1 >= *x0 && !line[*x1]) {
+    --*x1;
+  }
+}
+
+// Add the area contributed by a line segment which crosses the
+// current line with signed height <d>, going from <xa> to <xb>
+// (xa <= xb, in pixels).  Only pixels [0, <width> - 1] are needed:
+// the parts of the segment left of the line contribute as a vertical
+// edge at x = 0, and the parts right of it can be dropped.
+void SplashXPathScanner::addCoverage(SplashCoord xa, SplashCoord xb,
+				     SplashCoord d, int width) {
+  SplashCoord dLeft, dRight;
+
+  if (xb <= 0) {
+    accumulateCoverage(0, 0, d);
+    return;
+  }
+  if (xa >= width) {
+    return;
+  }
+  dLeft = dRight = 0;
+  if (xa < 0) {
+    dLeft = d * (-xa / (xb - xa));
+    accumulateCoverage(0, 0, dLeft);
+  }
+  if (xb > width) {
+    dRight = d * ((xb - width) / (xb - xa));
+  }
+  accumulateCoverage(xa < 0 ? 0 : xa, xb > width ? width : xb,
+		     d - dLeft - dRight);
+}
+
+// Add the area contributed by a line segment from <xa> to <xb>
+// (0 <= xa <= xb <= width) with signed height <d> to the cells.
+void SplashXPathScanner::accumulateCoverage(SplashCoord xa, SplashCoord xb,
+					    SplashCoord d) {
+  SplashCoord xaf, xbf, s, a0, a1, a2, am, xmf;
+  int xai, xbi, x;
+
+  xai = splashFloor(xa);
+  xbi = splashCeil(xb);
+  if (xbi <= xai + 1) {
+    // within one pixel: split by the mean x position
+    xmf = (SplashCoord)0.5 * (xa + xb) - xai;
+    covAcc[xai] += d - d * xmf;
+    covAcc[xai + 1] += d * xmf;
+    if (xai < covXMin) {
+      covXMin = xai;
+    }
+    if (xai + 1 > covXMax) {
+      covXMax = xai + 1;
+    }
+    return;
+  }
+
+  // across several pixels: the area left of the segment grows
+  // quadratically in the first and last pixels, and linearly in
+  // between
+  s = 1 / (xb - xa);
+  xaf = xa - xai;
+  a0 = (SplashCoord)0.5 * s * (1 - xaf) * (1 - xaf);
+  xbf = xb - xbi + 1;
+  am = (SplashCoord)0.5 * s * xbf * xbf;
+  covAcc[xai] += d * a0;
+  if (xbi == xai + 2) {
+    covAcc[xai + 1] += d * (1 - a0 - am);
+  } else {
+    a1 = s * ((SplashCoord)1.5 - xaf);
+    covAcc[xai + 1] += d * (a1 - a0);
+    for (x = xai + 2; x < xbi - 1; ++x) {
+      covAcc[x] += d * s;
+    }
+    a2 = a1 + (xbi - xai - 3) * s;
+    covAcc[xbi - 1] += d * (1 - a2 - am);
+  }
+  covAcc[xbi] += d * am;
+  if (xai < covXMin) {
+    covXMin = xai;
+  }
+  if (xbi > covXMax) {
+    covXMax = xbi;
+  }
+}
@@ -29,6 +29,7 @@
 
 class SplashXPath;
 class SplashBitmap;
+struct SplashXPathSeg;
 struct SplashIntersect;
 
 //------------------------------------------------------------------------
@@ -39,6 +40,10 @@ class SplashXPathScanner {
 public:
 
   // Create a new SplashXPathScanner object.  <xPathA> must be sorted.
+  // The intersections are computed one line at a time, as the lines
+  // are requested, as long as the lines are visited in increasing y
+  // order.  The first time an earlier line is requested, the
+  // intersections for the whole path are computed and kept.
   SplashXPathScanner(SplashXPath *xPathA, GBool eoA,
 		     int clipYMin, int clipYMax);
 
@@ -82,9 +87,27 @@ public:
   // will update <x0> and <x1>.
   void clipAALine(SplashBitmap *aaBuf, int *x0, int *x1, int y);
 
+  // Renders one anti-aliased line using the exact area of each pixel
+  // covered by the path, rather than sub-sampling it as renderAALine
+  // does.  The coverage of pixel <x> (0 = none, 255 = full) is stored
+  // in <line>[<x>], for the pixels in [0, <width> - 1].  Returns the
+  // min and max x coordinates with non-zero pixels in <x0> and <x1>
+  // (<x0> > <x1> if there are none); <line> is only written between
+  // them.  The path must have been scaled with SplashXPath::aaScale,
+  // as for renderAALine.  Lines are cheapest to render in increasing
+  // <y> order.
+  void renderAALineAnalytic(Guchar *line, int width,
+			    int *x0, int *x1, int y);
+
 private:
 
+  SplashIntersect *getIntersections(int y, int *nInter);
   void computeIntersections();
+  void computeLineIntersections(int y);
+  GBool addSegIntersections(SplashXPathSeg *seg, int y0, int y1);
+  void addCoverage(SplashCoord xa, SplashCoord xb, SplashCoord d,
+		   int width);
+  void accumulateCoverage(SplashCoord xa, SplashCoord xb, SplashCoord d);
   GBool addIntersection(double segYMin, double segYMax,
 		       Guint segFlags,
 		       int y, int x0, int x1);
@@ -94,15 +117,35 @@ private:
   int xMin, yMin, xMax, yMax;
   GBool partialClip;
 
-  SplashIntersect *allInter;	// array of intersections
+  SplashIntersect *allInter;	// array of intersections: either for
+				//   all lines (if <inter> is set), or
+				//   for line <lineY>
   int allInterLen;		// number of intersections in <allInter>
   int allInterSize;		// size of the <allInter> array
   int *inter;			// indexes into <allInter> for each y value
+  int lineY;			// line whose intersections are in
+				//   <allInter> (if <inter> is not set)
+  int *active;			// indexes into xPath->segs of the
+				//   segments which may cross <lineY>
+  int activeLen;		// number of entries in <active>
+  int activeSize;		// size of the <active> array
+  int nextSeg;			// next segment to add to <active>
   int interY;			// current y value - used by getNextSpan
-  int interIdx;			// current index into <inter> - used by
-				//   getNextSpan 
+  int interIdx;			// current index into the intersections
+				//   at <interY> - used by getNextSpan
   int interCount;		// current EO/NZWN counter - used by
 				//   getNextSpan
+
+  // state for renderAALineAnalytic
+  SplashCoord *covAcc;		// signed area accumulated in each cell
+  int covAccSize;		// size of the <covAcc> array
+  int covXMin, covXMax;		// range of <covAcc> cells touched so far
+  int *covActive;		// indexes into xPath->segs of the
+				//   segments which may cross the line
+  int covActiveLen;		// number of entries in <covActive>
+  int covActiveSize;		// size of the <covActive> array
+  int covNextSeg;		// next segment to add to <covActive>
+  int covY;			// last line rendered
 };
 
 #endif
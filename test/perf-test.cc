@@ -58,6 +58,8 @@
 #include "SplashOutputDev.h"
 #include "TextOutputDev.h"
 #include "PDFDoc.h"
+#include "PDFDocFactory.h"
+#include "XRef.h"
 #include "Link.h"
 
 #ifdef _MSC_VER
@@ -126,6 +128,19 @@ static StrList *gArgsListRoot = NULL;
 #define LOAD_ONLY_ARG       "-loadonly"
 #define PAGE_ARG            "-page"
 #define TEXT_ARG            "-text"
+#define RECONSTRUCT_ARG     "-reconstruct"
+#define STREAMS_ARG         "-streams"
+#define BYTEWISE_ARG        "-bytewise"
+#define FILTER_ARG          "-filter"
+#define RAW_ARG             "-raw"
+#define PASSWORD_ARG        "-password"
+#define AA_MODE_ARG         "-aamode"
+#define REDUCE_IMAGES_ARG   "-reduceimages"
+#define JPX_THREADS_ARG     "-jpxthreads"
+#define IMAGE_CACHE_ARG     "-imagecache"
+#define FORM_CACHE_ARG      "-formcache"
+#define OBJ_CACHE_ARG       "-objcache"
+#define MMAP_ARG            "-mmap"
 
 /* Should we record timings? True if -timings command-line argument was given. */
 static bool gfTimings = false;
@@ -167,6 +182,64 @@ static bool gfSlowPreview = false;
 /* If true, we only dump the text, not render */
 static bool gfTextOnly = false;
 
+/* If true, we only time rebuilding the xref table by scanning the whole
+   file, the way damaged files are read, not render.
+   Controlled by -reconstruct command-line argument */
+static bool gfReconstruct = false;
+
+/* If true, we only time decoding every stream in the file, not render.
+   Timings are summed up per filter chain.
+   Controlled by -streams command-line argument */
+static bool gfStreams = false;
+
+/* If true, streams are decoded one getChar() at a time instead of in
+   blocks, to compare against the block reads.
+   Controlled by -bytewise command-line argument */
+static bool gfBytewise = false;
+
+/* If not NULL, -streams only decodes the streams that use this filter,
+   e.g. JBIG2Decode.
+   Controlled by -filter command-line argument */
+static char *   gFilterName = NULL;
+
+/* If true, -streams only reads the raw stream data, i.e. times the
+   decryption of encrypted files without the filters behind it.
+   Controlled by -raw command-line argument */
+static bool gfRaw = false;
+
+/* Owner or user password of encrypted files, for -streams.
+   Controlled by -password command-line argument */
+static char *   gPassword = NULL;
+
+/* How vector graphics are anti-aliased when rendering.
+   Controlled by -aamode supersample|analytic command-line argument */
+static SplashAAMode gAAMode = splashAASupersample;
+
+/* Should images drawn below their native size be decoded at a reduced
+   resolution? True if -reduceimages command-line argument was given. */
+static bool gfReducedImages = false;
+
+/* Number of threads which decode each JPEG 2000 image.
+   Controlled by -jpxthreads N command-line argument */
+static int gJPXThreads = 1;
+
+/* Memory in MB for caching decoded images across pages; 0 turns the
+   cache off.
+   Controlled by -imagecache N command-line argument */
+static int gImageCacheMB = 0;
+
+/* Memory in MB for caching parsed form XObjects; 0 turns the cache off.
+   Controlled by -formcache N command-line argument */
+static int gFormCacheMB = 0;
+
+/* Memory in MB for caching parsed PDF objects; 0 turns the cache off.
+   Controlled by -objcache N command-line argument */
+static int gObjCacheMB = 0;
+
+/* Should PDF files be memory-mapped instead of read through a file
+   buffer? True if -mmap command-line argument was given. */
+static bool gfMapFiles = false;
+
 #define PAGE_NO_NOT_GIVEN -1
 
 /* If equals PAGE_NO_NOT_GIVEN, we're in default mode where we render all pages.
@@ -326,6 +399,17 @@ void sleep_milliseconds(int milliseconds)
 #endif
 }
 
+/* GooTimer::getElapsed() returns milliseconds on Windows but seconds
+   everywhere else */
+double elapsed_milliseconds(GooTimer *timer)
+{
+#ifdef _WIN32
+    return timer->getElapsed();
+#else
+    return timer->getElapsed() * 1000.0;
+#endif
+}
+
 #ifndef HAVE_STRCPY_S
 void strcpy_s(char* dst, size_t dst_size, const char* src)
 {
@@ -414,14 +498,19 @@ PdfEnginePoppler::~PdfEnginePoppler()
     delete _pdfDoc;
 }
 
+/* Open a PDF file the way the poppler utilities do, so that -mmap
+   takes effect */
+static PDFDoc *OpenPdfDoc(const char *fileName, GooString *ownerPassword,
+                          GooString *userPassword)
+{
+    GooString fileNameStr(fileName);
+    return PDFDocFactory().createPDFDoc(fileNameStr, ownerPassword, userPassword);
+}
+
 bool PdfEnginePoppler::load(const char *fileName)
 {
     setFileName(fileName);
-    /* note: don't delete fileNameStr since PDFDoc takes ownership and deletes them itself */
-    GooString *fileNameStr = new GooString(fileName);
-    if (!fileNameStr) return false;
-
-    _pdfDoc = new PDFDoc(fileNameStr, NULL, NULL, (void*)NULL);
+    _pdfDoc = OpenPdfDoc(fileName, NULL, NULL);
     if (!_pdfDoc->isOk()) {
         return false;
     }
@@ -433,8 +522,11 @@ SplashOutputDev * PdfEnginePoppler::outputDevice() {
     if (!_outputDev) {
         GBool bitmapTopDown = gTrue;
         _outputDev = new SplashOutputDev(gSplashColorMode, 4, gFalse, gBgColor, bitmapTopDown);
-        if (_outputDev)
+        if (_outputDev) {
+            _outputDev->setVectorAntialiasMode(gAAMode);
+            _outputDev->setReducedImages(gfReducedImages);
             _outputDev->startDoc(_pdfDoc);
+        }
     }
     return _outputDev;
 }
@@ -814,7 +906,7 @@ void LogInfo(const char *fmt, ...)
 
 static void PrintUsageAndExit(int argc, char **argv)
 {
-    printf("Usage: pdftest [-preview|-slowpreview] [-loadonly] [-timings] [-text] [-resolution NxM] [-recursive] [-page N] [-out out.txt] pdf-files-to-process\n");
+    printf("Usage: pdftest [-preview|-slowpreview] [-loadonly] [-timings] [-text] [-reconstruct] [-streams [-bytewise] [-raw] [-filter name] [-password pw]] [-aamode supersample|analytic] [-reduceimages] [-jpxthreads N] [-imagecache MB] [-formcache MB] [-objcache MB] [-mmap] [-resolution NxM] [-recursive] [-page N] [-out out.txt] pdf-files-to-process\n");
     for (int i=0; i < argc; i++) {
         printf("i=%d, '%s'\n", i, argv[i]);
     }
@@ -830,7 +922,6 @@ static bool ShowPreview(void)
 
 static void RenderPdfAsText(const char *fileName)
 {
-    GooString *         fileNameStr = NULL;
     PDFDoc *            pdfDoc = NULL;
     GooString *         txt = NULL;
     int                 pageCount;
@@ -849,19 +940,14 @@ static void RenderPdfAsText(const char *fileName)
     }
 
     GooTimer msTimer;
-    /* note: don't delete fileNameStr since PDFDoc takes ownership and deletes them itself */
-    fileNameStr = new GooString(fileName);
-    if (!fileNameStr)
-        goto Exit;
-
-    pdfDoc = new PDFDoc(fileNameStr, NULL, NULL, NULL);
+    pdfDoc = OpenPdfDoc(fileName, NULL, NULL);
     if (!pdfDoc->isOk()) {
         error(errIO, -1, "RenderPdfFile(): failed to open PDF file {0:s}\n", fileName);
         goto Exit;
     }
 
     msTimer.stop();
-    timeInMs = msTimer.getElapsed();
+    timeInMs = elapsed_milliseconds(&msTimer);
     LogInfo("load: %.2f ms\n", timeInMs);
 
     pageCount = pdfDoc->getNumPages();
@@ -879,7 +965,7 @@ static void RenderPdfAsText(const char *fileName)
         pdfDoc->displayPage(textOut, curPage, 72, 72, rotate, useMediaBox, crop, doLinks);
         txt = textOut->getText(0.0, 0.0, 10000.0, 10000.0);
         msTimer.stop();
-        timeInMs = msTimer.getElapsed();
+        timeInMs = elapsed_milliseconds(&msTimer);
         if (gfTimings)
             LogInfo("page %d: %.2f ms\n", curPage, timeInMs);
         printf("%s\n", txt->getCString());
@@ -923,7 +1009,7 @@ static void RenderPdf(const char *fileName)
         goto Error;
     }
     msTimer.stop();
-    timeInMs = msTimer.getElapsed();
+    timeInMs = elapsed_milliseconds(&msTimer);
     LogInfo("load splash: %.2f ms\n", timeInMs);
     pageCount = engineSplash->pageCount();
 
@@ -940,7 +1026,7 @@ static void RenderPdf(const char *fileName)
         GooTimer msTimer;
         bmpSplash = engineSplash->renderBitmap(curPage, 100.0, 0);
         msTimer.stop();
-        double timeInMs = msTimer.getElapsed();
+        double timeInMs = elapsed_milliseconds(&msTimer);
         if (gfTimings) {
             if (!bmpSplash)
                 LogInfo("page splash %d: failed to render\n", curPage);
@@ -960,8 +1046,220 @@ Error:
     LogInfo("finished: %s\n", fileName);
 }
 
+static void ReconstructPdfXRef(const char *fileName)
+{
+    PDFDoc *            pdfDoc = NULL;
+    XRef *              xref = NULL;
+    GBool               wasReconstructed = gFalse;
+    double              timeInMs;
+
+    assert(fileName);
+    if (!fileName)
+        return;
+
+    LogInfo("started: %s\n", fileName);
+
+    pdfDoc = OpenPdfDoc(fileName, NULL, NULL);
+    if (!pdfDoc->isOk()) {
+        error(errIO, -1, "ReconstructPdfXRef(): failed to open PDF file {0:s}\n", fileName);
+        goto Exit;
+    }
+
+    {
+        GooTimer msTimer;
+        xref = new XRef(pdfDoc->getBaseStream(), 0, 0, &wasReconstructed, gTrue);
+        msTimer.stop();
+        timeInMs = elapsed_milliseconds(&msTimer);
+    }
+    LogInfo("reconstruct: %.2f ms, %d objects%s\n", timeInMs,
+            xref->getNumObjects(), xref->isOk() ? "" : " (failed)");
+
+Exit:
+    LogInfo("finished: %s\n", fileName);
+    delete xref;
+    delete pdfDoc;
+}
+
+/* Decoding statistics of all the streams that use the same filters */
+typedef struct StreamStats {
+    struct StreamStats *next;
+    char *          filters;
+    int             count;
+    long long       bytes;
+    double          timeInMs;
+} StreamStats;
+
+static StreamStats *StreamStats_Find(StreamStats **root, const char *filters)
+{
+    StreamStats *stats;
+
+    for (stats = *root; stats; stats = stats->next) {
+        if (str_eq(stats->filters, filters))
+            return stats;
+    }
+    stats = (StreamStats*)zmalloc(sizeof(StreamStats));
+    if (!stats)
+        return NULL;
+    stats->filters = str_dup(filters);
+    stats->next = *root;
+    *root = stats;
+    return stats;
+}
+
+static void StreamStats_Destroy(StreamStats **root)
+{
+    StreamStats *stats;
+
+    while (*root) {
+        stats = *root;
+        *root = stats->next;
+        free(stats->filters);
+        free(stats);
+    }
+}
+
+/* Put the names of the filters of a stream dictionary in <filters>,
+   e.g. "FlateDecode DCTDecode", or "none" */
+static void GetStreamFilters(Dict *dict, char *filters, size_t filtersSize)
+{
+    Object obj, obj2;
+
+    strcpy_s(filters, filtersSize, "none");
+    dict->lookup("Filter", &obj);
+    if (obj.isName()) {
+        strcpy_s(filters, filtersSize, obj.getName());
+    } else if (obj.isArray() && obj.arrayGetLength() > 0) {
+        filters[0] = 0;
+        for (int i = 0; i < obj.arrayGetLength(); i++) {
+            obj.arrayGet(i, &obj2);
+            if (i > 0)
+                strcat_s(filters, filtersSize, " ");
+            strcat_s(filters, filtersSize, obj2.isName() ? obj2.getName() : "?");
+            obj2.free();
+        }
+    }
+    obj.free();
+}
+
+/* Return true if <name> is one of the space-separated <filters> */
+static bool HasFilter(const char *filters, const char *name)
+{
+    size_t nameLen = strlen(name);
+    const char *p = filters;
+
+    while ((p = strstr(p, name))) {
+        if ((p == filters || p[-1] == ' ') && (p[nameLen] == 0 || p[nameLen] == ' '))
+            return true;
+        p += nameLen;
+    }
+    return false;
+}
+
+/* Decode <str> to the end and return the number of bytes it produced */
+static long long DecodeStream(Stream *str)
+{
+    Guchar      buf[65536];
+    long long   bytes = 0;
+    int         n;
+
+    str->reset();
+    if (gfBytewise) {
+        while (str->getChar() != EOF)
+            ++bytes;
+    } else {
+        while ((n = str->doGetChars(sizeof(buf), buf)) > 0)
+            bytes += n;
+    }
+    str->close();
+    return bytes;
+}
+
+static void DecodePdfStreams(const char *fileName)
+{
+    PDFDoc *            pdfDoc = NULL;
+    XRef *              xref;
+    XRefEntry *         entry;
+    StreamStats *       statsRoot = NULL;
+    StreamStats *       stats;
+    Object              obj;
+    char                filters[256];
+    int                 count = 0;
+    long long           bytes = 0, streamBytes;
+    double              timeInMs = 0, streamTimeInMs;
+
+    assert(fileName);
+    if (!fileName)
+        return;
+
+    LogInfo("started: %s\n", fileName);
+
+    if (gPassword) {
+        GooString ownerPassword(gPassword), userPassword(gPassword);
+        pdfDoc = OpenPdfDoc(fileName, &ownerPassword, &userPassword);
+    } else {
+        pdfDoc = OpenPdfDoc(fileName, NULL, NULL);
+    }
+    if (!pdfDoc->isOk()) {
+        error(errIO, -1, "DecodePdfStreams(): failed to open PDF file {0:s}\n", fileName);
+        goto Exit;
+    }
+
+    xref = pdfDoc->getXRef();
+    for (int num = 1; num < xref->getNumObjects(); num++) {
+        entry = xref->getEntry(num, gFalse);
+        if (entry->type == xrefEntryFree)
+            continue;
+        xref->fetch(num, entry->type == xrefEntryCompressed ? 0 : entry->gen, &obj);
+        if (obj.isStream()) {
+            GetStreamFilters(obj.streamGetDict(), filters, sizeof(filters));
+            if (gFilterName && !HasFilter(filters, gFilterName)) {
+                obj.free();
+                continue;
+            }
+            GooTimer msTimer;
+            if (gfRaw)
+                streamBytes = DecodeStream(obj.getStream()->getUndecodedStream());
+            else
+                streamBytes = DecodeStream(obj.getStream());
+            msTimer.stop();
+            streamTimeInMs = elapsed_milliseconds(&msTimer);
+            stats = StreamStats_Find(&statsRoot, filters);
+            if (stats) {
+                stats->count++;
+                stats->bytes += streamBytes;
+                stats->timeInMs += streamTimeInMs;
+            }
+            count++;
+            bytes += streamBytes;
+            timeInMs += streamTimeInMs;
+        }
+        obj.free();
+    }
+
+    for (stats = statsRoot; stats; stats = stats->next) {
+        LogInfo("%s: %d streams, %lld bytes, %.2f ms\n", stats->filters,
+                stats->count, stats->bytes, stats->timeInMs);
+    }
+    LogInfo("streams: %d streams, %lld bytes, %.2f ms\n", count, bytes, timeInMs);
+
+Exit:
+    LogInfo("finished: %s\n", fileName);
+    StreamStats_Destroy(&statsRoot);
+    delete pdfDoc;
+}
+
 static void RenderFile(const char *fileName)
 {
+    if (gfReconstruct) {
+        ReconstructPdfXRef(fileName);
+        return;
+    }
+
+    if (gfStreams) {
+        DecodePdfStreams(fileName);
+        return;
+    }
+
     if (gfTextOnly) {
         RenderPdfAsText(fileName);
         return;
@@ -1061,6 +1359,73 @@ static void ParseCommandLine(int argc, char **argv)
                 gfPreview = true;
             } else if (str_ieq(arg, TEXT_ARG)) {
                 gfTextOnly = true;
+            } else if (str_ieq(arg, RECONSTRUCT_ARG)) {
+                gfReconstruct = true;
+            } else if (str_ieq(arg, STREAMS_ARG)) {
+                gfStreams = true;
+            } else if (str_ieq(arg, BYTEWISE_ARG)) {
+                gfBytewise = true;
+            } else if (str_ieq(arg, FILTER_ARG)) {
+                /* expect a filter name after that */
+                ++i;
+                if (i == argc)
+                    PrintUsageAndExit(argc, argv);
+                gFilterName = str_dup(argv[i]);
+            } else if (str_ieq(arg, AA_MODE_ARG)) {
+                /* expect supersample or analytic after that */
+                ++i;
+                if (i == argc)
+                    PrintUsageAndExit(argc, argv);
+                if (str_ieq(argv[i], "supersample"))
+                    gAAMode = splashAASupersample;
+                else if (str_ieq(argv[i], "analytic"))
+                    gAAMode = splashAAAnalytic;
+                else
+                    PrintUsageAndExit(argc, argv);
+            } else if (str_ieq(arg, MMAP_ARG)) {
+                gfMapFiles = true;
+            } else if (str_ieq(arg, REDUCE_IMAGES_ARG)) {
+                gfReducedImages = true;
+            } else if (str_ieq(arg, JPX_THREADS_ARG)) {
+                /* expect a number of threads after that */
+                ++i;
+                if (i == argc)
+                    PrintUsageAndExit(argc, argv);
+                gJPXThreads = atoi(argv[i]);
+                if (gJPXThreads < 1)
+                    PrintUsageAndExit(argc, argv);
+            } else if (str_ieq(arg, IMAGE_CACHE_ARG)) {
+                /* expect a size in MB after that */
+                ++i;
+                if (i == argc)
+                    PrintUsageAndExit(argc, argv);
+                gImageCacheMB = atoi(argv[i]);
+                if (gImageCacheMB < 0)
+                    PrintUsageAndExit(argc, argv);
+            } else if (str_ieq(arg, FORM_CACHE_ARG)) {
+                /* expect a size in MB after that */
+                ++i;
+                if (i == argc)
+                    PrintUsageAndExit(argc, argv);
+                gFormCacheMB = atoi(argv[i]);
+                if (gFormCacheMB < 0)
+                    PrintUsageAndExit(argc, argv);
+            } else if (str_ieq(arg, OBJ_CACHE_ARG)) {
+                /* expect a size in MB after that */
+                ++i;
+                if (i == argc)
+                    PrintUsageAndExit(argc, argv);
+                gObjCacheMB = atoi(argv[i]);
+                if (gObjCacheMB < 0)
+                    PrintUsageAndExit(argc, argv);
+            } else if (str_ieq(arg, RAW_ARG)) {
+                gfRaw = true;
+            } else if (str_ieq(arg, PASSWORD_ARG)) {
+                /* expect a password after that */
+                ++i;
+                if (i == argc)
+                    PrintUsageAndExit(argc, argv);
+                gPassword = str_dup(argv[i]);
             } else if (str_ieq(arg, SLOW_PREVIEW_ARG)) {
                 gfSlowPreview = true;
             } else if (str_ieq(arg, LOAD_ONLY_ARG)) {
@@ -1244,6 +1609,11 @@ int main(int argc, char **argv)
     if (!globalParams)
         return 1;
     globalParams->setErrQuiet(gFalse);
+    globalParams->setJPXDecodeThreads(gJPXThreads);
+    globalParams->setDecodedImageCacheSize((Goffset)gImageCacheMB << 20);
+    globalParams->setFormCacheSize((Goffset)gFormCacheMB << 20);
+    globalParams->setFetchCacheSize((Goffset)gObjCacheMB << 20);
+    globalParams->setMapLocalFiles(gfMapFiles);
 
     FILE * outFile = NULL;
     if (gOutFileName) {
@@ -1275,6 +1645,8 @@ int main(int argc, char **argv)
     StrList_Destroy(&gArgsListRoot);
     delete globalParams;
     free(gOutFileName);
+    free(gFilterName);
+    free(gPassword);
     return 0;
 }
 
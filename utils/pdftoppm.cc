@@ -95,6 +95,15 @@ static char antialiasStr[16] = "";
 static char vectorAntialiasStr[16] = "";
 static GBool fontAntialias = gTrue;
 static GBool vectorAntialias = gTrue;
+static char vectorAntialiasModeStr[16] = "";
+static SplashAAMode vectorAntialiasMode = splashAASupersample;
+static int rasterThreads = 1;
+static int jpxThreads = 1;
+static GBool reducedImages = gFalse;
+static int imageCacheMB = 0;
+static int formCacheMB = 0;
+static int objCacheMB = 0;
+static GBool mapFile = gFalse;
 static char ownerPassword[33] = "";
 static char userPassword[33] = "";
 static char TiffCompressionStr[16] = "";
@@ -182,6 +191,22 @@ static const ArgDesc argDesc[] = {
    "enable font anti-aliasing: yes, no"},
   {"-aaVector",   argString,      vectorAntialiasStr, sizeof(vectorAntialiasStr),
    "enable vector anti-aliasing: yes, no"},
+  {"-aaVectorMode", argString,    vectorAntialiasModeStr, sizeof(vectorAntialiasModeStr),
+   "vector anti-aliasing method: supersample, analytic. Default: supersample"},
+  {"-threads",    argInt,         &rasterThreads, 0,
+   "number of threads to rasterize each page with"},
+  {"-jpxthreads", argInt,         &jpxThreads,    0,
+   "number of threads to decode each JPEG 2000 image with"},
+  {"-reduceimages", argFlag,      &reducedImages, 0,
+   "decode JPEG and JPEG 2000 images drawn below their native size at a reduced resolution"},
+  {"-imagecache", argInt,         &imageCacheMB,  0,
+   "memory in MB for caching decoded images across pages. Default: 0 (off)"},
+  {"-formcache",  argInt,         &formCacheMB,   0,
+   "memory in MB for caching parsed form XObjects. Default: 0 (off)"},
+  {"-objcache",   argInt,         &objCacheMB,    0,
+   "memory in MB for caching parsed PDF objects. Default: 0 (off)"},
+  {"-mmap",       argFlag,        &mapFile,       0,
+   "memory-map the PDF file instead of reading it through a file buffer"},
   
   {"-opw",    argString,   ownerPassword,  sizeof(ownerPassword),
    "owner password (for encrypted files)"},
@@ -294,6 +319,9 @@ static void processPageJobs() {
 		              splashModeRGB8, 4, gFalse, *pageJob.paperColor, gTrue, thinLineMode);
     splashOut->setFontAntialias(fontAntialias);
     splashOut->setVectorAntialias(vectorAntialias);
+    splashOut->setVectorAntialiasMode(vectorAntialiasMode);
+    splashOut->setRasterThreads(rasterThreads);
+    splashOut->setReducedImages(reducedImages);
     splashOut->startDoc(pageJob.doc);
     
     savePageSlice(pageJob.doc, splashOut, pageJob.pg, x, y, w, h, pageJob.pg_w, pageJob.pg_h, pageJob.ppmFile);
@@ -371,6 +399,13 @@ int main(int argc, char *argv[]) {
       fprintf(stderr, "Bad '-aaVector' value on command line\n");
     }
   }
+  if (vectorAntialiasModeStr[0]) {
+    if (strcmp(vectorAntialiasModeStr, "analytic") == 0) {
+      vectorAntialiasMode = splashAAAnalytic;
+    } else if (strcmp(vectorAntialiasModeStr, "supersample") != 0) {
+      fprintf(stderr, "Bad '-aaVectorMode' value on command line\n");
+    }
+  }
 
   // read config file
   globalParams = new GlobalParams();
@@ -391,6 +426,21 @@ int main(int argc, char *argv[]) {
   if (quiet) {
     globalParams->setErrQuiet(quiet);
   }
+  if (jpxThreads > 1) {
+    globalParams->setJPXDecodeThreads(jpxThreads);
+  }
+  if (imageCacheMB > 0) {
+    globalParams->setDecodedImageCacheSize((Goffset)imageCacheMB << 20);
+  }
+  if (formCacheMB > 0) {
+    globalParams->setFormCacheSize((Goffset)formCacheMB << 20);
+  }
+  if (objCacheMB > 0) {
+    globalParams->setFetchCacheSize((Goffset)objCacheMB << 20);
+  }
+  if (mapFile) {
+    globalParams->setMapLocalFiles(mapFile);
+  }
 
   // open PDF file
   if (ownerPassword[0]) {
@@ -476,6 +526,9 @@ int main(int argc, char *argv[]) {
 
   splashOut->setFontAntialias(fontAntialias);
   splashOut->setVectorAntialias(vectorAntialias);
+  splashOut->setVectorAntialiasMode(vectorAntialiasMode);
+  splashOut->setRasterThreads(rasterThreads);
+  splashOut->setReducedImages(reducedImages);
   splashOut->startDoc(doc);
   
 #endif // UTILS_USE_PTHREADS